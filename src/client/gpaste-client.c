@@ -20,8 +20,11 @@
 #include <gpaste-client.h>
 #include <gpaste-util.h>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <unistd.h>
 
 typedef struct {
     GPasteClient *client;
@@ -99,20 +102,88 @@ parse_cmdline (int     *argc,
     return TRUE;
 }
 
+#define CHUNK_SIZE (64 * 1024)
+
 static gchar *
 extract_pipe_data (void)
 {
     if (isatty (STDIN_FILENO))
         return NULL; /* We're not being piped */
 
-    g_autoptr (GString) data = g_string_new (NULL);
-    gint64 c;
+    GString *data = g_string_sized_new (CHUNK_SIZE);
+    gssize length;
+
+    do
+    {
+        guint64 offset = data->len;
+
+        g_string_set_size (data, offset + CHUNK_SIZE);
+        length = read (STDIN_FILENO, data->str + offset, CHUNK_SIZE);
+        g_string_truncate (data, offset + MAX (length, 0));
+    } while (length > 0 || (length < 0 && errno == EINTR));
+
+    return g_string_free (data, FALSE);
+}
+
+/* Only read what's piped to us if we need it: it may be handed over to the daemon as is */
+static const gchar *
+get_pipe_data (Context *ctx)
+{
+    if (!ctx->pipe_data)
+        ctx->pipe_data = extract_pipe_data ();
+
+    return ctx->pipe_data;
+}
+
+static gboolean
+copy_fd (gint in,
+         gint out)
+{
+    gchar buffer[CHUNK_SIZE];
+    gssize length;
+
+    while ((length = read (in, buffer, CHUNK_SIZE)) != 0)
+    {
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+
+        for (const gchar *data = buffer; length;)
+        {
+            gssize written = write (out, data, length);
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return FALSE;
+            }
 
-    while ((c = fgetc (stdin)) != EOF)
-        data = g_string_append_c (data, (guchar)c);
-    g_string_append_c (data, '\0');
+            data += written;
+            length -= written;
+        }
+    }
 
-    return g_strdup (data->str);
+    return TRUE;
+}
+
+/* Let the daemon read the contents itself, returns FALSE if it's too old to do so */
+static gboolean
+add_fd (Context *ctx,
+        gint     fd,
+        GError **error)
+{
+    g_paste_client_add_fd_sync (ctx->client, fd, error);
+
+    if (!g_error_matches (*error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+        return TRUE;
+
+    g_clear_error (error);
+
+    return FALSE;
 }
 
 static const gchar *
@@ -176,6 +247,8 @@ show_help (void)
     printf ("  %s delete-history <%s>: %s\n", progname, _("name"),  _("delete a history"));
     /* Translators: help for gpaste list-histories */
     printf ("  %s list-histories: %s\n", progname, _("list available histories"));
+    /* Translators: help for gpaste search-all <pattern> */
+    printf ("  %s search-all <%s>: %s\n", progname, _("pattern"), _("search all the histories for items matching <pattern>"));
     /* Translators: help for gpaste add <text> */
     printf ("  %s add <%s>: %s\n", progname, _("text"), _("set text to clipboard"));
     /* Translators: help for gpaste add-password <name> <text> */
@@ -478,10 +551,18 @@ static gint
 g_paste_add (Context *ctx,
              GError **error)
 {
-    const gchar *data = (ctx->argc > 0) ? ctx->args[0] : ctx->pipe_data;
+    const gchar *data = (ctx->argc > 0) ? ctx->args[0] : NULL;
 
     if (!data)
-        return -1;
+    {
+        if (isatty (STDIN_FILENO))
+            return -1;
+
+        if (add_fd (ctx, STDIN_FILENO, error))
+            return (*error) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        data = get_pipe_data (ctx);
+    }
 
     g_paste_client_add_sync (ctx->client, data, error);
 
@@ -492,7 +573,7 @@ static gint
 g_paste_add_password (Context *ctx,
                       GError **error)
 {
-    const gchar *data = (ctx->argc > 1) ? ctx->args[1] : ctx->pipe_data;
+    const gchar *data = (ctx->argc > 1) ? ctx->args[1] : get_pipe_data (ctx);
 
     if (!data)
         return EXIT_FAILURE;
@@ -547,6 +628,19 @@ static gint
 g_paste_file (Context *ctx,
               GError **error)
 {
+    gint fd = open (ctx->args[0], O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        gboolean added = add_fd (ctx, fd, error);
+
+        close (fd);
+
+        if (added)
+            return (*error) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    /* Let the daemon tell what's wrong with the file, if anything */
     g_paste_client_add_file_sync (ctx->client, ctx->args[0], error);
 
     return (*error) ? EXIT_FAILURE : EXIT_SUCCESS;
@@ -556,6 +650,26 @@ static gint
 g_paste_get (Context *ctx,
              GError **error)
 {
+    if (ctx->raw)
+    {
+        gint fd = g_paste_client_get_raw_element_fd_sync (ctx->client, _strtoull (ctx->args[0]), error);
+
+        if (fd >= 0)
+        {
+            gboolean copied = copy_fd (fd, STDOUT_FILENO);
+
+            close (fd);
+
+            return (copied) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        /* Older daemons can only send it inline */
+        if (!g_error_matches (*error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+            return EXIT_FAILURE;
+
+        g_clear_error (error);
+    }
+
     const gchar *value = (!ctx->raw) ?
         g_paste_client_get_element_sync (ctx->client, _strtoull (ctx->args[0]), error) :
         g_paste_client_get_raw_element_sync (ctx->client, _strtoull (ctx->args[0]), error);
@@ -572,7 +686,7 @@ static gint
 g_paste_replace (Context *ctx,
                  GError **error)
 {
-    const gchar *data = (ctx->argc > 1) ? ctx->args[1] : ctx->pipe_data;
+    const gchar *data = (ctx->argc > 1) ? ctx->args[1] : get_pipe_data (ctx);
 
     if (!data)
         return EXIT_FAILURE;
@@ -610,6 +724,37 @@ g_paste_search (Context *ctx,
     return EXIT_SUCCESS;
 }
 
+static gint
+g_paste_search_all (Context *ctx,
+                    GError **error)
+{
+    g_autoptr (GVariant) results = g_paste_client_search_all_sync (ctx->client, ctx->args[0], error);
+
+    if (*error)
+        return EXIT_FAILURE;
+
+    GVariantIter histories;
+    GVariantIter *matches;
+    const gchar *name;
+
+    g_variant_iter_init (&histories, results);
+
+    while (g_variant_iter_loop (&histories, "(&sa(ts))", &name, &matches))
+    {
+        const gchar *snippet;
+        guint64 index;
+
+        while (g_variant_iter_loop (matches, "(t&s)", &index, &snippet))
+        {
+            if (!ctx->raw)
+                printf ("%s:%" G_GUINT64_FORMAT ": ", name, index);
+            printf ("%s%c", snippet, (ctx->zero) ? '\0' : '\n');
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
 static gint
 g_paste_select (Context *ctx,
                 GError **error)
@@ -742,6 +887,8 @@ g_paste_dispatch (gint         argc,
         { 2, "get",             0,        TRUE,  g_paste_get             },
         { 2, "replace",         1,        TRUE,  g_paste_replace         },
         { 2, "search",          0,        TRUE,  g_paste_search          },
+        { 2, "sa",              0,        TRUE,  g_paste_search_all      },
+        { 2, "search-all",      0,        TRUE,  g_paste_search_all      },
         { 2, "s",               0,        TRUE,  g_paste_select          },
         { 2, "set",             0,        TRUE,  g_paste_select          },
         { 2, "select",          0,        TRUE,  g_paste_select          },
@@ -794,9 +941,9 @@ main (gint argc, gchar *argv[])
     if (parse_cmdline (&argc, &argv, &ctx))
     {
         g_autoptr (GPasteClient) client = ctx.client = g_paste_client_new_sync (&error);
-        g_autofree gchar *pipe_data = ctx.pipe_data = extract_pipe_data ();
 
         status = g_paste_dispatch (argc, (argc > 0) ? argv[0] : NULL, &ctx, &error);
+        g_free (ctx.pipe_data);
     }
     else
     {
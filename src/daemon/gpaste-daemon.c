@@ -21,6 +21,8 @@
 #include <gpaste-daemon.h>
 #include <gpaste-search-provider.h>
 
+#include <unistd.h>
+
 static GApplication *_app;
 
 enum
@@ -91,13 +93,28 @@ on_bus_acquired (GPasteBus *bus,
 }
 
 static void
-reexec (GPasteDaemon *g_paste_daemon G_GNUC_UNUSED,
+reexec (GPasteDaemon *g_paste_daemon,
         gpointer      user_data)
 {
     GApplication *app = user_data;
+    gint fd = g_paste_daemon_hand_off (g_paste_daemon);
+
+    if (fd >= 0)
+    {
+        g_autofree gchar *handoff = g_strdup_printf ("%d", fd);
+
+        g_setenv (G_PASTE_DAEMON_HANDOFF_FD_ENV, handoff, TRUE);
+    }
 
     g_application_quit (app);
     execl (PKGLIBEXECDIR "/gpaste-daemon", "gpaste-daemon", NULL);
+
+    /* We're still there, don't leak the history to whatever we spawn next */
+    if (fd >= 0)
+    {
+        close (fd);
+        g_unsetenv (G_PASTE_DAEMON_HANDOFF_FD_ENV);
+    }
 }
 
 gint
@@ -138,6 +155,8 @@ main (gint argc, gchar *argv[])
 
     gint64 exit_status = g_application_run (gapp, argc, argv);
 
+    g_paste_daemon_flush (g_paste_daemon);
+
     g_signal_handler_disconnect (bus, c_signals[C_NAME_LOST]);
     g_signal_handler_disconnect (g_paste_daemon, c_signals[C_REEXECUTE_SELF]);
 
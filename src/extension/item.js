@@ -58,7 +58,8 @@ const GPasteItem = new Lang.Class({
         this.label.clutter_text.ellipsize = Pango.EllipsizeMode.END;
         this.setTextSize(size);
 
-        this.setIndex(index);
+        // The indicator fills its items a whole page at a time
+        this.setIndex(-1);
     },
 
     showIndex: function(state) {
@@ -77,6 +78,23 @@ const GPasteItem = new Lang.Class({
     },
 
     setIndex: function(index) {
+        if (this._setIndex(index)) {
+            this._client.get_items_page(index, 1, Lang.bind(this, function(client, result) {
+                let items = client.get_items_page_finish(result);
+                if (items.length > 0 && items[0].get_index() == this._index) {
+                    this._setText(items[0].get_display_string());
+                }
+            }));
+        }
+    },
+
+    setItem: function(index, item) {
+        if (this._setIndex(index)) {
+            this._setText(item.get_display_string());
+        }
+    },
+
+    _setIndex: function(index) {
         let oldIndex = this._index || -1;
         this._index = index;
 
@@ -88,21 +106,21 @@ const GPasteItem = new Lang.Class({
 
         this._deleteItem.setIndex(index);
 
-        if (index != -1) {
-            this._client.get_element(index, Lang.bind(this, function(client, result) {
-                let text = client.get_element_finish(result).replace(/[\t\n\r]/g, ' ');
-                if (text == this.label.get_text()) {
-                    return;
-                }
-                this.label.clutter_text.set_text(text);
-                if (oldIndex == -1) {
-                    this.actor.show();
-                }
-            }));
-        } else {
+        if (index == -1) {
             this.label.clutter_text.set_text(null);
             this.actor.hide();
+            return false;
+        }
+
+        return true;
+    },
+
+    _setText: function(text) {
+        text = text.replace(/[\t\n\r]/g, ' ');
+        if (text != this.label.get_text()) {
+            this.label.clutter_text.set_text(text);
         }
+        this.actor.show();
     },
 
     setTextSize: function(size) {
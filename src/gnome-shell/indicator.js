@@ -61,6 +61,14 @@ const GPasteIndicator = new Lang.Class({
         this._footerSize = 0;
 
         this._searchResults = [];
+        this._searched = null;
+        this._searchToken = 0;
+        this._searchSerial = 0;
+
+        /* Mirror of the displayed items, kept up to date with the deltas */
+        this._items = [];
+        this._length = 0;
+        this._version = 0;
 
         this._dummyHistoryItem = new DummyHistoryItem.GPasteDummyHistoryItem();
 
@@ -99,7 +107,7 @@ const GPasteIndicator = new Lang.Class({
             this._settingsMaxSizeChangedId = this._settings.connect('changed::max-displayed-history-size', Lang.bind(this, this._resetMaxDisplayedSize));
             this._resetMaxDisplayedSize();
 
-            this._clientUpdateId = this._client.connect('update', Lang.bind(this, this._update));
+            this._clientDeltaId = this._client.connect('delta', Lang.bind(this, this._delta));
             this._clientShowId = this._client.connect('show-history', Lang.bind(this, this._popup));
             this._clientTrackingId = this._client.connect('tracking', Lang.bind(this, this._toggle));
 
@@ -149,26 +157,49 @@ const GPasteIndicator = new Lang.Class({
 
     _onSearch: function() {
         let search = this._searchItem.text.toLowerCase();
+        let serial = ++this._searchSerial;
 
         if (search.length > 0) {
-            this._client.search(search, Lang.bind(this, function(client, result) {
-                this._searchResults = client.search_finish(result);
-                let results = this._searchResults.length;
+            let onResults = Lang.bind(this, function(results, token) {
+                /* Another search was started in the meantime */
+                if (serial != this._searchSerial) {
+                    return;
+                }
+
+                this._searchResults = results;
+                this._searchToken = token;
+                this._searched = search;
+
+                let displayed = results.length;
                 let maxSize = this._history.length;
 
-                if (results > maxSize)
-                    results = maxSize;
+                if (displayed > maxSize)
+                    displayed = maxSize;
 
-                for (let i = 0; i < results; ++i) {
-                    this._history[i].setIndex(this._searchResults[i]);
+                for (let i = 0; i < displayed; ++i) {
+                    this._history[i].setIndex(results[i]);
                 }
-                for (let i = results; i < maxSize; ++i) {
+                for (let i = displayed; i < maxSize; ++i) {
                     this._history[i].setIndex(-1);
                 }
-            }));
+            });
+
+            /* The daemon only narrows the previous results down if that's possible */
+            if (this._searched) {
+                this._client.refine_search(this._searchToken, this._searched, this._searchResults, search, Lang.bind(this, function(client, result) {
+                    let [results, token] = client.refine_search_finish(result);
+                    onResults(results, token);
+                }));
+            } else {
+                this._client.start_search(search, Lang.bind(this, function(client, result) {
+                    let [results, token] = client.start_search_finish(result);
+                    onResults(results, token);
+                }));
+            }
         } else {
             this._searchResults = [];
-            this._refresh(0);
+            this._searched = null;
+            this._refresh();
         }
     },
 
@@ -197,28 +228,95 @@ const GPasteIndicator = new Lang.Class({
             }
         }
 
-        this._refresh(oldSize);
+        this._refresh();
     },
 
-    _update: function(client, action, target, position) {
-        switch (target) {
-        case GPaste.UpdateTarget.ALL:
-            this._refresh(0);
+    _delta: function(client, version, action, target, position, item) {
+        let missed = (version != this._version + 1);
+        this._version = version;
+
+        /* Search results can't be updated locally */
+        if (missed || this._searchResults.length > 0 || target != GPaste.UpdateTarget.POSITION) {
+            this._refresh();
+            return;
+        }
+
+        switch (action) {
+        case GPaste.UpdateAction.ADD:
+            this._items.unshift(item);
+            this._items.splice(this._history.length);
+            ++this._length;
+            this._render(0);
+            break;
+        case GPaste.UpdateAction.REMOVE:
+            if (position < this._items.length) {
+                this._items.splice(position, 1);
+            }
+            if (this._length > 0) {
+                --this._length;
+            }
+            this._render(position);
+            this._fill();
             break;
-        case GPaste.UpdateTarget.POSITION:
-            switch (action) {
-            case GPaste.UpdateAction.REPLACE:
-                this._history[position].refresh();
-                break;
-            case GPaste.UpdateAction.REMOVE:
-                this._refresh(position);
-                break;
+        case GPaste.UpdateAction.REPLACE:
+            if (position < this._items.length) {
+                this._items[position] = item;
+                this._render(position);
             }
             break;
+        default:
+            this._refresh();
+            break;
+        }
+    },
+
+    _render: function(from) {
+        if (this._searchResults.length > 0) {
+            return;
+        }
+
+        let size = Math.min(this._length, this._history.length);
+
+        for (let i = from; i < this._history.length; ++i) {
+            if (i < this._items.length) {
+                this._history[i].setItem(i, this._items[i]);
+            } else if (i >= size) {
+                this._history[i].setIndex(-1);
+            }
         }
+
+        this._updateVisibility(size == 0);
     },
 
-    _refresh: function(resetTextFrom) {
+    _fill: function() {
+        let size = Math.min(this._length, this._history.length);
+        let from = this._items.length;
+
+        if (from >= size) {
+            return;
+        }
+
+        let version = this._version;
+        this._client.get_items_page(from, size - from, Lang.bind(this, function(client, result) {
+            let items = client.get_items_page_finish(result);
+
+            /* The history changed in the meantime, the indexes may not match anymore */
+            if (version != this._version) {
+                this._fill();
+                return;
+            }
+
+            from = this._items.length;
+            items.forEach(Lang.bind(this, function(item) {
+                if (item.get_index() == this._items.length && this._items.length < size) {
+                    this._items.push(item);
+                }
+            }));
+            this._render(from);
+        }));
+    },
+
+    _refresh: function() {
         if (this._searchResults.length > 0) {
             this._onSearch();
         } else {
@@ -226,20 +324,10 @@ const GPasteIndicator = new Lang.Class({
                 let name = client.get_history_name_finish(result);
 
                 this._client.get_history_size(name, Lang.bind(this, function(client, result) {
-                    let size = client.get_history_size_finish(result);
-                    let maxSize = this._history.length;
-
-                    if (size > maxSize)
-                        size = maxSize;
-
-                    for (let i = resetTextFrom; i < size; ++i) {
-                        this._history[i].setIndex(i);
-                    }
-                    for (let i = size ; i < maxSize; ++i) {
-                        this._history[i].setIndex(-1);
-                    }
-
-                    this._updateVisibility(size == 0);
+                    this._length = client.get_history_size_finish(result);
+                    this._items = [];
+                    this._render(0);
+                    this._fill();
                 }));
             }));
         }
@@ -305,7 +393,7 @@ const GPasteIndicator = new Lang.Class({
             return;
         }
         this._destroyed = true;
-        this._client.disconnect(this._clientUpdateId);
+        this._client.disconnect(this._clientDeltaId);
         this._client.disconnect(this._clientShowId);
         this._client.disconnect(this._clientTrackingId);
         this._settings.disconnect(this._settingsMaxSizeChangedId);
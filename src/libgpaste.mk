@@ -17,8 +17,17 @@
 
 libgpaste_la_file = lib/libgpaste.la
 
-lib_libgpaste_la_private_headers =          \
-	%D%/libgpaste/gpaste-gdbus-macros.h \
+lib_libgpaste_la_private_headers =                 \
+	%D%/libgpaste/gpaste-gdbus-macros.h          \
+	%D%/libgpaste/core/gpaste-history-binary.h   \
+	%D%/libgpaste/core/gpaste-history-blobs.h    \
+	%D%/libgpaste/core/gpaste-history-catalog.h  \
+	%D%/libgpaste/core/gpaste-history-eviction.h \
+	%D%/libgpaste/core/gpaste-history-index.h    \
+	%D%/libgpaste/core/gpaste-history-journal.h  \
+	%D%/libgpaste/util/gpaste-fingerprint.h      \
+	%D%/libgpaste/util/gpaste-memfd.h            \
+	%D%/libgpaste/util/gpaste-string.h           \
 	$(NULL)
 
 lib_libgpaste_la_misc_headers =               \
@@ -38,6 +47,7 @@ lib_libgpaste_la_public_headers =                                             \
 	%D%/libgpaste/applet/gpaste-applet-status-icon.h                      \
 	%D%/libgpaste/applet/gpaste-applet-ui.h                               \
 	%D%/libgpaste/client/gpaste-client.h                                  \
+	%D%/libgpaste/client/gpaste-client-item.h                             \
 	%D%/libgpaste/core/gpaste-clipboard.h                                 \
 	%D%/libgpaste/core/gpaste-clipboards-manager.h                        \
 	%D%/libgpaste/core/gpaste-history.h                                   \
@@ -101,9 +111,16 @@ lib_libgpaste_la_source_files =                                               \
 	%D%/libgpaste/applet/gpaste-applet-status-icon.c                      \
 	%D%/libgpaste/applet/gpaste-applet-ui.c                               \
 	%D%/libgpaste/client/gpaste-client.c                                  \
+	%D%/libgpaste/client/gpaste-client-item.c                             \
 	%D%/libgpaste/core/gpaste-clipboard.c                                 \
 	%D%/libgpaste/core/gpaste-clipboards-manager.c                        \
 	%D%/libgpaste/core/gpaste-history.c                                   \
+	%D%/libgpaste/core/gpaste-history-binary.c                            \
+	%D%/libgpaste/core/gpaste-history-blobs.c                             \
+	%D%/libgpaste/core/gpaste-history-catalog.c                           \
+	%D%/libgpaste/core/gpaste-history-eviction.c                          \
+	%D%/libgpaste/core/gpaste-history-index.c                             \
+	%D%/libgpaste/core/gpaste-history-journal.c                           \
 	%D%/libgpaste/core/gpaste-image-item.c                                \
 	%D%/libgpaste/core/gpaste-item.c                                      \
 	%D%/libgpaste/core/gpaste-password-item.c                             \
@@ -153,6 +170,9 @@ lib_libgpaste_la_source_files =                                               \
 	%D%/libgpaste/ui/gpaste-ui-switch.c                                   \
 	%D%/libgpaste/ui/gpaste-ui-upload-item.c                              \
 	%D%/libgpaste/ui/gpaste-ui-window.c                                   \
+	%D%/libgpaste/util/gpaste-fingerprint.c                               \
+	%D%/libgpaste/util/gpaste-memfd.c                                     \
+	%D%/libgpaste/util/gpaste-string.c                                    \
 	%D%/libgpaste/util/gpaste-util.c                                      \
 	$(NULL)
 
@@ -0,0 +1,168 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gpaste-client-item.h>
+
+struct _GPasteClientItem
+{
+    GObject parent_instance;
+
+    guint64         index;
+    gchar          *display_string;
+    GPasteItemKind  kind;
+    guint64         size;
+    gint64          timestamp;
+};
+
+G_DEFINE_TYPE (GPasteClientItem, g_paste_client_item, G_TYPE_OBJECT)
+
+/**
+ * g_paste_client_item_get_index:
+ * @self: a #GPasteClientItem instance
+ *
+ * Get the index of the item in the history it comes from
+ *
+ * Returns: the index of the item
+ */
+G_PASTE_VISIBLE guint64
+g_paste_client_item_get_index (const GPasteClientItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT_ITEM ((gpointer) self), 0);
+
+    return self->index;
+}
+
+/**
+ * g_paste_client_item_get_display_string:
+ * @self: a #GPasteClientItem instance
+ *
+ * Get the string to display for the item
+ *
+ * Returns: read-only string containing the string to display
+ */
+G_PASTE_VISIBLE const gchar *
+g_paste_client_item_get_display_string (const GPasteClientItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT_ITEM ((gpointer) self), NULL);
+
+    return self->display_string;
+}
+
+/**
+ * g_paste_client_item_get_kind:
+ * @self: a #GPasteClientItem instance
+ *
+ * Get the kind of the item
+ *
+ * Returns: the #GPasteItemKind of the item
+ */
+G_PASTE_VISIBLE GPasteItemKind
+g_paste_client_item_get_kind (const GPasteClientItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT_ITEM ((gpointer) self), G_PASTE_ITEM_KIND_INVALID);
+
+    return self->kind;
+}
+
+/**
+ * g_paste_client_item_get_size:
+ * @self: a #GPasteClientItem instance
+ *
+ * Get the memory used by the item in the daemon
+ *
+ * Returns: the size of the item
+ */
+G_PASTE_VISIBLE guint64
+g_paste_client_item_get_size (const GPasteClientItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT_ITEM ((gpointer) self), 0);
+
+    return self->size;
+}
+
+/**
+ * g_paste_client_item_get_timestamp:
+ * @self: a #GPasteClientItem instance
+ *
+ * Get the date at which the item was copied, as a unix timestamp
+ *
+ * Returns: the timestamp, or 0 if it isn't known for this item
+ */
+G_PASTE_VISIBLE gint64
+g_paste_client_item_get_timestamp (const GPasteClientItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT_ITEM ((gpointer) self), 0);
+
+    return self->timestamp;
+}
+
+static void
+g_paste_client_item_finalize (GObject *object)
+{
+    GPasteClientItem *self = G_PASTE_CLIENT_ITEM (object);
+
+    g_free (self->display_string);
+
+    G_OBJECT_CLASS (g_paste_client_item_parent_class)->finalize (object);
+}
+
+static void
+g_paste_client_item_class_init (GPasteClientItemClass *klass)
+{
+    G_OBJECT_CLASS (klass)->finalize = g_paste_client_item_finalize;
+}
+
+static void
+g_paste_client_item_init (GPasteClientItem *self G_GNUC_UNUSED)
+{
+}
+
+/**
+ * g_paste_client_item_new:
+ * @index: the index of the item in its history
+ * @display_string: the string to display for the item
+ * @kind: the kind of the item
+ * @size: the memory used by the item in the daemon
+ * @timestamp: the date at which the item was copied, 0 if unknown
+ *
+ * Create a new instance of #GPasteClientItem, the view a #GPasteClient
+ * has of an item of the history
+ *
+ * Returns: a newly allocated #GPasteClientItem
+ *          free it with g_object_unref
+ */
+G_PASTE_VISIBLE GPasteClientItem *
+g_paste_client_item_new (guint64         index,
+                         const gchar    *display_string,
+                         GPasteItemKind  kind,
+                         guint64         size,
+                         gint64          timestamp)
+{
+    g_return_val_if_fail (display_string, NULL);
+
+    GPasteClientItem *self = g_object_new (G_PASTE_TYPE_CLIENT_ITEM, NULL);
+
+    self->index = index;
+    self->display_string = g_strdup (display_string);
+    self->kind = kind;
+    self->size = size;
+    self->timestamp = timestamp;
+
+    return self;
+}
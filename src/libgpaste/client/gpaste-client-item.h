@@ -0,0 +1,50 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_CLIENT_ITEM_H__
+#define __G_PASTE_CLIENT_ITEM_H__
+
+#include <gpaste-item-enums.h>
+#include <gpaste-macros.h>
+
+G_BEGIN_DECLS
+
+#define G_PASTE_TYPE_CLIENT_ITEM (g_paste_client_item_get_type ())
+
+G_PASTE_FINAL_TYPE (ClientItem, client_item, CLIENT_ITEM, GObject)
+
+guint64         g_paste_client_item_get_index          (const GPasteClientItem *self);
+const gchar    *g_paste_client_item_get_display_string (const GPasteClientItem *self);
+GPasteItemKind  g_paste_client_item_get_kind           (const GPasteClientItem *self);
+guint64         g_paste_client_item_get_size           (const GPasteClientItem *self);
+gint64          g_paste_client_item_get_timestamp      (const GPasteClientItem *self);
+
+GPasteClientItem *g_paste_client_item_new (guint64         index,
+                                           const gchar    *display_string,
+                                           GPasteItemKind  kind,
+                                           guint64         size,
+                                           gint64          timestamp);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_CLIENT_ITEM_H__*/
@@ -22,17 +22,37 @@
 #include <gpaste-client.h>
 #include <gpaste-update-enums.h>
 
+#include <gio/gunixfdlist.h>
+
 struct _GPasteClient
 {
     GDBusProxy parent_instance;
 };
 
-G_DEFINE_TYPE (GPasteClient, g_paste_client, G_TYPE_DBUS_PROXY)
+typedef struct
+{
+    /* Local copy of the first items of the current history, see g_paste_client_set_cache_enabled */
+    gboolean   cache;
+    gboolean   cache_valid;
+    gboolean   cache_loading;
+    gchar     *cache_name;
+    guint64    cache_length;
+    GPtrArray *cache_items;
+    /* Version of the last delta we received, to discard outdated answers */
+    guint64    cache_version;
+} GPasteClientPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (GPasteClient, g_paste_client, G_TYPE_DBUS_PROXY)
+
+/* How many items we fetch ahead of the one which was asked for */
+#define G_PASTE_CLIENT_CACHE_PREFETCH 20
 
 enum
 {
     DELETE_HISTORY,
+    DELTA,
     EMPTY_HISTORY,
+    SEARCH_ALL_RESULT,
     SHOW_HISTORY,
     SWITCH_HISTORY,
     TRACKING,
@@ -180,6 +200,584 @@ compute_at_param (const guint64 *indexes,
     return g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64, indexes, n_indexes, sizeof (guint64));
 }
 
+static GList *
+get_items_page_result (GVariant *variant)
+{
+    GEnumClass *kind_class = g_type_class_peek (G_PASTE_TYPE_ITEM_KIND);
+    GList *items = NULL;
+    GVariantIter iter;
+    const gchar *display_string;
+    const gchar *kind;
+    guint64 size;
+    gint64 timestamp;
+    guint64 index;
+
+    g_variant_iter_init (&iter, variant);
+
+    while (g_variant_iter_next (&iter, "(&s&stxt)", &display_string, &kind, &size, &timestamp, &index))
+    {
+        GEnumValue *k = g_enum_get_value_by_nick (kind_class, kind);
+
+        items = g_list_prepend (items, g_paste_client_item_new (index,
+                                                                display_string,
+                                                                (k) ? k->value : G_PASTE_ITEM_KIND_INVALID,
+                                                                size,
+                                                                timestamp));
+    }
+
+    return g_list_reverse (items);
+}
+
+static guint64 *
+get_search_result (GVariant *variant,
+                   guint64  *token,
+                   guint64  *hits)
+{
+    g_autoptr (GVariant) results = NULL;
+    guint64 _token;
+
+    g_variant_get (variant, "(t@at)", &_token, &results);
+
+    if (token)
+        *token = _token;
+
+    return g_paste_util_get_dbus_at_result (results, hits);
+}
+
+/*********/
+/* Cache */
+/*********/
+
+static gboolean
+g_paste_client_is_cached_result (GPasteClient *self,
+                                 GAsyncResult *result)
+{
+    return g_task_is_valid (result, self) && g_task_get_source_tag (G_TASK (result)) == g_paste_client_is_cached_result;
+}
+
+static void
+g_paste_client_return_cached (GPasteClient       *self,
+                              gpointer            answer,
+                              GDestroyNotify      answer_free,
+                              GAsyncReadyCallback callback,
+                              gpointer            user_data)
+{
+    g_autoptr (GTask) task = g_task_new (self, NULL, callback, user_data);
+
+    g_task_set_source_tag (task, g_paste_client_is_cached_result);
+    g_task_return_pointer (task, answer, answer_free);
+}
+
+static void
+g_paste_client_free_items (gpointer data)
+{
+    g_list_free_full (data, g_object_unref);
+}
+
+static void
+g_paste_client_cache_invalidate (GPasteClientPrivate *priv)
+{
+    priv->cache_valid = FALSE;
+    g_clear_pointer (&priv->cache_name, g_free);
+    priv->cache_length = 0;
+    g_ptr_array_set_size (priv->cache_items, 0);
+}
+
+static void g_paste_client_cache_load (GPasteClient *self,
+                                       guint64       up_to);
+
+typedef struct
+{
+    GPasteClient *self;
+    guint64       version;
+    guint64       up_to;
+} CacheLoadData;
+
+static CacheLoadData *
+cache_load_data_new (GPasteClient *self,
+                     guint64       up_to)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    CacheLoadData *data = g_new (CacheLoadData, 1);
+
+    data->self = g_object_ref (self);
+    data->version = priv->cache_version;
+    data->up_to = up_to;
+
+    return data;
+}
+
+static void
+cache_load_data_free (CacheLoadData *data)
+{
+    g_object_unref (data->self);
+    g_free (data);
+}
+
+/*
+ * The answers come in the same order as the deltas, so if we got no delta
+ * since the request was made, the answer matches what we already have.
+ * Otherwise we just ask again.
+ */
+static gboolean
+g_paste_client_cache_load_done (CacheLoadData *data,
+                                gboolean       failed)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (data->self);
+
+    priv->cache_loading = FALSE;
+
+    if (failed || !priv->cache)
+        return FALSE;
+
+    if (data->version != priv->cache_version)
+    {
+        g_paste_client_cache_load (data->self, data->up_to);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+g_paste_client_cache_on_page_ready (GObject      *source_object G_GNUC_UNUSED,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
+{
+    CacheLoadData *data = user_data;
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (data->self);
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_finish (G_DBUS_PROXY (data->self), res, &error);
+    GList *items = NULL;
+
+    if (_result)
+    {
+        DBUS_PREPARE_EXTRACTION;
+        items = get_items_page_result (variant);
+    }
+
+    if (g_paste_client_cache_load_done (data, !_result))
+    {
+        for (GList *i = items; i; i = g_list_next (i))
+        {
+            if (g_paste_client_item_get_index (i->data) == priv->cache_items->len)
+                g_ptr_array_add (priv->cache_items, g_object_ref (i->data));
+        }
+    }
+
+    g_list_free_full (items, g_object_unref);
+    cache_load_data_free (data);
+}
+
+static void
+g_paste_client_cache_on_size_ready (GObject      *source_object G_GNUC_UNUSED,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
+{
+    CacheLoadData *data = user_data;
+    GPasteClient *self = data->self;
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_finish (G_DBUS_PROXY (self), res, &error);
+
+    if (!g_paste_client_cache_load_done (data, !_result))
+    {
+        cache_load_data_free (data);
+        return;
+    }
+
+    DBUS_PREPARE_EXTRACTION;
+
+    priv->cache_length = g_variant_get_uint64 (variant);
+    priv->cache_valid = TRUE;
+
+    /* Go on with the items */
+    g_paste_client_cache_load (self, data->up_to);
+    cache_load_data_free (data);
+}
+
+static void
+g_paste_client_cache_on_name_ready (GObject      *source_object G_GNUC_UNUSED,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
+{
+    CacheLoadData *data = user_data;
+    GPasteClient *self = data->self;
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_finish (G_DBUS_PROXY (self), res, &error);
+
+    if (!g_paste_client_cache_load_done (data, !_result))
+    {
+        cache_load_data_free (data);
+        return;
+    }
+
+    DBUS_PREPARE_EXTRACTION;
+
+    g_free (priv->cache_name);
+    priv->cache_name = g_variant_dup_string (variant, NULL);
+    priv->cache_loading = TRUE;
+
+    GVariant *parameter = g_variant_new_string (priv->cache_name);
+
+    g_dbus_proxy_call (G_DBUS_PROXY (self),
+                       G_PASTE_DAEMON_GET_HISTORY_SIZE,
+                       g_variant_new_tuple (&parameter, 1),
+                       G_DBUS_CALL_FLAGS_NONE,
+                       -1,
+                       NULL, /* cancellable */
+                       g_paste_client_cache_on_size_ready,
+                       data);
+}
+
+/*
+ * Make sure the cache will hold at least the items up to @up_to (excluded),
+ * and a few more so that we're ahead of the next requests.
+ */
+static void
+g_paste_client_cache_load (GPasteClient *self,
+                           guint64       up_to)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (!priv->cache || priv->cache_loading)
+        return;
+
+    if (!priv->cache_valid)
+    {
+        priv->cache_loading = TRUE;
+        g_dbus_proxy_call (G_DBUS_PROXY (self),
+                           G_PASTE_DAEMON_GET_HISTORY_NAME,
+                           NULL,
+                           G_DBUS_CALL_FLAGS_NONE,
+                           -1,
+                           NULL, /* cancellable */
+                           g_paste_client_cache_on_name_ready,
+                           cache_load_data_new (self, up_to));
+        return;
+    }
+
+    guint64 start = priv->cache_items->len;
+    guint64 end = MIN (MAX (up_to, start) + G_PASTE_CLIENT_CACHE_PREFETCH, priv->cache_length);
+
+    if (start >= end)
+        return;
+
+    GVariant *params[] = {
+        g_variant_new_uint64 (start),
+        g_variant_new_uint64 (end - start)
+    };
+
+    priv->cache_loading = TRUE;
+    g_dbus_proxy_call (G_DBUS_PROXY (self),
+                       G_PASTE_DAEMON_GET_ITEMS_PAGE,
+                       g_variant_new_tuple (params, 2),
+                       G_DBUS_CALL_FLAGS_NONE,
+                       -1,
+                       NULL, /* cancellable */
+                       g_paste_client_cache_on_page_ready,
+                       cache_load_data_new (self, up_to));
+}
+
+static const GPasteClientItem *
+g_paste_client_cache_lookup (GPasteClient *self,
+                             guint64       index)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), NULL);
+
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (!priv->cache)
+        return NULL;
+
+    /* Stay ahead of the caller */
+    if (!priv->cache_valid || index + G_PASTE_CLIENT_CACHE_PREFETCH / 2 >= priv->cache_items->len)
+        g_paste_client_cache_load (self, index + 1);
+
+    if (!priv->cache_valid || index >= priv->cache_items->len)
+        return NULL;
+
+    return g_ptr_array_index (priv->cache_items, index);
+}
+
+/*
+ * The cache holds the previews GetElements lists, which the daemon ends with "…"
+ * when it cut them. Those aren't what GetElement gives, ask the daemon for them.
+ */
+static const gchar *
+g_paste_client_cache_lookup_display_string (GPasteClient *self,
+                                            guint64       index)
+{
+    const GPasteClientItem *item = g_paste_client_cache_lookup (self, index);
+
+    if (!item)
+        return NULL;
+
+    const gchar *display_string = g_paste_client_item_get_display_string (item);
+
+    return (g_str_has_suffix (display_string, "…")) ? NULL : display_string;
+}
+
+static guint64
+g_paste_client_cache_get_range_end (guint64 start,
+                                    guint64 count,
+                                    guint64 length)
+{
+    return (start < length) ? start + MIN (count, length - start) : start;
+}
+
+static gboolean
+g_paste_client_cache_has_range (GPasteClient *self,
+                                guint64       start,
+                                guint64       count)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), FALSE);
+
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (!priv->cache)
+        return FALSE;
+
+    guint64 end = g_paste_client_cache_get_range_end (start, count, priv->cache_length);
+
+    if (!priv->cache_valid || end > priv->cache_items->len)
+    {
+        g_paste_client_cache_load (self, end);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static GList *
+g_paste_client_cache_get_range (GPasteClient *self,
+                                guint64       start,
+                                guint64       count)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    guint64 end = g_paste_client_cache_get_range_end (start, count, priv->cache_items->len);
+    GList *items = NULL;
+
+    /* The indexes stored in the items may be outdated by now */
+    for (guint64 i = end; i-- > start;)
+    {
+        const GPasteClientItem *item = g_ptr_array_index (priv->cache_items, i);
+
+        items = g_list_prepend (items, g_paste_client_item_new (i,
+                                                                g_paste_client_item_get_display_string (item),
+                                                                g_paste_client_item_get_kind (item),
+                                                                g_paste_client_item_get_size (item),
+                                                                g_paste_client_item_get_timestamp (item)));
+    }
+
+    return items;
+}
+
+static GStrv
+g_paste_client_cache_get_strv (GPasteClient  *self,
+                               const guint64 *indexes,
+                               guint64        n_indexes)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    GStrv strv = g_new (gchar *, n_indexes + 1);
+
+    for (guint64 i = 0; i < n_indexes; ++i)
+    {
+        guint64 index = (indexes) ? indexes[i] : i;
+
+        strv[i] = g_strdup (g_paste_client_item_get_display_string (g_ptr_array_index (priv->cache_items, index)));
+    }
+    strv[n_indexes] = NULL;
+
+    return strv;
+}
+
+static gboolean
+g_paste_client_cache_has_indexes (GPasteClient  *self,
+                                  const guint64 *indexes,
+                                  guint64        n_indexes)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), FALSE);
+
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    guint64 up_to = 0;
+
+    if (!priv->cache)
+        return FALSE;
+
+    for (guint64 i = 0; i < n_indexes; ++i)
+        up_to = MAX (up_to, indexes[i] + 1);
+
+    if (!priv->cache_valid || up_to > priv->cache_items->len)
+    {
+        g_paste_client_cache_load (self, up_to);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+g_paste_client_cache_has_name (GPasteClient *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), FALSE);
+
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    return priv->cache && priv->cache_valid;
+}
+
+static gboolean
+g_paste_client_cache_has_size (GPasteClient *self,
+                               const gchar  *name)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), FALSE);
+
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (!priv->cache)
+        return FALSE;
+
+    if (!priv->cache_valid)
+    {
+        g_paste_client_cache_load (self, 0);
+        return FALSE;
+    }
+
+    return !g_strcmp0 (name, priv->cache_name);
+}
+
+static void
+g_paste_client_cache_apply_delta (GPasteClient           *self,
+                                  guint64                 version,
+                                  GPasteUpdateAction      action,
+                                  GPasteUpdateTarget      target,
+                                  guint64                 position,
+                                  const GPasteClientItem *item)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+    gboolean missed = (version != priv->cache_version + 1);
+
+    priv->cache_version = version;
+
+    if (!priv->cache || !priv->cache_valid)
+        return;
+
+    if (missed || target != G_PASTE_UPDATE_TARGET_POSITION)
+    {
+        g_paste_client_cache_invalidate (priv);
+        return;
+    }
+
+    switch (action)
+    {
+    case G_PASTE_UPDATE_ACTION_ADD:
+        ++priv->cache_length;
+        if (item)
+            g_ptr_array_insert (priv->cache_items, 0, g_object_ref ((gpointer) item));
+        else
+            g_ptr_array_set_size (priv->cache_items, 0);
+        break;
+    case G_PASTE_UPDATE_ACTION_REMOVE:
+        if (priv->cache_length)
+            --priv->cache_length;
+        if (position < priv->cache_items->len)
+            g_ptr_array_remove_index (priv->cache_items, position);
+        break;
+    case G_PASTE_UPDATE_ACTION_REPLACE:
+        if (position < priv->cache_items->len)
+        {
+            if (item)
+            {
+                g_object_unref (g_ptr_array_index (priv->cache_items, position));
+                g_ptr_array_index (priv->cache_items, position) = g_object_ref ((gpointer) item);
+            }
+            else
+            {
+                g_ptr_array_set_size (priv->cache_items, position);
+            }
+        }
+        break;
+    default:
+        g_paste_client_cache_invalidate (priv);
+        break;
+    }
+}
+
+/**
+ * g_paste_client_set_cache_enabled:
+ * @self: a #GPasteClient instance
+ * @enabled: whether to keep a local copy of the history
+ *
+ * When enabled, the client keeps a local copy of the display strings,
+ * kinds and sizes of the items of the current history, kept up to date
+ * with the deltas sent by the daemon and filled ahead of the requests.
+ * The getters for those are then answered without going through the
+ * bus when possible.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_set_cache_enabled (GPasteClient *self,
+                                  gboolean      enabled)
+{
+    g_return_if_fail (G_PASTE_IS_CLIENT (self));
+
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (priv->cache == enabled)
+        return;
+
+    priv->cache = enabled;
+    g_paste_client_cache_invalidate (priv);
+
+    if (enabled)
+        g_paste_client_cache_load (self, 0);
+}
+
+/********************/
+/* File descriptors */
+/********************/
+
+/* Big contents go through file descriptors so that they aren't copied into the messages */
+
+static GUnixFDList *
+g_paste_client_fd_list_new (gint     fd,
+                            GError **error)
+{
+    GUnixFDList *fd_list = g_unix_fd_list_new ();
+
+    /* This duplicates fd, which stays ours */
+    if (g_unix_fd_list_append (fd_list, fd, error) < 0)
+        g_clear_object (&fd_list);
+
+    return fd_list;
+}
+
+static gint
+g_paste_client_get_fd_result (GVariant    *result,
+                              GUnixFDList *fd_list,
+                              GError     **error)
+{
+    gint fd = -1;
+
+    if (result && fd_list)
+    {
+        gint32 handle;
+
+        g_variant_get (result, "(h)", &handle);
+        fd = g_unix_fd_list_get (fd_list, handle, error);
+    }
+    else if (result)
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED, "The daemon didn't send any file descriptor");
+
+    if (fd_list)
+        g_object_unref (fd_list);
+
+    return fd;
+}
+
 /******************/
 /* Methods / Sync */
 /******************/
@@ -218,6 +816,44 @@ g_paste_client_add_sync (GPasteClient *self,
     DBUS_CALL_ONE_PARAM_NO_RETURN (ADD, string, text);
 }
 
+/**
+ * g_paste_client_add_fd_sync:
+ * @self: a #GPasteClient instance
+ * @fd: the file descriptor to read the contents to add from
+ * @error: a #GError
+ *
+ * Add what can be read from @fd (a file, a pipe...) to the #GPasteDaemon,
+ * without sending it through the bus. @fd is left open.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_add_fd_sync (GPasteClient *self,
+                            gint          fd,
+                            GError      **error)
+{
+    g_return_if_fail (G_PASTE_IS_CLIENT (self));
+    g_return_if_fail (fd >= 0);
+    g_return_if_fail (!error || !(*error));
+
+    GUnixFDList *fd_list = g_paste_client_fd_list_new (fd, error);
+
+    if (!fd_list)
+        return;
+
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_with_unix_fd_list_sync (G_DBUS_PROXY (self),
+                                                                             G_PASTE_DAEMON_ADD_FD,
+                                                                             g_variant_new ("(h)", 0),
+                                                                             G_DBUS_CALL_FLAGS_NONE,
+                                                                             -1,
+                                                                             fd_list,
+                                                                             NULL, /* out fd list */
+                                                                             NULL, /* cancellable */
+                                                                             error);
+
+    g_object_unref (fd_list);
+}
+
 /**
  * g_paste_client_add_file_sync:
  * @self: a #GPasteClient instance
@@ -381,6 +1017,11 @@ g_paste_client_get_element_sync (GPasteClient *self,
                                  guint64       index,
                                  GError      **error)
 {
+    const gchar *display_string = g_paste_client_cache_lookup_display_string (self, index);
+
+    if (display_string)
+        return g_strdup (display_string);
+
     DBUS_CALL_ONE_PARAM_RET_STRING (GET_ELEMENT, uint64, index);
 }
 
@@ -407,6 +1048,11 @@ g_paste_client_get_element_kind_sync (GPasteClient *self,
                                       guint64       index,
                                       GError      **error)
 {
+    const GPasteClientItem *item = g_paste_client_cache_lookup (self, index);
+
+    if (item)
+        return g_paste_client_item_get_kind (item);
+
     g_autofree gchar *kind = _g_paste_client_get_element_kind_sync (self, index, error);
     GEnumValue *k = (kind) ? g_enum_get_value_by_nick (g_type_class_peek (G_PASTE_TYPE_ITEM_KIND), kind) : NULL;
 
@@ -430,6 +1076,9 @@ g_paste_client_get_elements_sync (GPasteClient  *self,
                                   guint64        n_indexes,
                                   GError       **error)
 {
+    if (g_paste_client_cache_has_indexes (self, indexes, n_indexes))
+        return g_paste_client_cache_get_strv (self, indexes, n_indexes);
+
     GVariant *param = compute_at_param (indexes, n_indexes);
     DBUS_CALL_ONE_PARAMV_RET_STRV (GET_ELEMENTS, param);
 }
@@ -447,6 +1096,11 @@ G_PASTE_VISIBLE GStrv
 g_paste_client_get_history_sync (GPasteClient *self,
                                  GError      **error)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (g_paste_client_cache_has_range (self, 0, G_MAXUINT64))
+        return g_paste_client_cache_get_strv (self, NULL, priv->cache_length);
+
     DBUS_CALL_NO_PARAM_RET_STRV (GET_HISTORY);
 }
 
@@ -463,6 +1117,11 @@ G_PASTE_VISIBLE gchar *
 g_paste_client_get_history_name_sync (GPasteClient *self,
                                       GError      **error)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (g_paste_client_cache_has_name (self))
+        return g_strdup (priv->cache_name);
+
     DBUS_CALL_NO_PARAM_RET_STRING (GET_HISTORY_NAME);
 }
 
@@ -481,9 +1140,43 @@ g_paste_client_get_history_size_sync (GPasteClient *self,
                                       const gchar  *name,
                                       GError      **error)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (g_paste_client_cache_has_size (self, name))
+        return priv->cache_length;
+
     DBUS_CALL_ONE_PARAM_RET_UINT64 (GET_HISTORY_SIZE, string, name);
 }
 
+/**
+ * g_paste_client_get_items_page_sync:
+ * @self: a #GPasteClient instance
+ * @start: the index of the first item we want to get
+ * @count: the number of items we want to get
+ * @error: a #GError
+ *
+ * Get a whole range of items from the #GPasteDaemon in one call
+ *
+ * Returns: (element-type GPasteClientItem) (transfer full): the items, free
+ *          them with g_list_free_full and g_object_unref
+ */
+G_PASTE_VISIBLE GList *
+g_paste_client_get_items_page_sync (GPasteClient *self,
+                                    guint64       start,
+                                    guint64       count,
+                                    GError      **error)
+{
+    if (g_paste_client_cache_has_range (self, start, count))
+        return g_paste_client_cache_get_range (self, start, count);
+
+    GVariant *params[] = {
+        g_variant_new_uint64 (start),
+        g_variant_new_uint64 (count)
+    };
+
+    DBUS_CALL_TWO_PARAMS_BASE (CLIENT, params, G_PASTE_DAEMON_GET_ITEMS_PAGE, NULL, return get_items_page_result (variant));
+}
+
 /**
  * g_paste_client_get_raw_element_sync:
  * @self: a #GPasteClient instance
@@ -502,6 +1195,39 @@ g_paste_client_get_raw_element_sync (GPasteClient *self,
     DBUS_CALL_ONE_PARAM_RET_STRING (GET_RAW_ELEMENT, uint64, index);
 }
 
+/**
+ * g_paste_client_get_raw_element_fd_sync:
+ * @self: a #GPasteClient instance
+ * @index: the index of the element we want to get
+ * @error: a #GError
+ *
+ * Get an item from the #GPasteDaemon as a file descriptor to read it from,
+ * without sending it through the bus
+ *
+ * Returns: a file descriptor to close once done with it, or -1 on error
+ */
+G_PASTE_VISIBLE gint
+g_paste_client_get_raw_element_fd_sync (GPasteClient *self,
+                                        guint64       index,
+                                        GError      **error)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), -1);
+    g_return_val_if_fail (!error || !(*error), -1);
+
+    GUnixFDList *fd_list = NULL;
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_with_unix_fd_list_sync (G_DBUS_PROXY (self),
+                                                                             G_PASTE_DAEMON_GET_RAW_ELEMENT_FD,
+                                                                             g_variant_new ("(t)", index),
+                                                                             G_DBUS_CALL_FLAGS_NONE,
+                                                                             -1,
+                                                                             NULL, /* fd list */
+                                                                             &fd_list,
+                                                                             NULL, /* cancellable */
+                                                                             error);
+
+    return g_paste_client_get_fd_result (_result, fd_list, error);
+}
+
 /**
  * g_paste_client_get_raw_history_sync:
  * @self: a #GPasteClient instance
@@ -534,6 +1260,23 @@ g_paste_client_list_histories_sync (GPasteClient *self,
     DBUS_CALL_NO_PARAM_RET_STRV (LIST_HISTORIES);
 }
 
+/**
+ * g_paste_client_list_histories_info_sync:
+ * @self: a #GPasteClient instance
+ * @error: a #GError
+ *
+ * List all available histories along with what there is to know about them
+ *
+ * Returns: (transfer full): the name, number of items, size in bytes, modification time
+ *                           and preview of the first item of each history, as "a(sttxs)"
+ */
+G_PASTE_VISIBLE GVariant *
+g_paste_client_list_histories_info_sync (GPasteClient *self,
+                                         GError      **error)
+{
+    DBUS_CALL_NO_PARAM_BASE (CLIENT, G_PASTE_DAEMON_LIST_HISTORIES_INFO, NULL, return g_variant_ref (variant));
+}
+
 /**
  * g_paste_client_merge_sync:
  * @self: a #GPasteClient instance
@@ -601,6 +1344,44 @@ g_paste_client_reexecute_sync (GPasteClient *self,
     DBUS_CALL_NO_PARAM_NO_RETURN (REEXECUTE);
 }
 
+/**
+ * g_paste_client_refine_search_sync:
+ * @self: a #GPasteClient instance
+ * @token: the token given along with the previous results
+ * @previous_pattern: the pattern of the previous search
+ * @previous_results: (array length=n_previous_results): the results of the previous search
+ * @n_previous_results: the number of results of the previous search
+ * @pattern: the pattern to look for in history
+ * @new_token: (out) (optional): the token to give to the next refinement
+ * @hits: (out) (optional): number of hits
+ * @error: a #GError
+ *
+ * Search for items matching @pattern in history, only looking at the previous
+ * results if the history didn't change and @pattern extends @previous_pattern
+ *
+ * Returns: (array length=hits): The indexes of the matching items
+ */
+G_PASTE_VISIBLE guint64 *
+g_paste_client_refine_search_sync (GPasteClient  *self,
+                                   guint64        token,
+                                   const gchar   *previous_pattern,
+                                   const guint64 *previous_results,
+                                   guint64        n_previous_results,
+                                   const gchar   *pattern,
+                                   guint64       *new_token,
+                                   guint64       *hits,
+                                   GError       **error)
+{
+    GVariant *params[] = {
+        g_variant_new_uint64 (token),
+        g_variant_new_string (previous_pattern),
+        compute_at_param (previous_results, n_previous_results),
+        g_variant_new_string (pattern)
+    };
+
+    DBUS_CALL_WITH_RETURN_RAW_BASE (CLIENT, {}, G_PASTE_DAEMON_REFINE_SEARCH, params, 4, NULL, return get_search_result (variant, new_token, hits));
+}
+
 /**
  * g_paste_client_rename_password_sync:
  * @self: a #GPasteClient instance
@@ -671,6 +1452,26 @@ g_paste_client_search_sync (GPasteClient *self,
     DBUS_CALL_ONE_PARAM_RET_AT (SEARCH, string, pattern, hits);
 }
 
+/**
+ * g_paste_client_search_all_sync:
+ * @self: a #GPasteClient instance
+ * @pattern: the pattern to look for in the histories
+ * @error: a #GError
+ *
+ * Search for items matching @pattern in all the histories,
+ * not only the current one
+ *
+ * Returns: (transfer full): for each history with matching items, its name and
+ *                           the index and a snippet of each of them, as "a(sa(ts))"
+ */
+G_PASTE_VISIBLE GVariant *
+g_paste_client_search_all_sync (GPasteClient *self,
+                                const gchar  *pattern,
+                                GError      **error)
+{
+    DBUS_CALL_ONE_PARAM_BASE (CLIENT, string, pattern, G_PASTE_DAEMON_SEARCH_ALL, NULL, return g_variant_ref (variant));
+}
+
 /**
  * g_paste_client_select_sync:
  * @self: a #GPasteClient instance
@@ -729,6 +1530,29 @@ g_paste_client_show_history_sync (GPasteClient *self,
 {
     DBUS_CALL_NO_PARAM_NO_RETURN (SHOW_HISTORY);
 }
+/**
+ * g_paste_client_start_search_sync:
+ * @self: a #GPasteClient instance
+ * @pattern: the pattern to look for in history
+ * @token: (out) (optional): the token to give to g_paste_client_refine_search_sync
+ * @hits: (out) (optional): number of hits
+ * @error: a #GError
+ *
+ * Search for items matching @pattern in history, and get a token
+ * to refine that search afterwards
+ *
+ * Returns: (array length=hits): The indexes of the matching items
+ */
+G_PASTE_VISIBLE guint64 *
+g_paste_client_start_search_sync (GPasteClient *self,
+                                  const gchar  *pattern,
+                                  guint64      *token,
+                                  guint64      *hits,
+                                  GError      **error)
+{
+    DBUS_CALL_WITH_RETURN_RAW_BASE (CLIENT, GVariant *parameter = g_variant_new_string (pattern), G_PASTE_DAEMON_START_SEARCH, &parameter, 1, NULL, return get_search_result (variant, token, hits));
+}
+
 /**
  * g_paste_client_switch_history_sync:
  * @self: a #GPasteClient instance
@@ -827,6 +1651,44 @@ g_paste_client_add (GPasteClient       *self,
     DBUS_CALL_ONE_PARAM_ASYNC (ADD, string, text);
 }
 
+/**
+ * g_paste_client_add_fd:
+ * @self: a #GPasteClient instance
+ * @fd: the file descriptor to read the contents to add from
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * Add what can be read from @fd (a file, a pipe...) to the #GPasteDaemon,
+ * without sending it through the bus. @fd is left open.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_add_fd (GPasteClient       *self,
+                       gint                fd,
+                       GAsyncReadyCallback callback,
+                       gpointer            user_data)
+{
+    g_return_if_fail (G_PASTE_IS_CLIENT (self));
+    g_return_if_fail (fd >= 0);
+
+    GUnixFDList *fd_list = g_unix_fd_list_new ();
+
+    /* Let the call report the error, if any */
+    g_unix_fd_list_append (fd_list, fd, NULL);
+    g_dbus_proxy_call_with_unix_fd_list (G_DBUS_PROXY (self),
+                                         G_PASTE_DAEMON_ADD_FD,
+                                         g_variant_new ("(h)", 0),
+                                         G_DBUS_CALL_FLAGS_NONE,
+                                         -1,
+                                         fd_list,
+                                         NULL, /* cancellable */
+                                         callback,
+                                         user_data);
+    g_object_unref (fd_list);
+}
+
 /**
  * g_paste_client_add_file:
  * @self: a #GPasteClient instance
@@ -1014,6 +1876,14 @@ g_paste_client_get_element (GPasteClient       *self,
                             GAsyncReadyCallback callback,
                             gpointer            user_data)
 {
+    const gchar *display_string = g_paste_client_cache_lookup_display_string (self, index);
+
+    if (display_string)
+    {
+        g_paste_client_return_cached (self, g_strdup (display_string), g_free, callback, user_data);
+        return;
+    }
+
     DBUS_CALL_ONE_PARAM_ASYNC (GET_ELEMENT, uint64, index);
 }
 
@@ -1035,6 +1905,16 @@ g_paste_client_get_element_kind (GPasteClient       *self,
                                  GAsyncReadyCallback callback,
                                  gpointer            user_data)
 {
+    const GPasteClientItem *item = g_paste_client_cache_lookup (self, index);
+
+    if (item)
+    {
+        GEnumValue *kind = g_enum_get_value (g_type_class_peek (G_PASTE_TYPE_ITEM_KIND), g_paste_client_item_get_kind (item));
+
+        g_paste_client_return_cached (self, g_strdup ((kind) ? kind->value_nick : ""), g_free, callback, user_data);
+        return;
+    }
+
     DBUS_CALL_ONE_PARAM_ASYNC (GET_ELEMENT_KIND, uint64, index);
 }
 
@@ -1058,6 +1938,12 @@ g_paste_client_get_elements (GPasteClient       *self,
                              GAsyncReadyCallback callback,
                              gpointer            user_data)
 {
+    if (g_paste_client_cache_has_indexes (self, indexes, n_indexes))
+    {
+        g_paste_client_return_cached (self, g_paste_client_cache_get_strv (self, indexes, n_indexes), (GDestroyNotify) g_strfreev, callback, user_data);
+        return;
+    }
+
     GVariant *param = compute_at_param (indexes, n_indexes);
     DBUS_CALL_ONE_PARAMV_ASYNC (GET_ELEMENTS, param);
 }
@@ -1078,6 +1964,14 @@ g_paste_client_get_history (GPasteClient       *self,
                             GAsyncReadyCallback callback,
                             gpointer            user_data)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (g_paste_client_cache_has_range (self, 0, G_MAXUINT64))
+    {
+        g_paste_client_return_cached (self, g_paste_client_cache_get_strv (self, NULL, priv->cache_length), (GDestroyNotify) g_strfreev, callback, user_data);
+        return;
+    }
+
     DBUS_CALL_NO_PARAM_ASYNC (GET_HISTORY);
 }
 
@@ -1097,6 +1991,14 @@ g_paste_client_get_history_name (GPasteClient       *self,
                                  GAsyncReadyCallback callback,
                                  gpointer            user_data)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (g_paste_client_cache_has_name (self))
+    {
+        g_paste_client_return_cached (self, g_strdup (priv->cache_name), g_free, callback, user_data);
+        return;
+    }
+
     DBUS_CALL_NO_PARAM_ASYNC (GET_HISTORY_NAME);
 }
 
@@ -1118,9 +2020,51 @@ g_paste_client_get_history_size (GPasteClient       *self,
                                  GAsyncReadyCallback callback,
                                  gpointer            user_data)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
+
+    if (g_paste_client_cache_has_size (self, name))
+    {
+        g_paste_client_return_cached (self, g_memdup (&priv->cache_length, sizeof (guint64)), g_free, callback, user_data);
+        return;
+    }
+
     DBUS_CALL_ONE_PARAM_ASYNC (GET_HISTORY_SIZE, string, name);
 }
 
+/**
+ * g_paste_client_get_items_page:
+ * @self: a #GPasteClient instance
+ * @start: the index of the first item we want to get
+ * @count: the number of items we want to get
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * Get a whole range of items from the #GPasteDaemon in one call
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_get_items_page (GPasteClient       *self,
+                               guint64             start,
+                               guint64             count,
+                               GAsyncReadyCallback callback,
+                               gpointer            user_data)
+{
+    if (g_paste_client_cache_has_range (self, start, count))
+    {
+        g_paste_client_return_cached (self, g_paste_client_cache_get_range (self, start, count), g_paste_client_free_items, callback, user_data);
+        return;
+    }
+
+    GVariant *params[] = {
+        g_variant_new_uint64 (start),
+        g_variant_new_uint64 (count)
+    };
+
+    DBUS_CALL_TWO_PARAMS_ASYNC (GET_ITEMS_PAGE, params);
+}
+
 /**
  * g_paste_client_get_raw_element:
  * @self: a #GPasteClient instance
@@ -1142,6 +2086,38 @@ g_paste_client_get_raw_element (GPasteClient       *self,
     DBUS_CALL_ONE_PARAM_ASYNC (GET_RAW_ELEMENT, uint64, index);
 }
 
+/**
+ * g_paste_client_get_raw_element_fd:
+ * @self: a #GPasteClient instance
+ * @index: the index of the element we want to get
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * Get an item from the #GPasteDaemon as a file descriptor to read it from,
+ * without sending it through the bus
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_get_raw_element_fd (GPasteClient       *self,
+                                   guint64             index,
+                                   GAsyncReadyCallback callback,
+                                   gpointer            user_data)
+{
+    g_return_if_fail (G_PASTE_IS_CLIENT (self));
+
+    g_dbus_proxy_call_with_unix_fd_list (G_DBUS_PROXY (self),
+                                         G_PASTE_DAEMON_GET_RAW_ELEMENT_FD,
+                                         g_variant_new ("(t)", index),
+                                         G_DBUS_CALL_FLAGS_NONE,
+                                         -1,
+                                         NULL, /* fd list */
+                                         NULL, /* cancellable */
+                                         callback,
+                                         user_data);
+}
+
 /**
  * g_paste_client_get_raw_history:
  * @self: a #GPasteClient instance
@@ -1180,6 +2156,25 @@ g_paste_client_list_histories (GPasteClient       *self,
     DBUS_CALL_NO_PARAM_ASYNC (LIST_HISTORIES);
 }
 
+/**
+ * g_paste_client_list_histories_info:
+ * @self: a #GPasteClient instance
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * List all available histories along with what there is to know about them
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_list_histories_info (GPasteClient       *self,
+                                    GAsyncReadyCallback callback,
+                                    gpointer            user_data)
+{
+    DBUS_CALL_NO_PARAM_ASYNC (LIST_HISTORIES_INFO);
+}
+
 /**
  * g_paste_client_merge:
  * @self: a #GPasteClient instance
@@ -1256,6 +2251,43 @@ g_paste_client_reexecute (GPasteClient       *self,
     DBUS_CALL_NO_PARAM_ASYNC (REEXECUTE);
 }
 
+/**
+ * g_paste_client_refine_search:
+ * @self: a #GPasteClient instance
+ * @token: the token given along with the previous results
+ * @previous_pattern: the pattern of the previous search
+ * @previous_results: (array length=n_previous_results): the results of the previous search
+ * @n_previous_results: the number of results of the previous search
+ * @pattern: the pattern to look for in history
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * Search for items matching @pattern in history, only looking at the previous
+ * results if the history didn't change and @pattern extends @previous_pattern
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_refine_search (GPasteClient       *self,
+                              guint64             token,
+                              const gchar        *previous_pattern,
+                              const guint64      *previous_results,
+                              guint64             n_previous_results,
+                              const gchar        *pattern,
+                              GAsyncReadyCallback callback,
+                              gpointer            user_data)
+{
+    GVariant *params[] = {
+        g_variant_new_uint64 (token),
+        g_variant_new_string (previous_pattern),
+        compute_at_param (previous_results, n_previous_results),
+        g_variant_new_string (pattern)
+    };
+
+    DBUS_CALL_ASYNC_FULL (CLIENT, {}, G_PASTE_DAEMON_REFINE_SEARCH, params, 4);
+}
+
 /**
  * g_paste_client_rename_password:
  * @self: a #GPasteClient instance
@@ -1333,6 +2365,28 @@ g_paste_client_search (GPasteClient       *self,
     DBUS_CALL_ONE_PARAM_ASYNC (SEARCH, string, pattern);
 }
 
+/**
+ * g_paste_client_search_all:
+ * @self: a #GPasteClient instance
+ * @pattern: the pattern to look for in the histories
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * Search for items matching @pattern in all the histories,
+ * not only the current one
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_search_all (GPasteClient       *self,
+                           const gchar        *pattern,
+                           GAsyncReadyCallback callback,
+                           gpointer            user_data)
+{
+    DBUS_CALL_ONE_PARAM_ASYNC (SEARCH_ALL, string, pattern);
+}
+
 /**
  * g_paste_client_select:
  * @self: a #GPasteClient instance
@@ -1401,6 +2455,28 @@ g_paste_client_show_history (GPasteClient       *self,
     DBUS_CALL_NO_PARAM_ASYNC (SHOW_HISTORY);
 }
 
+/**
+ * g_paste_client_start_search:
+ * @self: a #GPasteClient instance
+ * @pattern: the pattern to look for in history
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the request is satisfied or %NULL if you don't
+ * care about the result of the method invocation.
+ * @user_data: (nullable): The data to pass to @callback.
+ *
+ * Search for items matching @pattern in history, and get a token
+ * to refine that search afterwards
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_start_search (GPasteClient       *self,
+                             const gchar        *pattern,
+                             GAsyncReadyCallback callback,
+                             gpointer            user_data)
+{
+    DBUS_CALL_ONE_PARAM_ASYNC (START_SEARCH, string, pattern);
+}
+
 /**
  * g_paste_client_switch_history:
  * @self: a #GPasteClient instance
@@ -1504,6 +2580,31 @@ g_paste_client_add_finish (GPasteClient *self,
     DBUS_ASYNC_FINISH_NO_RETURN;
 }
 
+/**
+ * g_paste_client_add_fd_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @error: a #GError
+ *
+ * Add what can be read from a file descriptor to the #GPasteDaemon
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_client_add_fd_finish (GPasteClient *self,
+                              GAsyncResult *result,
+                              GError      **error)
+{
+    g_return_if_fail (G_PASTE_IS_CLIENT (self));
+    g_return_if_fail (G_IS_ASYNC_RESULT (result));
+    g_return_if_fail (!error || !(*error));
+
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_with_unix_fd_list_finish (G_DBUS_PROXY (self),
+                                                                               NULL, /* out fd list */
+                                                                               result,
+                                                                               error);
+}
+
 /**
  * g_paste_client_add_file_finish:
  * @self: a #GPasteClient instance
@@ -1645,6 +2746,9 @@ g_paste_client_get_element_finish (GPasteClient *self,
                                    GAsyncResult *result,
                                    GError      **error)
 {
+    if (g_paste_client_is_cached_result (self, result))
+        return g_task_propagate_pointer (G_TASK (result), error);
+
     DBUS_ASYNC_FINISH_RET_STRING;
 }
 
@@ -1653,6 +2757,9 @@ _g_paste_client_get_element_kind_finish (GPasteClient *self,
                                          GAsyncResult *result,
                                          GError      **error)
 {
+    if (g_paste_client_is_cached_result (self, result))
+        return g_task_propagate_pointer (G_TASK (result), error);
+
     DBUS_ASYNC_FINISH_RET_STRING;
 }
 
@@ -1692,6 +2799,9 @@ g_paste_client_get_elements_finish (GPasteClient *self,
                                     GAsyncResult *result,
                                     GError      **error)
 {
+    if (g_paste_client_is_cached_result (self, result))
+        return g_task_propagate_pointer (G_TASK (result), error);
+
     DBUS_ASYNC_FINISH_RET_STRV;
 }
 
@@ -1710,6 +2820,9 @@ g_paste_client_get_history_finish (GPasteClient *self,
                                    GAsyncResult *result,
                                    GError      **error)
 {
+    if (g_paste_client_is_cached_result (self, result))
+        return g_task_propagate_pointer (G_TASK (result), error);
+
     DBUS_ASYNC_FINISH_RET_STRV;
 }
 
@@ -1728,6 +2841,9 @@ g_paste_client_get_history_name_finish (GPasteClient *self,
                                         GAsyncResult *result,
                                         GError      **error)
 {
+    if (g_paste_client_is_cached_result (self, result))
+        return g_task_propagate_pointer (G_TASK (result), error);
+
     DBUS_ASYNC_FINISH_RET_STRING;
 }
 
@@ -1746,9 +2862,38 @@ g_paste_client_get_history_size_finish (GPasteClient *self,
                                         GAsyncResult *result,
                                         GError      **error)
 {
+    if (g_paste_client_is_cached_result (self, result))
+    {
+        g_autofree guint64 *size = g_task_propagate_pointer (G_TASK (result), error);
+
+        return (size) ? *size : 0;
+    }
+
     DBUS_ASYNC_FINISH_RET_UINT64;
 }
 
+/**
+ * g_paste_client_get_items_page_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @error: a #GError
+ *
+ * Get a whole range of items from the #GPasteDaemon in one call
+ *
+ * Returns: (element-type GPasteClientItem) (transfer full): the items, free
+ *          them with g_list_free_full and g_object_unref
+ */
+G_PASTE_VISIBLE GList *
+g_paste_client_get_items_page_finish (GPasteClient *self,
+                                      GAsyncResult *result,
+                                      GError      **error)
+{
+    if (g_paste_client_is_cached_result (self, result))
+        return g_task_propagate_pointer (G_TASK (result), error);
+
+    DBUS_ASYNC_FINISH_WITH_RETURN (CLIENT, NULL, return get_items_page_result (variant));
+}
+
 /**
  * g_paste_client_get_raw_element_finish:
  * @self: a #GPasteClient instance
@@ -1767,6 +2912,34 @@ g_paste_client_get_raw_element_finish (GPasteClient *self,
     DBUS_ASYNC_FINISH_RET_STRING;
 }
 
+/**
+ * g_paste_client_get_raw_element_fd_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @error: a #GError
+ *
+ * Get an item from the #GPasteDaemon as a file descriptor to read it from
+ *
+ * Returns: a file descriptor to close once done with it, or -1 on error
+ */
+G_PASTE_VISIBLE gint
+g_paste_client_get_raw_element_fd_finish (GPasteClient *self,
+                                          GAsyncResult *result,
+                                          GError      **error)
+{
+    g_return_val_if_fail (G_PASTE_IS_CLIENT (self), -1);
+    g_return_val_if_fail (G_IS_ASYNC_RESULT (result), -1);
+    g_return_val_if_fail (!error || !(*error), -1);
+
+    GUnixFDList *fd_list = NULL;
+    g_autoptr (GVariant) _result = g_dbus_proxy_call_with_unix_fd_list_finish (G_DBUS_PROXY (self),
+                                                                               &fd_list,
+                                                                               result,
+                                                                               error);
+
+    return g_paste_client_get_fd_result (_result, fd_list, error);
+}
+
 /**
  * g_paste_client_get_raw_history_finish:
  * @self: a #GPasteClient instance
@@ -1803,6 +2976,25 @@ g_paste_client_list_histories_finish (GPasteClient *self,
     DBUS_ASYNC_FINISH_RET_STRV;
 }
 
+/**
+ * g_paste_client_list_histories_info_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @error: a #GError
+ *
+ * List all available histories along with what there is to know about them
+ *
+ * Returns: (transfer full): the name, number of items, size in bytes, modification time
+ *                           and preview of the first item of each history, as "a(sttxs)"
+ */
+G_PASTE_VISIBLE GVariant *
+g_paste_client_list_histories_info_finish (GPasteClient *self,
+                                           GAsyncResult *result,
+                                           GError      **error)
+{
+    DBUS_ASYNC_FINISH_WITH_RETURN (CLIENT, NULL, return g_variant_ref (variant));
+}
+
 /**
  * g_paste_client_merge_finish:
  * @self: a #GPasteClient instance
@@ -1857,6 +3049,29 @@ g_paste_client_reexecute_finish (GPasteClient *self,
     DBUS_ASYNC_FINISH_NO_RETURN;
 }
 
+/**
+ * g_paste_client_refine_search_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @new_token: (out) (optional): the token to give to the next refinement
+ * @hits: (out) (optional): number of hits
+ * @error: a #GError
+ *
+ * Search for items matching @pattern in history, only looking at the previous
+ * results if the history didn't change and @pattern extends @previous_pattern
+ *
+ * Returns: (array length=hits): The indexes of the matching items
+ */
+G_PASTE_VISIBLE guint64 *
+g_paste_client_refine_search_finish (GPasteClient *self,
+                                     GAsyncResult *result,
+                                     guint64      *new_token,
+                                     guint64      *hits,
+                                     GError      **error)
+{
+    DBUS_ASYNC_FINISH_WITH_RETURN (CLIENT, NULL, return get_search_result (_result, new_token, hits));
+}
+
 /**
  * g_paste_client_rename_password_finish:
  * @self: a #GPasteClient instance
@@ -1913,6 +3128,26 @@ g_paste_client_search_finish (GPasteClient *self,
     DBUS_ASYNC_FINISH_RET_AT (hits);
 }
 
+/**
+ * g_paste_client_search_all_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @error: a #GError
+ *
+ * Search for items matching @pattern in all the histories,
+ * not only the current one
+ *
+ * Returns: (transfer full): for each history with matching items, its name and
+ *                           the index and a snippet of each of them, as "a(sa(ts))"
+ */
+G_PASTE_VISIBLE GVariant *
+g_paste_client_search_all_finish (GPasteClient *self,
+                                  GAsyncResult *result,
+                                  GError      **error)
+{
+    DBUS_ASYNC_FINISH_WITH_RETURN (CLIENT, NULL, return g_variant_ref (variant));
+}
+
 /**
  * g_paste_client_select_finish:
  * @self: a #GPasteClient instance
@@ -1967,6 +3202,29 @@ g_paste_client_show_history_finish (GPasteClient *self,
     DBUS_ASYNC_FINISH_NO_RETURN;
 }
 
+/**
+ * g_paste_client_start_search_finish:
+ * @self: a #GPasteClient instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to the async call.
+ * @token: (out) (optional): the token to give to g_paste_client_refine_search
+ * @hits: (out) (optional): number of hits
+ * @error: a #GError
+ *
+ * Search for items matching @pattern in history, and get a token
+ * to refine that search afterwards
+ *
+ * Returns: (array length=hits): The indexes of the matching items
+ */
+G_PASTE_VISIBLE guint64 *
+g_paste_client_start_search_finish (GPasteClient *self,
+                                    GAsyncResult *result,
+                                    guint64      *token,
+                                    guint64      *hits,
+                                    GError      **error)
+{
+    DBUS_ASYNC_FINISH_WITH_RETURN (CLIENT, NULL, return get_search_result (_result, token, hits));
+}
+
 /**
  * g_paste_client_switch_history_finish:
  * @self: a #GPasteClient instance
@@ -2066,6 +3324,54 @@ g_paste_client_g_signal (GDBusProxy  *proxy,
     else HANDLE_SIGNAL_WITH_DATA (EMPTY_HISTORY,  const gchar *, g_variant_get_string (variant, NULL))
     else HANDLE_SIGNAL_WITH_DATA (SWITCH_HISTORY, const gchar *, g_variant_get_string (variant, NULL))
     else HANDLE_SIGNAL_WITH_DATA (TRACKING,       gboolean,      g_variant_get_boolean (variant))
+    else if (!g_strcmp0 (signal_name, G_PASTE_DAEMON_SIG_DELTA))
+    {
+        GVariantIter params_iter;
+        g_variant_iter_init (&params_iter, parameters);
+        g_autoptr (GVariant) v1 = g_variant_iter_next_value (&params_iter);
+        g_autoptr (GVariant) v2 = g_variant_iter_next_value (&params_iter);
+        g_autoptr (GVariant) v3 = g_variant_iter_next_value (&params_iter);
+        g_autoptr (GVariant) v4 = g_variant_iter_next_value (&params_iter);
+        g_autoptr (GVariant) v5 = g_variant_iter_next_value (&params_iter);
+        GList *item = get_items_page_result (v5);
+        GEnumValue *action = g_enum_get_value_by_nick (g_type_class_peek (G_PASTE_TYPE_UPDATE_ACTION), g_variant_get_string (v2, NULL));
+        GEnumValue *target = g_enum_get_value_by_nick (g_type_class_peek (G_PASTE_TYPE_UPDATE_TARGET), g_variant_get_string (v3, NULL));
+
+        /* Update the cache first so that handlers see the new state */
+        g_paste_client_cache_apply_delta (self,
+                                          g_variant_get_uint64 (v1),
+                                          (action) ? action->value : G_PASTE_UPDATE_ACTION_INVALID,
+                                          (target) ? target->value : G_PASTE_UPDATE_TARGET_INVALID,
+                                          g_variant_get_uint64 (v4),
+                                          (item) ? item->data : NULL);
+
+        g_signal_emit (self,
+                       signals[DELTA],
+                       0, /* detail */
+                       g_variant_get_uint64 (v1),
+                       (action) ? action->value : G_PASTE_UPDATE_ACTION_INVALID,
+                       (target) ? target->value : G_PASTE_UPDATE_TARGET_INVALID,
+                       g_variant_get_uint64 (v4),
+                       (item) ? item->data : NULL,
+                       NULL);
+        g_list_free_full (item, g_object_unref);
+    }
+    else if (!g_strcmp0 (signal_name, G_PASTE_DAEMON_SIG_SEARCH_ALL_RESULT))
+    {
+        GVariantIter params_iter;
+        g_variant_iter_init (&params_iter, parameters);
+        g_autoptr (GVariant) v1 = g_variant_iter_next_value (&params_iter);
+        g_autoptr (GVariant) v2 = g_variant_iter_next_value (&params_iter);
+        g_autoptr (GVariant) v3 = g_variant_iter_next_value (&params_iter);
+
+        g_signal_emit (self,
+                       signals[SEARCH_ALL_RESULT],
+                       0, /* detail */
+                       g_variant_get_string (v1, NULL),
+                       g_variant_get_string (v2, NULL),
+                       v3,
+                       NULL);
+    }
     else if (!g_strcmp0 (signal_name, G_PASTE_DAEMON_SIG_UPDATE))
     {
         GVariantIter params_iter;
@@ -2083,9 +3389,21 @@ g_paste_client_g_signal (GDBusProxy  *proxy,
     }
 }
 
+static void
+g_paste_client_finalize (GObject *object)
+{
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (G_PASTE_CLIENT (object));
+
+    g_free (priv->cache_name);
+    g_ptr_array_unref (priv->cache_items);
+
+    G_OBJECT_CLASS (g_paste_client_parent_class)->finalize (object);
+}
+
 static void
 g_paste_client_class_init (GPasteClientClass *klass)
 {
+    G_OBJECT_CLASS (klass)->finalize = g_paste_client_finalize;
     G_DBUS_PROXY_CLASS (klass)->g_signal = g_paste_client_g_signal;
 
     /**
@@ -2098,6 +3416,35 @@ g_paste_client_class_init (GPasteClientClass *klass)
      */
     signals[DELETE_HISTORY] = NEW_SIGNAL_WITH_DATA ("delete-history", STRING);
 
+    /**
+     * GPasteClient::delta:
+     * @client: the object on which the signal was emitted
+     * @version: the version of the history once the change is applied
+     * @action: the kind of change
+     * @target: POSITION for a single item, ALL when the whole history changed
+     * @index: the position of the change, when the target is POSITION
+     * @item: (nullable): the added or new item, if any
+     *
+     * The "delta" signal is emitted for each elementary change made to the
+     * history. Applying them in order keeps a local copy of the history
+     * in sync; a gap in @version means one was missed and the history has
+     * to be fetched again, as when @target is ALL.
+     */
+    signals[DELTA] = g_signal_new ("delta",
+                                   G_PASTE_TYPE_CLIENT,
+                                   G_SIGNAL_RUN_LAST,
+                                   0, /* class offset */
+                                   NULL, /* accumulator */
+                                   NULL, /* accumulator data */
+                                   g_cclosure_marshal_generic,
+                                   G_TYPE_NONE,
+                                   5, /* number of params */
+                                   G_TYPE_UINT64,
+                                   G_PASTE_TYPE_UPDATE_ACTION,
+                                   G_PASTE_TYPE_UPDATE_TARGET,
+                                   G_TYPE_UINT64,
+                                   G_PASTE_TYPE_CLIENT_ITEM);
+
     /**
      * GPasteClient::empty-history:
      * @client: the object on which the signal was emitted
@@ -2108,6 +3455,30 @@ g_paste_client_class_init (GPasteClientClass *klass)
      */
     signals[EMPTY_HISTORY] = NEW_SIGNAL_WITH_DATA ("empty-history", STRING);
 
+    /**
+     * GPasteClient::search-all-result:
+     * @client: the object on which the signal was emitted
+     * @query: the pattern given to g_paste_client_search_all
+     * @history: the name of a history with matching items
+     * @results: a #GVariant of type "a(ts)": the index and a snippet of each of them
+     *
+     * The "search-all-result" signal is emitted during g_paste_client_search_all
+     * for each history with matching items, as soon as it has been searched, so
+     * that they can be shown without waiting for all the histories.
+     */
+    signals[SEARCH_ALL_RESULT] = g_signal_new ("search-all-result",
+                                               G_PASTE_TYPE_CLIENT,
+                                               G_SIGNAL_RUN_LAST,
+                                               0, /* class offset */
+                                               NULL, /* accumulator */
+                                               NULL, /* accumulator data */
+                                               g_cclosure_marshal_generic,
+                                               G_TYPE_NONE,
+                                               3, /* number of params */
+                                               G_TYPE_STRING,
+                                               G_TYPE_STRING,
+                                               G_TYPE_VARIANT);
+
     /**
      * GPasteClient::show-history:
      * @client: the object on which the signal was emitted
@@ -2164,7 +3535,11 @@ g_paste_client_class_init (GPasteClientClass *klass)
 static void
 g_paste_client_init (GPasteClient *self)
 {
+    GPasteClientPrivate *priv = g_paste_client_get_instance_private (self);
     GDBusProxy *proxy = G_DBUS_PROXY (self);
+
+    priv->cache_items = g_ptr_array_new_with_free_func (g_object_unref);
+
     g_autoptr (GDBusNodeInfo) g_paste_daemon_dbus_info = g_dbus_node_info_new_for_xml (G_PASTE_DAEMON_INTERFACE,
                                                                                        NULL); /* Error */
 
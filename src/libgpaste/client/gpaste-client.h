@@ -24,6 +24,7 @@
 #ifndef __G_PASTE_CLIENT_H__
 #define __G_PASTE_CLIENT_H__
 
+#include <gpaste-client-item.h>
 #include <gpaste-item-enums.h>
 #include <gpaste-macros.h>
 
@@ -42,6 +43,9 @@ void     g_paste_client_about_sync                      (GPasteClient  *self,
 void     g_paste_client_add_sync                        (GPasteClient  *self,
                                                          const gchar   *text,
                                                          GError       **error);
+void     g_paste_client_add_fd_sync                     (GPasteClient  *self,
+                                                         gint           fd,
+                                                         GError       **error);
 void     g_paste_client_add_file_sync                   (GPasteClient  *self,
                                                          const gchar   *file,
                                                          GError       **error);
@@ -79,9 +83,16 @@ gchar   *g_paste_client_get_history_name_sync           (GPasteClient  *self,
 guint64  g_paste_client_get_history_size_sync           (GPasteClient  *self,
                                                          const gchar   *name,
                                                          GError       **error);
+GList   *g_paste_client_get_items_page_sync             (GPasteClient  *self,
+                                                         guint64        start,
+                                                         guint64        count,
+                                                         GError       **error);
 gchar   *g_paste_client_get_raw_element_sync            (GPasteClient  *self,
                                                          guint64        index,
                                                          GError       **error);
+gint     g_paste_client_get_raw_element_fd_sync         (GPasteClient  *self,
+                                                         guint64        index,
+                                                         GError       **error);
 GStrv    g_paste_client_get_raw_history_sync            (GPasteClient  *self,
                                                          GError       **error);
 GStrv    g_paste_client_list_histories_sync             (GPasteClient  *self,
@@ -97,6 +108,15 @@ void     g_paste_client_on_extension_state_changed_sync (GPasteClient  *self,
                                                          GError       **error);
 void     g_paste_client_reexecute_sync                  (GPasteClient  *self,
                                                          GError       **error);
+guint64 *g_paste_client_refine_search_sync              (GPasteClient  *self,
+                                                         guint64        token,
+                                                         const gchar   *previous_pattern,
+                                                         const guint64 *previous_results,
+                                                         guint64        n_previous_results,
+                                                         const gchar   *pattern,
+                                                         guint64       *new_token,
+                                                         guint64       *hits,
+                                                         GError       **error);
 void     g_paste_client_rename_password_sync            (GPasteClient  *self,
                                                          const gchar   *old_name,
                                                          const gchar   *new_name,
@@ -118,6 +138,11 @@ void     g_paste_client_set_password_sync               (GPasteClient  *self,
                                                          GError       **error);
 void     g_paste_client_show_history_sync               (GPasteClient  *self,
                                                          GError       **error);
+guint64 *g_paste_client_start_search_sync               (GPasteClient  *self,
+                                                         const gchar   *pattern,
+                                                         guint64       *token,
+                                                         guint64       *hits,
+                                                         GError       **error);
 void     g_paste_client_switch_history_sync             (GPasteClient  *self,
                                                          const gchar   *name,
                                                          GError       **error);
@@ -128,9 +153,14 @@ void     g_paste_client_upload_sync                     (GPasteClient  *self,
                                                          guint64        index,
                                                          GError       **error);
 
-GPasteItemKind g_paste_client_get_element_kind_sync (GPasteClient  *self,
-                                                     guint64        index,
-                                                     GError       **error);
+GPasteItemKind g_paste_client_get_element_kind_sync    (GPasteClient  *self,
+                                                        guint64        index,
+                                                        GError       **error);
+GVariant      *g_paste_client_list_histories_info_sync (GPasteClient  *self,
+                                                        GError       **error);
+GVariant      *g_paste_client_search_all_sync          (GPasteClient  *self,
+                                                        const gchar   *pattern,
+                                                        GError       **error);
 /*******************/
 /* Methods / Async */
 /*******************/
@@ -142,6 +172,10 @@ void g_paste_client_add                        (GPasteClient       *self,
                                                 const gchar        *text,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_add_fd                     (GPasteClient       *self,
+                                                gint                fd,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_add_file                   (GPasteClient       *self,
                                                 const gchar        *file,
                                                 GAsyncReadyCallback callback,
@@ -195,16 +229,28 @@ void g_paste_client_get_history_size           (GPasteClient       *self,
                                                 const gchar        *name,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_get_items_page             (GPasteClient       *self,
+                                                guint64             start,
+                                                guint64             count,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_get_raw_element            (GPasteClient       *self,
                                                 guint64             index,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_get_raw_element_fd         (GPasteClient       *self,
+                                                guint64             index,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_get_raw_history            (GPasteClient       *self,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
 void g_paste_client_list_histories             (GPasteClient       *self,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_list_histories_info        (GPasteClient       *self,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_merge                      (GPasteClient       *self,
                                                 const gchar        *decoration,
                                                 const gchar        *separator,
@@ -219,6 +265,14 @@ void g_paste_client_on_extension_state_changed (GPasteClient       *self,
 void g_paste_client_reexecute                  (GPasteClient       *self,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_refine_search              (GPasteClient       *self,
+                                                guint64             token,
+                                                const gchar        *previous_pattern,
+                                                const guint64      *previous_results,
+                                                guint64             n_previous_results,
+                                                const gchar        *pattern,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_rename_password            (GPasteClient       *self,
                                                 const gchar        *old_name,
                                                 const gchar        *new_name,
@@ -233,6 +287,10 @@ void g_paste_client_search                     (GPasteClient       *self,
                                                 const gchar        *pattern,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_search_all                 (GPasteClient       *self,
+                                                const gchar        *pattern,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_select                     (GPasteClient       *self,
                                                 guint64             index,
                                                 GAsyncReadyCallback callback,
@@ -245,6 +303,10 @@ void g_paste_client_set_password               (GPasteClient       *self,
 void g_paste_client_show_history               (GPasteClient       *self,
                                                 GAsyncReadyCallback callback,
                                                 gpointer            user_data);
+void g_paste_client_start_search               (GPasteClient       *self,
+                                                const gchar        *pattern,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
 void g_paste_client_switch_history             (GPasteClient       *self,
                                                 const gchar        *name,
                                                 GAsyncReadyCallback callback,
@@ -268,6 +330,9 @@ void     g_paste_client_about_finish                      (GPasteClient *self,
 void     g_paste_client_add_finish                        (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
+void     g_paste_client_add_fd_finish                     (GPasteClient *self,
+                                                           GAsyncResult *result,
+                                                           GError      **error);
 void     g_paste_client_add_file_finish                   (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
@@ -304,9 +369,15 @@ gchar   *g_paste_client_get_history_name_finish           (GPasteClient *self,
 guint64  g_paste_client_get_history_size_finish           (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
+GList   *g_paste_client_get_items_page_finish             (GPasteClient *self,
+                                                           GAsyncResult *result,
+                                                           GError      **error);
 gchar   *g_paste_client_get_raw_element_finish            (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
+gint     g_paste_client_get_raw_element_fd_finish         (GPasteClient *self,
+                                                           GAsyncResult *result,
+                                                           GError      **error);
 GStrv    g_paste_client_get_raw_history_finish            (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
@@ -322,6 +393,11 @@ void     g_paste_client_on_extension_state_changed_finish (GPasteClient *self,
 void     g_paste_client_reexecute_finish                  (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
+guint64 *g_paste_client_refine_search_finish              (GPasteClient *self,
+                                                           GAsyncResult *result,
+                                                           guint64      *new_token,
+                                                           guint64      *hits,
+                                                           GError      **error);
 void     g_paste_client_rename_password_finish            (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
@@ -341,6 +417,11 @@ void     g_paste_client_set_password_finish               (GPasteClient *self,
 void     g_paste_client_show_history_finish               (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
+guint64 *g_paste_client_start_search_finish               (GPasteClient *self,
+                                                           GAsyncResult *result,
+                                                           guint64      *token,
+                                                           guint64      *hits,
+                                                           GError      **error);
 void     g_paste_client_switch_history_finish             (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
@@ -351,9 +432,22 @@ void     g_paste_client_upload_finish                     (GPasteClient *self,
                                                            GAsyncResult *result,
                                                            GError      **error);
 
-GPasteItemKind g_paste_client_get_element_kind_finish (GPasteClient *self,
-                                                       GAsyncResult *result,
-                                                       GError      **error);
+GPasteItemKind g_paste_client_get_element_kind_finish    (GPasteClient *self,
+                                                          GAsyncResult *result,
+                                                          GError      **error);
+GVariant      *g_paste_client_list_histories_info_finish (GPasteClient *self,
+                                                          GAsyncResult *result,
+                                                          GError      **error);
+GVariant      *g_paste_client_search_all_finish          (GPasteClient *self,
+                                                          GAsyncResult *result,
+                                                          GError      **error);
+
+/*********/
+/* Cache */
+/*********/
+
+void g_paste_client_set_cache_enabled (GPasteClient *self,
+                                       gboolean      enabled);
 
 /**************/
 /* Properties */
@@ -17,10 +17,11 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-fingerprint.h"
+
 #include <gpaste-clipboard.h>
 #include <gpaste-image-item.h>
 #include <gpaste-uris-item.h>
-#include <gpaste-util.h>
 
 #include <string.h>
 
@@ -31,13 +32,25 @@ struct _GPasteClipboard
 
 typedef struct
 {
-    GdkAtom         target;
-    GtkClipboard   *real;
-    GPasteSettings *settings;
-    gchar          *text;
-    gchar          *image_checksum;
-
-    gulong          owner_change_signal;
+    GdkAtom          target;
+    GtkClipboard    *real;
+    GPasteSettings  *settings;
+    gchar           *text;
+    gchar           *image_checksum;
+
+    /* The image item being loaded before being selected */
+    GPasteImageItem *pending_image;
+
+    /* Active poll, see g_paste_clipboard_fake_event */
+    guint            poll_source;
+    guint64          poll_interval;
+    GdkAtom         *poll_targets;
+    gint             poll_n_targets;
+    GBytes          *poll_timestamp;
+    guint64          poll_fetches;
+    guint64          poll_saved_fetches;
+
+    gulong           owner_change_signal;
 } GPasteClipboardPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GPasteClipboard, g_paste_clipboard, G_TYPE_OBJECT)
@@ -59,9 +72,9 @@ g_paste_clipboard_bootstrap_finish (GPasteClipboard *self,
 
     if (!priv->text && !priv->image_checksum)
     {
-        const GList *h = g_paste_history_get_history (history);
-        if (h)
-            g_paste_clipboard_select_item (self, h->data);
+        const GPasteItem *first = g_paste_history_get (history, 0);
+        if (first)
+            g_paste_clipboard_select_item (self, first);
     }
 }
 
@@ -175,6 +188,7 @@ g_paste_clipboard_private_set_text (GPasteClipboardPrivate *priv,
 {
     g_free (priv->text);
     g_free (priv->image_checksum);
+    g_clear_object (&priv->pending_image);
 
     priv->text = g_strdup (text);
     priv->image_checksum = NULL;
@@ -396,6 +410,7 @@ g_paste_clipboard_private_set_image_checksum (GPasteClipboardPrivate *priv,
 {
     g_free (priv->text);
     g_free (priv->image_checksum);
+    g_clear_object (&priv->pending_image);
 
     priv->text = NULL;
     priv->image_checksum = g_strdup (image_checksum);
@@ -437,9 +452,7 @@ g_paste_clipboard_on_image_ready (GtkClipboard *clipboard G_GNUC_UNUSED,
 
     GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
 
-    g_autofree gchar *checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
-                                                                        (guchar *) gdk_pixbuf_get_pixels (image),
-                                                                        -1);
+    const gchar *checksum = g_paste_fingerprint_image (image);
 
     if (g_strcmp0 (checksum, priv->image_checksum))
     {
@@ -485,6 +498,30 @@ g_paste_clipboard_set_image (GPasteClipboard             *self,
                                  data);
 }
 
+static void
+g_paste_clipboard_on_image_loaded (GObject      *source_object,
+                                   GAsyncResult *res,
+                                   gpointer      user_data)
+{
+    g_autoptr (GPasteClipboard) self = user_data;
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
+    GPasteImageItem *image_item = G_PASTE_IMAGE_ITEM (source_object);
+    GdkPixbuf *image = g_paste_image_item_load_image_finish (image_item,
+                                                             res,
+                                                             NULL); /* error */
+
+    /* Something else got into the clipboard in the meantime */
+    if (image && image_item == priv->pending_image)
+    {
+        g_paste_clipboard_private_select_image (priv,
+                                                image,
+                                                g_paste_image_item_get_checksum (image_item));
+    }
+
+    if (image)
+        g_object_unref (image);
+}
+
 /**
  * g_paste_clipboard_select_item:
  * @self: a #GPasteClipboard instance
@@ -507,12 +544,26 @@ g_paste_clipboard_select_item (GPasteClipboard  *self,
     {
         GPasteImageItem *image_item = G_PASTE_IMAGE_ITEM (item);
         const gchar *checksum = g_paste_image_item_get_checksum (image_item);
+        GdkPixbuf *image = g_paste_image_item_get_image (image_item);
 
-        if (g_strcmp0 (checksum, priv->image_checksum))
+        if (!checksum || g_strcmp0 (checksum, priv->image_checksum))
         {
-            g_paste_clipboard_private_select_image (priv,
-                                                    g_paste_image_item_get_image (image_item),
-                                                    checksum);
+            if (image)
+            {
+                g_paste_clipboard_private_select_image (priv,
+                                                        image,
+                                                        checksum);
+            }
+            else
+            {
+                /* Don't block on decoding the image, it gets selected once ready */
+                g_clear_object (&priv->pending_image);
+                priv->pending_image = g_object_ref (image_item);
+                g_paste_image_item_load_image (image_item,
+                                               NULL, /* cancellable */
+                                               g_paste_clipboard_on_image_loaded,
+                                               g_object_ref (self));
+            }
         }
     }
     else
@@ -545,6 +596,50 @@ g_paste_clipboard_owner_change (GtkClipboard        *clipboard G_GNUC_UNUSED,
                    NULL);
 }
 
+/*
+ * When the display can't notify us of selection changes, we poll it.
+ * Fetching the whole contents each time is expensive, so we first look at the
+ * targets and the timestamp of the selection, which change along with its owner,
+ * and we poll less and less often while nothing happens.
+ */
+
+#define G_PASTE_CLIPBOARD_POLL_MIN_INTERVAL 500  /* ms */
+#define G_PASTE_CLIPBOARD_POLL_MAX_INTERVAL 4000 /* ms */
+
+static gboolean g_paste_clipboard_fake_event (gpointer user_data);
+
+static void
+g_paste_clipboard_fake_event_schedule (GPasteClipboard *self,
+                                       gboolean         changed)
+{
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
+
+    if (changed)
+        priv->poll_interval = G_PASTE_CLIPBOARD_POLL_MIN_INTERVAL;
+    else
+        priv->poll_interval = MIN (priv->poll_interval * 2, G_PASTE_CLIPBOARD_POLL_MAX_INTERVAL);
+
+    priv->poll_source = g_timeout_add (priv->poll_interval, g_paste_clipboard_fake_event, self);
+    g_source_set_name_by_id (priv->poll_source, "[GPaste] clipboard fake events");
+}
+
+static void
+g_paste_clipboard_fake_event_finish (GPasteClipboard *self,
+                                     gboolean         changed)
+{
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
+
+    /* We got disposed in the meantime */
+    if (priv->settings)
+    {
+        if (changed)
+            g_paste_clipboard_owner_change (NULL, NULL, self);
+        g_paste_clipboard_fake_event_schedule (self, changed);
+    }
+
+    g_object_unref (self);
+}
+
 static void
 g_paste_clipboard_fake_event_finish_text (GtkClipboard *clipboard G_GNUC_UNUSED,
                                           const gchar  *text,
@@ -553,8 +648,7 @@ g_paste_clipboard_fake_event_finish_text (GtkClipboard *clipboard G_GNUC_UNUSED,
     GPasteClipboard *self = user_data;
     GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
 
-    if (g_strcmp0 (text, priv->text))
-        g_paste_clipboard_owner_change (NULL, NULL, self);
+    g_paste_clipboard_fake_event_finish (self, !!g_strcmp0 (text, priv->text));
 }
 
 static void
@@ -564,12 +658,113 @@ g_paste_clipboard_fake_event_finish_image (GtkClipboard *clipboard G_GNUC_UNUSED
 {
     GPasteClipboard *self = user_data;
     GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
-    g_autofree gchar *checksum = g_paste_util_compute_checksum (image);
+    const gchar *checksum = g_paste_fingerprint_image (image);
 
-    if (g_strcmp0 (checksum, priv->image_checksum))
-        g_paste_clipboard_owner_change (NULL, NULL, self);
+    g_paste_clipboard_fake_event_finish (self, !!g_strcmp0 (checksum, priv->image_checksum));
+}
+
+static void
+g_paste_clipboard_fake_event_fetch (GPasteClipboard *self)
+{
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
 
-    g_object_unref (image);
+    ++priv->poll_fetches;
+
+    if (priv->text)
+        gtk_clipboard_request_text (priv->real, g_paste_clipboard_fake_event_finish_text, self);
+    else
+        gtk_clipboard_request_image (priv->real, g_paste_clipboard_fake_event_finish_image, self);
+}
+
+static void
+g_paste_clipboard_fake_event_finish_timestamp (GtkClipboard     *clipboard G_GNUC_UNUSED,
+                                               GtkSelectionData *selection_data,
+                                               gpointer          user_data)
+{
+    GPasteClipboard *self = user_data;
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
+    gint length = gtk_selection_data_get_length (selection_data);
+
+    if (length <= 0)
+    {
+        /* No usable timestamp, we have to look at the contents */
+        g_clear_pointer (&priv->poll_timestamp, g_bytes_unref);
+        g_paste_clipboard_fake_event_fetch (self);
+        return;
+    }
+
+    g_autoptr (GBytes) timestamp = g_bytes_new (gtk_selection_data_get_data (selection_data), length);
+
+    if (priv->poll_timestamp && g_bytes_equal (timestamp, priv->poll_timestamp))
+    {
+        ++priv->poll_saved_fetches;
+        g_paste_clipboard_fake_event_finish (self, FALSE);
+        return;
+    }
+
+    gboolean changed = !!priv->poll_timestamp;
+
+    if (priv->poll_timestamp)
+        g_bytes_unref (priv->poll_timestamp);
+    priv->poll_timestamp = g_bytes_ref (timestamp);
+
+    /* The selection got a new owner, or we didn't know its timestamp yet */
+    if (changed)
+    {
+        ++priv->poll_saved_fetches;
+        g_paste_clipboard_fake_event_finish (self, TRUE);
+    }
+    else
+        g_paste_clipboard_fake_event_fetch (self);
+}
+
+static void
+g_paste_clipboard_fake_event_finish_targets (GtkClipboard *clipboard G_GNUC_UNUSED,
+                                             GdkAtom      *atoms,
+                                             gint          n_atoms,
+                                             gpointer      user_data)
+{
+    GPasteClipboard *self = user_data;
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
+    GdkAtom timestamp_target = gdk_atom_intern_static_string ("TIMESTAMP");
+    gboolean has_timestamp = FALSE;
+    gboolean same_targets = (n_atoms == priv->poll_n_targets);
+
+    for (gint i = 0; i < n_atoms; ++i)
+    {
+        if (same_targets && atoms[i] != priv->poll_targets[i])
+            same_targets = FALSE;
+        if (atoms[i] == timestamp_target)
+            has_timestamp = TRUE;
+    }
+
+    if (!same_targets)
+    {
+        gboolean known = !!priv->poll_targets;
+
+        g_free (priv->poll_targets);
+        priv->poll_targets = g_memdup (atoms, MAX (n_atoms, 0) * sizeof (GdkAtom));
+        priv->poll_n_targets = n_atoms;
+        g_clear_pointer (&priv->poll_timestamp, g_bytes_unref);
+
+        /* Other targets, other contents */
+        if (known)
+        {
+            ++priv->poll_saved_fetches;
+            g_paste_clipboard_fake_event_finish (self, TRUE);
+            return;
+        }
+    }
+
+    if (has_timestamp)
+    {
+        gtk_clipboard_request_contents (priv->real,
+                                        timestamp_target,
+                                        g_paste_clipboard_fake_event_finish_timestamp,
+                                        self);
+    }
+    else
+        g_paste_clipboard_fake_event_fetch (self);
 }
 
 static gboolean
@@ -578,14 +773,45 @@ g_paste_clipboard_fake_event (gpointer user_data)
     GPasteClipboard *self = user_data;
     GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
 
-    if (priv->text)
-        gtk_clipboard_request_text (priv->real, g_paste_clipboard_fake_event_finish_text, self);
-    else if (priv->image_checksum)
-        gtk_clipboard_request_image (priv->real, g_paste_clipboard_fake_event_finish_image, self);
+    priv->poll_source = 0;
+
+    if (priv->text || priv->image_checksum)
+    {
+        gtk_clipboard_request_targets (priv->real, g_paste_clipboard_fake_event_finish_targets, g_object_ref (self));
+    }
     else
+    {
         g_paste_clipboard_owner_change (NULL, NULL, self);
+        g_paste_clipboard_fake_event_schedule (self, FALSE);
+    }
 
-    return G_SOURCE_CONTINUE;
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * g_paste_clipboard_get_poll_statistics:
+ * @self: a #GPasteClipboard instance
+ * @fetches: (out): the number of times the contents were fetched by the active poll
+ * @saved_fetches: (out): the number of fetches which the targets or the timestamp made useless
+ *
+ * Get statistics about the active poll, used when the display can't
+ * notify us of selection changes
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_clipboard_get_poll_statistics (const GPasteClipboard *self,
+                                       guint64               *fetches,
+                                       guint64               *saved_fetches)
+{
+    g_return_if_fail (G_PASTE_IS_CLIPBOARD (self));
+
+    GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (self);
+
+    if (fetches)
+        *fetches = priv->poll_fetches;
+    if (saved_fetches)
+        *saved_fetches = priv->poll_saved_fetches;
 }
 
 static void
@@ -593,6 +819,14 @@ g_paste_clipboard_dispose (GObject *object)
 {
     GPasteClipboardPrivate *priv = g_paste_clipboard_get_instance_private (G_PASTE_CLIPBOARD (object));
 
+    g_clear_object (&priv->pending_image);
+
+    if (priv->poll_source)
+    {
+        g_source_remove (priv->poll_source);
+        priv->poll_source = 0;
+    }
+
     if (priv->settings)
     {
         g_signal_handler_disconnect (priv->real, priv->owner_change_signal);
@@ -609,6 +843,9 @@ g_paste_clipboard_finalize (GObject *object)
 
     g_free (priv->text);
     g_free (priv->image_checksum);
+    g_free (priv->poll_targets);
+    if (priv->poll_timestamp)
+        g_bytes_unref (priv->poll_timestamp);
 
     G_OBJECT_CLASS (g_paste_clipboard_parent_class)->finalize (object);
 }
@@ -680,10 +917,11 @@ g_paste_clipboard_new (GdkAtom         target,
                                                   G_CALLBACK (g_paste_clipboard_owner_change),
                                                   self);
 
+    /* This uses XFixes on X11, which is way cheaper than polling */
     if (!gdk_display_request_selection_notification (gdk_display_get_default (), target))
     {
         g_warning ("Selection notification not supported, using active poll");
-        g_source_set_name_by_id (g_timeout_add_seconds (1, g_paste_clipboard_fake_event, self), "[GPaste] clipboard fake events");
+        g_paste_clipboard_fake_event_schedule (self, TRUE);
     }
 
     return self;
@@ -58,6 +58,9 @@ void          g_paste_clipboard_set_image          (GPasteClipboard
                                                     gpointer                     user_data);
 void          g_paste_clipboard_select_item        (GPasteClipboard  *self,
                                                     const GPasteItem *item);
+void          g_paste_clipboard_get_poll_statistics (const GPasteClipboard *self,
+                                                     guint64               *fetches,
+                                                     guint64               *saved_fetches);
 
 GPasteClipboard *g_paste_clipboard_new (GdkAtom         target,
                                         GPasteSettings *settings);
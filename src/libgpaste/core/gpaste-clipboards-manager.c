@@ -121,9 +121,9 @@ g_paste_clipboards_manager_notify_finish (GPasteClipboardsManagerPrivate *priv,
 
     if (!something_in_clipboard)
     {
-        const GList *hist = g_paste_history_get_history (history);
-        if (hist)
-            g_paste_clipboard_select_item (clipboard, hist->data);
+        const GPasteItem *first = g_paste_history_get (history, 0);
+        if (first)
+            g_paste_clipboard_select_item (clipboard, first);
     }
 
     if (synchronized_text)
@@ -195,7 +195,7 @@ g_paste_clipboards_manager_image_ready (GPasteClipboard *clipboard,
 
     /* If our contents got updated */
     if (image && data->track)
-        item = G_PASTE_ITEM (g_paste_image_item_new (image));
+        item = G_PASTE_ITEM (g_paste_image_item_new_full (image, g_paste_settings_get_image_compression (priv->settings)));
 
     g_paste_clipboards_manager_notify_finish (priv, clipboard, item, NULL, something_in_clipboard);
 }
@@ -0,0 +1,749 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-binary.h"
+#include "gpaste-history-blobs.h"
+
+#include <gpaste-image-item.h>
+#include <gpaste-password-item.h>
+#include <gpaste-text-item.h>
+#include <gpaste-uris-item.h>
+
+#include <string.h>
+
+#define G_PASTE_HISTORY_BINARY_MAGIC   "GPasteHB"
+#define G_PASTE_HISTORY_BINARY_VERSION 1
+
+typedef enum
+{
+    G_PASTE_HISTORY_BINARY_KIND_TEXT,
+    G_PASTE_HISTORY_BINARY_KIND_URIS,
+    G_PASTE_HISTORY_BINARY_KIND_IMAGE,
+    /* Never written to disk, only handed off to a reexecuted daemon */
+    G_PASTE_HISTORY_BINARY_KIND_PASSWORD,
+    /* A text whose value is the id of the blob holding it */
+    G_PASTE_HISTORY_BINARY_KIND_BLOB
+} GPasteHistoryBinaryKind;
+
+/* All the integers are stored little endian */
+
+typedef struct
+{
+    gchar   magic[8];
+    guint32 version;
+    guint32 reserved;
+    guint64 serial;
+    guint64 n_items;
+} GPasteHistoryBinaryHeader;
+
+/*
+ * Entries hold what is known about images, so that loading them doesn't
+ * need to decode them. A checksum_length of 0 means no checksum.
+ * Passwords store their name where images store their checksum.
+ * Big texts may be stored as blobs, see gpaste-history-blobs.h.
+ * hash and length are the ones of the real value, blobs included, so that
+ * duplicates can be spotted and memory accounted without reading it.
+ */
+typedef struct
+{
+    guint32 kind;
+    guint32 reserved;
+    gint64  date;
+    guint64 value_offset;
+    guint64 value_length;
+    guint32 width;
+    guint32 height;
+    guint64 checksum_offset;
+    guint64 checksum_length;
+    guint64 hash;
+    guint64 length;
+} GPasteHistoryBinaryEntry;
+
+/* Keep the entries aligned in the mapping */
+G_STATIC_ASSERT (sizeof (GPasteHistoryBinaryHeader) == 32);
+G_STATIC_ASSERT (sizeof (GPasteHistoryBinaryEntry) == 72);
+
+/* What an entry slot points to */
+typedef struct
+{
+    GMappedFile *mapping;
+    guint64      index;
+} GPasteHistoryBinaryStub;
+
+#define G_PASTE_HISTORY_BINARY_STUB(slot) ((GPasteHistoryBinaryStub *) (GPOINTER_TO_SIZE (slot) & ~((gsize) 1)))
+
+static gpointer
+g_paste_history_binary_stub_new (GMappedFile *mapping,
+                                 guint64      index)
+{
+    GPasteHistoryBinaryStub *stub = g_new (GPasteHistoryBinaryStub, 1);
+
+    stub->mapping = g_mapped_file_ref (mapping);
+    stub->index = index;
+
+    /* Allocations are at least 2 bytes aligned, so the lowest bit is ours */
+    return GSIZE_TO_POINTER (GPOINTER_TO_SIZE (stub) | 1);
+}
+
+static const GPasteHistoryBinaryEntry *
+g_paste_history_binary_stub_get_entry (const GPasteHistoryBinaryStub *stub)
+{
+    const gchar *data = g_mapped_file_get_contents (stub->mapping);
+
+    return (const GPasteHistoryBinaryEntry *) (data + sizeof (GPasteHistoryBinaryHeader)) + stub->index;
+}
+
+/* The bounds are checked when loading, the terminator only now so that loading doesn't touch the values */
+static GBytes *
+g_paste_history_binary_stub_ref_string (const GPasteHistoryBinaryStub *stub,
+                                        guint64                        offset,
+                                        guint64                        string_length)
+{
+    const gchar *data = g_mapped_file_get_contents (stub->mapping);
+
+    if (data[offset + string_length])
+    {
+        g_warning ("Unterminated string in binary history");
+        return NULL;
+    }
+
+    return g_bytes_new_with_free_func (data + offset,
+                                       string_length + 1,
+                                       (GDestroyNotify) g_mapped_file_unref,
+                                       g_mapped_file_ref (stub->mapping));
+}
+
+/* Whatever got written, only hand out valid UTF-8 */
+static GBytes *
+g_paste_history_binary_validate (GBytes *string)
+{
+    if (!string)
+        return NULL;
+
+    gsize length;
+    const gchar *data = g_bytes_get_data (string, &length);
+    const gchar *end;
+
+    if (g_utf8_validate (data, length - 1, &end))
+        return string;
+
+    g_warning ("Invalid UTF-8 in binary history, only keeping the valid part");
+
+    guint64 valid_length = end - data;
+    gchar *valid = g_strndup (data, valid_length);
+
+    g_bytes_unref (string);
+
+    return g_bytes_new_take (valid, valid_length + 1);
+}
+
+static GBytes *
+g_paste_history_binary_stub_ref_checksum (const GPasteHistoryBinaryStub *stub)
+{
+    const GPasteHistoryBinaryEntry *entry = g_paste_history_binary_stub_get_entry (stub);
+    guint64 checksum_length = GUINT64_FROM_LE (entry->checksum_length);
+
+    if (!checksum_length && GUINT32_FROM_LE (entry->kind) != G_PASTE_HISTORY_BINARY_KIND_PASSWORD)
+        return NULL;
+
+    return g_paste_history_binary_validate (g_paste_history_binary_stub_ref_string (stub,
+                                                                                    GUINT64_FROM_LE (entry->checksum_offset),
+                                                                                    checksum_length));
+}
+
+static GBytes *
+g_paste_history_binary_stub_ref_value (const GPasteHistoryBinaryStub *stub)
+{
+    const GPasteHistoryBinaryEntry *entry = g_paste_history_binary_stub_get_entry (stub);
+    GBytes *value = g_paste_history_binary_validate (g_paste_history_binary_stub_ref_string (stub,
+                                                                                            GUINT64_FROM_LE (entry->value_offset),
+                                                                                            GUINT64_FROM_LE (entry->value_length)));
+
+    if (!value || GUINT32_FROM_LE (entry->kind) != G_PASTE_HISTORY_BINARY_KIND_BLOB)
+        return value;
+
+    g_autoptr (GBytes) id = value;
+    gchar *text = g_paste_history_blobs_load (g_bytes_get_data (id, NULL), GUINT64_FROM_LE (entry->length));
+
+    if (!text)
+    {
+        g_warning ("Missing or damaged blob: %s", (const gchar *) g_bytes_get_data (id, NULL));
+        return NULL;
+    }
+
+    return g_bytes_new_take (text, strlen (text) + 1);
+}
+
+static GPasteHistoryBinaryKind
+g_paste_history_binary_get_kind (const GPasteItem *item)
+{
+    if (G_PASTE_IS_IMAGE_ITEM (item))
+        return G_PASTE_HISTORY_BINARY_KIND_IMAGE;
+    else if (G_PASTE_IS_PASSWORD_ITEM (item))
+        return G_PASTE_HISTORY_BINARY_KIND_PASSWORD;
+    else if (G_PASTE_IS_URIS_ITEM (item))
+        return G_PASTE_HISTORY_BINARY_KIND_URIS;
+    else
+        return G_PASTE_HISTORY_BINARY_KIND_TEXT;
+}
+
+/*
+ * Fill in the native endian entry of an item, and give the value to store
+ * and the checksum or name which follows it, if any.
+ */
+static gboolean
+g_paste_history_binary_describe_item (const GPasteItem         *item,
+                                      GPasteHistoryBinaryEntry *entry,
+                                      GBytes                  **value,
+                                      GBytes                  **extra,
+                                      GPtrArray                *blobs)
+{
+    GPasteHistoryBinaryKind kind = g_paste_history_binary_get_kind (item);
+
+    *value = g_paste_item_ref_real_value (item);
+    entry->hash = g_paste_item_get_hash (item);
+    entry->length = g_bytes_get_size (*value) - 1;
+
+    if (blobs && kind == G_PASTE_HISTORY_BINARY_KIND_TEXT && entry->length >= G_PASTE_HISTORY_BLOBS_THRESHOLD)
+    {
+        gchar *id = g_paste_history_blobs_store ((GPasteItem *) item, g_bytes_get_data (*value, NULL), entry->length);
+
+        if (id)
+        {
+            g_ptr_array_add (blobs, id);
+            g_bytes_unref (*value);
+            *value = g_bytes_new (id, strlen (id) + 1);
+            kind = G_PASTE_HISTORY_BINARY_KIND_BLOB;
+        }
+    }
+
+    entry->kind = kind;
+
+    if (G_PASTE_IS_IMAGE_ITEM (item))
+    {
+        GPasteImageItem *image_item = G_PASTE_IMAGE_ITEM (item);
+        const gchar *checksum = g_paste_image_item_get_checksum (image_item);
+
+        entry->date = g_date_time_to_unix ((GDateTime *) g_paste_image_item_get_date (image_item));
+        entry->width = (guint32) g_paste_image_item_get_width (image_item);
+        entry->height = (guint32) g_paste_image_item_get_height (image_item);
+
+        if (checksum)
+            *extra = g_bytes_new (checksum, strlen (checksum) + 1);
+    }
+    else if (G_PASTE_IS_PASSWORD_ITEM (item))
+    {
+        const gchar *name = g_paste_password_item_get_name (G_PASTE_PASSWORD_ITEM (item));
+
+        *extra = g_bytes_new (name, strlen (name) + 1);
+    }
+
+    return TRUE;
+}
+
+/* Entries are copied as they are, blobs included, without creating their item */
+static gboolean
+g_paste_history_binary_describe_stub (const GPasteHistoryBinaryStub *stub,
+                                      GPasteHistoryBinaryEntry      *entry,
+                                      GBytes                       **value,
+                                      GBytes                       **extra,
+                                      GPtrArray                     *blobs)
+{
+    const GPasteHistoryBinaryEntry *source = g_paste_history_binary_stub_get_entry (stub);
+    GPasteHistoryBinaryKind kind = GUINT32_FROM_LE (source->kind);
+
+    if (!(*value = g_paste_history_binary_stub_ref_string (stub, GUINT64_FROM_LE (source->value_offset), GUINT64_FROM_LE (source->value_length))))
+        return FALSE;
+
+    *extra = g_paste_history_binary_stub_ref_checksum (stub);
+
+    if (kind == G_PASTE_HISTORY_BINARY_KIND_PASSWORD && !*extra)
+    {
+        g_clear_pointer (value, g_bytes_unref);
+        return FALSE;
+    }
+
+    if (kind == G_PASTE_HISTORY_BINARY_KIND_BLOB && blobs)
+        g_ptr_array_add (blobs, g_strdup (g_bytes_get_data (*value, NULL)));
+
+    entry->kind = kind;
+    entry->date = GINT64_FROM_LE (source->date);
+    entry->width = GUINT32_FROM_LE (source->width);
+    entry->height = GUINT32_FROM_LE (source->height);
+    entry->hash = GUINT64_FROM_LE (source->hash);
+    entry->length = GUINT64_FROM_LE (source->length);
+
+    return TRUE;
+}
+
+static void
+g_paste_history_binary_bytes_unref (gpointer data)
+{
+    if (data)
+        g_bytes_unref (data);
+}
+
+/**
+ * g_paste_history_binary_serialize:
+ * @slots: the slots of the history to store
+ * @serial: the serial of the snapshot, 0 if there is no journal
+ * @blobs: (nullable) (element-type utf8): where to add the ids of the blobs
+ *         big texts get stored in, %NULL to keep everything in the snapshot
+ *
+ * Serialize a history into a binary snapshot
+ *
+ * Returns: (transfer full): the contents of the snapshot
+ */
+GString *
+g_paste_history_binary_serialize (const GPtrArray *slots,
+                                  guint64          serial,
+                                  GPtrArray       *blobs)
+{
+    g_autoptr (GArray) entries = g_array_sized_new (FALSE, /* zero-terminated */
+                                                    TRUE,  /* clear */
+                                                    sizeof (GPasteHistoryBinaryEntry),
+                                                    slots->len);
+    /* Each value and its checksum or name (or NULL), taken once and for all as this runs in the save thread */
+    g_autoptr (GPtrArray) strings = g_ptr_array_new_full (2 * slots->len, g_paste_history_binary_bytes_unref);
+
+    for (guint i = 0; i < slots->len; ++i)
+    {
+        gconstpointer slot = g_ptr_array_index (slots, i);
+        GPasteHistoryBinaryEntry entry = { 0 };
+        GBytes *value = NULL;
+        GBytes *extra = NULL;
+        gboolean described = (G_PASTE_HISTORY_BINARY_IS_ENTRY (slot)) ?
+            g_paste_history_binary_describe_stub (G_PASTE_HISTORY_BINARY_STUB (slot), &entry, &value, &extra, blobs) :
+            g_paste_history_binary_describe_item (slot, &entry, &value, &extra, blobs);
+
+        if (!described)
+            continue;
+
+        g_array_append_val (entries, entry);
+        g_ptr_array_add (strings, value);
+        g_ptr_array_add (strings, extra);
+    }
+
+    guint64 offset = sizeof (GPasteHistoryBinaryHeader) + entries->len * sizeof (GPasteHistoryBinaryEntry);
+    GString *contents = g_string_sized_new (offset);
+    GPasteHistoryBinaryHeader header;
+
+    memcpy (header.magic, G_PASTE_HISTORY_BINARY_MAGIC, sizeof (header.magic));
+    header.version = GUINT32_TO_LE (G_PASTE_HISTORY_BINARY_VERSION);
+    header.reserved = 0;
+    header.serial = GUINT64_TO_LE (serial);
+    header.n_items = GUINT64_TO_LE ((guint64) entries->len);
+
+    g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        const GPasteHistoryBinaryEntry *entry = &g_array_index (entries, GPasteHistoryBinaryEntry, i);
+        GBytes *value = g_ptr_array_index (strings, 2 * i);
+        GBytes *extra = g_ptr_array_index (strings, 2 * i + 1);
+        GPasteHistoryBinaryEntry stored = { 0 };
+
+        stored.kind = GUINT32_TO_LE (entry->kind);
+        stored.date = GINT64_TO_LE (entry->date);
+        stored.width = GUINT32_TO_LE (entry->width);
+        stored.height = GUINT32_TO_LE (entry->height);
+        stored.hash = GUINT64_TO_LE (entry->hash);
+        stored.length = GUINT64_TO_LE (entry->length);
+
+        /* Keep the trailing NULs so that values can be used right from the mapping */
+        stored.value_offset = GUINT64_TO_LE (offset);
+        stored.value_length = GUINT64_TO_LE ((guint64) g_bytes_get_size (value) - 1);
+        offset += g_bytes_get_size (value);
+
+        if (extra)
+        {
+            stored.checksum_offset = GUINT64_TO_LE (offset);
+            stored.checksum_length = GUINT64_TO_LE ((guint64) g_bytes_get_size (extra) - 1);
+            offset += g_bytes_get_size (extra);
+        }
+
+        g_string_append_len (contents, (const gchar *) &stored, sizeof (stored));
+    }
+
+    for (guint i = 0; i < strings->len; ++i)
+    {
+        GBytes *string = g_ptr_array_index (strings, i);
+        gsize length;
+        const gchar *data;
+
+        if (!string)
+            continue;
+
+        data = g_bytes_get_data (string, &length);
+        g_string_append_len (contents, data, length);
+    }
+
+    return contents;
+}
+
+static gboolean
+g_paste_history_binary_check_string (guint64 offset,
+                                     guint64 string_length,
+                                     guint64 length)
+{
+    /* Room for the terminator included */
+    return (offset < length && string_length < length - offset);
+}
+
+static gboolean
+g_paste_history_binary_check_entry (const GPasteHistoryBinaryEntry *entry,
+                                    guint64                         length)
+{
+    GPasteHistoryBinaryKind kind = GUINT32_FROM_LE (entry->kind);
+
+    if (kind > G_PASTE_HISTORY_BINARY_KIND_BLOB ||
+        !g_paste_history_binary_check_string (GUINT64_FROM_LE (entry->value_offset), GUINT64_FROM_LE (entry->value_length), length))
+    {
+        return FALSE;
+    }
+
+    if (kind == G_PASTE_HISTORY_BINARY_KIND_PASSWORD || entry->checksum_length)
+        return g_paste_history_binary_check_string (GUINT64_FROM_LE (entry->checksum_offset), GUINT64_FROM_LE (entry->checksum_length), length);
+
+    return TRUE;
+}
+
+static gboolean
+g_paste_history_binary_parse (GMappedFile *mapping,
+                              const gchar *origin,
+                              guint64     *serial,
+                              GPtrArray   *history,
+                              guint64     *size)
+{
+    const gchar *data = g_mapped_file_get_contents (mapping);
+    guint64 length = g_mapped_file_get_length (mapping);
+
+    /* This is a freshly created history */
+    if (!length)
+        return TRUE;
+
+    const GPasteHistoryBinaryHeader *header = (const GPasteHistoryBinaryHeader *) data;
+
+    if (length < sizeof (GPasteHistoryBinaryHeader) ||
+        memcmp (header->magic, G_PASTE_HISTORY_BINARY_MAGIC, sizeof (header->magic)) ||
+        GUINT32_FROM_LE (header->version) != G_PASTE_HISTORY_BINARY_VERSION)
+    {
+        g_warning ("Unknown binary history format: %s", origin);
+        return FALSE;
+    }
+
+    guint64 n_items = GUINT64_FROM_LE (header->n_items);
+
+    if (n_items > (length - sizeof (GPasteHistoryBinaryHeader)) / sizeof (GPasteHistoryBinaryEntry))
+    {
+        g_warning ("Truncated binary history: %s", origin);
+        return FALSE;
+    }
+
+    const GPasteHistoryBinaryEntry *entries = (const GPasteHistoryBinaryEntry *) (data + sizeof (GPasteHistoryBinaryHeader));
+
+    /* Only the entries are read here, the values are left alone until their item is needed */
+    for (guint64 i = 0; i < n_items; ++i)
+    {
+        if (g_paste_history_binary_check_entry (&entries[i], length))
+            g_ptr_array_add (history, g_paste_history_binary_stub_new (mapping, i));
+        else
+            g_warning ("Skipping invalid item %" G_GUINT64_FORMAT " in binary history: %s", i, origin);
+    }
+
+    *serial = GUINT64_FROM_LE (header->serial);
+    *size = length;
+
+    return TRUE;
+}
+
+/**
+ * g_paste_history_binary_load:
+ * @path: the path of the snapshot
+ * @serial: (out): the serial of the snapshot
+ * @history: where to append the slots of the loaded items
+ * @size: (out): the size of the snapshot
+ *
+ * Load a history from a binary snapshot
+ *
+ * Returns: whether the snapshot could be read
+ */
+gboolean
+g_paste_history_binary_load (const gchar *path,
+                             guint64     *serial,
+                             GPtrArray   *history,
+                             guint64     *size)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GMappedFile) mapping = g_mapped_file_new (path,
+                                                         FALSE, /* writable */
+                                                         &error);
+
+    *serial = 0;
+    *size = 0;
+
+    if (!mapping)
+    {
+        g_warning ("Failed to map history %s: %s", path, error->message);
+        return FALSE;
+    }
+
+    return g_paste_history_binary_parse (mapping, path, serial, history, size);
+}
+
+/**
+ * g_paste_history_binary_load_fd:
+ * @fd: a file descriptor holding a binary snapshot
+ * @serial: (out): the serial of the snapshot
+ * @history: where to append the slots of the loaded items
+ *
+ * Load a history from a binary snapshot that was handed to us as a
+ * file descriptor, which we don't close
+ *
+ * Returns: whether the snapshot could be read
+ */
+gboolean
+g_paste_history_binary_load_fd (gint       fd,
+                                guint64   *serial,
+                                GPtrArray *history)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GMappedFile) mapping = g_mapped_file_new_from_fd (fd,
+                                                                 FALSE, /* writable */
+                                                                 &error);
+    guint64 size = 0;
+
+    *serial = 0;
+
+    if (!mapping)
+    {
+        g_warning ("Failed to map history from fd %d: %s", fd, error->message);
+        return FALSE;
+    }
+
+    return g_paste_history_binary_parse (mapping, "handoff", serial, history, &size);
+}
+
+/**
+ * g_paste_history_binary_slot_get_kind:
+ * @slot: a slot of a history
+ *
+ * Get the kind of the item in @slot, as given by g_paste_item_get_kind
+ *
+ * Returns: the kind of the item
+ */
+const gchar *
+g_paste_history_binary_slot_get_kind (gconstpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_paste_item_get_kind (slot);
+
+    switch (GUINT32_FROM_LE (g_paste_history_binary_stub_get_entry (G_PASTE_HISTORY_BINARY_STUB (slot))->kind))
+    {
+    case G_PASTE_HISTORY_BINARY_KIND_URIS:
+        return "Uris";
+    case G_PASTE_HISTORY_BINARY_KIND_IMAGE:
+        return "Image";
+    case G_PASTE_HISTORY_BINARY_KIND_PASSWORD:
+        return "Password";
+    default:
+        return "Text";
+    }
+}
+
+/**
+ * g_paste_history_binary_slot_get_hash:
+ * @slot: a slot of a history
+ *
+ * Get the hash of the value of the item in @slot, as given by g_paste_item_get_hash
+ *
+ * Returns: the hash of the value
+ */
+guint64
+g_paste_history_binary_slot_get_hash (gconstpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_paste_item_get_hash (slot);
+
+    return GUINT64_FROM_LE (g_paste_history_binary_stub_get_entry (G_PASTE_HISTORY_BINARY_STUB (slot))->hash);
+}
+
+/**
+ * g_paste_history_binary_slot_get_size:
+ * @slot: a slot of a history
+ *
+ * Get the memory used by the item in @slot, or the one its value
+ * would use for an entry
+ *
+ * Returns: the size of the item
+ */
+guint64
+g_paste_history_binary_slot_get_size (gconstpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_paste_item_get_size (slot);
+
+    return GUINT64_FROM_LE (g_paste_history_binary_stub_get_entry (G_PASTE_HISTORY_BINARY_STUB (slot))->length) + 1;
+}
+
+/**
+ * g_paste_history_binary_slot_dup_blob:
+ * @slot: a slot of a history
+ *
+ * Get the id of the blob holding the value of the entry in @slot
+ *
+ * Returns: (nullable) (transfer full): the id of the blob, %NULL if
+ *          @slot isn't an entry stored as a blob
+ */
+gchar *
+g_paste_history_binary_slot_dup_blob (gconstpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return NULL;
+
+    const GPasteHistoryBinaryStub *stub = G_PASTE_HISTORY_BINARY_STUB (slot);
+    const GPasteHistoryBinaryEntry *entry = g_paste_history_binary_stub_get_entry (stub);
+
+    if (GUINT32_FROM_LE (entry->kind) != G_PASTE_HISTORY_BINARY_KIND_BLOB)
+        return NULL;
+
+    g_autoptr (GBytes) id = g_paste_history_binary_validate (g_paste_history_binary_stub_ref_string (stub,
+                                                                                                     GUINT64_FROM_LE (entry->value_offset),
+                                                                                                     GUINT64_FROM_LE (entry->value_length)));
+
+    return (id) ? g_strdup (g_bytes_get_data (id, NULL)) : NULL;
+}
+
+/**
+ * g_paste_history_binary_slot_ref_value:
+ * @slot: a slot of a history
+ *
+ * Get the real value of the item in @slot, without creating it for an entry:
+ * values are used right from the mapping, only blobs are read.
+ * This can be used from any thread.
+ *
+ * Returns: (nullable) (transfer full): the NUL-terminated value, %NULL
+ *          if it couldn't be read
+ */
+GBytes *
+g_paste_history_binary_slot_ref_value (gconstpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_paste_item_ref_real_value (slot);
+
+    return g_paste_history_binary_stub_ref_value (G_PASTE_HISTORY_BINARY_STUB (slot));
+}
+
+/**
+ * g_paste_history_binary_slot_dup_item:
+ * @slot: a slot of a history
+ *
+ * Get the item in @slot, creating it for an entry
+ *
+ * Returns: (transfer full): the #GPasteItem
+ */
+GPasteItem *
+g_paste_history_binary_slot_dup_item (gconstpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_object_ref ((gpointer) slot);
+
+    const GPasteHistoryBinaryStub *stub = G_PASTE_HISTORY_BINARY_STUB (slot);
+    const GPasteHistoryBinaryEntry *entry = g_paste_history_binary_stub_get_entry (stub);
+    g_autoptr (GBytes) value = g_paste_history_binary_stub_ref_value (stub);
+    g_autoptr (GBytes) extra = g_paste_history_binary_stub_ref_checksum (stub);
+    /* Something went wrong reading it and we've already complained, but the history expects an item there */
+    const gchar *v = (value) ? g_bytes_get_data (value, NULL) : "";
+
+    switch (GUINT32_FROM_LE (entry->kind))
+    {
+    case G_PASTE_HISTORY_BINARY_KIND_URIS:
+        return g_paste_uris_item_new (v);
+    case G_PASTE_HISTORY_BINARY_KIND_IMAGE:
+    {
+        g_autoptr (GDateTime) date_time = g_date_time_new_from_unix_local (GINT64_FROM_LE (entry->date));
+
+        if (entry->width && entry->height)
+        {
+            return g_paste_image_item_new_from_file_full (v,
+                                                          date_time,
+                                                          (gint) GUINT32_FROM_LE (entry->width),
+                                                          (gint) GUINT32_FROM_LE (entry->height),
+                                                          (extra) ? g_bytes_get_data (extra, NULL) : NULL);
+        }
+
+        return g_paste_image_item_new_from_file (v, date_time);
+    }
+    case G_PASTE_HISTORY_BINARY_KIND_PASSWORD:
+        return g_paste_password_item_new ((extra) ? g_bytes_get_data (extra, NULL) : NULL, v);
+    case G_PASTE_HISTORY_BINARY_KIND_BLOB:
+    {
+        GPasteItem *item = g_paste_text_item_new (v);
+        g_autofree gchar *id = g_paste_history_binary_slot_dup_blob (slot);
+
+        /* Storing it again won't need to compute its id */
+        if (value && id)
+            g_paste_history_blobs_set_item_id (item, id);
+
+        return item;
+    }
+    default:
+        return g_paste_text_item_new (v);
+    }
+}
+
+/**
+ * g_paste_history_binary_slot_ref:
+ * @slot: a slot of a history
+ *
+ * Get a new reference to a slot, to store it in another history
+ *
+ * Returns: (transfer full): the new slot, release it with g_paste_history_binary_slot_unref
+ */
+gpointer
+g_paste_history_binary_slot_ref (gpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_object_ref (slot);
+
+    const GPasteHistoryBinaryStub *stub = G_PASTE_HISTORY_BINARY_STUB (slot);
+
+    return g_paste_history_binary_stub_new (stub->mapping, stub->index);
+}
+
+/**
+ * g_paste_history_binary_slot_unref:
+ * @slot: a slot of a history
+ *
+ * Release a slot, dropping the mapping with the last of its entries
+ */
+void
+g_paste_history_binary_slot_unref (gpointer slot)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+    {
+        g_object_unref (slot);
+        return;
+    }
+
+    GPasteHistoryBinaryStub *stub = G_PASTE_HISTORY_BINARY_STUB (slot);
+
+    g_mapped_file_unref (stub->mapping);
+    g_free (stub);
+}
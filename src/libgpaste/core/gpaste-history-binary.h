@@ -0,0 +1,73 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_HISTORY_BINARY_H__
+#define __G_PASTE_HISTORY_BINARY_H__
+
+#include <gpaste-item.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The binary snapshot is meant to be read straight from a mapping: a header,
+ * an array of fixed-size entries giving the kind of each item and where its
+ * value lives, and then the NUL-terminated values themselves.
+ * No parsing nor decoding is needed to load it.
+ *
+ * Loading it doesn't create any item either: the history gets one slot per
+ * entry, which only becomes a #GPasteItem when something needs it as such,
+ * so that only the items we look at take memory. A slot is either a
+ * #GPasteItem or a tagged pointer to an entry, and the slot helpers below
+ * accept both. Entries keep the mapping alive.
+ */
+
+#define G_PASTE_HISTORY_BINARY_FORMAT    "binary"
+#define G_PASTE_HISTORY_BINARY_EXTENSION ".bin"
+
+#define G_PASTE_HISTORY_BINARY_IS_ENTRY(slot) (GPOINTER_TO_SIZE (slot) & 1)
+
+GString *g_paste_history_binary_serialize (const GPtrArray *slots,
+                                           guint64          serial,
+                                           GPtrArray       *blobs);
+
+gboolean g_paste_history_binary_load (const gchar *path,
+                                      guint64     *serial,
+                                      GPtrArray   *history,
+                                      guint64     *size);
+
+gboolean g_paste_history_binary_load_fd (gint       fd,
+                                         guint64   *serial,
+                                         GPtrArray *history);
+
+const gchar *g_paste_history_binary_slot_get_kind  (gconstpointer slot);
+guint64      g_paste_history_binary_slot_get_hash  (gconstpointer slot);
+guint64      g_paste_history_binary_slot_get_size  (gconstpointer slot);
+gchar       *g_paste_history_binary_slot_dup_blob  (gconstpointer slot);
+GBytes      *g_paste_history_binary_slot_ref_value (gconstpointer slot);
+GPasteItem  *g_paste_history_binary_slot_dup_item  (gconstpointer slot);
+gpointer     g_paste_history_binary_slot_ref       (gpointer      slot);
+void         g_paste_history_binary_slot_unref     (gpointer      slot);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_HISTORY_BINARY_H__*/
@@ -0,0 +1,307 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-blobs.h"
+
+#include <gio/gio.h>
+
+#include <errno.h>
+
+#define G_PASTE_HISTORY_BLOBS_GROUP_PREFIX "History "
+
+#define G_PASTE_HISTORY_BLOBS_REFS "Blobs"
+
+/* Blobs are stored and released from worker threads */
+static GMutex blobs_mutex;
+/* Blobs stored for a history file which isn't written yet: id -> count */
+static GHashTable *pending = NULL;
+
+G_DEFINE_QUARK (gpaste-history-blob-id, g_paste_history_blobs_id)
+
+static void
+g_paste_history_blobs_lock (void)
+{
+    g_mutex_lock (&blobs_mutex);
+
+    if (!pending)
+        pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static gchar *
+g_paste_history_blobs_get_dir_path (void)
+{
+    return g_build_filename (g_get_user_data_dir (), "gpaste", "blobs", NULL);
+}
+
+static gchar *
+g_paste_history_blobs_get_path (const gchar *id)
+{
+    g_autofree gchar *dir_path = g_paste_history_blobs_get_dir_path ();
+
+    return g_build_filename (dir_path, id, NULL);
+}
+
+/* History names can hold characters which aren't allowed in group names */
+static gchar *
+g_paste_history_blobs_get_group (const gchar *name)
+{
+    g_autofree gchar *escaped = g_uri_escape_string (name, NULL, TRUE);
+
+    return g_strconcat (G_PASTE_HISTORY_BLOBS_GROUP_PREFIX, escaped, NULL);
+}
+
+static GKeyFile *
+g_paste_history_blobs_load_refs (const gchar *path)
+{
+    GKeyFile *refs = g_key_file_new ();
+
+    g_key_file_load_from_file (refs, path, G_KEY_FILE_NONE, NULL);
+
+    return refs;
+}
+
+static void
+g_paste_history_blobs_save_refs (GKeyFile    *refs,
+                                 const gchar *path)
+{
+    g_autoptr (GError) error = NULL;
+    gsize length;
+    g_autofree gchar *data = g_key_file_to_data (refs, &length, NULL);
+
+    if (!g_file_set_contents (path, data, length, &error))
+        g_warning ("Failed to write blobs references: %s", error->message);
+}
+
+/* Must be called with the blobs mutex held */
+static void
+g_paste_history_blobs_release (const gchar *id)
+{
+    guint count = GPOINTER_TO_UINT (g_hash_table_lookup (pending, id));
+
+    if (count > 1)
+        g_hash_table_insert (pending, g_strdup (id), GUINT_TO_POINTER (count - 1));
+    else
+        g_hash_table_remove (pending, id);
+}
+
+/* Must be called with the blobs mutex held */
+static void
+g_paste_history_blobs_delete_unreferenced (GKeyFile           *refs,
+                                           const gchar *const *ids,
+                                           guint64             n_ids)
+{
+    g_autoptr (GHashTable) referenced = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_auto (GStrv) groups = g_key_file_get_groups (refs, NULL);
+
+    for (gchar **group = groups; *group; ++group)
+    {
+        g_auto (GStrv) blobs = g_key_file_get_string_list (refs, *group, G_PASTE_HISTORY_BLOBS_REFS, NULL, NULL);
+
+        for (gchar **blob = blobs; blob && *blob; ++blob)
+            g_hash_table_add (referenced, g_strdup (*blob));
+    }
+
+    for (guint64 i = 0; i < n_ids; ++i)
+    {
+        if (g_hash_table_contains (referenced, ids[i]) || g_hash_table_contains (pending, ids[i]))
+            continue;
+
+        g_autofree gchar *path = g_paste_history_blobs_get_path (ids[i]);
+        g_autoptr (GFile) blob = g_file_new_for_path (path);
+
+        g_file_delete (blob,
+                       NULL, /* cancellable */
+                       NULL); /* error */
+    }
+}
+
+/**
+ * g_paste_history_blobs_set_item_id:
+ * @item: a #GPasteItem
+ * @id: the id of the blob holding its value
+ *
+ * Remember which blob holds the value of @item, for the next time it's stored
+ *
+ * Returns:
+ */
+void
+g_paste_history_blobs_set_item_id (GPasteItem  *item,
+                                   const gchar *id)
+{
+    g_object_set_qdata_full (G_OBJECT (item), g_paste_history_blobs_id_quark (), g_strdup (id), g_free);
+}
+
+/**
+ * g_paste_history_blobs_store:
+ * @item: (nullable): the #GPasteItem @value belongs to, if any
+ * @value: the value to store
+ * @length: the length of @value
+ *
+ * Store a value in the blobs directory if it isn't there yet.
+ * The blob is kept until the history file referencing it is written,
+ * see g_paste_history_blobs_set_refs and g_paste_history_blobs_collect.
+ * Its id is only computed the first time @item gets stored.
+ *
+ * Returns: (nullable): the id of the blob, %NULL if it couldn't be stored
+ */
+gchar *
+g_paste_history_blobs_store (GPasteItem  *item,
+                             const gchar *value,
+                             guint64      length)
+{
+    g_autofree gchar *dir_path = g_paste_history_blobs_get_dir_path ();
+    gchar *id = (item) ? g_object_dup_qdata (G_OBJECT (item), g_paste_history_blobs_id_quark (), (GDuplicateFunc) g_strdup, NULL) : NULL;
+
+    if (!id)
+    {
+        id = g_compute_checksum_for_string (G_CHECKSUM_SHA256, value, length);
+        if (item)
+            g_paste_history_blobs_set_item_id (item, id);
+    }
+
+    g_autofree gchar *path = g_build_filename (dir_path, id, NULL);
+    g_autoptr (GError) error = NULL;
+
+    g_paste_history_blobs_lock ();
+
+    /* Identical contents have the same name, so an existing blob is already what we want */
+    if (!g_file_test (path, G_FILE_TEST_EXISTS) &&
+        (g_mkdir_with_parents (dir_path, 0700) || !g_file_set_contents (path, value, length, &error)))
+    {
+        g_warning ("Failed to store blob: %s", (error) ? error->message : g_strerror (errno));
+        g_clear_pointer (&id, g_free);
+    }
+    else
+        g_hash_table_insert (pending, g_strdup (id), GUINT_TO_POINTER (GPOINTER_TO_UINT (g_hash_table_lookup (pending, id)) + 1));
+
+    g_mutex_unlock (&blobs_mutex);
+
+    return id;
+}
+
+/**
+ * g_paste_history_blobs_load:
+ * @id: the id of the blob
+ * @length: the length of its value, %G_PASTE_HISTORY_BLOBS_UNKNOWN_LENGTH if we don't know it
+ *
+ * Read back a blob, making sure it wasn't damaged: a blob whose length
+ * we know is trusted if it still has it, the others are checked against
+ * their id
+ *
+ * Returns: (nullable): the value of the blob, %NULL if it's missing or damaged
+ */
+gchar *
+g_paste_history_blobs_load (const gchar *id,
+                            guint64      length)
+{
+    g_autofree gchar *path = g_paste_history_blobs_get_path (id);
+    g_autofree gchar *value = NULL;
+    gsize value_length;
+
+    if (!g_file_get_contents (path, &value, &value_length, NULL))
+        return NULL;
+
+    if (length != G_PASTE_HISTORY_BLOBS_UNKNOWN_LENGTH)
+    {
+        if (value_length != length)
+            return NULL;
+    }
+    else
+    {
+        g_autofree gchar *checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, value, value_length);
+
+        if (g_strcmp0 (checksum, id))
+            return NULL;
+    }
+
+    if (!g_utf8_validate (value, value_length, NULL))
+        return NULL;
+
+    return g_steal_pointer (&value);
+}
+
+/**
+ * g_paste_history_blobs_set_refs:
+ * @name: the name of the history
+ * @ids: (nullable) (element-type utf8): the blobs its files reference now, %NULL if it's gone
+ *
+ * Record which blobs a history references once its files are written,
+ * and delete the ones it was the last one to reference
+ *
+ * Returns:
+ */
+void
+g_paste_history_blobs_set_refs (const gchar     *name,
+                                const GPtrArray *ids)
+{
+    g_autofree gchar *dir_path = g_paste_history_blobs_get_dir_path ();
+    g_autofree gchar *path = g_build_filename (dir_path, "refs", NULL);
+    g_autofree gchar *group = g_paste_history_blobs_get_group (name);
+
+    g_paste_history_blobs_lock ();
+
+    g_autoptr (GKeyFile) refs = g_paste_history_blobs_load_refs (path);
+    gsize n_old = 0;
+    g_auto (GStrv) old = g_key_file_get_string_list (refs, group, G_PASTE_HISTORY_BLOBS_REFS, &n_old, NULL);
+
+    if (ids && ids->len)
+    {
+        g_key_file_set_string_list (refs, group, G_PASTE_HISTORY_BLOBS_REFS, (const gchar * const *) ids->pdata, ids->len);
+        g_paste_history_blobs_save_refs (refs, path);
+
+        for (guint i = 0; i < ids->len; ++i)
+            g_paste_history_blobs_release (g_ptr_array_index (ids, i));
+    }
+    else if (g_key_file_remove_group (refs, group, NULL))
+        g_paste_history_blobs_save_refs (refs, path);
+
+    if (old)
+        g_paste_history_blobs_delete_unreferenced (refs, (const gchar * const *) old, n_old);
+
+    g_mutex_unlock (&blobs_mutex);
+}
+
+/**
+ * g_paste_history_blobs_collect:
+ * @ids: (element-type utf8): blobs stored for a history file which couldn't be written
+ *
+ * Delete the blobs among @ids which no history references
+ *
+ * Returns:
+ */
+void
+g_paste_history_blobs_collect (const GPtrArray *ids)
+{
+    if (!ids->len)
+        return;
+
+    g_autofree gchar *dir_path = g_paste_history_blobs_get_dir_path ();
+    g_autofree gchar *path = g_build_filename (dir_path, "refs", NULL);
+
+    g_paste_history_blobs_lock ();
+
+    g_autoptr (GKeyFile) refs = g_paste_history_blobs_load_refs (path);
+
+    for (guint i = 0; i < ids->len; ++i)
+        g_paste_history_blobs_release (g_ptr_array_index (ids, i));
+
+    g_paste_history_blobs_delete_unreferenced (refs, (const gchar * const *) ids->pdata, ids->len);
+
+    g_mutex_unlock (&blobs_mutex);
+}
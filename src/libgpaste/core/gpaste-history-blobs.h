@@ -0,0 +1,64 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_HISTORY_BLOBS_H__
+#define __G_PASTE_HISTORY_BLOBS_H__
+
+#include <gpaste-item.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Big text values are stored once in the blobs directory, next to the
+ * images one, in a file named after the SHA-256 of their contents.
+ * History files only reference them, so that a blob kept in several
+ * histories, or in a backup, is only written once.
+ * The blobs referenced by the files of each history are recorded in
+ * blobs/refs, and a blob gets deleted as soon as no history references
+ * it anymore.
+ * Items remember the id of their blob, so that it's only computed once,
+ * and a blob is only checked against its id when we don't know its length.
+ */
+
+/* Values shorter than this stay in the history files */
+#define G_PASTE_HISTORY_BLOBS_THRESHOLD (16 * 1024)
+
+/* The length of a blob we know nothing about */
+#define G_PASTE_HISTORY_BLOBS_UNKNOWN_LENGTH G_MAXUINT64
+
+gchar *g_paste_history_blobs_store (GPasteItem  *item,
+                                    const gchar *value,
+                                    guint64      length);
+gchar *g_paste_history_blobs_load  (const gchar *id,
+                                    guint64      length);
+
+void g_paste_history_blobs_set_item_id (GPasteItem  *item,
+                                        const gchar *id);
+
+void g_paste_history_blobs_set_refs (const gchar     *name,
+                                     const GPtrArray *ids);
+void g_paste_history_blobs_collect  (const GPtrArray *ids);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_HISTORY_BLOBS_H__*/
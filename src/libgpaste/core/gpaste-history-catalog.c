@@ -0,0 +1,206 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-catalog.h"
+
+#include <gio/gio.h>
+
+#define G_PASTE_HISTORY_CATALOG_GROUP_PREFIX "History "
+
+#define G_PASTE_HISTORY_CATALOG_LENGTH   "Length"
+#define G_PASTE_HISTORY_CATALOG_SIZE     "Size"
+#define G_PASTE_HISTORY_CATALOG_MODIFIED "Modified"
+#define G_PASTE_HISTORY_CATALOG_PREVIEW  "Preview"
+
+/* Histories are written from worker threads, serialize our accesses to the catalog */
+static GMutex catalog_mutex;
+/* Read once, then kept in sync with what we write */
+static GKeyFile *cached_catalog = NULL;
+/* Whether it holds changes which weren't worth writing on their own */
+static gboolean catalog_dirty = FALSE;
+
+static gchar *
+g_paste_history_catalog_get_path (void)
+{
+    return g_build_filename (g_get_user_data_dir (), "gpaste", "catalog", NULL);
+}
+
+/* History names can hold characters which aren't allowed in group names */
+static gchar *
+g_paste_history_catalog_get_group (const gchar *name)
+{
+    g_autofree gchar *escaped = g_uri_escape_string (name, NULL, TRUE);
+
+    return g_strconcat (G_PASTE_HISTORY_CATALOG_GROUP_PREFIX, escaped, NULL);
+}
+
+/* Must be called with the catalog mutex held */
+static GKeyFile *
+g_paste_history_catalog_get (void)
+{
+    if (!cached_catalog)
+    {
+        g_autofree gchar *path = g_paste_history_catalog_get_path ();
+
+        cached_catalog = g_key_file_new ();
+        /* A missing or broken catalog is the same as an empty one */
+        g_key_file_load_from_file (cached_catalog, path, G_KEY_FILE_NONE, NULL);
+    }
+
+    return cached_catalog;
+}
+
+/* Must be called with the catalog mutex held */
+static void
+g_paste_history_catalog_save (void)
+{
+    g_autofree gchar *path = g_paste_history_catalog_get_path ();
+    g_autoptr (GError) error = NULL;
+    gsize length;
+    g_autofree gchar *data = g_key_file_to_data (g_paste_history_catalog_get (), &length, NULL);
+
+    if (!g_file_set_contents (path, data, length, &error))
+        g_warning ("Failed to write history catalog: %s", error->message);
+
+    catalog_dirty = FALSE;
+}
+
+/**
+ * g_paste_history_catalog_entry_clear:
+ * @entry: a #GPasteHistoryCatalogEntry
+ *
+ * Free what @entry holds
+ *
+ * Returns:
+ */
+void
+g_paste_history_catalog_entry_clear (GPasteHistoryCatalogEntry *entry)
+{
+    g_clear_pointer (&entry->preview, g_free);
+}
+
+/**
+ * g_paste_history_catalog_lookup:
+ * @name: the name of the history
+ * @entry: (out caller-allocates): where to store what we know about it
+ *
+ * Look up a history in the catalog
+ *
+ * Returns: whether the history is in the catalog
+ */
+gboolean
+g_paste_history_catalog_lookup (const gchar               *name,
+                                GPasteHistoryCatalogEntry *entry)
+{
+    g_autofree gchar *group = g_paste_history_catalog_get_group (name);
+    g_autoptr (GError) error = NULL;
+
+    g_mutex_lock (&catalog_mutex);
+
+    GKeyFile *catalog = g_paste_history_catalog_get ();
+
+    entry->length = g_key_file_get_uint64 (catalog, group, G_PASTE_HISTORY_CATALOG_LENGTH, &error);
+    if (!error)
+        entry->size = g_key_file_get_uint64 (catalog, group, G_PASTE_HISTORY_CATALOG_SIZE, &error);
+    if (!error)
+        entry->modified = g_key_file_get_int64 (catalog, group, G_PASTE_HISTORY_CATALOG_MODIFIED, &error);
+
+    entry->preview = (error) ? NULL : g_key_file_get_string (catalog, group, G_PASTE_HISTORY_CATALOG_PREVIEW, NULL);
+
+    g_mutex_unlock (&catalog_mutex);
+
+    return !error;
+}
+
+/**
+ * g_paste_history_catalog_update:
+ * @name: the name of the history
+ * @entry: what we know about it
+ *
+ * Record a history in the catalog.
+ * It's only written right away if the length or the preview changed,
+ * new sizes and modification times wait for g_paste_history_catalog_flush.
+ *
+ * Returns:
+ */
+void
+g_paste_history_catalog_update (const gchar                     *name,
+                                const GPasteHistoryCatalogEntry *entry)
+{
+    g_autofree gchar *group = g_paste_history_catalog_get_group (name);
+
+    g_mutex_lock (&catalog_mutex);
+
+    GKeyFile *catalog = g_paste_history_catalog_get ();
+    g_autoptr (GError) error = NULL;
+    guint64 length = g_key_file_get_uint64 (catalog, group, G_PASTE_HISTORY_CATALOG_LENGTH, &error);
+    g_autofree gchar *preview = g_key_file_get_string (catalog, group, G_PASTE_HISTORY_CATALOG_PREVIEW, NULL);
+    gboolean changed = (error || length != entry->length || g_strcmp0 (preview, (entry->preview) ? entry->preview : ""));
+
+    g_key_file_set_uint64 (catalog, group, G_PASTE_HISTORY_CATALOG_LENGTH, entry->length);
+    g_key_file_set_uint64 (catalog, group, G_PASTE_HISTORY_CATALOG_SIZE, entry->size);
+    g_key_file_set_int64 (catalog, group, G_PASTE_HISTORY_CATALOG_MODIFIED, entry->modified);
+    g_key_file_set_string (catalog, group, G_PASTE_HISTORY_CATALOG_PREVIEW, (entry->preview) ? entry->preview : "");
+
+    if (changed)
+        g_paste_history_catalog_save ();
+    else
+        catalog_dirty = TRUE;
+
+    g_mutex_unlock (&catalog_mutex);
+}
+
+/**
+ * g_paste_history_catalog_remove:
+ * @name: the name of the history
+ *
+ * Forget about a history which is gone
+ *
+ * Returns:
+ */
+void
+g_paste_history_catalog_remove (const gchar *name)
+{
+    g_autofree gchar *group = g_paste_history_catalog_get_group (name);
+
+    g_mutex_lock (&catalog_mutex);
+
+    if (g_key_file_remove_group (g_paste_history_catalog_get (), group, NULL))
+        g_paste_history_catalog_save ();
+
+    g_mutex_unlock (&catalog_mutex);
+}
+
+/**
+ * g_paste_history_catalog_flush:
+ *
+ * Write what g_paste_history_catalog_update kept for later, if anything
+ *
+ * Returns:
+ */
+void
+g_paste_history_catalog_flush (void)
+{
+    g_mutex_lock (&catalog_mutex);
+
+    if (catalog_dirty)
+        g_paste_history_catalog_save ();
+
+    g_mutex_unlock (&catalog_mutex);
+}
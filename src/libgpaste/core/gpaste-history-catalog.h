@@ -0,0 +1,62 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_HISTORY_CATALOG_H__
+#define __G_PASTE_HISTORY_CATALOG_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The catalog remembers what there is to know about each saved history
+ * without having to read it: how many items it has, how much room it takes
+ * on disk, when it was last written and a preview of its first item.
+ * It's updated each time a history is written, an entry whose size and
+ * modification time don't match the files anymore is stale.
+ * It's read once and kept in memory, and only written to disk when what
+ * it says about a history changes: new sizes and modification times alone
+ * wait for g_paste_history_catalog_flush.
+ */
+
+typedef struct
+{
+    guint64  length;
+    guint64  size;
+    /* Unix time, in microseconds */
+    gint64   modified;
+    gchar   *preview;
+} GPasteHistoryCatalogEntry;
+
+void g_paste_history_catalog_entry_clear (GPasteHistoryCatalogEntry *entry);
+
+gboolean g_paste_history_catalog_lookup (const gchar                     *name,
+                                         GPasteHistoryCatalogEntry       *entry);
+void     g_paste_history_catalog_update (const gchar                     *name,
+                                         const GPasteHistoryCatalogEntry *entry);
+void     g_paste_history_catalog_remove (const gchar                     *name);
+void     g_paste_history_catalog_flush  (void);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_HISTORY_CATALOG_H__*/
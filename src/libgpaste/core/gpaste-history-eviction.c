@@ -0,0 +1,169 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-eviction.h"
+
+typedef struct
+{
+    guint64 score;
+    guint64 index;
+} GPasteHistoryCandidate;
+
+#define G_PASTE_HISTORY_CANDIDATE(heap, i) (&g_array_index ((heap), GPasteHistoryCandidate, (i)))
+
+/**
+ * g_paste_history_eviction_policy_from_string:
+ * @policy: the value of the "eviction-policy" setting
+ *
+ * Unknown policies fall back to "largest"
+ *
+ * Returns: the matching #GPasteHistoryEvictionPolicy
+ */
+GPasteHistoryEvictionPolicy
+g_paste_history_eviction_policy_from_string (const gchar *policy)
+{
+    if (!g_strcmp0 (policy, "lru"))
+        return G_PASTE_HISTORY_EVICTION_LRU;
+    else if (!g_strcmp0 (policy, "weighted"))
+        return G_PASTE_HISTORY_EVICTION_WEIGHTED;
+
+    return G_PASTE_HISTORY_EVICTION_LARGEST;
+}
+
+static guint64
+g_paste_history_eviction_score (GPasteHistoryEvictionPolicy policy,
+                                guint64                     index,
+                                guint64                     size)
+{
+    switch (policy)
+    {
+    case G_PASTE_HISTORY_EVICTION_LRU:
+        return index;
+    case G_PASTE_HISTORY_EVICTION_WEIGHTED:
+        return size * index;
+    case G_PASTE_HISTORY_EVICTION_LARGEST:
+    default:
+        return size;
+    }
+}
+
+/* On equal scores, the oldest item goes first */
+static gboolean
+g_paste_history_candidate_before (const GPasteHistoryCandidate *a,
+                                  const GPasteHistoryCandidate *b)
+{
+    return (a->score > b->score || (a->score == b->score && a->index > b->index));
+}
+
+static void
+g_paste_history_eviction_sift_down (GArray *heap,
+                                    guint64 i)
+{
+    for (;;)
+    {
+        guint64 first = i;
+        guint64 left = 2 * i + 1;
+        guint64 right = left + 1;
+
+        if (left < heap->len && g_paste_history_candidate_before (G_PASTE_HISTORY_CANDIDATE (heap, left), G_PASTE_HISTORY_CANDIDATE (heap, first)))
+            first = left;
+        if (right < heap->len && g_paste_history_candidate_before (G_PASTE_HISTORY_CANDIDATE (heap, right), G_PASTE_HISTORY_CANDIDATE (heap, first)))
+            first = right;
+
+        if (first == i)
+            return;
+
+        GPasteHistoryCandidate tmp = *G_PASTE_HISTORY_CANDIDATE (heap, i);
+
+        *G_PASTE_HISTORY_CANDIDATE (heap, i) = *G_PASTE_HISTORY_CANDIDATE (heap, first);
+        *G_PASTE_HISTORY_CANDIDATE (heap, first) = tmp;
+        i = first;
+    }
+}
+
+static gint
+g_paste_history_eviction_compare (gconstpointer a,
+                                  gconstpointer b)
+{
+    guint64 x = *(const guint64 *) a;
+    guint64 y = *(const guint64 *) b;
+
+    return (x < y) - (x > y);
+}
+
+/**
+ * g_paste_history_eviction_plan:
+ * @sizes: (element-type guint64): the size of each item of the history, most recent first
+ * @policy: how to rank the items
+ * @excess: how many bytes we need to free
+ *
+ * Pick the items to evict to free at least @excess bytes, or all of them
+ * but the first one if that's not enough.
+ * The heap is only built when we're above the limit, and we only pop as
+ * many items as needed from it.
+ *
+ * Returns: (transfer full): the indexes of the items to evict, highest first
+ */
+GArray *
+g_paste_history_eviction_plan (const GArray               *sizes,
+                               GPasteHistoryEvictionPolicy policy,
+                               guint64                     excess)
+{
+    GArray *victims = g_array_new (FALSE, /* zero-terminated */
+                                   FALSE, /* clear */
+                                   sizeof (guint64));
+
+    if (!excess || sizes->len < 2)
+        return victims;
+
+    g_autoptr (GArray) heap = g_array_sized_new (FALSE, /* zero-terminated */
+                                                 FALSE, /* clear */
+                                                 sizeof (GPasteHistoryCandidate),
+                                                 sizes->len - 1);
+
+    for (guint64 index = 1; index < sizes->len; ++index)
+    {
+        guint64 size = g_array_index (sizes, guint64, index);
+        GPasteHistoryCandidate candidate = { g_paste_history_eviction_score (policy, index, size), index };
+
+        g_array_append_val (heap, candidate);
+    }
+
+    for (guint64 i = heap->len / 2; i-- > 0;)
+        g_paste_history_eviction_sift_down (heap, i);
+
+    guint64 freed = 0;
+
+    while (freed < excess && heap->len)
+    {
+        guint64 index = G_PASTE_HISTORY_CANDIDATE (heap, 0)->index;
+
+        freed += g_array_index (sizes, guint64, index);
+        g_array_append_val (victims, index);
+
+        *G_PASTE_HISTORY_CANDIDATE (heap, 0) = *G_PASTE_HISTORY_CANDIDATE (heap, heap->len - 1);
+        g_array_set_size (heap, heap->len - 1);
+        g_paste_history_eviction_sift_down (heap, 0);
+    }
+
+    /* Removing the highest indexes first keeps the other ones valid */
+    g_array_sort (victims, g_paste_history_eviction_compare);
+
+    return victims;
+}
@@ -0,0 +1,55 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_HISTORY_EVICTION_H__
+#define __G_PASTE_HISTORY_EVICTION_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * When the history uses more memory than allowed, the eviction policy
+ * ranks the items to tell which ones go first.
+ * The history is ordered by last selection, so the position of an item
+ * is its age: "lru" drops the tail first, "largest" the biggest items
+ * and "weighted" the ones with the biggest size × position.
+ * The first (active) item is never evicted.
+ */
+
+typedef enum
+{
+    G_PASTE_HISTORY_EVICTION_LARGEST,
+    G_PASTE_HISTORY_EVICTION_LRU,
+    G_PASTE_HISTORY_EVICTION_WEIGHTED
+} GPasteHistoryEvictionPolicy;
+
+GPasteHistoryEvictionPolicy g_paste_history_eviction_policy_from_string (const gchar *policy);
+
+GArray *g_paste_history_eviction_plan (const GArray               *sizes,
+                                       GPasteHistoryEvictionPolicy policy,
+                                       guint64                     excess);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_HISTORY_EVICTION_H__*/
@@ -0,0 +1,522 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-index.h"
+
+#include <string.h>
+
+/* What we know about the value of a key */
+typedef struct
+{
+    /* How many slots have this key, which almost always is one */
+    guint64 refs;
+    /* How many of them we don't have the trigrams of yet */
+    guint64 pending;
+    /* Sorted and distinct */
+    GArray *trigrams;
+} GPasteHistoryIndexDoc;
+
+struct _GPasteHistoryIndex
+{
+    /* key -> GPasteHistoryIndexDoc */
+    GHashTable *docs;
+    /* trigram -> set of the keys whose value contains it */
+    GHashTable *postings;
+    /* The keys with pending trigrams, they may match anything */
+    GHashTable *pending;
+    /* How much memory all of this takes, roughly */
+    guint64     size;
+};
+
+#define G_PASTE_HISTORY_INDEX_TRIGRAM(s) \
+    (((guint32) (guchar) (s)[0] << 16) | ((guint32) (guchar) (s)[1] << 8) | (guint32) (guchar) (s)[2])
+
+/* Those make a pattern something else than a literal string */
+#define G_PASTE_HISTORY_INDEX_REGEX_CHARS "\\^$.|?*+()[]{}"
+/* Those escapes stand for something else than what follows them, without using it */
+#define G_PASTE_HISTORY_INDEX_SIMPLE_ESCAPES "dDwWsSbBntrfeAzZGhHvVRX"
+
+/* What a key takes in a GHashTable: itself, its value and its hash */
+#define G_PASTE_HISTORY_INDEX_ENTRY_SIZE (2 * sizeof (gpointer) + sizeof (guint))
+/* What an empty GHashTable takes, with its first buckets */
+#define G_PASTE_HISTORY_INDEX_SET_SIZE (64 + 8 * G_PASTE_HISTORY_INDEX_ENTRY_SIZE)
+
+static gint
+g_paste_history_index_compare (gconstpointer a,
+                               gconstpointer b)
+{
+    guint32 x = *(const guint32 *) a;
+    guint32 y = *(const guint32 *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void
+g_paste_history_index_doc_free (gpointer data)
+{
+    GPasteHistoryIndexDoc *doc = data;
+
+    g_array_unref (doc->trigrams);
+    g_free (doc);
+}
+
+/**
+ * g_paste_history_index_get_trigrams:
+ * @text: the value of an item
+ *
+ * Compute the trigrams to give to g_paste_history_index_add_trigrams
+ * This can be called from any thread.
+ *
+ * Returns: (transfer full): the sorted distinct trigrams of the case folded @text
+ */
+GArray *
+g_paste_history_index_get_trigrams (const gchar *text)
+{
+    g_autofree gchar *folded = g_utf8_casefold (text, -1);
+    guint64 length = strlen (folded);
+    g_autoptr (GArray) all = g_array_sized_new (FALSE, /* zero-terminated */
+                                                FALSE, /* clear */
+                                                sizeof (guint32),
+                                                (length > 2) ? length - 2 : 0);
+
+    for (guint64 i = 0; i + 2 < length; ++i)
+    {
+        guint32 trigram = G_PASTE_HISTORY_INDEX_TRIGRAM (folded + i);
+        g_array_append_val (all, trigram);
+    }
+
+    g_array_sort (all, g_paste_history_index_compare);
+
+    /* Only keep the distinct ones, this is what stays in memory */
+    guint64 n_distinct = 0;
+
+    for (guint64 i = 0; i < all->len; ++i)
+    {
+        if (!i || g_array_index (all, guint32, i) != g_array_index (all, guint32, n_distinct - 1))
+            g_array_index (all, guint32, n_distinct++) = g_array_index (all, guint32, i);
+    }
+
+    GArray *trigrams = g_array_sized_new (FALSE, /* zero-terminated */
+                                          FALSE, /* clear */
+                                          sizeof (guint32),
+                                          n_distinct);
+
+    return g_array_append_vals (trigrams, all->data, n_distinct);
+}
+
+/**
+ * g_paste_history_index_new:
+ *
+ * Create a new, empty, search index
+ *
+ * Returns: (transfer full): the new index
+ */
+GPasteHistoryIndex *
+g_paste_history_index_new (void)
+{
+    GPasteHistoryIndex *self = g_new (GPasteHistoryIndex, 1);
+
+    self->docs = g_hash_table_new_full (NULL, NULL, NULL, g_paste_history_index_doc_free);
+    self->postings = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_hash_table_unref);
+    self->pending = g_hash_table_new (NULL, NULL);
+    self->size = 0;
+
+    return self;
+}
+
+/**
+ * g_paste_history_index_free:
+ * @self: the index
+ *
+ * Free a search index
+ *
+ * Returns:
+ */
+void
+g_paste_history_index_free (GPasteHistoryIndex *self)
+{
+    g_hash_table_unref (self->docs);
+    g_hash_table_unref (self->postings);
+    g_hash_table_unref (self->pending);
+    g_free (self);
+}
+
+/**
+ * g_paste_history_index_add_pending:
+ * @self: the index
+ * @key: the key of the item entering the history
+ *
+ * Add an item whose trigrams we don't know yet, it may match
+ * any query until they get added
+ *
+ * Returns:
+ */
+void
+g_paste_history_index_add_pending (GPasteHistoryIndex *self,
+                                   gconstpointer       key)
+{
+    GPasteHistoryIndexDoc *doc = g_hash_table_lookup (self->docs, key);
+
+    if (!doc)
+    {
+        doc = g_new (GPasteHistoryIndexDoc, 1);
+        doc->refs = 0;
+        doc->pending = 0;
+        doc->trigrams = g_array_new (FALSE, /* zero-terminated */
+                                     FALSE, /* clear */
+                                     sizeof (guint32));
+        g_hash_table_insert (self->docs, (gpointer) key, doc);
+        self->size += sizeof (GPasteHistoryIndexDoc) + G_PASTE_HISTORY_INDEX_ENTRY_SIZE;
+    }
+
+    ++doc->refs;
+    ++doc->pending;
+    g_hash_table_add (self->pending, (gpointer) key);
+}
+
+/**
+ * g_paste_history_index_add_trigrams:
+ * @self: the index
+ * @key: the key of a pending item
+ * @trigrams: the result of g_paste_history_index_get_trigrams for its value
+ *
+ * Index the trigrams of a pending item. Nothing happens if the
+ * item left the history meanwhile.
+ *
+ * Returns:
+ */
+void
+g_paste_history_index_add_trigrams (GPasteHistoryIndex *self,
+                                    gconstpointer       key,
+                                    const GArray       *trigrams)
+{
+    GPasteHistoryIndexDoc *doc = g_hash_table_lookup (self->docs, key);
+
+    if (!doc || !doc->pending)
+        return;
+
+    if (!--doc->pending)
+        g_hash_table_remove (self->pending, key);
+
+    /* We only know some already if several values have the same hash */
+    guint64 known = doc->trigrams->len;
+
+    for (guint64 i = 0; i < trigrams->len; ++i)
+    {
+        guint32 trigram = g_array_index (trigrams, guint32, i);
+
+        if (known && bsearch (&trigram, doc->trigrams->data, known, sizeof (guint32), g_paste_history_index_compare))
+            continue;
+
+        GHashTable *keys = g_hash_table_lookup (self->postings, GUINT_TO_POINTER (trigram));
+
+        if (!keys)
+        {
+            keys = g_hash_table_new (NULL, NULL);
+            g_hash_table_insert (self->postings, GUINT_TO_POINTER (trigram), keys);
+            self->size += G_PASTE_HISTORY_INDEX_SET_SIZE + G_PASTE_HISTORY_INDEX_ENTRY_SIZE;
+        }
+
+        g_hash_table_add (keys, (gpointer) key);
+        g_array_append_val (doc->trigrams, trigram);
+        self->size += sizeof (guint32) + G_PASTE_HISTORY_INDEX_ENTRY_SIZE;
+    }
+
+    if (known)
+        g_array_sort (doc->trigrams, g_paste_history_index_compare);
+}
+
+/**
+ * g_paste_history_index_remove:
+ * @self: the index
+ * @key: the key of the item leaving the history
+ *
+ * Forget about an item
+ *
+ * Returns:
+ */
+void
+g_paste_history_index_remove (GPasteHistoryIndex *self,
+                              gconstpointer       key)
+{
+    GPasteHistoryIndexDoc *doc = g_hash_table_lookup (self->docs, key);
+
+    if (!doc || --doc->refs)
+        return;
+
+    for (guint64 i = 0; i < doc->trigrams->len; ++i)
+    {
+        gpointer trigram = GUINT_TO_POINTER (g_array_index (doc->trigrams, guint32, i));
+        GHashTable *keys = g_hash_table_lookup (self->postings, trigram);
+
+        g_hash_table_remove (keys, key);
+        self->size -= sizeof (guint32) + G_PASTE_HISTORY_INDEX_ENTRY_SIZE;
+
+        if (!g_hash_table_size (keys))
+        {
+            g_hash_table_remove (self->postings, trigram);
+            self->size -= G_PASTE_HISTORY_INDEX_SET_SIZE + G_PASTE_HISTORY_INDEX_ENTRY_SIZE;
+        }
+    }
+
+    g_hash_table_remove (self->pending, key);
+    g_hash_table_remove (self->docs, key);
+    self->size -= sizeof (GPasteHistoryIndexDoc) + G_PASTE_HISTORY_INDEX_ENTRY_SIZE;
+}
+
+/**
+ * g_paste_history_index_clear:
+ * @self: the index
+ *
+ * Forget about all the items
+ *
+ * Returns:
+ */
+void
+g_paste_history_index_clear (GPasteHistoryIndex *self)
+{
+    g_hash_table_remove_all (self->docs);
+    g_hash_table_remove_all (self->postings);
+    g_hash_table_remove_all (self->pending);
+    self->size = 0;
+}
+
+/**
+ * g_paste_history_index_get_size:
+ * @self: the index
+ *
+ * Get roughly how much memory the index takes
+ *
+ * Returns: the size of the index
+ */
+guint64
+g_paste_history_index_get_size (const GPasteHistoryIndex *self)
+{
+    return self->size;
+}
+
+/**
+ * g_paste_history_index_is_literal:
+ * @pattern: the pattern we search
+ *
+ * Check whether @pattern only matches itself
+ *
+ * Returns: whether @pattern has no regex metacharacter
+ */
+gboolean
+g_paste_history_index_is_literal (const gchar *pattern)
+{
+    return !strpbrk (pattern, G_PASTE_HISTORY_INDEX_REGEX_CHARS);
+}
+
+static void
+g_paste_history_index_end_run (GPtrArray *runs,
+                               GString   *run)
+{
+    if (run->len)
+        g_ptr_array_add (runs, g_strndup (run->str, run->len));
+    g_string_truncate (run, 0);
+}
+
+/*
+ * Find the literal parts of a regex which whatever it matches must contain.
+ * We skip what we're not sure about (groups, classes, optional characters...),
+ * and give up on the patterns where we can't even tell that (alternatives,
+ * options, quoting, escapes which use what follows them...).
+ */
+static GPtrArray *
+g_paste_history_index_get_required (const gchar *pattern)
+{
+    if (strchr (pattern, '|') || strstr (pattern, "(?") || strstr (pattern, "\\Q"))
+        return NULL;
+
+    g_autoptr (GPtrArray) runs = g_ptr_array_new_with_free_func (g_free);
+    g_autoptr (GString) run = g_string_new (NULL);
+    guint64 depth = 0;
+    const gchar *p = pattern;
+
+    while (*p)
+    {
+        gchar c = *p++;
+
+        if (c == '\\' && g_ascii_isalnum (*p))
+        {
+            if (!strchr (G_PASTE_HISTORY_INDEX_SIMPLE_ESCAPES, *p))
+                return NULL;
+            g_paste_history_index_end_run (runs, run);
+            ++p;
+        }
+        else if (c == '\\' && *p)
+        {
+            if (!depth)
+                g_string_append_c (run, *p);
+            ++p;
+        }
+        else if (c == '[')
+        {
+            g_paste_history_index_end_run (runs, run);
+
+            /* A "]" right at the beginning of the class is part of it */
+            if (*p == '^')
+                ++p;
+            if (*p == ']')
+                ++p;
+            while (*p && *p != ']')
+                p += (*p == '\\' && p[1]) ? 2 : 1;
+            if (*p)
+                ++p;
+        }
+        else if (c == '?' || c == '*' || c == '{')
+        {
+            /* What comes before may not be there at all */
+            if (run->len)
+                g_string_truncate (run, g_utf8_find_prev_char (run->str, run->str + run->len) - run->str);
+            g_paste_history_index_end_run (runs, run);
+
+            if (c == '{')
+            {
+                while (*p && *p != '}')
+                    ++p;
+                if (*p)
+                    ++p;
+            }
+        }
+        else if (strchr ("()+.^$", c))
+        {
+            g_paste_history_index_end_run (runs, run);
+
+            if (c == '(')
+                ++depth;
+            else if (c == ')' && depth)
+                --depth;
+        }
+        else if (!depth)
+            g_string_append_c (run, c);
+    }
+
+    g_paste_history_index_end_run (runs, run);
+
+    return g_steal_pointer (&runs);
+}
+
+/**
+ * g_paste_history_index_prepare_query:
+ * @pattern: the pattern we search
+ *
+ * Compute what the items need to contain to match @pattern: all of it
+ * for a literal pattern, the literal parts it can't match without otherwise
+ *
+ * Returns: (transfer full) (nullable): the query to give to
+ *          g_paste_history_index_lookup, or %NULL if the
+ *          index can't help with that pattern
+ */
+GArray *
+g_paste_history_index_prepare_query (const gchar *pattern)
+{
+    GArray *query;
+
+    if (g_paste_history_index_is_literal (pattern))
+        query = g_paste_history_index_get_trigrams (pattern);
+    else
+    {
+        g_autoptr (GPtrArray) runs = g_paste_history_index_get_required (pattern);
+
+        if (!runs)
+            return NULL;
+
+        query = g_array_new (FALSE, /* zero-terminated */
+                             FALSE, /* clear */
+                             sizeof (guint32));
+
+        for (guint64 i = 0; i < runs->len; ++i)
+        {
+            g_autoptr (GArray) trigrams = g_paste_history_index_get_trigrams (g_ptr_array_index (runs, i));
+
+            g_array_append_vals (query, trigrams->data, trigrams->len);
+        }
+    }
+
+    if (!query->len)
+    {
+        g_array_unref (query);
+        return NULL;
+    }
+
+    return query;
+}
+
+/**
+ * g_paste_history_index_lookup:
+ * @self: the index
+ * @query: the result of g_paste_history_index_prepare_query
+ *
+ * Get the keys of the items which can match the query. There can be
+ * false positives, but never false negatives.
+ *
+ * Returns: (transfer full): the set of the keys of the items containing
+ *          all the trigrams of the query, and of the pending ones
+ */
+GHashTable *
+g_paste_history_index_lookup (const GPasteHistoryIndex *self,
+                              const GArray             *query)
+{
+    GHashTable *matches = g_hash_table_new (NULL, NULL);
+    g_autofree GHashTable **postings = g_new (GHashTable *, query->len);
+    GHashTable *smallest = NULL;
+    gboolean found = TRUE;
+
+    for (guint64 i = 0; found && i < query->len; ++i)
+    {
+        postings[i] = g_hash_table_lookup (self->postings, GUINT_TO_POINTER (g_array_index (query, guint32, i)));
+
+        if (!postings[i])
+            found = FALSE;
+        else if (!smallest || g_hash_table_size (postings[i]) < g_hash_table_size (smallest))
+            smallest = postings[i];
+    }
+
+    if (found && smallest)
+    {
+        GHashTableIter iter;
+        gpointer key;
+
+        g_hash_table_iter_init (&iter, smallest);
+
+        while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+            gboolean everywhere = TRUE;
+
+            for (guint64 i = 0; everywhere && i < query->len; ++i)
+                everywhere = (postings[i] == smallest || g_hash_table_contains (postings[i], key));
+
+            if (everywhere)
+                g_hash_table_add (matches, key);
+        }
+    }
+
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init (&iter, self->pending);
+
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+        g_hash_table_add (matches, key);
+
+    return matches;
+}
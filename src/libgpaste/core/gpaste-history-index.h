@@ -0,0 +1,67 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_HISTORY_INDEX_H__
+#define __G_PASTE_HISTORY_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The search index knows which trigrams (sequences of three bytes) can be
+ * found in the case folded value of each item, and which items contain each
+ * trigram, so that a search only needs to run the regex on the items
+ * which contain all the trigrams of its literal parts.
+ * Items are known by a key, which is the hash of their value. They're added
+ * as pending, which makes them match any query, until the trigrams computed
+ * by g_paste_history_index_get_trigrams (which is fine to call from any
+ * thread) get added. Everything else must happen in the same thread.
+ */
+
+typedef struct _GPasteHistoryIndex GPasteHistoryIndex;
+
+GPasteHistoryIndex *g_paste_history_index_new   (void);
+void                g_paste_history_index_free  (GPasteHistoryIndex *self);
+
+GArray *g_paste_history_index_get_trigrams (const gchar *text);
+
+void g_paste_history_index_add_pending  (GPasteHistoryIndex *self,
+                                         gconstpointer       key);
+void g_paste_history_index_add_trigrams (GPasteHistoryIndex *self,
+                                         gconstpointer       key,
+                                         const GArray       *trigrams);
+void g_paste_history_index_remove       (GPasteHistoryIndex *self,
+                                         gconstpointer       key);
+void g_paste_history_index_clear        (GPasteHistoryIndex *self);
+
+guint64 g_paste_history_index_get_size (const GPasteHistoryIndex *self);
+
+gboolean    g_paste_history_index_is_literal    (const gchar              *pattern);
+GArray     *g_paste_history_index_prepare_query (const gchar              *pattern);
+GHashTable *g_paste_history_index_lookup        (const GPasteHistoryIndex *self,
+                                                 const GArray             *query);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_HISTORY_INDEX_H__*/
@@ -0,0 +1,421 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-journal.h"
+#include "gpaste-history-binary.h"
+
+#include <gpaste-image-item.h>
+#include <gpaste-text-item.h>
+#include <gpaste-uris-item.h>
+
+#include <string.h>
+
+#define G_PASTE_HISTORY_JOURNAL_VERSION "1"
+#define G_PASTE_HISTORY_JOURNAL_HEADER  "GPaste journal " G_PASTE_HISTORY_JOURNAL_VERSION
+
+/*
+ * Records are one header line, optionally followed by a length-prefixed payload:
+ *   a <item> <length>\n<value>\n   add an item on top of the history
+ *   c <index> <item> <length>\n<value>\n   replace the item at index
+ *   r <index>\n   remove the item at index
+ *   e\n   empty the history
+ * <item> is "<kind> -", apart from images which are "Image <date> <width> <height> <checksum>",
+ * <checksum> being "-" if it's not known.
+ */
+
+/**
+ * g_paste_history_journal_get_path:
+ * @history_file_path: the path of the history snapshot
+ *
+ * Get the path of the journal matching a history snapshot
+ *
+ * Returns: (transfer full): the path of the journal
+ */
+gchar *
+g_paste_history_journal_get_path (const gchar *history_file_path)
+{
+    g_return_val_if_fail (history_file_path, NULL);
+
+    return g_strconcat (history_file_path, ".journal", NULL);
+}
+
+static void
+g_paste_history_journal_log_item (GString          *records,
+                                  const GPasteItem *item)
+{
+    const gchar *value = g_paste_item_get_value (item);
+    guint64 length = strlen (value);
+
+    g_string_append_printf (records, " %s ", g_paste_item_get_kind (item));
+
+    if (G_PASTE_IS_IMAGE_ITEM (item))
+    {
+        GPasteImageItem *image_item = G_PASTE_IMAGE_ITEM (item);
+        g_autofree gchar *date = g_date_time_format ((GDateTime *) g_paste_image_item_get_date (image_item), "%s");
+        const gchar *checksum = g_paste_image_item_get_checksum (image_item);
+
+        g_string_append_printf (records, "%s %d %d %s",
+                                date,
+                                g_paste_image_item_get_width (image_item),
+                                g_paste_image_item_get_height (image_item),
+                                (checksum) ? checksum : "-");
+    }
+    else
+        g_string_append_c (records, '-');
+
+    g_string_append_printf (records, " %" G_GUINT64_FORMAT "\n", length);
+    g_string_append_len (records, value, length);
+    g_string_append_c (records, '\n');
+}
+
+/**
+ * g_paste_history_journal_log_add:
+ * @records: the pending records
+ * @item: the #GPasteItem added on top of the history
+ *
+ * Log the addition of an item
+ */
+void
+g_paste_history_journal_log_add (GString          *records,
+                                 const GPasteItem *item)
+{
+    g_string_append_c (records, 'a');
+    g_paste_history_journal_log_item (records, item);
+}
+
+/**
+ * g_paste_history_journal_log_remove:
+ * @records: the pending records
+ * @index: the index of the removed item
+ *
+ * Log the removal of an item
+ */
+void
+g_paste_history_journal_log_remove (GString *records,
+                                    guint64  index)
+{
+    g_string_append_printf (records, "r %" G_GUINT64_FORMAT "\n", index);
+}
+
+/**
+ * g_paste_history_journal_log_replace:
+ * @records: the pending records
+ * @index: the index of the replaced item
+ * @item: the new #GPasteItem
+ *
+ * Log the replacement of an item
+ */
+void
+g_paste_history_journal_log_replace (GString          *records,
+                                     guint64           index,
+                                     const GPasteItem *item)
+{
+    g_string_append_printf (records, "c %" G_GUINT64_FORMAT, index);
+    g_paste_history_journal_log_item (records, item);
+}
+
+/**
+ * g_paste_history_journal_log_empty:
+ * @records: the pending records
+ *
+ * Log the emptying of the history
+ */
+void
+g_paste_history_journal_log_empty (GString *records)
+{
+    g_string_append (records, "e\n");
+}
+
+/**
+ * g_paste_history_journal_reset:
+ * @path: the path of the journal
+ * @serial: the serial of the snapshot the journal applies to
+ * @size: (out): the new size of the journal
+ * @error: a #GError
+ *
+ * Atomically replace the journal by an empty one
+ *
+ * Returns: whether the journal was reset
+ */
+gboolean
+g_paste_history_journal_reset (const gchar *path,
+                               guint64      serial,
+                               guint64     *size,
+                               GError     **error)
+{
+    g_autoptr (GFile) journal = g_file_new_for_path (path);
+    g_autofree gchar *header = g_strdup_printf (G_PASTE_HISTORY_JOURNAL_HEADER " %" G_GUINT64_FORMAT "\n", serial);
+    guint64 length = strlen (header);
+
+    if (!g_file_replace_contents (journal,
+                                  header,
+                                  length,
+                                  NULL, /* etag */
+                                  FALSE, /* backup */
+                                  G_FILE_CREATE_REPLACE_DESTINATION,
+                                  NULL, /* new etag */
+                                  NULL, /* cancellable */
+                                  error))
+    {
+        return FALSE;
+    }
+
+    *size = length;
+
+    return TRUE;
+}
+
+/**
+ * g_paste_history_journal_append:
+ * @path: the path of the journal
+ * @records: the records to append
+ * @size: (inout): the size of the journal
+ * @error: a #GError
+ *
+ * Append the pending records to the journal
+ *
+ * Returns: whether the records were written
+ */
+gboolean
+g_paste_history_journal_append (const gchar   *path,
+                                const GString *records,
+                                guint64       *size,
+                                GError       **error)
+{
+    g_autoptr (GFile) journal = g_file_new_for_path (path);
+    g_autoptr (GFileOutputStream) stream = g_file_append_to (journal,
+                                                             G_FILE_CREATE_NONE,
+                                                             NULL, /* cancellable */
+                                                             error);
+
+    if (!stream)
+        return FALSE;
+
+    if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), records->str, records->len, NULL, NULL /* cancellable */, error) ||
+        !g_output_stream_close (G_OUTPUT_STREAM (stream), NULL /* cancellable */, error))
+    {
+        return FALSE;
+    }
+
+    *size += records->len;
+
+    return TRUE;
+}
+
+/**
+ * g_paste_history_journal_delete:
+ * @path: the path of the journal
+ *
+ * Delete the journal if it exists
+ */
+void
+g_paste_history_journal_delete (const gchar *path)
+{
+    g_autoptr (GFile) journal = g_file_new_for_path (path);
+
+    g_file_delete (journal,
+                   NULL, /* cancellable */
+                   NULL); /* error */
+}
+
+/****************/
+/* Begin Replay */
+/****************/
+
+static const gchar *
+g_paste_history_journal_read_line (const gchar  *data,
+                                   const gchar  *end,
+                                   gchar      ***fields)
+{
+    const gchar *eol = memchr (data, '\n', end - data);
+
+    if (!eol)
+        return NULL;
+
+    g_autofree gchar *line = g_strndup (data, eol - data);
+
+    *fields = g_strsplit (line, " ", -1);
+
+    return eol + 1;
+}
+
+static GPasteItem *
+g_paste_history_journal_read_item (gchar       **fields,
+                                   guint64       nfields,
+                                   const gchar **data,
+                                   const gchar  *end)
+{
+    if (nfields != 3 && nfields != 6)
+        return NULL;
+
+    const gchar *kind = fields[0];
+    const gchar *date = fields[1];
+    guint64 length = g_ascii_strtoull (fields[nfields - 1], NULL, 10);
+
+    if ((guint64) (end - *data) < length + 1 || (*data)[length] != '\n')
+        return NULL;
+
+    g_autofree gchar *value = g_strndup (*data, length);
+
+    *data += length + 1;
+
+    if (!g_strcmp0 (kind, "Text"))
+        return g_paste_text_item_new (value);
+    else if (!g_strcmp0 (kind, "Uris"))
+        return g_paste_uris_item_new (value);
+    else if (!g_strcmp0 (kind, "Image") && nfields == 6)
+    {
+        g_autoptr (GDateTime) date_time = g_date_time_new_from_unix_local (g_ascii_strtoll (date,
+                                                                                            NULL, /* end */
+                                                                                            10)); /* base */
+        gint width = (gint) g_ascii_strtoll (fields[2], NULL, 10);
+        gint height = (gint) g_ascii_strtoll (fields[3], NULL, 10);
+
+        if (width > 0 && height > 0)
+        {
+            return g_paste_image_item_new_from_file_full (value,
+                                                          date_time,
+                                                          width,
+                                                          height,
+                                                          (g_strcmp0 (fields[4], "-")) ? fields[4] : NULL);
+        }
+
+        return g_paste_image_item_new_from_file (value, date_time);
+    }
+
+    g_warning ("Unknown item kind in journal: %s", kind);
+
+    return NULL;
+}
+
+static gboolean
+g_paste_history_journal_apply (const gchar **data,
+                               const gchar  *end,
+                               GPtrArray    *history)
+{
+    g_auto (GStrv) fields = NULL;
+    const gchar *next = g_paste_history_journal_read_line (*data, end, &fields);
+
+    if (!next)
+        return FALSE;
+
+    guint64 nfields = g_strv_length (fields);
+    gboolean ok = FALSE;
+
+    if (!g_strcmp0 (fields[0], "a"))
+    {
+        GPasteItem *item = g_paste_history_journal_read_item (fields + 1, nfields - 1, &next, end);
+
+        if ((ok = !!item))
+            g_ptr_array_insert (history, 0, item);
+    }
+    else if (!g_strcmp0 (fields[0], "c") && nfields > 1)
+    {
+        guint64 index = g_ascii_strtoull (fields[1], NULL, 10);
+        GPasteItem *item = g_paste_history_journal_read_item (fields + 2, nfields - 2, &next, end);
+
+        if ((ok = (index < history->len && item)))
+        {
+            g_paste_history_binary_slot_unref (g_ptr_array_index (history, index));
+            g_ptr_array_index (history, index) = item;
+        }
+        else if (item)
+            g_object_unref (item);
+    }
+    else if (!g_strcmp0 (fields[0], "r") && nfields == 2)
+    {
+        guint64 index = g_ascii_strtoull (fields[1], NULL, 10);
+
+        if ((ok = (index < history->len)))
+        {
+            g_paste_history_binary_slot_unref (g_ptr_array_index (history, index));
+            g_ptr_array_remove_index (history, index);
+        }
+    }
+    else if (!g_strcmp0 (fields[0], "e") && nfields == 1)
+    {
+        g_ptr_array_foreach (history, (GFunc) g_paste_history_binary_slot_unref, NULL);
+        g_ptr_array_set_size (history, 0);
+        ok = TRUE;
+    }
+
+    if (ok)
+        *data = next;
+
+    return ok;
+}
+
+/**
+ * g_paste_history_journal_replay:
+ * @path: the path of the journal
+ * @serial: the serial of the loaded snapshot
+ * @history: the slots of the history loaded from the snapshot, see gpaste-history-binary.h
+ * @size: (out): the size of the journal
+ *
+ * Replay the journal on top of the loaded snapshot
+ *
+ * Returns: %TRUE if the whole journal applied to this snapshot and
+ * can be appended to, %FALSE if it needs to be reset
+ */
+gboolean
+g_paste_history_journal_replay (const gchar *path,
+                                guint64      serial,
+                                GPtrArray   *history,
+                                guint64     *size)
+{
+    g_autofree gchar *contents = NULL;
+    gsize length;
+
+    *size = 0;
+
+    if (!g_file_get_contents (path, &contents, &length, NULL))
+        return FALSE;
+
+    const gchar *data = contents;
+    const gchar *end = contents + length;
+    g_auto (GStrv) header = NULL;
+
+    if (!(data = g_paste_history_journal_read_line (data, end, &header)) ||
+        g_strv_length (header) != 4 ||
+        g_strcmp0 (header[0], "GPaste") || g_strcmp0 (header[1], "journal") ||
+        g_strcmp0 (header[2], G_PASTE_HISTORY_JOURNAL_VERSION) ||
+        g_ascii_strtoull (header[3], NULL, 10) != serial)
+    {
+        /* This journal belongs to another snapshot */
+        return FALSE;
+    }
+
+    while (data < end)
+    {
+        if (!g_paste_history_journal_apply (&data, end, history))
+        {
+            /* Most likely a record interrupted by a crash, keep what we have */
+            g_warning ("Stopped replaying truncated or corrupted journal: %s", path);
+            return FALSE;
+        }
+    }
+
+    *size = length;
+
+    return TRUE;
+}
+
+/**************/
+/* End Replay */
+/**************/
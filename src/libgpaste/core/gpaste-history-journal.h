@@ -0,0 +1,72 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_HISTORY_JOURNAL_H__
+#define __G_PASTE_HISTORY_JOURNAL_H__
+
+#include <gpaste-item.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The journal is an append-only log of the changes made to a history since
+ * its last snapshot (the history file). Indexes in the journal never count
+ * password items as those are never persisted.
+ *
+ * The first line of the journal holds the serial of the snapshot it applies to,
+ * the journal is ignored if it doesn't match the one stored in the snapshot.
+ */
+
+#define G_PASTE_HISTORY_JOURNAL_FORMAT "journal"
+
+/* Don't compact before the journal reaches that size */
+#define G_PASTE_HISTORY_JOURNAL_MIN_COMPACT_SIZE (256 * 1024)
+
+gchar *g_paste_history_journal_get_path (const gchar *history_file_path);
+
+void g_paste_history_journal_log_add     (GString          *records,
+                                          const GPasteItem *item);
+void g_paste_history_journal_log_remove  (GString          *records,
+                                          guint64           index);
+void g_paste_history_journal_log_replace (GString          *records,
+                                          guint64           index,
+                                          const GPasteItem *item);
+void g_paste_history_journal_log_empty   (GString          *records);
+
+gboolean g_paste_history_journal_reset  (const gchar   *path,
+                                         guint64        serial,
+                                         guint64       *size,
+                                         GError       **error);
+gboolean g_paste_history_journal_append (const gchar   *path,
+                                         const GString *records,
+                                         guint64       *size,
+                                         GError       **error);
+gboolean g_paste_history_journal_replay (const gchar   *path,
+                                         guint64        serial,
+                                         GPtrArray     *history,
+                                         guint64       *size);
+void     g_paste_history_journal_delete (const gchar   *path);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_HISTORY_JOURNAL_H__*/
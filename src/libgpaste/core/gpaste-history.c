@@ -17,12 +17,22 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-history-binary.h"
+#include "gpaste-history-blobs.h"
+#include "gpaste-history-catalog.h"
+#include "gpaste-history-eviction.h"
+#include "gpaste-history-index.h"
+#include "gpaste-history-journal.h"
+#include "gpaste-memfd.h"
+#include "gpaste-string.h"
+
 #include <gpaste-history.h>
 #include <gpaste-image-item.h>
 #include <gpaste-gsettings-keys.h>
 #include <gpaste-update-enums.h>
 #include <gpaste-uris-item.h>
-#include <gpaste-util.h>
+
+#include <unistd.h>
 
 struct _GPasteHistory
 {
@@ -32,14 +42,52 @@ struct _GPasteHistory
 typedef struct
 {
     GPasteSettings *settings;
-    GList          *history;
-    guint64         size;
+    /*
+     * Most recent first, we own a reference on each slot: slots loaded from
+     * a binary snapshot only get their item when it's needed, see
+     * g_paste_history_private_get_item
+     */
+    GPtrArray      *history;
+
+    /* Built on demand by g_paste_history_get_history */
+    GList          *history_view;
+    /* The slots holding each value hash, so that duplicates are found without walking the history */
+    GHashTable     *hashes;
+
+    /* Which items can match a search, see gpaste-history-index.h */
+    GPasteHistoryIndex *search_index;
+    /* Slots waiting for their trigrams to be computed in a thread */
+    GPtrArray          *unindexed;
+    guint               index_source;
+    GCancellable       *index_cancellable;
+    /* Reads and searches the other histories for g_paste_history_search_all */
+    GThreadPool        *search_pool;
 
     gchar          *name;
-
-    /* Note: we never track the first (active) item here */
-    guint64         biggest_index;
-    guint64         biggest_size;
+    /* Histories we recently switched away from, most recently used first */
+    GQueue         *residents;
+
+    /* Persistence: changes are coalesced and written from a worker thread */
+    guint64         generation;
+    guint64         snapshot_generation;
+    guint64         saved_generation;
+    GMutex          save_mutex;
+    guint           save_source;
+    gboolean        saving;
+
+    /* Records not yet appended to the journal, NULL when not using it */
+    GString        *journal;
+    gboolean        binary;
+    /* Those are protected by save_mutex */
+    guint64         journal_serial;
+    guint64         journal_size;
+    guint64         snapshot_size;
+
+    /* Bumped for each delta sent, never reset so that clients can spot a gap */
+    guint64         version;
+    /* Deltas waiting for the next update, see g_paste_history_private_log_delta */
+    GArray         *deltas;
+    gboolean        reset;
 
     gulong          changed_signal;
 } GPasteHistoryPrivate;
@@ -48,6 +96,8 @@ G_DEFINE_TYPE_WITH_PRIVATE (GPasteHistory, g_paste_history, G_TYPE_OBJECT)
 
 enum
 {
+    DELTA,
+    SEARCHED,
     SELECTED,
     SWITCH,
     UPDATE,
@@ -57,56 +107,338 @@ enum
 
 static guint64 signals[LAST_SIGNAL] = { 0 };
 
-static void
-g_paste_history_private_elect_new_biggest (GPasteHistoryPrivate *priv)
+static void g_paste_history_private_schedule_save (GPasteHistory *self);
+static void g_paste_history_search_all_thread (gpointer data,
+                                               gpointer user_data);
+static GBytes *g_paste_history_slot_ref_search_value (gconstpointer slot);
+
+#define G_PASTE_HISTORY_SLOT(priv, index) g_ptr_array_index ((priv)->history, (index))
+
+static gboolean
+g_paste_history_slot_is_password (gconstpointer slot)
+{
+    return !g_strcmp0 (g_paste_history_binary_slot_get_kind (slot), "Password");
+}
+
+static gboolean
+g_paste_history_slot_is_text (gconstpointer slot)
+{
+    const gchar *kind = g_paste_history_binary_slot_get_kind (slot);
+
+    return (!g_strcmp0 (kind, "Text") || !g_strcmp0 (kind, "Uris"));
+}
+
+static gboolean
+g_paste_history_slot_is_image (gconstpointer slot)
 {
-    priv->biggest_index = 0;
-    priv->biggest_size = 0;
+    return !g_strcmp0 (g_paste_history_binary_slot_get_kind (slot), "Image");
+}
 
-    GList *history = priv->history;
+/* Like g_paste_item_equals, without creating the item of an entry */
+static gboolean
+g_paste_history_slot_equals (gconstpointer     slot,
+                             const GPasteItem *item)
+{
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return g_paste_item_equals (slot, item);
 
-    if (history)
+    /* Images are named after their contents, so comparing their paths is enough */
+    if (g_paste_history_binary_slot_get_hash (slot) != g_paste_item_get_hash (item) ||
+        g_paste_history_slot_is_image (slot) != G_PASTE_IS_IMAGE_ITEM (item))
     {
-        guint64 index = 1;
+        return FALSE;
+    }
 
-        for (history = history->next; history; history = history->next, ++index)
-        {
-            GPasteItem *item = history->data;
-            guint64 size = g_paste_item_get_size (item);
+    g_autoptr (GBytes) value = g_paste_history_binary_slot_ref_value (slot);
+    g_autoptr (GBytes) other = g_paste_item_ref_real_value (item);
 
-            if (size > priv->biggest_size)
-            {
-                priv->biggest_index = index;
-                priv->biggest_size = size;
-            }
-        }
+    return (value && g_bytes_equal (value, other));
+}
+
+static void
+g_paste_history_slot_delete_image (gconstpointer slot)
+{
+    if (!g_paste_history_slot_is_image (slot))
+        return;
+
+    /* It may still be writing it */
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+    {
+        g_paste_image_item_discard (G_PASTE_IMAGE_ITEM ((gpointer) slot));
+        return;
     }
+
+    g_autoptr (GBytes) path = g_paste_history_binary_slot_ref_value (slot);
+
+    if (!path)
+        return;
+
+    g_autoptr (GFile) image = g_file_new_for_path (g_bytes_get_data (path, NULL));
+
+    g_file_delete (image,
+                   NULL, /* cancellable */
+                   NULL); /* error */
 }
 
+typedef struct
+{
+    GPasteUpdateAction action;
+    guint64            position;
+    GPasteItem        *item;
+} GPasteHistoryDelta;
+
 static void
-g_paste_history_private_remove (GPasteHistoryPrivate *priv,
-                                GList                *elem,
-                                gboolean              remove_leftovers)
+g_paste_history_delta_clear (gpointer data)
+{
+    GPasteHistoryDelta *delta = data;
+
+    g_clear_object (&delta->item);
+}
+
+/*
+ * Every elementary change is logged in order, positions being relative to the
+ * history as it is once the previous deltas are applied. They're sent to the
+ * clients on the next update so that they can apply them locally.
+ */
+static void
+g_paste_history_private_log_delta (GPasteHistoryPrivate *priv,
+                                   GPasteUpdateAction    action,
+                                   guint64               position,
+                                   GPasteItem           *item)
+{
+    if (priv->reset)
+        return;
+
+    GPasteHistoryDelta delta = { action, position, (item) ? g_object_ref (item) : NULL };
+
+    g_array_append_val (priv->deltas, delta);
+}
+
+static void
+g_paste_history_private_invalidate_view (GPasteHistoryPrivate *priv)
+{
+    g_list_free (priv->history_view);
+    priv->history_view = NULL;
+}
+
+/* Hashes are truncated on 32 bits platforms, which only means more candidates to compare */
+#define G_PASTE_HISTORY_HASH_KEY(slot) GSIZE_TO_POINTER (g_paste_history_binary_slot_get_hash (slot))
+
+static void
+g_paste_history_private_hash_slot (GPasteHistoryPrivate *priv,
+                                   gconstpointer         slot)
+{
+    gpointer key = G_PASTE_HISTORY_HASH_KEY (slot);
+    GSList *slots = g_hash_table_lookup (priv->hashes, key);
+
+    /* Don't let the table free the list we're prepending to */
+    g_hash_table_steal (priv->hashes, key);
+    g_hash_table_insert (priv->hashes, key, g_slist_prepend (slots, (gpointer) slot));
+}
+
+static void
+g_paste_history_private_unhash_slot (GPasteHistoryPrivate *priv,
+                                     gconstpointer         slot)
+{
+    gpointer key = G_PASTE_HISTORY_HASH_KEY (slot);
+    GSList *slots = g_slist_remove (g_hash_table_lookup (priv->hashes, key), slot);
+
+    g_hash_table_steal (priv->hashes, key);
+    if (slots)
+        g_hash_table_insert (priv->hashes, key, slots);
+}
+
+static void
+g_paste_history_index_thread (GTask        *task,
+                              gpointer      source_object G_GNUC_UNUSED,
+                              gpointer      task_data,
+                              GCancellable *cancellable G_GNUC_UNUSED)
+{
+    const GPtrArray *slots = task_data;
+    GPtrArray *trigrams = g_ptr_array_new_full (slots->len, (GDestroyNotify) g_array_unref);
+
+    for (guint64 i = 0; i < slots->len; ++i)
+    {
+        g_autoptr (GBytes) value = g_paste_history_slot_ref_search_value (g_ptr_array_index (slots, i));
+
+        g_ptr_array_add (trigrams, g_paste_history_index_get_trigrams ((value) ? g_bytes_get_data (value, NULL) : ""));
+    }
+
+    g_task_return_pointer (task, trigrams, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+g_paste_history_private_on_indexed (GObject      *source_object G_GNUC_UNUSED,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
 {
-    if (!elem)
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GPtrArray) trigrams = g_task_propagate_pointer (G_TASK (result), &error);
+
+    /* The history is gone */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         return;
 
-    GPasteItem *item = elem->data;
+    GPasteHistoryPrivate *priv = user_data;
+    const GPtrArray *slots = g_task_get_task_data (G_TASK (result));
+
+    /* The slots which left the history meanwhile are ignored by the index */
+    for (guint64 i = 0; i < slots->len; ++i)
+        g_paste_history_index_add_trigrams (priv->search_index, G_PASTE_HISTORY_HASH_KEY (g_ptr_array_index (slots, i)), g_ptr_array_index (trigrams, i));
+}
+
+static gboolean
+g_paste_history_private_index_pending (gpointer user_data)
+{
+    GPasteHistoryPrivate *priv = user_data;
+    g_autoptr (GTask) task = g_task_new (NULL, /* source object */
+                                         priv->index_cancellable,
+                                         g_paste_history_private_on_indexed,
+                                         priv);
+
+    priv->index_source = 0;
+    g_task_set_task_data (task, priv->unindexed, (GDestroyNotify) g_ptr_array_unref);
+    priv->unindexed = g_ptr_array_new_with_free_func (g_paste_history_binary_slot_unref);
+    g_task_run_in_thread (task, g_paste_history_index_thread);
+
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Items are found by their hash, and by their trigrams for the searches. Casefolding
+ * them and getting their trigrams happens in a thread, for all the items we added
+ * before the main loop runs again, the index knows they may match anything meanwhile.
+ */
+static void
+g_paste_history_private_index_item (GPasteHistoryPrivate *priv,
+                                    gconstpointer         slot)
+{
+    g_paste_history_private_hash_slot (priv, slot);
+    g_paste_history_index_add_pending (priv->search_index, G_PASTE_HISTORY_HASH_KEY (slot));
+    g_ptr_array_add (priv->unindexed, g_paste_history_binary_slot_ref ((gpointer) slot));
+
+    if (!priv->index_source)
+        priv->index_source = g_idle_add (g_paste_history_private_index_pending, priv);
+}
 
-    priv->size -= g_paste_item_get_size (item);
+static void
+g_paste_history_private_unindex_item (GPasteHistoryPrivate *priv,
+                                      gconstpointer         slot)
+{
+    g_paste_history_private_unhash_slot (priv, slot);
+    g_paste_history_index_remove (priv->search_index, G_PASTE_HISTORY_HASH_KEY (slot));
+}
 
-    if (remove_leftovers)
+/* Find an item equal to @item past the first one, returns 0 if there's none */
+static guint64
+g_paste_history_private_find_duplicate (const GPasteHistoryPrivate *priv,
+                                        const GPasteItem           *item)
+{
+    for (GSList *slots = g_hash_table_lookup (priv->hashes, G_PASTE_HISTORY_HASH_KEY (item)); slots; slots = g_slist_next (slots))
     {
-        if (G_PASTE_IS_IMAGE_ITEM (item))
+        if (slots->data == G_PASTE_HISTORY_SLOT (priv, 0) || !g_paste_history_slot_equals (slots->data, item))
+            continue;
+
+        /* Comparing pointers is cheap compared to moving the rest of the history when removing it */
+        for (guint64 index = 1; index < priv->history->len; ++index)
         {
-            g_autoptr (GFile) image = g_file_new_for_path (g_paste_item_get_value (item));
-            g_file_delete (image,
-                           NULL, /* cancellable */
-                           NULL); /* error */
+            if (G_PASTE_HISTORY_SLOT (priv, index) == slots->data)
+                return index;
         }
-        g_object_unref (item);
     }
-    priv->history = g_list_delete_link (priv->history, elem);
+
+    return 0;
+}
+
+/*
+ * Get the item at index, creating it if its slot still is an entry of the
+ * snapshot we loaded. This is the only place where this happens, so that
+ * the items we never look at never take any memory.
+ */
+static GPasteItem *
+g_paste_history_private_get_item (GPasteHistoryPrivate *priv,
+                                  guint64               index)
+{
+    gpointer slot = G_PASTE_HISTORY_SLOT (priv, index);
+
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+        return slot;
+
+    GPasteItem *item = g_paste_history_binary_slot_dup_item (slot);
+
+    if (index)
+        g_paste_item_set_state (item, G_PASTE_ITEM_STATE_IDLE);
+
+    /* Same value, so same hash and same trigrams */
+    g_paste_history_private_unhash_slot (priv, slot);
+    g_paste_history_binary_slot_unref (slot);
+
+    G_PASTE_HISTORY_SLOT (priv, index) = item;
+    g_paste_history_private_hash_slot (priv, item);
+
+    return item;
+}
+
+static void
+g_paste_history_private_clear (GPasteHistoryPrivate *priv)
+{
+    g_ptr_array_foreach (priv->history, (GFunc) g_paste_history_binary_slot_unref, NULL);
+    g_ptr_array_set_size (priv->history, 0);
+    g_hash_table_remove_all (priv->hashes);
+    g_paste_history_index_clear (priv->search_index);
+    g_ptr_array_set_size (priv->unindexed, 0);
+    g_paste_history_private_invalidate_view (priv);
+
+    /* Nothing before that matters to the clients anymore */
+    g_array_set_size (priv->deltas, 0);
+    priv->reset = TRUE;
+}
+
+/* Passwords are never persisted, so they don't count in the journal indexes */
+static guint64
+g_paste_history_private_get_persisted_index (const GPasteHistoryPrivate *priv,
+                                             guint64                     index)
+{
+    guint64 persisted_index = 0;
+
+    for (guint64 i = 0; i < index; ++i)
+    {
+        if (!g_paste_history_slot_is_password (G_PASTE_HISTORY_SLOT (priv, i)))
+            ++persisted_index;
+    }
+
+    return persisted_index;
+}
+
+/* Take a slot out of the history, the caller gets our reference */
+static gpointer
+g_paste_history_private_take (GPasteHistoryPrivate *priv,
+                              guint64               index)
+{
+    gpointer slot = G_PASTE_HISTORY_SLOT (priv, index);
+
+    if (priv->journal && !g_paste_history_slot_is_password (slot))
+        g_paste_history_journal_log_remove (priv->journal, g_paste_history_private_get_persisted_index (priv, index));
+
+    g_paste_history_private_log_delta (priv, G_PASTE_UPDATE_ACTION_REMOVE, index, NULL);
+    g_paste_history_private_unindex_item (priv, slot);
+    g_ptr_array_remove_index (priv->history, index);
+    g_paste_history_private_invalidate_view (priv);
+
+    return slot;
+}
+
+static void
+g_paste_history_private_remove (GPasteHistoryPrivate *priv,
+                                guint64               index)
+{
+    if (index >= priv->history->len)
+        return;
+
+    gpointer slot = g_paste_history_private_take (priv, index);
+
+    g_paste_history_slot_delete_image (slot);
+    g_paste_history_binary_slot_unref (slot);
 }
 
 static void
@@ -131,13 +463,49 @@ g_paste_history_emit_switch (GPasteHistory *self,
                    NULL);
 }
 
+static GArray *
+g_paste_history_private_new_deltas (void)
+{
+    GArray *deltas = g_array_new (FALSE, FALSE, sizeof (GPasteHistoryDelta));
+
+    g_array_set_clear_func (deltas, g_paste_history_delta_clear);
+
+    return deltas;
+}
+
+static GPasteItem *g_paste_history_private_get (GPasteHistoryPrivate *priv,
+                                                guint64               pos);
+
+static void
+g_paste_history_emit_delta (GPasteHistory     *self,
+                            GPasteUpdateAction action,
+                            GPasteUpdateTarget target,
+                            guint64            position,
+                            GPasteItem        *item)
+{
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    g_signal_emit (self,
+                   signals[DELTA],
+                   0, /* detail */
+                   ++priv->version,
+                   action,
+                   target,
+                   position,
+                   item,
+                   NULL);
+}
+
 static void
 g_paste_history_update (GPasteHistory     *self,
                         GPasteUpdateAction action,
                         GPasteUpdateTarget target,
                         guint64            position)
 {
-    g_paste_history_save (self, NULL);
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    ++priv->generation;
+    g_paste_history_private_schedule_save (self);
 
     g_signal_emit (self,
                    signals[UPDATE],
@@ -146,6 +514,33 @@ g_paste_history_update (GPasteHistory     *self,
                    target,
                    position,
                    NULL);
+
+    if (priv->reset || (!priv->deltas->len && target == G_PASTE_UPDATE_TARGET_ALL))
+    {
+        g_array_set_size (priv->deltas, 0);
+        g_paste_history_emit_delta (self, action, G_PASTE_UPDATE_TARGET_ALL, 0, NULL);
+    }
+    else if (!priv->deltas->len)
+    {
+        /* Changes made in place, such as replacing an item */
+        g_paste_history_emit_delta (self, action, target, position, g_paste_history_private_get (priv, position));
+    }
+    else
+    {
+        /* Take the deltas first, handlers may change the history */
+        g_autoptr (GArray) deltas = priv->deltas;
+
+        priv->deltas = g_paste_history_private_new_deltas ();
+
+        for (guint i = 0; i < deltas->len; ++i)
+        {
+            const GPasteHistoryDelta *delta = &g_array_index (deltas, GPasteHistoryDelta, i);
+
+            g_paste_history_emit_delta (self, delta->action, G_PASTE_UPDATE_TARGET_POSITION, delta->position, delta->item);
+        }
+    }
+
+    priv->reset = FALSE;
 }
 
 static void
@@ -153,70 +548,203 @@ g_paste_history_activate_first (GPasteHistory *self,
                                 gboolean       select)
 {
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GList *history = priv->history;
 
-    if (!history)
+    if (!priv->history->len)
         return;
 
-    GPasteItem *first = history->data;
+    GPasteItem *first = g_paste_history_private_get_item (priv, 0);
 
-    priv->size -= g_paste_item_get_size (first);
     g_paste_item_set_state (first, G_PASTE_ITEM_STATE_ACTIVE);
-    priv->size += g_paste_item_get_size (first);
 
     if (select)
         g_paste_history_selected (self, first);
 }
 
+/* How many histories we keep in memory besides the current one, so that switching back to them is instant */
+#define G_PASTE_HISTORY_MAX_RESIDENTS 4
+
+/* A history we switched away from, as it was on disk when we left it */
+typedef struct
+{
+    gchar     *name;
+    /* We own a reference on each item */
+    GPtrArray *history;
+    gboolean   binary;
+    guint64    journal_serial;
+    guint64    journal_size;
+    guint64    snapshot_size;
+    /* What its files looked like (0 if it has none), to spot them being changed behind our back */
+    gint64     files_modified;
+    guint64    files_size;
+} GPasteHistoryResident;
+
+static void
+g_paste_history_resident_free (gpointer data)
+{
+    GPasteHistoryResident *resident = data;
+
+    if (resident->history)
+    {
+        g_ptr_array_foreach (resident->history, (GFunc) g_paste_history_binary_slot_unref, NULL);
+        g_ptr_array_unref (resident->history);
+    }
+    g_free (resident->name);
+    g_free (resident);
+}
+
 static void
-g_paste_history_private_check_memory_usage (GPasteHistoryPrivate *priv)
+g_paste_history_private_drop_resident (GPasteHistoryPrivate *priv,
+                                       const gchar          *name)
+{
+    for (GList *resident = priv->residents->head; resident; resident = g_list_next (resident))
+    {
+        if (!g_strcmp0 (((GPasteHistoryResident *) resident->data)->name, name))
+        {
+            g_paste_history_resident_free (resident->data);
+            g_queue_delete_link (priv->residents, resident);
+            return;
+        }
+    }
+}
+
+/* Items change size by themselves (see g_paste_item_compress), so this is summed each time we need it */
+static guint64
+g_paste_history_get_memory_usage (const GPtrArray *history)
+{
+    guint64 size = 0;
+
+    for (guint64 i = 0; i < history->len; ++i)
+        size += g_paste_history_binary_slot_get_size (g_ptr_array_index (history, i));
+
+    return size;
+}
+
+/* The resident histories share the memory budget with the current one, which always comes first */
+static void
+g_paste_history_private_trim_residents (GPasteHistoryPrivate *priv)
 {
     guint64 max_memory = g_paste_settings_get_max_memory_usage (priv->settings) * 1024 * 1024;
+    guint64 size = g_paste_history_get_memory_usage (priv->history) + g_paste_history_index_get_size (priv->search_index);
 
-    while (priv->size > max_memory && !priv->biggest_index)
+    for (GList *resident = priv->residents->head; resident; resident = g_list_next (resident))
+        size += g_paste_history_get_memory_usage (((GPasteHistoryResident *) resident->data)->history);
+
+    /* The images cached by the image items are the cheapest to get back, they go first */
+    g_paste_image_item_trim_cache ((size < max_memory) ? max_memory - size : 0);
+    size += g_paste_image_item_get_cache_size ();
+
+    while (!g_queue_is_empty (priv->residents) &&
+           (size > max_memory || g_queue_get_length (priv->residents) > G_PASTE_HISTORY_MAX_RESIDENTS))
     {
-        GList *biggest = g_list_nth (priv->history, priv->biggest_index);
+        GPasteHistoryResident *resident = g_queue_pop_tail (priv->residents);
+
+        size -= g_paste_history_get_memory_usage (resident->history);
+        g_paste_history_resident_free (resident);
+    }
+}
+
+/* The search index grows with the items, and shrinks with them, the cached images go with them too */
+static guint64
+g_paste_history_private_get_memory_usage (const GPasteHistoryPrivate *priv)
+{
+    return g_paste_history_get_memory_usage (priv->history) +
+           g_paste_history_index_get_size (priv->search_index) +
+           g_paste_image_item_get_cache_size ();
+}
 
-        g_return_if_fail (biggest);
+/*
+ * max-memory-usage is a hard bound: we evict as many items as the eviction policy
+ * needs to get back under it, only the first (active) item is always kept.
+ * Each eviction is reported to the clients as a removal with the next update.
+ */
+static void
+g_paste_history_private_check_memory_usage (GPasteHistoryPrivate *priv)
+{
+    guint64 max_memory = g_paste_settings_get_max_memory_usage (priv->settings) * 1024 * 1024;
+
+    g_paste_history_private_trim_residents (priv);
+
+    guint64 size = g_paste_history_private_get_memory_usage (priv);
 
-        g_paste_history_private_remove (priv, biggest, TRUE);
-        g_paste_history_private_elect_new_biggest (priv);
+    if (size <= max_memory)
+        return;
+
+    GPasteHistoryEvictionPolicy policy = g_paste_history_eviction_policy_from_string (g_paste_settings_get_eviction_policy (priv->settings));
+    g_autoptr (GArray) sizes = g_array_sized_new (FALSE, /* zero-terminated */
+                                                  FALSE, /* clear */
+                                                  sizeof (guint64),
+                                                  priv->history->len);
+
+    for (guint64 i = 0; i < priv->history->len; ++i)
+    {
+        guint64 item_size = g_paste_history_binary_slot_get_size (G_PASTE_HISTORY_SLOT (priv, i));
+
+        g_array_append_val (sizes, item_size);
     }
+
+    g_autoptr (GArray) victims = g_paste_history_eviction_plan (sizes, policy, size - max_memory);
+
+    for (guint64 i = 0; i < victims->len; ++i)
+        g_paste_history_private_remove (priv, g_array_index (victims, guint64, i));
+
+    guint64 freed = size - g_paste_history_private_get_memory_usage (priv);
+
+    g_debug ("Evicted %u items (%" G_GUINT64_FORMAT " bytes) to stay under max-memory-usage",
+             victims->len,
+             freed);
 }
 
 static void
 g_paste_history_private_check_size (GPasteHistoryPrivate *priv)
 {
-    GList *history = priv->history;
     guint64 max_history_size = g_paste_settings_get_max_history_size (priv->settings);
-    guint64 length = g_list_length (history);
+    guint64 length = priv->history->len;
 
     if (length > max_history_size)
     {
-        history = g_list_nth (history, max_history_size);
-        g_return_if_fail (history);
-        history->prev->next = NULL;
-        history->prev = NULL;
+        guint64 index = (priv->journal) ? g_paste_history_private_get_persisted_index (priv, max_history_size) : 0;
+
+        /* Log them from the tail, so that each position is still valid when applied */
+        for (guint64 i = length; i-- > max_history_size;)
+            g_paste_history_private_log_delta (priv, G_PASTE_UPDATE_ACTION_REMOVE, i, NULL);
+
+        for (guint64 i = max_history_size; i < length; ++i)
+        {
+            gpointer slot = G_PASTE_HISTORY_SLOT (priv, i);
 
-        for (GList *_history = history; _history; _history = g_list_next (_history))
-            priv->size -= g_paste_item_get_size (_history->data);
-        g_list_free_full (history,
-                          g_object_unref);
+            if (priv->journal && !g_paste_history_slot_is_password (slot))
+                g_paste_history_journal_log_remove (priv->journal, index);
+
+            g_paste_history_private_unindex_item (priv, slot);
+            g_paste_history_binary_slot_unref (slot);
+        }
+
+        /* Evicting from the tail is only a matter of shrinking the array */
+        g_ptr_array_set_size (priv->history, max_history_size);
+        g_paste_history_private_invalidate_view (priv);
     }
 }
 
+/* How deep in the history we look for a line that grew */
+#define G_PASTE_HISTORY_GROWING_LINES_DEPTH 8
+
 static gboolean
 g_paste_history_private_is_growing_line (GPasteHistoryPrivate *priv,
-                                         GPasteItem           *old,
+                                         gconstpointer         old,
                                          GPasteItem           *new)
 {
     if (!(g_paste_settings_get_growing_lines (priv->settings) &&
-        G_PASTE_IS_TEXT_ITEM (old) && G_PASTE_IS_TEXT_ITEM (new) &&
-        !G_PASTE_IS_PASSWORD_ITEM (old) && !G_PASTE_IS_PASSWORD_ITEM (new)))
+        g_paste_history_slot_is_text (old) && g_paste_history_slot_is_text (new)))
             return FALSE;
 
-    const gchar *n = g_paste_item_get_value (new);
-    const gchar *o = g_paste_item_get_value (old);
+    g_autoptr (GBytes) new_value = g_paste_item_ref_real_value (new);
+    g_autoptr (GBytes) old_value = g_paste_history_binary_slot_ref_value (old);
+
+    if (!old_value)
+        return FALSE;
+
+    const gchar *n = g_bytes_get_data (new_value, NULL);
+    const gchar *o = g_bytes_get_data (old_value, NULL);
 
     return (g_str_has_prefix (n, o) || g_str_has_suffix (n, o));
 }
@@ -242,13 +770,11 @@ g_paste_history_add (GPasteHistory *self,
 
     g_return_if_fail (g_paste_item_get_size (item) < max_memory);
 
-    GList *history = priv->history;
-    gboolean election_needed = FALSE;
     GPasteUpdateTarget target = G_PASTE_UPDATE_TARGET_ALL;
 
-    if (history)
+    if (priv->history->len)
     {
-        GPasteItem *old_first = history->data;
+        GPasteItem *old_first = g_paste_history_private_get_item (priv, 0);
 
         if (g_paste_item_equals (old_first, item))
             return;
@@ -256,50 +782,48 @@ g_paste_history_add (GPasteHistory *self,
         if (g_paste_history_private_is_growing_line (priv, old_first, item))
         {
             target = G_PASTE_UPDATE_TARGET_POSITION;
-            g_paste_history_private_remove (priv, history, FALSE);
+            g_object_unref (g_paste_history_private_take (priv, 0));
         }
         else
         {
-            /* size may change when state is idle */
-            priv->size -= g_paste_item_get_size (old_first);
             g_paste_item_set_state (old_first, G_PASTE_ITEM_STATE_IDLE);
 
-            guint64 size = g_paste_item_get_size (old_first);
+            guint64 index = g_paste_history_private_find_duplicate (priv, item);
 
-            priv->size += size;
-
-            if (size >= priv->biggest_size)
+            /* A line being extended is one of the last ones we copied */
+            if (!index && g_paste_settings_get_growing_lines (priv->settings))
             {
-                priv->biggest_index = 0; /* Current 0, will become 1 */
-                priv->biggest_size = size;
-            }
+                guint64 length = MIN (priv->history->len, G_PASTE_HISTORY_GROWING_LINES_DEPTH);
 
-            guint64 index = 1;
-            for (history = history->next; history; history = history->next, ++index)
-            {
-                if (g_paste_item_equals (history->data, item) || g_paste_history_private_is_growing_line (priv, history->data, item))
+                for (guint64 i = 1; !index && i < length; ++i)
                 {
-                    g_paste_history_private_remove (priv, history, FALSE);
-                    if (index == priv->biggest_index)
-                        election_needed = TRUE;
-                    break;
+                    if (g_paste_history_private_is_growing_line (priv, G_PASTE_HISTORY_SLOT (priv, i), item))
+                        index = i;
                 }
             }
 
-            ++priv->biggest_index;
+            if (index)
+            {
+                gpointer other = g_paste_history_private_take (priv, index);
+
+                /* When selecting an item, it's the one we're adding and our reference moves to the front */
+                if (other != item)
+                    g_paste_history_binary_slot_unref (other);
+            }
         }
     }
 
-    priv->history = g_list_prepend (priv->history, item);
+    g_ptr_array_insert (priv->history, 0, item);
+    g_paste_history_private_log_delta (priv, G_PASTE_UPDATE_ACTION_ADD, 0, item);
+    g_paste_history_private_index_item (priv, item);
+    g_paste_history_private_invalidate_view (priv);
+
+    if (priv->journal && !G_PASTE_IS_PASSWORD_ITEM (item))
+        g_paste_history_journal_log_add (priv->journal, item);
 
     g_paste_history_activate_first (self, FALSE);
-    priv->size += g_paste_item_get_size (item);
 
     g_paste_history_private_check_size (priv);
-
-    if (election_needed)
-        g_paste_history_private_elect_new_biggest (priv);
-
     g_paste_history_private_check_memory_usage (priv);
     g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REPLACE, target, 0);
 }
@@ -320,24 +844,14 @@ g_paste_history_remove (GPasteHistory *self,
     g_return_if_fail (G_PASTE_IS_HISTORY (self));
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GList *history = priv->history;
 
-    g_return_if_fail (pos < g_list_length (history));
+    g_return_if_fail (pos < priv->history->len);
 
-    GList *item = g_list_nth (history, pos);
-
-    g_return_if_fail (item);
-
-    g_paste_history_private_remove (priv, item, TRUE);
+    g_paste_history_private_remove (priv, pos);
 
     if (!pos)
         g_paste_history_activate_first (self, TRUE);
 
-    if (pos == priv->biggest_index)
-        g_paste_history_private_elect_new_biggest (priv);
-    else if (pos < priv->biggest_index)
-        --priv->biggest_index;
-
     g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REMOVE, G_PASTE_UPDATE_TARGET_POSITION, pos);
 }
 
@@ -345,12 +859,10 @@ static GPasteItem *
 g_paste_history_private_get (GPasteHistoryPrivate *priv,
                              guint64               pos)
 {
-    GList *history = priv->history;
-
-    if (pos >= g_list_length (history))
+    if (pos >= priv->history->len)
         return NULL;
 
-    return G_PASTE_ITEM (g_list_nth_data (history, pos));
+    return g_paste_history_private_get_item (priv, pos);
 }
 
 /**
@@ -450,11 +962,10 @@ g_paste_history_select (GPasteHistory *self,
     g_return_if_fail (G_PASTE_IS_HISTORY (self));
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GList *history = priv->history;
 
-    g_return_if_fail (index < g_list_length (history));
+    g_return_if_fail (index < priv->history->len);
 
-    GPasteItem *item = g_list_nth_data (history, index);
+    GPasteItem *item = g_paste_history_private_get_item (priv, index);
 
     g_paste_history_add (self, item);
     g_paste_history_selected (self, item);
@@ -463,21 +974,26 @@ g_paste_history_select (GPasteHistory *self,
 static void
 _g_paste_history_replace (GPasteHistory *self,
                           guint64        index,
-                          GPasteItem    *new,
-                          GList         *todel)
+                          GPasteItem    *new)
 {
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GPasteItem *old = todel->data;
+    gpointer old = G_PASTE_HISTORY_SLOT (priv, index);
 
-    priv->size -= g_paste_item_get_size (old);
-    priv->size += g_paste_item_get_size (new);
-
-    g_object_unref (old);
-    todel->data = new;
+    if (priv->journal && !g_paste_history_slot_is_password (old))
+    {
+        guint64 persisted_index = g_paste_history_private_get_persisted_index (priv, index);
 
-    if (index == priv->biggest_index)
-        g_paste_history_private_elect_new_biggest (priv);
+        if (G_PASTE_IS_PASSWORD_ITEM (new))
+            g_paste_history_journal_log_remove (priv->journal, persisted_index);
+        else
+            g_paste_history_journal_log_replace (priv->journal, persisted_index, new);
+    }
 
+    g_paste_history_private_unindex_item (priv, old);
+    g_paste_history_private_index_item (priv, new);
+    g_paste_history_binary_slot_unref (old);
+    g_ptr_array_index (priv->history, index) = new;
+    g_paste_history_private_invalidate_view (priv);
     g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REPLACE, G_PASTE_UPDATE_TARGET_POSITION, index);
 }
 
@@ -500,21 +1016,14 @@ g_paste_history_replace (GPasteHistory *self,
     g_return_if_fail (!contents || g_utf8_validate (contents, -1, NULL));
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GList *history = priv->history;
 
-    g_return_if_fail (index < g_list_length (history));
+    g_return_if_fail (index < priv->history->len);
 
-    GList *todel = g_list_nth (history, index);
-
-    g_return_if_fail (todel);
-
-    GPasteItem *item = todel->data;
-
-    g_return_if_fail (G_PASTE_IS_TEXT_ITEM (item) && !g_strcmp0 (g_paste_item_get_kind (item), "Text"));
+    g_return_if_fail (!g_strcmp0 (g_paste_history_binary_slot_get_kind (G_PASTE_HISTORY_SLOT (priv, index)), "Text"));
 
     GPasteItem *new = g_paste_text_item_new (contents);
 
-    _g_paste_history_replace (self, index, new, todel);
+    _g_paste_history_replace (self, index, new);
 
     if (!index)
         g_paste_history_selected (self, new);
@@ -539,35 +1048,34 @@ g_paste_history_set_password (GPasteHistory *self,
     g_return_if_fail (!name || g_utf8_validate (name, -1, NULL));
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GList *history = priv->history;
 
-    g_return_if_fail (index < g_list_length (history));
+    g_return_if_fail (index < priv->history->len);
 
-    GList *todel = g_list_nth (history, index);
+    gconstpointer slot = G_PASTE_HISTORY_SLOT (priv, index);
 
-    g_return_if_fail (todel);
+    g_return_if_fail (!g_strcmp0 (g_paste_history_binary_slot_get_kind (slot), "Text"));
 
-    GPasteItem *item = todel->data;
+    g_autoptr (GBytes) value = g_paste_history_binary_slot_ref_value (slot);
 
-    g_return_if_fail (G_PASTE_IS_TEXT_ITEM (item) && !g_strcmp0 (g_paste_item_get_kind (item), "Text"));
+    g_return_if_fail (value);
 
-    GPasteItem *password = g_paste_password_item_new (name, g_paste_item_get_real_value (item));
+    GPasteItem *password = g_paste_password_item_new (name, g_bytes_get_data (value, NULL));
 
-    _g_paste_history_replace (self, index, password, todel);
+    _g_paste_history_replace (self, index, password);
 }
 
 static GPasteItem *
-_g_paste_history_private_get_password (const GPasteHistoryPrivate *priv,
-                                       const gchar                *name,
-                                       guint64                    *index)
+_g_paste_history_private_get_password (GPasteHistoryPrivate *priv,
+                                       const gchar          *name,
+                                       guint64              *index)
 {
-    guint64 idx = 0;
-
-    for (GList *h = priv->history; h; h = g_list_next (h), ++idx)
+    for (guint64 idx = 0; idx < priv->history->len; ++idx)
     {
-        GPasteItem *i = h->data;
-        if (G_PASTE_IS_PASSWORD_ITEM (i) &&
-            !g_strcmp0 (g_paste_password_item_get_name ((GPastePasswordItem *) i), name))
+        if (!g_paste_history_slot_is_password (G_PASTE_HISTORY_SLOT (priv, idx)))
+            continue;
+
+        GPasteItem *i = g_paste_history_private_get_item (priv, idx);
+        if (!g_strcmp0 (g_paste_password_item_get_name ((GPastePasswordItem *) i), name))
         {
             if (index)
                 *index = idx;
@@ -669,27 +1177,12 @@ g_paste_history_empty (GPasteHistory *self)
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-    g_list_free_full (priv->history,
-                      g_object_unref);
-    priv->history = NULL;
-    priv->size = 0;
-
-    g_paste_history_private_elect_new_biggest (priv);
-    g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REMOVE, G_PASTE_UPDATE_TARGET_ALL, 0);
-}
+    g_paste_history_private_clear (priv);
 
-static gchar *
-g_paste_history_encode (const gchar *text)
-{
-    g_autofree gchar *_encoded_text = g_paste_util_replace (text, "&", "&amp;");
-    return g_paste_util_replace (_encoded_text, ">", "&gt;");
-}
+    if (priv->journal)
+        g_paste_history_journal_log_empty (priv->journal);
 
-static gchar *
-g_paste_history_decode (const gchar *text)
-{
-    g_autofree gchar *_decoded_text = g_paste_util_replace (text, "&gt;", ">");
-    return g_paste_util_replace (_decoded_text, "&amp;", "&");
+    g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REMOVE, G_PASTE_UPDATE_TARGET_ALL, 0);
 }
 
 static gchar *
@@ -706,21 +1199,79 @@ g_paste_history_get_history_dir (void)
 }
 
 static gchar *
-g_paste_history_get_history_file_path (const gchar *name)
+g_paste_history_get_history_file_path (const gchar *name,
+                                       gboolean     binary)
 {
     g_return_val_if_fail (name, NULL);
 
     g_autofree gchar *history_dir_path = g_paste_history_get_history_dir_path ();
-    g_autofree gchar *history_file_name = g_strconcat (name, ".xml", NULL);
+    g_autofree gchar *history_file_name = g_strconcat (name, (binary) ? G_PASTE_HISTORY_BINARY_EXTENSION : ".xml", NULL);
 
     return g_build_filename (history_dir_path, history_file_name, NULL);
 }
 
-static GFile *
-g_paste_history_get_history_file (const gchar *name)
+static void
+g_paste_history_delete_history_file (const gchar *history_file_path)
+{
+    g_autoptr (GFile) history_file = g_file_new_for_path (history_file_path);
+    g_autofree gchar *journal_path = g_paste_history_journal_get_path (history_file_path);
+
+    g_file_delete (history_file,
+                   NULL, /* cancellable*/
+                   NULL); /* error */
+    g_paste_history_journal_delete (journal_path);
+}
+
+/* How many characters of an item we show when it stands for a whole history or search result */
+#define G_PASTE_HISTORY_SNIPPET_LENGTH 80
+
+static gchar *
+g_paste_history_get_snippet (gconstpointer slot)
+{
+    g_autoptr (GPasteItem) item = g_paste_history_binary_slot_dup_item (slot);
+    g_autofree gchar *snippet = g_paste_item_dup_display_string (item, G_PASTE_HISTORY_SNIPPET_LENGTH);
+
+    return g_paste_string_flatten (snippet);
+}
+
+/* Get the latest modification time of the files of a history (0 if there's none) and the room they take */
+static gint64
+g_paste_history_get_files_info (const gchar *name,
+                                guint64     *size)
 {
-    g_autofree gchar *history_file_path = g_paste_history_get_history_file_path (name);
-    return g_file_new_for_path (history_file_path);
+    gint64 modified = 0;
+
+    *size = 0;
+
+    for (guint64 binary = 0; binary < 2; ++binary)
+    {
+        g_autofree gchar *history_file_path = g_paste_history_get_history_file_path (name, binary);
+        g_autofree gchar *journal_path = g_paste_history_journal_get_path (history_file_path);
+        const gchar *paths[] = { history_file_path, journal_path };
+
+        for (guint64 i = 0; i < G_N_ELEMENTS (paths); ++i)
+        {
+            g_autoptr (GFile) file = g_file_new_for_path (paths[i]);
+            g_autoptr (GFileInfo) info = g_file_query_info (file,
+                                                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                                            G_FILE_QUERY_INFO_NONE,
+                                                            NULL, /* cancellable */
+                                                            NULL); /* error */
+
+            if (!info)
+                continue;
+
+            gint64 mtime = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+                           g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+            *size += g_file_info_get_size (info);
+            modified = MAX (modified, mtime);
+        }
+    }
+
+    return modified;
 }
 
 static gboolean
@@ -749,12 +1300,389 @@ ensure_history_dir_exists (gboolean save_history)
     return TRUE;
 }
 
+typedef struct
+{
+    GPtrArray *items;
+    GString   *records;
+    gchar     *name;
+    gchar     *history_file_path;
+    /* The same history in the other format, which we replace */
+    gchar     *stale_file_path;
+    gboolean   save_history;
+    gboolean   journal;
+    gboolean   binary;
+    guint64    generation;
+    /* What goes to the catalog */
+    guint64    length;
+    gchar     *preview;
+} GPasteHistorySnapshot;
+
+static void
+g_paste_history_snapshot_free (gpointer data)
+{
+    GPasteHistorySnapshot *snapshot = data;
+
+    if (snapshot->items)
+        g_ptr_array_unref (snapshot->items);
+    if (snapshot->records)
+        g_string_free (snapshot->records, TRUE);
+    g_free (snapshot->name);
+    g_free (snapshot->history_file_path);
+    g_free (snapshot->stale_file_path);
+    g_free (snapshot->preview);
+    g_free (snapshot);
+}
+
+static GPasteHistorySnapshot *
+g_paste_history_private_snapshot (GPasteHistoryPrivate *priv,
+                                  const gchar          *name,
+                                  gboolean              full)
+{
+    GPasteHistorySnapshot *snapshot = g_new (GPasteHistorySnapshot, 1);
+
+    snapshot->items = NULL;
+    snapshot->records = NULL;
+    snapshot->name = g_strdup ((name) ? name : priv->name);
+    snapshot->history_file_path = g_paste_history_get_history_file_path (snapshot->name, priv->binary);
+    snapshot->stale_file_path = g_paste_history_get_history_file_path (snapshot->name, !priv->binary);
+    snapshot->save_history = g_paste_settings_get_save_history (priv->settings);
+    snapshot->journal = !!priv->journal;
+    snapshot->binary = priv->binary;
+    snapshot->generation = priv->generation;
+    snapshot->length = 0;
+    snapshot->preview = NULL;
+
+    for (guint64 i = 0; i < priv->history->len; ++i)
+    {
+        gconstpointer slot = G_PASTE_HISTORY_SLOT (priv, i);
+
+        if (g_paste_history_slot_is_password (slot))
+            continue;
+
+        if (!snapshot->length++)
+            snapshot->preview = g_paste_history_get_snippet (slot);
+    }
+
+    if (!full)
+    {
+        /* We only need to append what changed since the last save to the journal */
+        snapshot->records = priv->journal;
+        priv->journal = g_string_new (NULL);
+        return snapshot;
+    }
+
+    snapshot->items = g_ptr_array_new_with_free_func (g_paste_history_binary_slot_unref);
+
+    /* Items are never mutated once in the history (apart from their state), so holding a ref is enough */
+    for (guint64 i = 0; i < priv->history->len; ++i)
+    {
+        gpointer slot = G_PASTE_HISTORY_SLOT (priv, i);
+
+        if (!g_paste_history_slot_is_password (slot))
+            g_ptr_array_add (snapshot->items, g_paste_history_binary_slot_ref (slot));
+    }
+
+    /* The snapshot will contain everything that's been journaled so far */
+    if (priv->journal && (!name || !g_strcmp0 (name, priv->name)))
+        g_string_truncate (priv->journal, 0);
+
+    return snapshot;
+}
+
+static GString *
+g_paste_history_snapshot_serialize (const GPasteHistorySnapshot *snapshot,
+                                    guint64                      serial,
+                                    GPtrArray                   *blobs)
+{
+    GString *contents = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+
+    if (serial)
+        g_string_append_printf (contents, "<history version=\"1.0\" serial=\"%" G_GUINT64_FORMAT "\">\n", serial);
+    else
+        g_string_append (contents, "<history version=\"1.0\">\n");
+
+    for (guint i = 0; i < snapshot->items->len; ++i)
+    {
+        gconstpointer slot = g_ptr_array_index (snapshot->items, i);
+        const gchar *kind = g_paste_history_binary_slot_get_kind (slot);
+        /* Entries which already are in a blob stay there */
+        gchar *blob = g_paste_history_binary_slot_dup_blob (slot);
+        g_autoptr (GBytes) value = (blob) ? NULL : g_paste_history_binary_slot_ref_value (slot);
+
+        if (!blob && !value)
+            continue;
+
+        if (!blob && !g_strcmp0 (kind, "Text") && g_bytes_get_size (value) > G_PASTE_HISTORY_BLOBS_THRESHOLD)
+        {
+            blob = g_paste_history_blobs_store ((G_PASTE_HISTORY_BINARY_IS_ENTRY (slot)) ? NULL : (GPasteItem *) slot,
+                                                g_bytes_get_data (value, NULL),
+                                                g_bytes_get_size (value) - 1);
+        }
+
+        g_autofree gchar *text = g_paste_string_xml_encode ((blob) ? blob : g_bytes_get_data (value, NULL));
+
+        g_string_append (contents, "  <item kind=\"");
+        g_string_append (contents, kind);
+
+        if (blob)
+        {
+            /* So that loading it back doesn't need to check it against its id */
+            guint64 length = (value) ? g_bytes_get_size (value) - 1 : g_paste_history_binary_slot_get_size (slot) - 1;
+
+            g_string_append_printf (contents, "\" blob=\"true\" length=\"%" G_GUINT64_FORMAT, length);
+            g_ptr_array_add (blobs, blob);
+        }
+
+        if (g_paste_history_slot_is_image (slot))
+        {
+            g_autoptr (GPasteItem) item = g_paste_history_binary_slot_dup_item (slot);
+            GPasteImageItem *image_item = G_PASTE_IMAGE_ITEM (item);
+            g_autofree gchar *date = g_date_time_format ((GDateTime *) g_paste_image_item_get_date (image_item), "%s");
+            const gchar *checksum = g_paste_image_item_get_checksum (image_item);
+
+            g_string_append (contents, "\" date=\"");
+            g_string_append (contents, date);
+            g_string_append_printf (contents, "\" width=\"%d\" height=\"%d",
+                                    g_paste_image_item_get_width (image_item),
+                                    g_paste_image_item_get_height (image_item));
+
+            if (checksum)
+            {
+                g_string_append (contents, "\" checksum=\"");
+                g_string_append (contents, checksum);
+            }
+        }
+
+        g_string_append (contents, "\"><![CDATA[");
+        g_string_append (contents, text);
+        g_string_append (contents, "]]></item>\n");
+    }
+
+    g_string_append (contents, "</history>\n");
+
+    return contents;
+}
+
+static void
+g_paste_history_private_snapshot_write_full (GPasteHistoryPrivate        *priv,
+                                             const GPasteHistorySnapshot *snapshot,
+                                             gboolean                     own_history)
+{
+    g_autoptr (GFile) history_file = g_file_new_for_path (snapshot->history_file_path);
+    g_autofree gchar *journal_path = g_paste_history_journal_get_path (snapshot->history_file_path);
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GPtrArray) blobs = g_ptr_array_new_with_free_func (g_free);
+
+    /* The serial links the snapshot to its journal, a journal with another serial is stale */
+    guint64 serial = (own_history && snapshot->journal) ? MAX (priv->journal_serial + 1, (guint64) g_get_real_time ()) : 0;
+    GString *contents = (snapshot->binary) ?
+        g_paste_history_binary_serialize (snapshot->items, serial, blobs) :
+        g_paste_history_snapshot_serialize (snapshot, serial, blobs);
+
+    /* This writes to a temporary file and renames it, so that we never leave a truncated history behind */
+    if (!g_file_replace_contents (history_file,
+                                  contents->str,
+                                  contents->len,
+                                  NULL, /* etag */
+                                  FALSE, /* backup */
+                                  G_FILE_CREATE_REPLACE_DESTINATION,
+                                  NULL, /* new etag */
+                                  NULL, /* cancellable */
+                                  &error))
+    {
+        g_warning ("%s: %s", _("Failed to save history"), error->message);
+        /* The previous file is still there, and so are its references */
+        g_paste_history_blobs_collect (blobs);
+        serial = 0;
+    }
+    else
+    {
+        g_paste_history_blobs_set_refs (snapshot->name, blobs);
+
+        if (serial && !g_paste_history_journal_reset (journal_path, serial, &priv->journal_size, &error))
+        {
+            g_warning ("%s: %s", _("Failed to reset history journal"), error->message);
+            serial = 0;
+        }
+        else if (!serial)
+            g_paste_history_journal_delete (journal_path);
+    }
+
+    /* Don't let the history in its previous format shadow this one */
+    if (!error)
+        g_paste_history_delete_history_file (snapshot->stale_file_path);
+
+    if (own_history)
+    {
+        priv->journal_serial = serial;
+        priv->snapshot_size = contents->len;
+    }
+
+    g_string_free (contents, TRUE);
+}
+
+static void
+g_paste_history_snapshot_catalog (const GPasteHistorySnapshot *snapshot)
+{
+    GPasteHistoryCatalogEntry entry = { snapshot->length, 0, 0, snapshot->preview };
+
+    entry.modified = g_paste_history_get_files_info (snapshot->name, &entry.size);
+
+    if (entry.modified)
+        g_paste_history_catalog_update (snapshot->name, &entry);
+    else
+        g_paste_history_catalog_remove (snapshot->name);
+}
+
+static void
+g_paste_history_private_snapshot_write (GPasteHistoryPrivate        *priv,
+                                        const GPasteHistorySnapshot *snapshot,
+                                        gboolean                     own_history)
+{
+    if (!snapshot->save_history)
+    {
+        g_paste_history_delete_history_file (snapshot->history_file_path);
+        g_paste_history_delete_history_file (snapshot->stale_file_path);
+        g_paste_history_blobs_set_refs (snapshot->name, NULL);
+
+        if (own_history)
+            priv->journal_serial = 0;
+    }
+    else if (snapshot->records)
+    {
+        g_autofree gchar *journal_path = g_paste_history_journal_get_path (snapshot->history_file_path);
+        g_autoptr (GError) error = NULL;
+
+        if (snapshot->records->len && !g_paste_history_journal_append (journal_path, snapshot->records, &priv->journal_size, &error))
+        {
+            g_warning ("%s: %s", _("Failed to write history journal"), error->message);
+            /* Force the next save to be a full one */
+            priv->journal_serial = 0;
+        }
+    }
+    else
+        g_paste_history_private_snapshot_write_full (priv, snapshot, own_history);
+
+    g_paste_history_snapshot_catalog (snapshot);
+}
+
+static void
+g_paste_history_private_write_snapshot (GPasteHistoryPrivate        *priv,
+                                        const GPasteHistorySnapshot *snapshot,
+                                        gboolean                     own_history)
+{
+    g_mutex_lock (&priv->save_mutex);
+
+    if (!own_history)
+        g_paste_history_private_snapshot_write (priv, snapshot, FALSE);
+    else if (snapshot->generation > priv->saved_generation)
+    {
+        /* An older snapshot still queued in a worker will see this and won't overwrite us */
+        g_paste_history_private_snapshot_write (priv, snapshot, TRUE);
+        priv->saved_generation = snapshot->generation;
+    }
+
+    g_mutex_unlock (&priv->save_mutex);
+}
+
+static gboolean
+g_paste_history_private_needs_compaction (GPasteHistoryPrivate *priv)
+{
+    if (!priv->journal)
+        return TRUE;
+
+    g_mutex_lock (&priv->save_mutex);
+    gboolean ret = (!priv->journal_serial ||
+                    priv->journal_size + priv->journal->len > MAX (priv->snapshot_size, G_PASTE_HISTORY_JOURNAL_MIN_COMPACT_SIZE));
+    g_mutex_unlock (&priv->save_mutex);
+
+    return ret;
+}
+
+static void
+g_paste_history_save_thread (GTask        *task,
+                             gpointer      source_object,
+                             gpointer      task_data,
+                             GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (G_PASTE_HISTORY (source_object));
+
+    g_paste_history_private_write_snapshot (priv, task_data, TRUE);
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+g_paste_history_save_done (GObject      *source_object,
+                           GAsyncResult *res G_GNUC_UNUSED,
+                           gpointer      user_data G_GNUC_UNUSED)
+{
+    GPasteHistory *self = G_PASTE_HISTORY (source_object);
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    priv->saving = FALSE;
+
+    /* Something changed while we were writing */
+    if (priv->generation > priv->snapshot_generation)
+        g_paste_history_private_schedule_save (self);
+}
+
+static void
+g_paste_history_private_start_save (GPasteHistory *self)
+{
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    if (!ensure_history_dir_exists (g_paste_settings_get_save_history (priv->settings)))
+        return;
+
+    g_autoptr (GTask) task = g_task_new (self,
+                                         NULL, /* cancellable */
+                                         g_paste_history_save_done,
+                                         NULL); /* user data */
+
+    gboolean full = g_paste_history_private_needs_compaction (priv);
+
+    g_task_set_task_data (task, g_paste_history_private_snapshot (priv, NULL, full), g_paste_history_snapshot_free);
+    priv->snapshot_generation = priv->generation;
+    priv->saving = TRUE;
+
+    g_task_run_in_thread (task, g_paste_history_save_thread);
+}
+
+static gboolean
+g_paste_history_save_timeout (gpointer user_data)
+{
+    GPasteHistory *self = user_data;
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    priv->save_source = 0;
+    g_paste_history_private_start_save (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+g_paste_history_private_schedule_save (GPasteHistory *self)
+{
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    /* If a save is already pending or running, it will pick up this change */
+    if (priv->save_source || priv->saving)
+        return;
+
+    guint64 delay = g_paste_settings_get_save_history_delay (priv->settings);
+
+    if (delay)
+        priv->save_source = g_timeout_add (delay, g_paste_history_save_timeout, self);
+    else
+        g_paste_history_private_start_save (self);
+}
+
 /**
  * g_paste_history_save:
  * @self: a #GPasteHistory instance
  * @name: (nullable): the name to save the history to (defaults to the configured one)
  *
- * Save the #GPasteHistory to the history file
+ * Save the #GPasteHistory to the history file right away
  *
  * Returns:
  */
@@ -765,65 +1693,108 @@ g_paste_history_save (GPasteHistory *self,
     g_return_if_fail (G_PASTE_IS_HISTORY (self));
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+    gboolean own_history = (!name || !g_strcmp0 (name, priv->name));
 
-    GPasteSettings *settings = priv->settings;
-    gboolean save_history = g_paste_settings_get_save_history (settings);
-    g_autofree gchar *history_file_path = NULL;
-    g_autoptr (GFile) history_file = NULL;
-
-    if (!ensure_history_dir_exists (save_history))
+    if (!ensure_history_dir_exists (g_paste_settings_get_save_history (priv->settings)))
         return;
 
-    history_file_path = g_paste_history_get_history_file_path ((name) ? name : priv->name);
-    history_file = g_file_new_for_path (history_file_path);
+    if (own_history && priv->save_source)
+    {
+        g_source_remove (priv->save_source);
+        priv->save_source = 0;
+    }
+
+    GPasteHistorySnapshot *snapshot = g_paste_history_private_snapshot (priv, name, TRUE);
 
-    if (!save_history)
+    if (!own_history)
     {
-        g_file_delete (history_file,
-                       NULL, /* cancellable*/
-                       NULL); /* error */
+        /* We're overwriting it */
+        g_paste_history_private_drop_resident (priv, name);
     }
     else
     {
-        g_autoptr (GOutputStream) stream = G_OUTPUT_STREAM (g_file_replace (history_file,
-                                                            NULL,
-                                                            FALSE,
-                                                            G_FILE_CREATE_REPLACE_DESTINATION,
-                                                            NULL, /* cancellable */
-                                                            NULL)); /* error */
+        /* Make sure we write even if nothing changed since the last save */
+        snapshot->generation = ++priv->generation;
+        priv->snapshot_generation = priv->generation;
+    }
 
-        if (!g_output_stream_write_all (stream, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n", 39, NULL, NULL /* cancellable */, NULL /* error */) ||
-            !g_output_stream_write_all (stream, "<history version=\"1.0\">\n", 24, NULL, NULL /* cancellable */, NULL /* error */))
-                return;
+    g_paste_history_private_write_snapshot (priv, snapshot, own_history);
+    g_paste_history_snapshot_free (snapshot);
+}
 
-        for (GList *history = priv->history; history; history = g_list_next (history))
-        {
-            GPasteItem *item = history->data;
-            const gchar *kind = g_paste_item_get_kind (item);
+/**
+ * g_paste_history_flush:
+ * @self: a #GPasteHistory instance
+ *
+ * Synchronously write the pending changes of the #GPasteHistory to the
+ * history file, if any, and wait for the images it references to be saved.
+ * Call this before exiting or reexecuting.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_history_flush (GPasteHistory *self)
+{
+    g_return_if_fail (G_PASTE_IS_HISTORY (self));
 
-            if (!g_strcmp0 (kind, "Password"))
-                continue;
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-            g_autofree gchar *text = g_paste_history_encode (g_paste_item_get_value (item));
+    if (priv->save_source)
+    {
+        g_source_remove (priv->save_source);
+        priv->save_source = 0;
+    }
 
-            if (!g_output_stream_write_all (stream, "  <item kind=\"", 14, NULL, NULL /* cancellable */, NULL /* error */) ||
-                !g_output_stream_write_all (stream, kind, strlen (kind), NULL, NULL /* cancellable */, NULL /* error */) ||
-                (G_PASTE_IS_IMAGE_ITEM (item) &&
-                    (!g_output_stream_write_all (stream, "\" date=\"", 8, NULL, NULL /* cancellable */, NULL /* error */) ||
-                     !g_output_stream_write_all (stream, g_date_time_format ((GDateTime *) g_paste_image_item_get_date (G_PASTE_IMAGE_ITEM (item)), "%s"), 10, NULL, NULL /* cancellable */, NULL /* error */))) ||
-                !g_output_stream_write_all (stream, "\"><![CDATA[", 11, NULL, NULL /* cancellable */, NULL /* error */) ||
-                !g_output_stream_write_all (stream, text, strlen (text), NULL, NULL /* cancellable */, NULL /* error */) ||
-                !g_output_stream_write_all (stream, "]]></item>\n", 11, NULL, NULL /* cancellable */, NULL /* error */))
-            {
-                g_warning ("Failed to write an item to history");
-                continue;
-            }
-        }
+    g_mutex_lock (&priv->save_mutex);
+    gboolean dirty = (priv->generation > priv->saved_generation);
+    g_mutex_unlock (&priv->save_mutex);
 
-        if (!g_output_stream_write_all (stream, "</history>\n", 11, NULL, NULL /* cancellable */, NULL /* error */) ||
-            !g_output_stream_close (stream, NULL /* cancellable */, NULL /* error */))
-                return;
+    if (dirty && ensure_history_dir_exists (g_paste_settings_get_save_history (priv->settings)))
+    {
+        GPasteHistorySnapshot *snapshot = g_paste_history_private_snapshot (priv, NULL, TRUE);
+
+        priv->snapshot_generation = priv->generation;
+        g_paste_history_private_write_snapshot (priv, snapshot, TRUE);
+        g_paste_history_snapshot_free (snapshot);
     }
+
+    g_paste_history_catalog_flush ();
+    /* The history would reference images which were never written otherwise */
+    g_paste_image_item_wait_for_saves ();
+}
+
+/**
+ * g_paste_history_hand_off:
+ * @self: a #GPasteHistory instance
+ *
+ * Flush the #GPasteHistory and serialize all of it, passwords included,
+ * into a sealed memory file which survives exec, so that a new daemon
+ * can pick it up with g_paste_history_take_over
+ *
+ * Returns: the file descriptor, or -1 if the history couldn't be handed off
+ */
+G_PASTE_VISIBLE gint
+g_paste_history_hand_off (GPasteHistory *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), -1);
+
+    /* Whatever happens to the new daemon, what we have must be on disk */
+    g_paste_history_flush (self);
+
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+    GString *contents = g_paste_history_binary_serialize (priv->history,
+                                                          0,     /* serial */
+                                                          NULL); /* blobs */
+    g_autoptr (GError) error = NULL;
+    gint fd = g_paste_memfd_new ("gpaste-history", contents->str, contents->len, TRUE, &error);
+
+    g_string_free (contents, TRUE);
+
+    /* Without sealed memory files, the new daemon will just load the history */
+    if (fd < 0 && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED))
+        g_warning ("%s: %s", _("Failed to hand off history"), error->message);
+
+    return fd;
 }
 
 /********************/
@@ -849,15 +1820,22 @@ typedef enum
 
 typedef struct
 {
-    GPasteHistoryPrivate *priv;
-    State                 state;
-    Type                  type;
-    guint64               current_size;
-    guint64               max_size;
-    gboolean              images_support;
-    gchar                *date;
-    gchar                *name;
-    gchar                *text;
+    GPtrArray *history;
+    /* Don't clean anything up when only peeking at a history */
+    gboolean   read_only;
+    State      state;
+    Type       type;
+    guint64    serial;
+    gchar     *date;
+    gint       width;
+    gint       height;
+    gchar     *checksum;
+    gchar     *name;
+    gchar     *text;
+    /* The text is the id of the blob holding the value */
+    gboolean   blob;
+    /* The length of that value, if the history knows it */
+    guint64    length;
 } Data;
 
 #define ASSERT_STATE(x)                                                                           \
@@ -883,12 +1861,22 @@ start_tag (GMarkupParseContext *context G_GNUC_UNUSED,
     if (!g_strcmp0 (element_name, "history"))
     {
         SWITCH_STATE (BEGIN, IN_HISTORY);
+        for (const gchar **a = attribute_names, **v = attribute_values; *a && *v; ++a, ++v)
+        {
+            if (!g_strcmp0 (*a, "serial"))
+                data->serial = g_ascii_strtoull (*v, NULL, 10);
+        }
     }
     else if (!g_strcmp0 (element_name, "item"))
     {
         SWITCH_STATE (IN_HISTORY, IN_ITEM);
         g_clear_pointer (&data->date, g_free);
+        g_clear_pointer (&data->checksum, g_free);
+        g_clear_pointer (&data->name, g_free);
         g_clear_pointer (&data->text, g_free);
+        data->width = data->height = 0;
+        data->blob = FALSE;
+        data->length = G_PASTE_HISTORY_BLOBS_UNKNOWN_LENGTH;
         for (const gchar **a = attribute_names, **v = attribute_values; *a && *v; ++a, ++v)
         {
             if (!g_strcmp0 (*a, "kind"))
@@ -913,6 +1901,20 @@ start_tag (GMarkupParseContext *context G_GNUC_UNUSED,
                 }
                 data->date = g_strdup (*v);
             }
+            else if (!g_strcmp0 (*a, "width") || !g_strcmp0 (*a, "height") || !g_strcmp0 (*a, "checksum"))
+            {
+                if (data->type != IMAGE)
+                {
+                    g_warning ("Expected type %" G_GINT32_FORMAT ", but got %" G_GINT32_FORMAT, IMAGE, data->type);
+                    return;
+                }
+                if (**a == 'w')
+                    data->width = (gint) g_ascii_strtoll (*v, NULL, 10);
+                else if (**a == 'h')
+                    data->height = (gint) g_ascii_strtoll (*v, NULL, 10);
+                else
+                    data->checksum = g_strdup (*v);
+            }
             else if (!g_strcmp0 (*a, "name"))
             {
                 if (data->type != PASSWORD)
@@ -922,6 +1924,17 @@ start_tag (GMarkupParseContext *context G_GNUC_UNUSED,
                 }
                 data->name = g_strdup (*v);
             }
+            else if (!g_strcmp0 (*a, "blob"))
+            {
+                if (data->type != TEXT)
+                {
+                    g_warning ("Expected type %" G_GINT32_FORMAT ", but got %" G_GINT32_FORMAT, TEXT, data->type);
+                    return;
+                }
+                data->blob = !g_strcmp0 (*v, "true");
+            }
+            else if (!g_strcmp0 (*a, "length"))
+                data->length = g_ascii_strtoull (*v, NULL, 10);
             else
                 g_warning ("Unknown item attribute: %s", *a);
         }
@@ -972,56 +1985,66 @@ on_text (GMarkupParseContext *context G_GNUC_UNUSED,
         break;
     case IN_ITEM:
     {
-        g_autofree gchar *value = g_paste_history_decode (txt);
+        g_autofree gchar *value = g_paste_string_xml_decode (txt);
         if (*g_strstrip (txt))
         {
-            if (data->current_size < data->max_size)
-            {
-                GPasteItem *item = NULL;
+            GPasteItem *item = NULL;
 
-                switch (data->type)
+            /* Size limits and images support are enforced once the journal has been replayed */
+            switch (data->type)
+            {
+            case TEXT:
+                if (data->blob)
                 {
-                case TEXT:
-                    item = g_paste_text_item_new (value);
-                    break;
-                case URIS:
-                    item = g_paste_uris_item_new (value);
-                    break;
-                case PASSWORD:
-                    item = g_paste_password_item_new (data->name, value);
-                    break;
-                case IMAGE:
-                    if (data->images_support && data->date)
+                    g_autofree gchar *blob = g_paste_history_blobs_load (value, data->length);
+
+                    if (blob)
                     {
-                        g_autoptr (GDateTime) date_time = g_date_time_new_from_unix_local (g_ascii_strtoll (data->date,
-                                                                                                            NULL, /* end */
-                                                                                                            0)); /* base */
-                        item = g_paste_image_item_new_from_file (value, date_time);
+                        item = g_paste_text_item_new (blob);
+                        g_paste_history_blobs_set_item_id (item, value);
                     }
                     else
-                    {
-                        g_autoptr (GFile) img_file = g_file_new_for_path (value);
-
-                        if (g_file_query_exists (img_file,
-                                                 NULL)) /* cancellable */
-                        {
-                            g_file_delete (img_file,
-                                           NULL, /* cancellable */
-                                           NULL); /* error */
-                        }
-                    }
-                    break;
-                }
-
-                if (item)
-                {
-                    GPasteHistoryPrivate *priv = data->priv;
-                    priv->size += g_paste_item_get_size (item);
-                    priv->history = g_list_append (priv->history, item);
-                    ++data->current_size;;
+                        g_warning ("Missing or damaged blob: %s", value);
                 }
-            }
-
+                else
+                    item = g_paste_text_item_new (value);
+                break;
+            case URIS:
+                item = g_paste_uris_item_new (value);
+                break;
+            case PASSWORD:
+                item = g_paste_password_item_new (data->name, value);
+                break;
+            case IMAGE:
+                if (data->date)
+                {
+                    g_autoptr (GDateTime) date_time = g_date_time_new_from_unix_local (g_ascii_strtoll (data->date,
+                                                                                                        NULL, /* end */
+                                                                                                        0)); /* base */
+                    /* Histories saved by older versions don't know about the image itself */
+                    if (data->width > 0 && data->height > 0)
+                        item = g_paste_image_item_new_from_file_full (value, date_time, data->width, data->height, data->checksum);
+                    else
+                        item = g_paste_image_item_new_from_file (value, date_time);
+                }
+                else if (!data->read_only)
+                {
+                    g_autoptr (GFile) img_file = g_file_new_for_path (value);
+
+                    if (g_file_query_exists (img_file,
+                                             NULL)) /* cancellable */
+                    {
+                        g_file_delete (img_file,
+                                       NULL, /* cancellable */
+                                       NULL); /* error */
+                    }
+                }
+                break;
+            }
+
+            if (item)
+                g_ptr_array_add (data->history, item);
+
             SWITCH_STATE (IN_ITEM, HAS_TEXT);
         }
         break;
@@ -1042,6 +2065,290 @@ static void on_error (GMarkupParseContext *context   G_GNUC_UNUSED,
 /* End XML Parser */
 /******************/
 
+static void
+g_paste_history_load_xml (GPtrArray   *history,
+                          gboolean     read_only,
+                          const gchar *history_file_path,
+                          guint64     *serial,
+                          guint64     *size)
+{
+    GMarkupParser parser = {
+        start_tag,
+        end_tag,
+        on_text,
+        NULL,
+        on_error
+    };
+    Data data = {
+        history,
+        read_only,
+        BEGIN,
+        TEXT,
+        0,
+        NULL,
+        0,
+        0,
+        NULL,
+        NULL,
+        NULL,
+        FALSE,
+        G_PASTE_HISTORY_BLOBS_UNKNOWN_LENGTH
+    };
+    GMarkupParseContext *ctx = g_markup_parse_context_new (&parser,
+                                                           G_MARKUP_TREAT_CDATA_AS_TEXT,
+                                                           &data,
+                                                           NULL);
+    g_autofree gchar *text = NULL;
+    guint64 text_length = 0;
+
+    g_file_get_contents (history_file_path, &text, &text_length, NULL);
+    g_markup_parse_context_parse (ctx, text, text_length, NULL);
+    g_markup_parse_context_end_parse (ctx, NULL);
+
+    if (data.state != END)
+        g_warning ("Unexpected state adter parsing history: %" G_GINT32_FORMAT, data.state);
+    g_markup_parse_context_unref (ctx);
+    g_free (data.date);
+    g_free (data.checksum);
+    g_free (data.name);
+    g_free (data.text);
+
+    *serial = data.serial;
+    *size = text_length;
+}
+
+static gboolean
+g_paste_history_private_apply_limits (GPasteHistoryPrivate *priv)
+{
+    gboolean images_support = g_paste_settings_get_images_support (priv->settings);
+    guint64 max_history_size = g_paste_settings_get_max_history_size (priv->settings);
+    guint64 length = 0;
+
+    for (guint64 i = 0; i < priv->history->len; ++i)
+    {
+        gpointer slot = G_PASTE_HISTORY_SLOT (priv, i);
+
+        if (length < max_history_size && (images_support || !g_paste_history_slot_is_image (slot)))
+        {
+            /* Compact the kept items as we go */
+            G_PASTE_HISTORY_SLOT (priv, length++) = slot;
+            continue;
+        }
+
+        if (!images_support)
+            g_paste_history_slot_delete_image (slot);
+
+        g_paste_history_binary_slot_unref (slot);
+    }
+
+    gboolean changed = (length != priv->history->len);
+
+    g_ptr_array_set_size (priv->history, length);
+
+    return changed;
+}
+
+/*
+ * Read a history which isn't the current one, leaving it untouched on disk:
+ * unlike g_paste_history_load, this never creates, converts or trims anything.
+ * This doesn't touch any instance data so that it can run in a worker thread.
+ */
+static GPtrArray *
+g_paste_history_read (const gchar *name,
+                      gboolean     binary)
+{
+    GPtrArray *history = g_ptr_array_new ();
+    g_autofree gchar *history_file_path = g_paste_history_get_history_file_path (name, binary);
+
+    if (!g_file_test (history_file_path, G_FILE_TEST_EXISTS))
+    {
+        /* The history may not have been converted to the current format yet */
+        g_free (history_file_path);
+        binary = !binary;
+        history_file_path = g_paste_history_get_history_file_path (name, binary);
+    }
+
+    if (g_file_test (history_file_path, G_FILE_TEST_EXISTS))
+    {
+        guint64 serial = 0;
+        guint64 size = 0;
+
+        if (binary)
+            g_paste_history_binary_load (history_file_path, &serial, history, &size);
+        else
+            g_paste_history_load_xml (history, TRUE, history_file_path, &serial, &size);
+
+        if (serial)
+        {
+            g_autofree gchar *journal_path = g_paste_history_journal_get_path (history_file_path);
+
+            g_paste_history_journal_replay (journal_path, serial, history, &size);
+        }
+    }
+
+    /* The journal releases the items it drops itself, only own them from now on */
+    g_ptr_array_set_free_func (history, g_paste_history_binary_slot_unref);
+
+    return history;
+}
+
+/*
+ * Keep the history we're leaving around, its pending changes must have been flushed.
+ * It's ours until we come back to it: we drop it ourselves when we change it
+ * (see g_paste_history_private_drop_resident), so its files only tell us whether
+ * something else wrote it in the meantime. A history we don't save has no files,
+ * and stays valid as long as nothing creates some for it.
+ */
+static void
+g_paste_history_private_stash (GPasteHistoryPrivate *priv)
+{
+    guint64 files_size = 0;
+    gint64 files_modified = g_paste_history_get_files_info (priv->name, &files_size);
+    GPasteHistoryResident *resident = g_new (GPasteHistoryResident, 1);
+
+    resident->name = g_strdup (priv->name);
+    resident->history = priv->history;
+    resident->binary = priv->binary;
+    resident->files_modified = files_modified;
+    resident->files_size = files_size;
+
+    g_mutex_lock (&priv->save_mutex);
+    resident->journal_serial = priv->journal_serial;
+    resident->journal_size = priv->journal_size;
+    resident->snapshot_size = priv->snapshot_size;
+    g_mutex_unlock (&priv->save_mutex);
+
+    priv->history = g_ptr_array_new ();
+
+    /* Keep it just like loading it again would give it back: no password and nothing active */
+    for (guint64 i = resident->history->len; i-- > 0;)
+    {
+        gpointer slot = g_ptr_array_index (resident->history, i);
+
+        if (g_paste_history_slot_is_password (slot))
+        {
+            g_paste_history_binary_slot_unref (slot);
+            g_ptr_array_remove_index (resident->history, i);
+            continue;
+        }
+
+        if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+            g_paste_item_set_state (slot, G_PASTE_ITEM_STATE_IDLE);
+    }
+
+    g_paste_history_private_drop_resident (priv, resident->name);
+    g_queue_push_head (priv->residents, resident);
+}
+
+static GPasteHistoryResident *
+g_paste_history_private_take_resident (GPasteHistoryPrivate *priv,
+                                       const gchar          *name)
+{
+    for (GList *l = priv->residents->head; l; l = g_list_next (l))
+    {
+        GPasteHistoryResident *resident = l->data;
+
+        if (g_strcmp0 (resident->name, name))
+            continue;
+
+        g_queue_delete_link (priv->residents, l);
+
+        guint64 files_size = 0;
+        gint64 files_modified = g_paste_history_get_files_info (name, &files_size);
+
+        if (files_modified == resident->files_modified && files_size == resident->files_size)
+            return resident;
+
+        g_paste_history_resident_free (resident);
+        break;
+    }
+
+    return NULL;
+}
+
+/* Read the current history from its files, returns whether they were in the binary format */
+static gboolean
+g_paste_history_private_read_files (GPasteHistoryPrivate *priv,
+                                    guint64              *serial,
+                                    guint64              *snapshot_size,
+                                    guint64              *journal_size)
+{
+    gboolean binary = priv->binary;
+    g_autofree gchar *history_file_path = g_paste_history_get_history_file_path (priv->name, binary);
+    g_autoptr (GFile) history_file = g_file_new_for_path (history_file_path);
+
+    if (!g_file_query_exists (history_file,
+                              NULL)) /* cancellable */
+    {
+        /* The history may not have been converted to the current format yet */
+        g_autofree gchar *other_file_path = g_paste_history_get_history_file_path (priv->name, !binary);
+        g_autoptr (GFile) other_file = g_file_new_for_path (other_file_path);
+
+        if (g_file_query_exists (other_file,
+                                 NULL)) /* cancellable */
+        {
+            g_free (history_file_path);
+            history_file_path = g_steal_pointer (&other_file_path);
+            g_object_unref (history_file);
+            history_file = g_steal_pointer (&other_file);
+            binary = !binary;
+        }
+    }
+
+    if (g_file_query_exists (history_file,
+                             NULL)) /* cancellable */
+    {
+        guint64 snapshot_serial = 0;
+
+        if (binary)
+            g_paste_history_binary_load (history_file_path, &snapshot_serial, priv->history, snapshot_size);
+        else
+            g_paste_history_load_xml (priv->history, FALSE, history_file_path, &snapshot_serial, snapshot_size);
+
+        /* Whatever the configured format is, don't lose what has been journaled */
+        if (snapshot_serial)
+        {
+            g_autofree gchar *journal_path = g_paste_history_journal_get_path (history_file_path);
+
+            if (g_paste_history_journal_replay (journal_path, snapshot_serial, priv->history, journal_size))
+                *serial = snapshot_serial;
+        }
+    }
+    else
+    {
+        /* Create the empty file to be listed as an available history */
+        if (ensure_history_dir_exists (g_paste_settings_get_save_history (priv->settings)))
+            g_object_unref (g_file_create (history_file, G_FILE_CREATE_NONE, NULL, NULL));
+    }
+
+    return binary;
+}
+
+/* Index the items we just loaded and make the first one active */
+static void
+g_paste_history_finish_loading (GPasteHistory *self)
+{
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    g_paste_history_private_invalidate_view (priv);
+
+    for (guint64 i = 0; i < priv->history->len; ++i)
+    {
+        gpointer slot = G_PASTE_HISTORY_SLOT (priv, i);
+
+        /* The first one gets activated right after, entries are idle until they become items */
+        if (i && !G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+            g_paste_item_set_state (slot, G_PASTE_ITEM_STATE_IDLE);
+
+        g_paste_history_private_index_item (priv, slot);
+    }
+
+    if (priv->history->len)
+        g_paste_history_activate_first (self, TRUE);
+
+    g_paste_history_private_trim_residents (priv);
+}
+
 /**
  * g_paste_history_load:
  * @self: a #GPasteHistory instance
@@ -1059,69 +2366,110 @@ g_paste_history_load (GPasteHistory *self,
     g_return_if_fail (!name || g_utf8_validate (name, -1, NULL));
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    GPasteSettings *settings = priv->settings;
 
     if (priv->name && !g_strcmp0(name, priv->name))
         return;
 
-    g_list_free_full (priv->history,
-                      g_object_unref);
-    priv->history = NULL;
+    /* Don't lose the pending changes of the history we're leaving */
+    if (priv->name)
+    {
+        g_paste_history_flush (self);
+        g_paste_history_private_stash (priv);
+    }
+
+    g_paste_history_private_clear (priv);
+
+    if (priv->journal)
+        g_string_truncate (priv->journal, 0);
 
     g_free (priv->name);
     priv->name = g_strdup ((name) ? name : g_paste_settings_get_history_name (priv->settings));
 
-    g_autofree gchar *history_file_path = g_paste_history_get_history_file_path (priv->name);
-    g_autoptr (GFile) history_file = g_file_new_for_path (history_file_path);
+    GPasteHistoryResident *resident = g_paste_history_private_take_resident (priv, priv->name);
+    gboolean binary;
+    guint64 serial = 0;
+    guint64 snapshot_size = 0;
+    guint64 journal_size = 0;
 
-    if (g_file_query_exists (history_file,
-                             NULL)) /* cancellable */
+    if (resident)
     {
-        GMarkupParser parser = {
-            start_tag,
-            end_tag,
-            on_text,
-            NULL,
-            on_error
-        };
-        Data data = {
-            priv,
-            BEGIN,
-            TEXT,
-            0,
-            g_paste_settings_get_max_history_size (settings),
-            g_paste_settings_get_images_support (settings),
-            NULL,
-            NULL,
-            NULL
-        };
-        GMarkupParseContext *ctx = g_markup_parse_context_new (&parser,
-                                                               G_MARKUP_TREAT_CDATA_AS_TEXT,
-                                                               &data,
-                                                               NULL);
-        gchar *text;
-        guint64 text_length;
-
-        g_file_get_contents (history_file_path, &text, &text_length, NULL);
-        g_markup_parse_context_parse (ctx, text, text_length, NULL);
-        g_markup_parse_context_end_parse (ctx, NULL);
-
-        if (data.state != END)
-            g_warning ("Unexpected state adter parsing history: %" G_GINT32_FORMAT, data.state);
-        g_markup_parse_context_unref (ctx);
+        /* We left it recently and nobody touched it since, no need to read it again */
+        g_ptr_array_unref (priv->history);
+        priv->history = g_steal_pointer (&resident->history);
+        binary = resident->binary;
+        serial = resident->journal_serial;
+        snapshot_size = resident->snapshot_size;
+        journal_size = resident->journal_size;
+        g_paste_history_resident_free (resident);
     }
     else
+        binary = g_paste_history_private_read_files (priv, &serial, &snapshot_size, &journal_size);
+
+    if (binary != priv->binary)
     {
-        /* Create the empty file to be listed as an available history */
-        if (ensure_history_dir_exists (g_paste_settings_get_save_history (settings)))
-            g_object_unref (g_file_create (history_file, G_FILE_CREATE_NONE, NULL, NULL));
+        /* Force a full save to convert the history */
+        serial = 0;
     }
 
-    if (priv->history)
+    if (g_paste_history_private_apply_limits (priv))
     {
-        g_paste_history_activate_first (self, TRUE);
-        g_paste_history_private_elect_new_biggest (priv);
+        /* The journal doesn't match what we have in memory anymore */
+        serial = 0;
     }
+
+    g_mutex_lock (&priv->save_mutex);
+    priv->journal_serial = serial;
+    priv->journal_size = journal_size;
+    priv->snapshot_size = snapshot_size;
+    g_mutex_unlock (&priv->save_mutex);
+
+    g_paste_history_finish_loading (self);
+}
+
+/**
+ * g_paste_history_take_over:
+ * @self: a #GPasteHistory instance
+ * @fd: a file descriptor obtained from g_paste_history_hand_off
+ *
+ * Load the #GPasteHistory handed off by a previous daemon instead
+ * of reading the history file, passwords included.
+ * This replaces g_paste_history_load and closes @fd.
+ *
+ * Returns: whether the history could be taken over, load it otherwise
+ */
+G_PASTE_VISIBLE gboolean
+g_paste_history_take_over (GPasteHistory *self,
+                           gint           fd)
+{
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), FALSE);
+    g_return_val_if_fail (fd >= 0, FALSE);
+
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    g_return_val_if_fail (!priv->name, FALSE);
+
+    GPtrArray *history = g_ptr_array_new ();
+    guint64 serial;
+    gboolean loaded = g_paste_history_binary_load_fd (fd, &serial, history);
+
+    close (fd);
+
+    if (!loaded)
+    {
+        g_ptr_array_foreach (history, (GFunc) g_paste_history_binary_slot_unref, NULL);
+        g_ptr_array_unref (history);
+        return FALSE;
+    }
+
+    g_ptr_array_unref (priv->history);
+    priv->history = history;
+    priv->name = g_strdup (g_paste_settings_get_history_name (priv->settings));
+
+    /* We don't know how the journal was when it was handed off, the first save will be a full one */
+    g_paste_history_private_apply_limits (priv);
+    g_paste_history_finish_loading (self);
+
+    return TRUE;
 }
 
 /**
@@ -1165,10 +2513,24 @@ g_paste_history_delete (GPasteHistory *self,
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-    g_autoptr (GFile) history_file = g_paste_history_get_history_file ((name) ? name : priv->name);
+    g_autofree gchar *history_file_path = g_paste_history_get_history_file_path ((name) ? name : priv->name, priv->binary);
+    g_autofree gchar *stale_file_path = g_paste_history_get_history_file_path ((name) ? name : priv->name, !priv->binary);
+    g_autofree gchar *journal_path = g_paste_history_journal_get_path (history_file_path);
+    g_autoptr (GFile) history_file = g_file_new_for_path (history_file_path);
 
     if (!g_strcmp0 (name, priv->name))
+    {
         g_paste_history_empty (self);
+        /* Don't let a pending save resurrect the file */
+        g_paste_history_flush (self);
+
+        g_mutex_lock (&priv->save_mutex);
+        priv->journal_serial = 0;
+        g_mutex_unlock (&priv->save_mutex);
+    }
+
+    g_paste_history_journal_delete (journal_path);
+    g_paste_history_delete_history_file (stale_file_path);
 
     if (g_file_query_exists (history_file,
                              NULL)) /* cancellable */
@@ -1177,6 +2539,10 @@ g_paste_history_delete (GPasteHistory *self,
                        NULL, /* cancellable */
                        error);
     }
+
+    g_paste_history_private_drop_resident (priv, name);
+    g_paste_history_catalog_remove ((name) ? name : priv->name);
+    g_paste_history_blobs_set_refs ((name) ? name : priv->name, NULL);
 }
 
 static void
@@ -1189,6 +2555,37 @@ g_paste_history_history_name_changed (GPasteHistory *self)
     g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REPLACE, G_PASTE_UPDATE_TARGET_ALL, 0);
 }
 
+static void
+g_paste_history_private_update_format (GPasteHistoryPrivate *priv)
+{
+    const gchar *format = g_paste_settings_get_history_format (priv->settings);
+    gboolean binary = !g_strcmp0 (format, G_PASTE_HISTORY_BINARY_FORMAT);
+    /* The binary format also relies on the journal */
+    gboolean journal = (binary || !g_strcmp0 (format, G_PASTE_HISTORY_JOURNAL_FORMAT));
+
+    priv->binary = binary;
+
+    if (journal && !priv->journal)
+        priv->journal = g_string_new (NULL);
+    else if (!journal && priv->journal)
+    {
+        g_string_free (priv->journal, TRUE);
+        priv->journal = NULL;
+    }
+}
+
+static void
+g_paste_history_history_format_changed (GPasteHistory *self)
+{
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    g_paste_history_private_update_format (priv);
+
+    /* Rewrite the history in its new format */
+    if (priv->name)
+        g_paste_history_save (self, NULL);
+}
+
 static void
 g_paste_history_settings_changed (GPasteSettings *settings G_GNUC_UNUSED,
                                   const gchar    *key,
@@ -1203,6 +2600,12 @@ g_paste_history_settings_changed (GPasteSettings *settings G_GNUC_UNUSED,
         g_paste_history_private_check_memory_usage (priv);
     else if (!g_strcmp0 (key, G_PASTE_HISTORY_NAME_SETTING))
         g_paste_history_history_name_changed (self);
+    else if (!g_strcmp0 (key, G_PASTE_HISTORY_FORMAT_SETTING))
+        g_paste_history_history_format_changed (self);
+
+    /* Let the clients know about the evicted items */
+    if (priv->deltas->len)
+        g_paste_history_update (self, G_PASTE_UPDATE_ACTION_REMOVE, G_PASTE_UPDATE_TARGET_POSITION, 0);
 }
 
 static void
@@ -1214,6 +2617,7 @@ g_paste_history_dispose (GObject *object)
 
     if (settings)
     {
+        g_paste_history_flush (self);
         g_signal_handler_disconnect (settings, priv->changed_signal);
         g_clear_object (&priv->settings);
     }
@@ -1227,8 +2631,22 @@ g_paste_history_finalize (GObject *object)
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (G_PASTE_HISTORY (object));
 
     g_free (priv->name);
-    g_list_free_full (priv->history,
-                      g_object_unref);
+    g_queue_free_full (priv->residents, g_paste_history_resident_free);
+    g_paste_history_private_clear (priv);
+    g_ptr_array_unref (priv->history);
+    g_hash_table_unref (priv->hashes);
+    /* An indexing thread may still be running, it mustn't find us when done */
+    if (priv->index_source)
+        g_source_remove (priv->index_source);
+    g_cancellable_cancel (priv->index_cancellable);
+    g_object_unref (priv->index_cancellable);
+    g_ptr_array_unref (priv->unindexed);
+    g_paste_history_index_free (priv->search_index);
+    g_thread_pool_free (priv->search_pool, FALSE, TRUE);
+    g_array_unref (priv->deltas);
+    g_mutex_clear (&priv->save_mutex);
+    if (priv->journal)
+        g_string_free (priv->journal, TRUE);
 
     G_OBJECT_CLASS (g_paste_history_parent_class)->finalize (object);
 }
@@ -1241,6 +2659,57 @@ g_paste_history_class_init (GPasteHistoryClass *klass)
     object_class->dispose = g_paste_history_dispose;
     object_class->finalize = g_paste_history_finalize;
 
+    /**
+     * GPasteHistory::delta:
+     * @history: the object on which the signal was emitted
+     * @version: the version of the history once the change is applied
+     * @action: the kind of change
+     * @target: POSITION for a single item, ALL when the whole history changed
+     * @index: the position of the change, when the target is POSITION
+     * @item: (nullable): the added or new item, if any
+     *
+     * The "delta" signal is emitted for each elementary change made to the
+     * history, so that it can be mirrored without fetching it again.
+     * The version increases by one with each delta: a gap means that the
+     * mirror has missed something and needs to be fetched again.
+     */
+    signals[DELTA] = g_signal_new ("delta",
+                                   G_PASTE_TYPE_HISTORY,
+                                   G_SIGNAL_RUN_LAST,
+                                   0, /* class offset */
+                                   NULL, /* accumulator */
+                                   NULL, /* accumulator data */
+                                   g_cclosure_marshal_generic,
+                                   G_TYPE_NONE,
+                                   5, /* number of params */
+                                   G_TYPE_UINT64,
+                                   G_PASTE_TYPE_UPDATE_ACTION,
+                                   G_PASTE_TYPE_UPDATE_TARGET,
+                                   G_TYPE_UINT64,
+                                   G_PASTE_TYPE_ITEM);
+
+    /**
+     * GPasteHistory::searched:
+     * @history: the object on which the signal was emitted
+     * @pattern: the pattern given to g_paste_history_search_all
+     * @result: a #GVariant of type "(sa(ts))": the name of a history, and the
+     *          index and a snippet of each of its matching items
+     *
+     * The "searched" signal is emitted by g_paste_history_search_all for each
+     * history with matching items, as soon as it has been searched.
+     */
+    signals[SEARCHED] = g_signal_new ("searched",
+                                      G_PASTE_TYPE_HISTORY,
+                                      G_SIGNAL_RUN_LAST,
+                                      0, /* class offset */
+                                      NULL, /* accumulator */
+                                      NULL, /* accumulator data */
+                                      g_cclosure_marshal_generic,
+                                      G_TYPE_NONE,
+                                      2, /* number of params */
+                                      G_TYPE_STRING,
+                                      G_TYPE_VARIANT);
+
     /**
      * GPasteHistory::selected:
      * @history: the object on which the signal was emitted
@@ -1308,10 +2777,36 @@ g_paste_history_init (GPasteHistory *self)
 {
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-    priv->history = NULL;
-    priv->size = 0;
-
-    g_paste_history_private_elect_new_biggest (priv);
+    priv->history = g_ptr_array_new ();
+    priv->history_view = NULL;
+    priv->hashes = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_slist_free);
+    priv->search_index = g_paste_history_index_new ();
+    priv->unindexed = g_ptr_array_new_with_free_func (g_paste_history_binary_slot_unref);
+    priv->index_source = 0;
+    priv->index_cancellable = g_cancellable_new ();
+    priv->search_pool = g_thread_pool_new (g_paste_history_search_all_thread,
+                                           NULL, /* user_data */
+                                           g_get_num_processors (),
+                                           FALSE, /* exclusive */
+                                           NULL); /* error */
+    priv->residents = g_queue_new ();
+
+    priv->version = 0;
+    priv->deltas = g_paste_history_private_new_deltas ();
+    priv->reset = FALSE;
+
+    priv->generation = 0;
+    priv->snapshot_generation = 0;
+    priv->saved_generation = 0;
+    priv->save_source = 0;
+    priv->saving = FALSE;
+    g_mutex_init (&priv->save_mutex);
+
+    priv->journal = NULL;
+    priv->binary = FALSE;
+    priv->journal_serial = 0;
+    priv->journal_size = 0;
+    priv->snapshot_size = 0;
 }
 
 /**
@@ -1319,6 +2814,8 @@ g_paste_history_init (GPasteHistory *self)
  * @self: a #GPasteHistory instance
  *
  * Get the inner history of a #GPasteHistory
+ * The list is only valid until the history gets modified, prefer
+ * g_paste_history_get_length and g_paste_history_get for random access
  *
  * Returns: (element-type GPasteItem) (transfer none): The inner history
  */
@@ -1329,7 +2826,17 @@ g_paste_history_get_history (const GPasteHistory *self)
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-    return priv->history;
+    if (!priv->history_view)
+    {
+        /* Whoever walks the list expects items */
+        for (guint64 i = 0; i < priv->history->len; ++i)
+            g_paste_history_private_get_item (priv, i);
+
+        for (guint64 i = priv->history->len; i > 0; --i)
+            priv->history_view = g_list_prepend (priv->history_view, g_ptr_array_index (priv->history, i - 1));
+    }
+
+    return priv->history_view;
 }
 
 /**
@@ -1347,63 +2854,55 @@ g_paste_history_get_length (const GPasteHistory *self)
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-    return g_list_length (priv->history);
+    return priv->history->len;
 }
 
 /**
- * g_paste_history_get_current:
+ * g_paste_history_get_version:
  * @self: a #GPasteHistory instance
  *
- * Get the name of the current history
+ * Get the version of the history, as sent along with each delta
  *
- * Returns: The name of the current history
+ * Returns: the version of the #GPasteHistory
  */
-G_PASTE_VISIBLE const gchar *
-g_paste_history_get_current (const GPasteHistory *self)
+G_PASTE_VISIBLE guint64
+g_paste_history_get_version (const GPasteHistory *self)
 {
     g_return_val_if_fail (G_PASTE_IS_HISTORY (self), 0);
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
 
-    return priv->name;
+    return priv->version;
 }
 
 /**
- * g_paste_history_search:
+ * g_paste_history_get_current:
  * @self: a #GPasteHistory instance
- * @pattern: the pattern to match
  *
- * Get the elements matching @pattern in the history
+ * Get the name of the current history
  *
- * Returns: (element-type guint64) (transfer full): The indexes of the matching elements
+ * Returns: The name of the current history
  */
-G_PASTE_VISIBLE GArray *
-g_paste_history_search (const GPasteHistory *self,
-                        const gchar         *pattern)
+G_PASTE_VISIBLE const gchar *
+g_paste_history_get_current (const GPasteHistory *self)
 {
-    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), NULL);
-    g_return_val_if_fail (pattern && g_utf8_validate (pattern, -1, NULL), NULL);
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), 0);
 
     GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
-    g_autoptr (GError) error = NULL;
-    g_autoptr (GRegex) regex = g_regex_new (pattern,
-                                            G_REGEX_CASELESS|G_REGEX_MULTILINE|G_REGEX_DOTALL|G_REGEX_OPTIMIZE,
-                                            G_REGEX_MATCH_NOTEMPTY|G_REGEX_MATCH_NEWLINE_ANY,
-                                            &error);
 
-    if (error)
-    {
-        g_warning ("error while creating regex: %s", error->message);
-        return NULL;
-    }
-    if (!regex)
-        return NULL;
+    return priv->name;
+}
 
-    /* Check whether we include the index in the search too */
+/* Check whether we include the index in the search too */
+static gboolean
+g_paste_history_search_get_index (const gchar *pattern,
+                                  guint64     *idx)
+{
     gboolean include_idx = FALSE;
-    guint64 idx = 0;
     guint64 len = strlen (pattern);
 
+    *idx = 0;
+
     if (len < 5)
     {
         for (guint64 i = 0; i < len; ++i)
@@ -1413,8 +2912,8 @@ g_paste_history_search (const GPasteHistory *self,
             if (c >= '0' && c <= '9')
             {
                 include_idx = TRUE;
-                idx *= 10;
-                idx += (c - '0');
+                *idx *= 10;
+                *idx += (c - '0');
             }
             else
             {
@@ -1424,22 +2923,444 @@ g_paste_history_search (const GPasteHistory *self,
         }
     }
 
+    return include_idx;
+}
+
+static GRegex *
+g_paste_history_search_compile (const gchar *pattern,
+                                GError     **error)
+{
+    return g_regex_new (pattern,
+                        G_REGEX_CASELESS|G_REGEX_MULTILINE|G_REGEX_DOTALL|G_REGEX_OPTIMIZE,
+                        G_REGEX_MATCH_NOTEMPTY|G_REGEX_MATCH_NEWLINE_ANY,
+                        error);
+}
+
+/* What a search matches, which never is the real value of a password */
+static GBytes *
+g_paste_history_slot_ref_search_value (gconstpointer slot)
+{
+    if (!g_paste_history_slot_is_password (slot))
+        return g_paste_history_binary_slot_ref_value (slot);
+
+    g_autoptr (GPasteItem) item = g_paste_history_binary_slot_dup_item (slot);
+    const gchar *value = g_paste_item_get_value (item);
+
+    return g_bytes_new (value, strlen (value) + 1);
+}
+
+/*
+ * Search among @candidates if they're given, or among all the @items.
+ * Candidates must be sorted, as the results are.
+ * With @may_match, the regex only runs on the items whose hash key is in it,
+ * see g_paste_history_private_lookup.
+ */
+static GArray *
+g_paste_history_search_items (const GPtrArray  *items,
+                              const GHashTable *may_match,
+                              const GRegex     *regex,
+                              const gchar      *pattern,
+                              const guint64    *candidates,
+                              guint64           n_candidates)
+{
+    guint64 idx;
+    gboolean include_idx = g_paste_history_search_get_index (pattern, &idx);
+    guint64 length = (candidates) ? n_candidates : items->len;
     GArray *results = g_array_new (FALSE, /* zero-terminated */
                                    TRUE,  /* clear */
                                    sizeof (guint64));
-    guint64 index = 0;
 
-    for (GList *history = priv->history; history; history = g_list_next (history), ++index)
+    for (guint64 i = 0; i < length; ++i)
     {
-        if (include_idx && idx == index)
-            g_array_append_val (results, index);
-        else if (g_regex_match (regex, g_paste_item_get_value (history->data), G_REGEX_MATCH_NOTEMPTY|G_REGEX_MATCH_NEWLINE_ANY, NULL))
-            g_array_append_val (results, index);
+        guint64 position = (candidates) ? candidates[i] : i;
+
+        if (position >= items->len)
+            continue;
+
+        gconstpointer slot = g_ptr_array_index (items, position);
+
+        if (include_idx && idx == position)
+        {
+            g_array_append_val (results, position);
+            continue;
+        }
+
+        /* Don't even look at the value of those which can't match */
+        if (may_match && !g_hash_table_contains ((GHashTable *) may_match, G_PASTE_HISTORY_HASH_KEY (slot)))
+            continue;
+
+        g_autoptr (GBytes) value = g_paste_history_slot_ref_search_value (slot);
+
+        if (value && g_regex_match (regex, g_bytes_get_data (value, NULL), G_REGEX_MATCH_NOTEMPTY|G_REGEX_MATCH_NEWLINE_ANY, NULL))
+            g_array_append_val (results, position);
     }
 
     return results;
 }
 
+/* Searches only need to run the regex on the items the index selects */
+static GHashTable *
+g_paste_history_private_lookup (const GPasteHistoryPrivate *priv,
+                                const gchar                *pattern)
+{
+    g_autoptr (GArray) query = g_paste_history_index_prepare_query (pattern);
+
+    return (query) ? g_paste_history_index_lookup (priv->search_index, query) : NULL;
+}
+
+static GArray *
+g_paste_history_private_search (GPasteHistoryPrivate *priv,
+                                const gchar          *pattern,
+                                const guint64        *candidates,
+                                guint64               n_candidates)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GRegex) regex = g_paste_history_search_compile (pattern, &error);
+
+    if (error)
+    {
+        g_warning ("error while creating regex: %s", error->message);
+        return NULL;
+    }
+    if (!regex)
+        return NULL;
+
+    g_autoptr (GHashTable) may_match = g_paste_history_private_lookup (priv, pattern);
+
+    return g_paste_history_search_items (priv->history, may_match, regex, pattern, candidates, n_candidates);
+}
+
+/**
+ * g_paste_history_search:
+ * @self: a #GPasteHistory instance
+ * @pattern: the pattern to match
+ *
+ * Get the elements matching @pattern in the history
+ *
+ * Returns: (element-type guint64) (transfer full): The indexes of the matching elements
+ */
+G_PASTE_VISIBLE GArray *
+g_paste_history_search (const GPasteHistory *self,
+                        const gchar         *pattern)
+{
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), NULL);
+    g_return_val_if_fail (pattern && g_utf8_validate (pattern, -1, NULL), NULL);
+
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+
+    return g_paste_history_private_search (priv, pattern, NULL, 0);
+}
+
+/**
+ * g_paste_history_refine_search:
+ * @self: a #GPasteHistory instance
+ * @previous_pattern: the pattern of the previous search
+ * @previous_results: (array length=n_previous_results): the results of the previous search
+ * @n_previous_results: the number of results of the previous search
+ * @pattern: the pattern to match
+ *
+ * Get the elements matching @pattern in the history, only looking at the
+ * results of the previous search when @pattern can only match a subset of
+ * them (a literal pattern containing the previous one).
+ * The history must not have changed since the previous search, see
+ * g_paste_history_get_version.
+ *
+ * Returns: (element-type guint64) (transfer full): The indexes of the matching elements
+ */
+G_PASTE_VISIBLE GArray *
+g_paste_history_refine_search (const GPasteHistory *self,
+                               const gchar         *previous_pattern,
+                               const guint64       *previous_results,
+                               guint64              n_previous_results,
+                               const gchar         *pattern)
+{
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), NULL);
+    g_return_val_if_fail (previous_pattern && g_utf8_validate (previous_pattern, -1, NULL), NULL);
+    g_return_val_if_fail (!n_previous_results || previous_results, NULL);
+    g_return_val_if_fail (pattern && g_utf8_validate (pattern, -1, NULL), NULL);
+
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+    guint64 idx;
+
+    /*
+     * Whatever matches the new pattern matches the previous one if both are literal
+     * and the previous one is part of the new one, as long as the new one can't
+     * select an item by its index.
+     */
+    if (!*previous_pattern ||
+        !g_paste_history_index_is_literal (previous_pattern) ||
+        !g_paste_history_index_is_literal (pattern) ||
+        !strstr (pattern, previous_pattern) ||
+        g_paste_history_search_get_index (pattern, &idx))
+    {
+        return g_paste_history_private_search (priv, pattern, NULL, 0);
+    }
+
+    return g_paste_history_private_search (priv, pattern, previous_results, n_previous_results);
+}
+
+typedef struct
+{
+    GRegex    *regex;
+    gchar     *pattern;
+    gboolean   binary;
+    GStrv      names;
+    /* One "(sa(ts))" per history, in the same order as names */
+    GVariant **results;
+    /* Only touched from the main loop */
+    guint64    pending;
+} GPasteHistorySearchAll;
+
+typedef struct
+{
+    GTask      *task;
+    guint64     slot;
+    /* A snapshot of the current history, NULL for the ones read from disk */
+    GPtrArray  *items;
+    GHashTable *may_match;
+    GArray     *results;
+} GPasteHistorySearchAllJob;
+
+static void
+g_paste_history_search_all_free (gpointer data)
+{
+    GPasteHistorySearchAll *search = data;
+    guint64 n_histories = g_strv_length (search->names);
+
+    for (guint64 i = 0; i < n_histories; ++i)
+    {
+        if (search->results[i])
+            g_variant_unref (search->results[i]);
+    }
+
+    g_regex_unref (search->regex);
+    g_free (search->pattern);
+    g_strfreev (search->names);
+    g_free (search->results);
+    g_free (search);
+}
+
+static GVariant *
+g_paste_history_search_all_format (const gchar     *name,
+                                   const GPtrArray *items,
+                                   const GArray    *results)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ts)"));
+
+    for (guint64 i = 0; i < results->len; ++i)
+    {
+        guint64 index = g_array_index (results, guint64, i);
+        g_autofree gchar *snippet = g_paste_history_get_snippet (g_ptr_array_index (items, index));
+
+        g_variant_builder_add (&builder, "(ts)", index, snippet);
+    }
+
+    return g_variant_ref_sink (g_variant_new ("(s@a(ts))", name, g_variant_builder_end (&builder)));
+}
+
+static void
+g_paste_history_search_all_done (GTask *task)
+{
+    GPasteHistorySearchAll *search = g_task_get_task_data (task);
+    guint64 n_histories = g_strv_length (search->names);
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sa(ts))"));
+
+    for (guint64 i = 0; i < n_histories; ++i)
+    {
+        g_autoptr (GVariant) matches = g_variant_get_child_value (search->results[i], 1);
+
+        if (g_variant_n_children (matches))
+            g_variant_builder_add_value (&builder, search->results[i]);
+    }
+
+    g_task_return_pointer (task, g_variant_ref_sink (g_variant_builder_end (&builder)), (GDestroyNotify) g_variant_unref);
+}
+
+static void
+g_paste_history_search_all_job_free (GPasteHistorySearchAllJob *job)
+{
+    g_object_unref (job->task);
+    if (job->items)
+        g_ptr_array_unref (job->items);
+    if (job->may_match)
+        g_hash_table_unref (job->may_match);
+    if (job->results)
+        g_array_unref (job->results);
+    g_free (job);
+}
+
+/* Back in the main loop: hand the results of that history over as soon as we have them */
+static gboolean
+g_paste_history_search_all_job_done (gpointer user_data)
+{
+    GPasteHistorySearchAllJob *job = user_data;
+    GTask *task = job->task;
+    GPasteHistorySearchAll *search = g_task_get_task_data (task);
+    GVariant *result = g_paste_history_search_all_format (search->names[job->slot], job->items, job->results);
+    g_autoptr (GVariant) matches = g_variant_get_child_value (result, 1);
+
+    search->results[job->slot] = result;
+
+    if (g_variant_n_children (matches))
+    {
+        g_signal_emit (g_task_get_source_object (task),
+                       signals[SEARCHED],
+                       0, /* detail */
+                       search->pattern,
+                       result);
+    }
+
+    /* The last one to finish answers */
+    if (!--search->pending)
+        g_paste_history_search_all_done (task);
+
+    g_paste_history_search_all_job_free (job);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+g_paste_history_search_all_thread (gpointer data,
+                                   gpointer user_data G_GNUC_UNUSED)
+{
+    GPasteHistorySearchAllJob *job = data;
+    GTask *task = job->task;
+    GPasteHistorySearchAll *search = g_task_get_task_data (task);
+
+    if (!job->items)
+        job->items = g_paste_history_read (search->names[job->slot], search->binary);
+
+    job->results = g_paste_history_search_items (job->items,
+                                                 job->may_match,
+                                                 search->regex,
+                                                 search->pattern,
+                                                 NULL, /* candidates */
+                                                 0);
+
+    g_main_context_invoke (g_task_get_context (task), g_paste_history_search_all_job_done, job);
+}
+
+/**
+ * g_paste_history_search_all:
+ * @self: a #GPasteHistory instance
+ * @pattern: the pattern to match
+ * @callback: (nullable): A #GAsyncReadyCallback to call when the search is over
+ * @user_data: The data to pass to @callback.
+ *
+ * Search all the available histories, not only the current one.
+ * The other histories are read from disk, in parallel worker threads,
+ * without loading nor modifying them, while a snapshot of the current
+ * one is searched alongside them.
+ * The results of each history are emitted through #GPasteHistory::searched
+ * as soon as they are known.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_history_search_all (GPasteHistory      *self,
+                            const gchar        *pattern,
+                            GAsyncReadyCallback callback,
+                            gpointer            user_data)
+{
+    g_return_if_fail (G_PASTE_IS_HISTORY (self));
+    g_return_if_fail (pattern && g_utf8_validate (pattern, -1, NULL));
+
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+    g_autoptr (GTask) task = g_task_new (self,
+                                         NULL, /* cancellable */
+                                         callback,
+                                         user_data);
+    GError *error = NULL;
+    GRegex *regex = g_paste_history_search_compile (pattern, &error);
+
+    if (!regex)
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    GStrv names = g_paste_history_list (&error);
+
+    if (!names)
+    {
+        g_regex_unref (regex);
+        g_task_return_error (task, error);
+        return;
+    }
+
+    GPasteHistorySearchAll *search = g_new0 (GPasteHistorySearchAll, 1);
+    guint64 n_histories = g_strv_length (names);
+
+    /* The current history isn't on disk when we don't save it */
+    if (priv->name && !g_strv_contains ((const gchar * const *) names, priv->name))
+    {
+        names = g_renew (gchar *, names, n_histories + 2);
+        names[n_histories++] = g_strdup (priv->name);
+        names[n_histories] = NULL;
+    }
+
+    search->regex = regex;
+    search->pattern = g_strdup (pattern);
+    search->binary = priv->binary;
+    search->names = names;
+    search->results = g_new0 (GVariant *, n_histories);
+    /* Hold one for ourselves until all the jobs are queued */
+    search->pending = 1;
+
+    g_task_set_task_data (task, search, g_paste_history_search_all_free);
+
+    for (guint64 i = 0; i < n_histories; ++i)
+    {
+        GPasteHistorySearchAllJob *job = g_new0 (GPasteHistorySearchAllJob, 1);
+
+        job->task = g_object_ref (task);
+        job->slot = i;
+
+        /* What's on disk may lag behind the current history, search a snapshot of it instead */
+        if (!g_strcmp0 (names[i], priv->name))
+        {
+            job->items = g_ptr_array_new_full (priv->history->len, g_paste_history_binary_slot_unref);
+            for (guint64 j = 0; j < priv->history->len; ++j)
+                g_ptr_array_add (job->items, g_paste_history_binary_slot_ref (g_ptr_array_index (priv->history, j)));
+            job->may_match = g_paste_history_private_lookup (priv, pattern);
+        }
+
+        ++search->pending;
+        g_thread_pool_push (priv->search_pool, job, NULL);
+    }
+
+    if (!--search->pending)
+        g_paste_history_search_all_done (task);
+}
+
+/**
+ * g_paste_history_search_all_finish:
+ * @self: a #GPasteHistory instance
+ * @result: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to g_paste_history_search_all
+ * @error: a #GError
+ *
+ * Get the results of g_paste_history_search_all: for each history with
+ * matching items, its name and the index and a snippet of each of them.
+ *
+ * Returns: (transfer full): a #GVariant of type "a(sa(ts))"
+ *                           free it with g_variant_unref
+ */
+G_PASTE_VISIBLE GVariant *
+g_paste_history_search_all_finish (GPasteHistory *self,
+                                   GAsyncResult  *result,
+                                   GError       **error)
+{
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), NULL);
+    g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+    g_return_val_if_fail (!error || !(*error), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * g_paste_history_new:
  * @settings: (transfer none): a #GPasteSettings instance
@@ -1463,6 +3384,8 @@ g_paste_history_new (GPasteSettings *settings)
                                              G_CALLBACK (g_paste_history_settings_changed),
                                              self);
 
+    g_paste_history_private_update_format (priv);
+
     return self;
 }
 
@@ -1508,14 +3431,91 @@ g_paste_history_list (GError **error)
 
         const gchar *raw_name = g_file_info_get_display_name (h);
 
+        gchar *name = NULL;
+
         if (g_str_has_suffix (raw_name, ".xml"))
-        {
-            gchar *name = g_strdup (raw_name);
+            name = g_strndup (raw_name, strlen (raw_name) - strlen (".xml"));
+        else if (g_str_has_suffix (raw_name, G_PASTE_HISTORY_BINARY_EXTENSION))
+            name = g_strndup (raw_name, strlen (raw_name) - strlen (G_PASTE_HISTORY_BINARY_EXTENSION));
 
-            name[strlen (name) - 4] = '\0';
+        /* A history being converted can exist in both formats */
+        if (name && !g_strv_contains ((const gchar * const *) history_names->data, name))
             g_array_append_val (history_names, name);
-        }
+        else
+            g_free (name);
     }
 
     return g_strdupv ((GStrv) (gpointer) history_names->data);
 }
+
+/**
+ * g_paste_history_get_info:
+ * @self: a #GPasteHistory instance
+ * @name: the name of the history
+ * @length: (out) (optional): its number of items
+ * @size: (out) (optional): the room it takes on disk, in bytes
+ * @modified: (out) (optional): when it was last written, as a unix time
+ * @preview: (out) (optional) (transfer full): a preview of its first item, if any
+ *
+ * Get what there is to know about a history without loading it.
+ * Saved histories are looked up in the catalog, and only read if
+ * it doesn't know about their latest version, the catalog being
+ * updated with what we read.
+ *
+ * Returns: whether the history exists
+ */
+G_PASTE_VISIBLE gboolean
+g_paste_history_get_info (GPasteHistory *self,
+                          const gchar   *name,
+                          guint64       *length,
+                          guint64       *size,
+                          gint64        *modified,
+                          gchar        **preview)
+{
+    g_return_val_if_fail (G_PASTE_IS_HISTORY (self), FALSE);
+    g_return_val_if_fail (name && g_utf8_validate (name, -1, NULL), FALSE);
+
+    GPasteHistoryPrivate *priv = g_paste_history_get_instance_private (self);
+    GPasteHistoryCatalogEntry entry = { 0, 0, 0, NULL };
+    guint64 files_size;
+    gint64 files_modified = g_paste_history_get_files_info (name, &files_size);
+
+    if (!g_strcmp0 (name, priv->name))
+    {
+        /* What's in memory may not have been saved yet */
+        entry.length = priv->history->len;
+        if (priv->history->len)
+            entry.preview = g_paste_history_get_snippet (G_PASTE_HISTORY_SLOT (priv, 0));
+    }
+    else if (!files_modified)
+    {
+        return FALSE;
+    }
+    else if (!g_paste_history_catalog_lookup (name, &entry) || entry.modified != files_modified || entry.size != files_size)
+    {
+        /* Saved by something else than us, read it once to catch up */
+        g_autoptr (GPtrArray) items = g_paste_history_read (name, priv->binary);
+
+        g_paste_history_catalog_entry_clear (&entry);
+        entry.length = items->len;
+        entry.size = files_size;
+        entry.modified = files_modified;
+        if (items->len)
+            entry.preview = g_paste_history_get_snippet (g_ptr_array_index (items, 0));
+
+        g_paste_history_catalog_update (name, &entry);
+    }
+
+    if (length)
+        *length = entry.length;
+    if (size)
+        *size = files_size;
+    if (modified)
+        *modified = files_modified / G_USEC_PER_SEC;
+    if (preview)
+        *preview = g_steal_pointer (&entry.preview);
+
+    g_paste_history_catalog_entry_clear (&entry);
+
+    return TRUE;
+}
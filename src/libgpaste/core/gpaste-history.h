@@ -63,8 +63,12 @@ void                      g_paste_history_rename_password (GPasteHistory *self,
 void         g_paste_history_empty       (GPasteHistory *self);
 void         g_paste_history_save        (GPasteHistory *self,
                                           const gchar   *name);
+void         g_paste_history_flush       (GPasteHistory *self);
 void         g_paste_history_load        (GPasteHistory *self,
                                           const gchar   *name);
+gint         g_paste_history_hand_off    (GPasteHistory *self);
+gboolean     g_paste_history_take_over   (GPasteHistory *self,
+                                          gint           fd);
 void         g_paste_history_switch      (GPasteHistory *self,
                                           const gchar   *name);
 void         g_paste_history_delete      (GPasteHistory *self,
@@ -72,14 +76,34 @@ void         g_paste_history_delete      (GPasteHistory *self,
                                           GError       **error);
 const GList *g_paste_history_get_history (const GPasteHistory *self);
 guint64      g_paste_history_get_length  (const GPasteHistory *self);
+guint64      g_paste_history_get_version (const GPasteHistory *self);
 const gchar *g_paste_history_get_current (const GPasteHistory *self);
 
-GArray *g_paste_history_search (const GPasteHistory *self,
-                                const gchar         *pattern);
+GArray *g_paste_history_search        (const GPasteHistory *self,
+                                       const gchar         *pattern);
+GArray *g_paste_history_refine_search (const GPasteHistory *self,
+                                       const gchar         *previous_pattern,
+                                       const guint64       *previous_results,
+                                       guint64              n_previous_results,
+                                       const gchar         *pattern);
+
+void      g_paste_history_search_all        (GPasteHistory      *self,
+                                             const gchar        *pattern,
+                                             GAsyncReadyCallback callback,
+                                             gpointer            user_data);
+GVariant *g_paste_history_search_all_finish (GPasteHistory      *self,
+                                             GAsyncResult       *result,
+                                             GError            **error);
 
 GPasteHistory *g_paste_history_new (GPasteSettings *settings);
 
-GStrv g_paste_history_list (GError **error);
+GStrv    g_paste_history_list     (GError             **error);
+gboolean g_paste_history_get_info (GPasteHistory *self,
+                                   const gchar   *name,
+                                   guint64       *length,
+                                   guint64       *size,
+                                   gint64        *modified,
+                                   gchar        **preview);
 
 G_END_DECLS
 
@@ -17,10 +17,10 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-fingerprint.h"
+
 #include <gpaste-image-item.h>
-#include <gpaste-util.h>
 
-#include <string.h>
 #include <sys/stat.h>
 
 struct _GPasteImageItem
@@ -33,19 +33,133 @@ typedef struct _GPasteImageItemPrivate
     gchar     *checksum;
     GDateTime *date;
     GdkPixbuf *image;
+    gint       width;
+    gint       height;
+
+    gboolean   active;
+    gboolean   loading;
+    gboolean   saving;
+    /* Its file has to go as soon as it's saved */
+    gboolean   discarded;
+    GSList    *waiters;
 
     guint64    additional_size;
 } GPasteImageItemPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GPasteImageItem, g_paste_image_item, G_PASTE_TYPE_ITEM)
 
+/*
+ * Images which were recently deactivated, most recent first, so that going
+ * back and forth between a few images doesn't decode them again and again.
+ * They belong to no item, the history counts them against max-memory-usage
+ * and drops them before anything else, see g_paste_image_item_trim_cache.
+ * Only ever used from the main thread.
+ */
+
+#define G_PASTE_IMAGE_ITEM_CACHE_SIZE 4
+
+typedef struct
+{
+    gchar     *path;
+    GdkPixbuf *image;
+} GPasteImageItemCacheEntry;
+
+static GQueue g_paste_image_item_cache = G_QUEUE_INIT;
+static guint64 g_paste_image_item_cache_size = 0;
+
+/* Images being written by worker threads, which flushing a history has to wait for */
+static GMutex g_paste_image_item_saves_mutex;
+static GCond g_paste_image_item_saves_cond;
+static guint64 g_paste_image_item_pending_saves = 0;
+
+static void
+g_paste_image_item_cache_entry_free (GPasteImageItemCacheEntry *entry)
+{
+    g_paste_image_item_cache_size -= gdk_pixbuf_get_byte_length (entry->image);
+    g_free (entry->path);
+    g_object_unref (entry->image);
+    g_free (entry);
+}
+
+static GdkPixbuf *
+g_paste_image_item_cache_take (const gchar *path)
+{
+    for (GList *l = g_paste_image_item_cache.head; l; l = g_list_next (l))
+    {
+        GPasteImageItemCacheEntry *entry = l->data;
+
+        if (!g_strcmp0 (entry->path, path))
+        {
+            GdkPixbuf *image = g_object_ref (entry->image);
+
+            g_queue_delete_link (&g_paste_image_item_cache, l);
+            g_paste_image_item_cache_entry_free (entry);
+
+            return image;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+g_paste_image_item_cache_put (const gchar *path,
+                              GdkPixbuf   *image)
+{
+    GPasteImageItemCacheEntry *entry = g_new (GPasteImageItemCacheEntry, 1);
+    GdkPixbuf *stale = g_paste_image_item_cache_take (path);
+
+    if (stale)
+        g_object_unref (stale);
+
+    entry->path = g_strdup (path);
+    entry->image = image;
+    g_paste_image_item_cache_size += gdk_pixbuf_get_byte_length (image);
+
+    g_queue_push_head (&g_paste_image_item_cache, entry);
+
+    if (g_queue_get_length (&g_paste_image_item_cache) > G_PASTE_IMAGE_ITEM_CACHE_SIZE)
+        g_paste_image_item_cache_entry_free (g_queue_pop_tail (&g_paste_image_item_cache));
+}
+
+/**
+ * g_paste_image_item_get_cache_size:
+ *
+ * Get the memory used by the images kept around since their
+ * items were deactivated, which no item accounts for
+ *
+ * Returns: the size of the cached images, in bytes
+ */
+G_PASTE_VISIBLE guint64
+g_paste_image_item_get_cache_size (void)
+{
+    return g_paste_image_item_cache_size;
+}
+
+/**
+ * g_paste_image_item_trim_cache:
+ * @max_size: the memory the cached images may still use, in bytes
+ *
+ * Drop the least recently deactivated images until the others fit
+ * in @max_size, they'll be decoded again if needed
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_image_item_trim_cache (guint64 max_size)
+{
+    while (g_paste_image_item_cache_size > max_size)
+        g_paste_image_item_cache_entry_free (g_queue_pop_tail (&g_paste_image_item_cache));
+}
+
 /**
  * g_paste_image_item_get_checksum:
  * @self: a #GPasteImageItem instance
  *
  * Get the checksum of the GdkPixbuf contained in the #GPasteImageItem
  *
- * Returns: read-only string representatig the SHA256 checksum of the image
+ * Returns: read-only string representing the fingerprint of the image,
+ *          or NULL if it's not known until the image gets loaded
  */
 G_PASTE_VISIBLE const gchar *
 g_paste_image_item_get_checksum (const GPasteImageItem *self)
@@ -75,13 +189,50 @@ g_paste_image_item_get_date (const GPasteImageItem *self)
     return priv->date;
 }
 
+/**
+ * g_paste_image_item_get_width:
+ * @self: a #GPasteImageItem instance
+ *
+ * Get the width of the image, without loading it
+ *
+ * Returns: the width of the image
+ */
+G_PASTE_VISIBLE gint
+g_paste_image_item_get_width (const GPasteImageItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_IMAGE_ITEM (self), 0);
+
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (self);
+
+    return priv->width;
+}
+
+/**
+ * g_paste_image_item_get_height:
+ * @self: a #GPasteImageItem instance
+ *
+ * Get the height of the image, without loading it
+ *
+ * Returns: the height of the image
+ */
+G_PASTE_VISIBLE gint
+g_paste_image_item_get_height (const GPasteImageItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_IMAGE_ITEM (self), 0);
+
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (self);
+
+    return priv->height;
+}
+
 /**
  * g_paste_image_item_get_image:
  * @self: a #GPasteImageItem instance
  *
  * Get the image contained in the #GPasteImageItem
  *
- * Returns: (transfer none): the GdkPixbuf of the image
+ * Returns: (transfer none) (nullable): the GdkPixbuf of the image,
+ *          NULL if it isn't loaded (yet), see g_paste_image_item_load_image
  */
 G_PASTE_VISIBLE GdkPixbuf *
 g_paste_image_item_get_image (const GPasteImageItem *self)
@@ -103,7 +254,11 @@ g_paste_image_item_equals (const GPasteItem *self,
     GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (self));
     GPasteImageItemPrivate *_priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (other));
 
-    return !g_strcmp0 (priv->checksum, _priv->checksum);
+    if (priv->checksum && _priv->checksum)
+        return !g_strcmp0 (priv->checksum, _priv->checksum);
+
+    /* The checksum isn't known until the image gets loaded, files are named after their contents */
+    return !g_strcmp0 (g_paste_item_get_value (self), g_paste_item_get_value (other));
 }
 
 static void
@@ -112,11 +267,13 @@ g_paste_image_item_set_size (GPasteItem *self)
     GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (self));
     GdkPixbuf *image = priv->image;
 
-    if (image)
+    /* The image may outlive the activation while it's being saved, it's still ours until then */
+    if (priv->active || image)
     {
+        /* Account for the image as soon as it gets activated, even while it's being loaded */
         if (!priv->additional_size)
         {
-            priv->additional_size += strlen (priv->checksum) + 1 + gdk_pixbuf_get_byte_length (image);
+            priv->additional_size = (image) ? gdk_pixbuf_get_byte_length (image) : (guint64) priv->width * priv->height * 4;
             g_paste_item_add_size (self, priv->additional_size);
         }
     }
@@ -127,12 +284,167 @@ g_paste_image_item_set_size (GPasteItem *self)
     }
 }
 
+static gchar *
+g_paste_image_item_build_display_string (const GPasteItem *self,
+                                         guint64           max_length G_GNUC_UNUSED)
+{
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (self));
+
+    /* This is the date format "month/day/year time" */
+    g_autofree gchar *formatted_date = g_date_time_format (priv->date, _("%m/%d/%y %T"));
+    /* This gets displayed in history when selecting an image */
+    return g_strdup_printf (_("[Image, %d x %d (%s)]"),
+                            priv->width,
+                            priv->height,
+                            formatted_date);
+}
+
 static const gchar *
 g_paste_image_item_get_kind (const GPasteItem *self G_GNUC_UNUSED)
 {
     return "Image";
 }
 
+static void
+g_paste_image_item_decode_thread (GTask        *task,
+                                  gpointer      source_object G_GNUC_UNUSED,
+                                  gpointer      task_data,
+                                  GCancellable *cancellable   G_GNUC_UNUSED)
+{
+    GError *error = NULL;
+    GdkPixbuf *image = gdk_pixbuf_new_from_file (task_data, &error);
+
+    if (!image)
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    /* Compute and cache the fingerprint here rather than in the main loop */
+    g_paste_fingerprint_image (image);
+    g_task_return_pointer (task, image, g_object_unref);
+}
+
+static void
+g_paste_image_item_on_decoded (GObject      *source_object,
+                               GAsyncResult *res,
+                               gpointer      user_data G_GNUC_UNUSED)
+{
+    GPasteItem *self = G_PASTE_ITEM (source_object);
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (self));
+    g_autoptr (GError) error = NULL;
+    GdkPixbuf *image = g_task_propagate_pointer (G_TASK (res), &error);
+    GSList *waiters = priv->waiters;
+
+    priv->waiters = NULL;
+    priv->loading = FALSE;
+
+    if (image)
+    {
+        if (!priv->checksum)
+            priv->checksum = g_strdup (g_paste_fingerprint_image (image));
+
+        if (priv->active && !priv->image)
+            priv->image = g_object_ref (image);
+        else if (!priv->active)
+            g_paste_image_item_cache_put (g_paste_item_get_value (self), g_object_ref (image));
+    }
+    else
+        g_warning ("Failed to load image %s: %s", g_paste_item_get_value (self), error->message);
+
+    for (GSList *w = waiters; w; w = g_slist_next (w))
+    {
+        GTask *waiter = w->data;
+
+        if (image)
+            g_task_return_pointer (waiter, g_object_ref (image), g_object_unref);
+        else
+            g_task_return_error (waiter, g_error_copy (error));
+        g_object_unref (waiter);
+    }
+
+    g_slist_free (waiters);
+
+    if (image)
+        g_object_unref (image);
+}
+
+static void
+g_paste_image_item_decode (GPasteImageItem *self)
+{
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (self);
+
+    if (priv->loading)
+        return;
+
+    /* The task holds a reference on us until the image is loaded */
+    GTask *task = g_task_new (self,
+                              NULL, /* cancellable */
+                              g_paste_image_item_on_decoded,
+                              NULL); /* user_data */
+
+    priv->loading = TRUE;
+    g_task_set_task_data (task, g_strdup (g_paste_item_get_value (G_PASTE_ITEM (self))), g_free);
+    g_task_run_in_thread (task, g_paste_image_item_decode_thread);
+    g_object_unref (task);
+}
+
+/**
+ * g_paste_image_item_load_image:
+ * @self: a #GPasteImageItem instance
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (scope async): the callback to call once the image is loaded
+ * @user_data: user data to pass to @callback
+ *
+ * Get the image contained in the #GPasteImageItem, decoding it in a
+ * worker thread if it isn't loaded yet
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_image_item_load_image (GPasteImageItem    *self,
+                               GCancellable       *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer            user_data)
+{
+    g_return_if_fail (G_PASTE_IS_IMAGE_ITEM (self));
+    g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (self);
+    GTask *task = g_task_new (self, cancellable, callback, user_data);
+
+    if (priv->image)
+    {
+        g_task_return_pointer (task, g_object_ref (priv->image), g_object_unref);
+        g_object_unref (task);
+        return;
+    }
+
+    priv->waiters = g_slist_prepend (priv->waiters, task);
+    g_paste_image_item_decode (self);
+}
+
+/**
+ * g_paste_image_item_load_image_finish:
+ * @self: a #GPasteImageItem instance
+ * @result: the #GAsyncResult
+ * @error: a #GError
+ *
+ * Finish loading the image contained in the #GPasteImageItem
+ *
+ * Returns: (transfer full) (nullable): the GdkPixbuf of the image
+ */
+G_PASTE_VISIBLE GdkPixbuf *
+g_paste_image_item_load_image_finish (GPasteImageItem *self,
+                                      GAsyncResult    *result,
+                                      GError         **error)
+{
+    g_return_val_if_fail (G_PASTE_IS_IMAGE_ITEM (self), NULL);
+    g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static void
 g_paste_image_item_set_state (GPasteItem     *self,
                               GPasteItemState state)
@@ -142,19 +454,18 @@ g_paste_image_item_set_state (GPasteItem     *self,
     switch (state)
     {
     case G_PASTE_ITEM_STATE_IDLE:
-        if (priv->image)
+        priv->active = FALSE;
+        /* Keep the image until it's on disk, it couldn't be loaded back otherwise */
+        if (priv->image && !priv->saving)
         {
-            g_clear_object (&priv->image);
-            g_clear_pointer (&priv->checksum, g_free);
+            g_paste_image_item_cache_put (g_paste_item_get_value (self), priv->image);
+            priv->image = NULL;
         }
         break;
     case G_PASTE_ITEM_STATE_ACTIVE:
-        if (!priv->image)
-        {
-            priv->image = gdk_pixbuf_new_from_file (g_paste_item_get_value (self),
-                                                    NULL); /* Error */
-            priv->checksum = g_paste_util_compute_checksum (priv->image);
-        }
+        priv->active = TRUE;
+        if (!priv->image && !(priv->image = g_paste_image_item_cache_take (g_paste_item_get_value (self))))
+            g_paste_image_item_decode (G_PASTE_IMAGE_ITEM (self));
         break;
     }
 
@@ -196,6 +507,7 @@ g_paste_image_item_class_init (GPasteImageItemClass *klass)
     item_class->equals = g_paste_image_item_equals;
     item_class->get_kind = g_paste_image_item_get_kind;
     item_class->set_state = g_paste_image_item_set_state;
+    item_class->build_display_string = g_paste_image_item_build_display_string;
 
     GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
@@ -208,11 +520,176 @@ g_paste_image_item_init (GPasteImageItem *self G_GNUC_UNUSED)
 {
 }
 
+typedef struct
+{
+    GdkPixbuf *image;
+    gchar     *path;
+    gchar     *compression;
+} GPasteImageItemSaveData;
+
+static void
+g_paste_image_item_save_data_free (gpointer user_data)
+{
+    GPasteImageItemSaveData *data = user_data;
+
+    g_object_unref (data->image);
+    g_free (data->path);
+    g_free (data->compression);
+    g_free (data);
+}
+
+static void
+g_paste_image_item_save_thread (GTask        *task,
+                                gpointer      source_object G_GNUC_UNUSED,
+                                gpointer      task_data,
+                                GCancellable *cancellable   G_GNUC_UNUSED)
+{
+    GPasteImageItemSaveData *data = task_data;
+    g_autofree gchar *buffer = NULL;
+    gsize length;
+    GError *error = NULL;
+
+    /* Write to a temporary file and rename it, a crash never leaves a truncated image */
+    gboolean saved = (gdk_pixbuf_save_to_buffer (data->image,
+                                                 &buffer,
+                                                 &length,
+                                                 "png",
+                                                 &error,
+                                                 "compression", data->compression,
+                                                 NULL) &&
+                      g_file_set_contents (data->path, buffer, length, &error));
+
+    g_mutex_lock (&g_paste_image_item_saves_mutex);
+    --g_paste_image_item_pending_saves;
+    g_cond_broadcast (&g_paste_image_item_saves_cond);
+    g_mutex_unlock (&g_paste_image_item_saves_mutex);
+
+    if (!saved)
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * g_paste_image_item_wait_for_saves:
+ *
+ * Wait for the images being saved in worker threads to be written,
+ * so that the histories referencing them can be flushed
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_image_item_wait_for_saves (void)
+{
+    g_mutex_lock (&g_paste_image_item_saves_mutex);
+
+    while (g_paste_image_item_pending_saves)
+        g_cond_wait (&g_paste_image_item_saves_cond, &g_paste_image_item_saves_mutex);
+
+    g_mutex_unlock (&g_paste_image_item_saves_mutex);
+}
+
+static void
+g_paste_image_item_delete_file (GPasteImageItem *self)
+{
+    g_autoptr (GFile) image = g_file_new_for_path (g_paste_item_get_value (G_PASTE_ITEM (self)));
+
+    g_file_delete (image,
+                   NULL, /* cancellable */
+                   NULL); /* error */
+}
+
+static void
+g_paste_image_item_on_saved (GObject      *source_object,
+                             GAsyncResult *res,
+                             gpointer      user_data G_GNUC_UNUSED)
+{
+    GPasteItem *self = G_PASTE_ITEM (source_object);
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (self));
+    g_autoptr (GError) error = NULL;
+
+    if (!g_task_propagate_boolean (G_TASK (res), &error))
+        g_warning ("Failed to save image %s: %s", g_paste_item_get_value (self), error->message);
+
+    priv->saving = FALSE;
+
+    /* We got removed from the history while saving */
+    if (priv->discarded)
+        g_paste_image_item_delete_file (G_PASTE_IMAGE_ITEM (self));
+
+    /* We got deactivated while saving */
+    if (!priv->active && priv->image)
+    {
+        g_paste_image_item_cache_put (g_paste_item_get_value (self), priv->image);
+        priv->image = NULL;
+        g_paste_image_item_set_size (self);
+    }
+}
+
+static void
+g_paste_image_item_save (GPasteImageItem *self,
+                         guint64          compression)
+{
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (self);
+    const gchar *path = g_paste_item_get_value (G_PASTE_ITEM (self));
+
+    /* Files are named after their contents, this one is already saved */
+    if (g_file_test (path, G_FILE_TEST_EXISTS))
+        return;
+
+    GPasteImageItemSaveData *data = g_new (GPasteImageItemSaveData, 1);
+    GTask *task = g_task_new (self,
+                              NULL, /* cancellable */
+                              g_paste_image_item_on_saved,
+                              NULL); /* user_data */
+
+    data->image = g_object_ref (priv->image);
+    data->path = g_strdup (path);
+    data->compression = g_strdup_printf ("%" G_GUINT64_FORMAT, MIN (compression, 9));
+
+    priv->saving = TRUE;
+
+    g_mutex_lock (&g_paste_image_item_saves_mutex);
+    ++g_paste_image_item_pending_saves;
+    g_mutex_unlock (&g_paste_image_item_saves_mutex);
+
+    g_task_set_task_data (task, data, g_paste_image_item_save_data_free);
+    g_task_run_in_thread (task, g_paste_image_item_save_thread);
+    g_object_unref (task);
+}
+
+/**
+ * g_paste_image_item_discard:
+ * @self: a #GPasteImageItem instance
+ *
+ * Delete the file holding the image, once the item is removed from
+ * the history. If it's still being saved, it's deleted once it's written.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_image_item_discard (GPasteImageItem *self)
+{
+    g_return_if_fail (G_PASTE_IS_IMAGE_ITEM (self));
+
+    GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (self);
+
+    priv->discarded = TRUE;
+
+    if (!priv->saving)
+        g_paste_image_item_delete_file (self);
+}
+
 static GPasteItem *
 _g_paste_image_item_new (const gchar *path,
                          GDateTime   *date,
                          GdkPixbuf   *image,
-                         gchar       *checksum)
+                         gint         width,
+                         gint         height,
+                         const gchar *checksum)
 {
     GPasteItem *self = g_paste_item_new (G_PASTE_TYPE_IMAGE_ITEM, path);
     GPasteImageItemPrivate *priv = g_paste_image_item_get_instance_private (G_PASTE_IMAGE_ITEM (self));
@@ -221,23 +698,21 @@ _g_paste_image_item_new (const gchar *path,
     priv->image = image;
 
     if (image)
-        priv->checksum = (checksum) ? checksum : g_paste_util_compute_checksum (image);
+    {
+        /* A brand new image, which is about to become the active one */
+        priv->active = TRUE;
+        priv->width = gdk_pixbuf_get_width (image);
+        priv->height = gdk_pixbuf_get_height (image);
+        priv->checksum = g_strdup (g_paste_fingerprint_image (image));
+    }
     else
-        g_paste_image_item_set_state (G_PASTE_ITEM (self), G_PASTE_ITEM_STATE_ACTIVE);
-
-    /* This is the date format "month/day/year time" */
-    g_autofree gchar *formatted_date = g_date_time_format (date, _("%m/%d/%y %T"));
-    /* This gets displayed in history when selecting an image */
-    g_autofree gchar *display_string = g_strdup_printf (_("[Image, %d x %d (%s)]"),
-                                                                  gdk_pixbuf_get_width (priv->image),
-                                                                  gdk_pixbuf_get_height (priv->image),
-                                                                  formatted_date);
-    g_paste_item_set_display_string (self, display_string);
+    {
+        priv->width = width;
+        priv->height = height;
+        priv->checksum = g_strdup (checksum);
+    }
 
-    if (image)
-        g_paste_image_item_set_size (self);
-    else
-        g_paste_image_item_set_state (G_PASTE_ITEM (self), G_PASTE_ITEM_STATE_IDLE);
+    g_paste_image_item_set_size (self);
 
     return self;
 }
@@ -247,16 +722,40 @@ _g_paste_image_item_new (const gchar *path,
  * @img: (transfer none): the GdkPixbuf we want to be contained in the #GPasteImageItem
  *
  * Create a new instance of #GPasteImageItem
+ * The image is saved with the default compression level.
  *
  * Returns: a newly allocated #GPasteImageItem
  *          free it with g_object_unref
  */
 G_PASTE_VISIBLE GPasteItem *
 g_paste_image_item_new (GdkPixbuf *img)
+{
+    return g_paste_image_item_new_full (img, 6);
+}
+
+/**
+ * g_paste_image_item_new_full:
+ * @img: (transfer none): the GdkPixbuf we want to be contained in the #GPasteImageItem
+ * @compression: the compression level of the saved image, from 0 to 9
+ *
+ * Create a new instance of #GPasteImageItem
+ * The image is saved in a worker thread, the item can be used right away.
+ *
+ * Returns: a newly allocated #GPasteImageItem
+ *          free it with g_object_unref
+ */
+G_PASTE_VISIBLE GPasteItem *
+g_paste_image_item_new_full (GdkPixbuf *img,
+                             guint64    compression)
 {
     g_return_val_if_fail (GDK_IS_PIXBUF (img), NULL);
 
-    gchar *checksum = g_paste_util_compute_checksum (img);
+    /*
+     * Name the file after the fingerprint the clipboard already computed, instead
+     * of hashing all the pixels again here: images with the same fingerprint are
+     * the same item anyway, see g_paste_image_item_equals.
+     */
+    const gchar *checksum = g_paste_fingerprint_image (img);
     g_autofree gchar *images_dir_path = g_build_filename (g_get_user_data_dir (), "gpaste", "images", NULL);
     g_autoptr (GFile) images_dir = g_file_new_for_path (images_dir_path);
 
@@ -268,13 +767,10 @@ g_paste_image_item_new (GdkPixbuf *img)
     GPasteItem *self = _g_paste_image_item_new (path,
                                                 g_date_time_new_now_local (),
                                                 g_object_ref (img),
-                                                checksum);
+                                                0, 0, /* size */
+                                                NULL); /* checksum */
 
-    gdk_pixbuf_save (img,
-                     g_paste_item_get_value (self),
-                     "png",
-                     NULL, /* Error */
-                     NULL); /* Params */
+    g_paste_image_item_save (G_PASTE_IMAGE_ITEM (self), compression);
 
     return self;
 }
@@ -285,6 +781,7 @@ g_paste_image_item_new (GdkPixbuf *img)
  * @date: (transfer none): the date at which the image was created
  *
  * Create a new instance of #GPasteImageItem
+ * Only the header of the image is read, the image itself is loaded when needed.
  *
  * Returns: a newly allocated #GPasteImageItem
  *          free it with g_object_unref
@@ -297,8 +794,49 @@ g_paste_image_item_new_from_file (const gchar *path,
     g_return_val_if_fail (g_utf8_validate (path, -1, NULL), NULL);
     g_return_val_if_fail (date, NULL);
 
+    gint width = 0, height = 0;
+
+    if (!gdk_pixbuf_get_file_info (path, &width, &height))
+        g_warning ("Failed to read image %s", path);
+
+    return _g_paste_image_item_new (path,
+                                    g_date_time_ref (date),
+                                    NULL, /* GdkPixbuf */
+                                    width,
+                                    height,
+                                    NULL); /* checksum */
+}
+
+/**
+ * g_paste_image_item_new_from_file_full:
+ * @path: the path to the image we want to be contained in the #GPasteImageItem
+ * @date: (transfer none): the date at which the image was created
+ * @width: the width of the image
+ * @height: the height of the image
+ * @checksum: (nullable): the checksum of the image, as given by g_paste_image_item_get_checksum
+ *
+ * Create a new instance of #GPasteImageItem from what was stored about it,
+ * without touching the image at all
+ *
+ * Returns: a newly allocated #GPasteImageItem
+ *          free it with g_object_unref
+ */
+G_PASTE_VISIBLE GPasteItem *
+g_paste_image_item_new_from_file_full (const gchar *path,
+                                       GDateTime   *date,
+                                       gint         width,
+                                       gint         height,
+                                       const gchar *checksum)
+{
+    g_return_val_if_fail (path, NULL);
+    g_return_val_if_fail (g_utf8_validate (path, -1, NULL), NULL);
+    g_return_val_if_fail (date, NULL);
+    g_return_val_if_fail (width > 0 && height > 0, NULL);
+
     return _g_paste_image_item_new (path,
                                     g_date_time_ref (date),
                                     NULL, /* GdkPixbuf */
-                                    NULL); /* Checksum */
+                                    width,
+                                    height,
+                                    checksum);
 }
@@ -34,11 +34,34 @@ G_PASTE_FINAL_TYPE (ImageItem, image_item, IMAGE_ITEM, GPasteItem)
 
 const gchar     *g_paste_image_item_get_checksum (const GPasteImageItem *self);
 const GDateTime *g_paste_image_item_get_date     (const GPasteImageItem *self);
+gint             g_paste_image_item_get_width    (const GPasteImageItem *self);
+gint             g_paste_image_item_get_height   (const GPasteImageItem *self);
 GdkPixbuf       *g_paste_image_item_get_image    (const GPasteImageItem *self);
 
-GPasteItem      *g_paste_image_item_new           (GdkPixbuf *img);
-GPasteItem      *g_paste_image_item_new_from_file (const gchar *path,
-                                                   GDateTime   *date);
+void       g_paste_image_item_load_image        (GPasteImageItem    *self,
+                                                 GCancellable       *cancellable,
+                                                 GAsyncReadyCallback callback,
+                                                 gpointer            user_data);
+GdkPixbuf *g_paste_image_item_load_image_finish (GPasteImageItem    *self,
+                                                 GAsyncResult       *result,
+                                                 GError            **error);
+
+void g_paste_image_item_discard        (GPasteImageItem *self);
+void g_paste_image_item_wait_for_saves (void);
+
+guint64 g_paste_image_item_get_cache_size (void);
+void    g_paste_image_item_trim_cache     (guint64 max_size);
+
+GPasteItem      *g_paste_image_item_new                (GdkPixbuf *img);
+GPasteItem      *g_paste_image_item_new_full           (GdkPixbuf *img,
+                                                        guint64    compression);
+GPasteItem      *g_paste_image_item_new_from_file      (const gchar *path,
+                                                        GDateTime   *date);
+GPasteItem      *g_paste_image_item_new_from_file_full (const gchar *path,
+                                                        GDateTime   *date,
+                                                        gint         width,
+                                                        gint         height,
+                                                        const gchar *checksum);
 
 G_END_DECLS
 
@@ -17,24 +17,198 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-fingerprint.h"
+#include "gpaste-string.h"
+
 #include <gpaste-item.h>
 
 #include <string.h>
 
 typedef struct
 {
-    gchar  *value;
-    gchar  *display_string;
-    guint64 size;
+    /* With its trailing NUL, NULL for compressed items unless it's been inflated */
+    GBytes       *value;
+    /* Raw deflate of the value, see g_paste_item_compress */
+    GBytes       *compressed;
+    /* Set while the value is being compressed in a thread */
+    GCancellable *compressing;
+    guint64       length;
+    gchar        *display_string;
+    /* Built on demand by g_paste_item_get_display_string, held like inflated values */
+    gchar        *display_string_cache;
+    guint64       size;
+    guint64       hash;
 } GPasteItemPrivate;
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (GPasteItem, g_paste_item, G_TYPE_OBJECT)
 
+/* Values shorter than this aren't worth compressing */
+#define G_PASTE_ITEM_COMPRESSION_THRESHOLD 4096
+
+/* Protects the values of all the items, as the save thread reads them */
+static GMutex g_paste_item_value_mutex;
+/* Items with an inflated value or a display string cache, we hold them until the main loop runs again */
+static GPtrArray *g_paste_item_held = NULL;
+
+static GBytes *
+g_paste_item_convert (GConverter *converter,
+                      GBytes     *input,
+                      gsize       expected_size)
+{
+    gsize in_length;
+    const guint8 *in = g_bytes_get_data (input, &in_length);
+    GByteArray *out = g_byte_array_sized_new (expected_size);
+    gsize out_length = 0;
+    GConverterResult result = G_CONVERTER_CONVERTED;
+
+    g_byte_array_set_size (out, MAX (expected_size, 64));
+
+    while (result != G_CONVERTER_FINISHED)
+    {
+        g_autoptr (GError) error = NULL;
+        gsize read = 0, written = 0;
+
+        result = g_converter_convert (converter,
+                                      in, in_length,
+                                      out->data + out_length, out->len - out_length,
+                                      G_CONVERTER_INPUT_AT_END,
+                                      &read, &written,
+                                      &error);
+
+        if (result == G_CONVERTER_ERROR)
+        {
+            if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE))
+            {
+                g_byte_array_unref (out);
+                return NULL;
+            }
+
+            g_byte_array_set_size (out, out->len * 2);
+            continue;
+        }
+
+        in += read;
+        in_length -= read;
+        out_length += written;
+    }
+
+    g_byte_array_set_size (out, out_length);
+
+    return g_byte_array_free_to_bytes (out);
+}
+
+static GBytes *
+g_paste_item_inflate (GBytes *compressed,
+                      guint64 length)
+{
+    g_autoptr (GZlibDecompressor) decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+    GBytes *value = g_paste_item_convert (G_CONVERTER (decompressor), compressed, length + 1);
+
+    g_return_val_if_fail (value && g_bytes_get_size (value) == length + 1, g_bytes_new_static ("", 1));
+
+    return value;
+}
+
+static gboolean
+g_paste_item_release_held (gpointer user_data G_GNUC_UNUSED)
+{
+    g_mutex_lock (&g_paste_item_value_mutex);
+    GPtrArray *held = g_paste_item_held;
+    g_paste_item_held = NULL;
+
+    for (guint64 i = 0; i < held->len; ++i)
+    {
+        GPasteItemPrivate *priv = g_paste_item_get_instance_private (g_ptr_array_index (held, i));
+
+        /* It may have become active meanwhile, and then keeps its value */
+        if (priv->compressed && priv->value)
+        {
+            g_clear_pointer (&priv->value, g_bytes_unref);
+            priv->size -= priv->length + 1;
+        }
+
+        if (priv->display_string_cache)
+        {
+            priv->size -= strlen (priv->display_string_cache) + 1;
+            g_clear_pointer (&priv->display_string_cache, g_free);
+        }
+    }
+    g_mutex_unlock (&g_paste_item_value_mutex);
+
+    g_ptr_array_unref (held);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Only inflate the first @max_size bytes of the value */
+static gchar *
+g_paste_item_inflate_prefix (GBytes *compressed,
+                             gsize   max_size)
+{
+    g_autoptr (GZlibDecompressor) decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+    gsize in_length;
+    const guint8 *in = g_bytes_get_data (compressed, &in_length);
+    gchar *out = g_malloc0 (max_size + 1);
+    gsize out_length = 0;
+    GConverterResult result = G_CONVERTER_CONVERTED;
+
+    while (result == G_CONVERTER_CONVERTED && out_length < max_size)
+    {
+        gsize read = 0, written = 0;
+
+        result = g_converter_convert (G_CONVERTER (decompressor),
+                                      in, in_length,
+                                      out + out_length, max_size - out_length,
+                                      G_CONVERTER_INPUT_AT_END,
+                                      &read, &written,
+                                      NULL); /* error */
+
+        if (!read && !written)
+            break;
+
+        in += read;
+        in_length -= read;
+        out_length += written;
+    }
+
+    return out;
+}
+
+/* Must be called with the value mutex held */
+static void
+g_paste_item_private_hold (const GPasteItem *self)
+{
+    if (!g_paste_item_held)
+    {
+        g_paste_item_held = g_ptr_array_new_with_free_func (g_object_unref);
+        g_idle_add (g_paste_item_release_held, NULL);
+    }
+
+    g_ptr_array_add (g_paste_item_held, g_object_ref ((gpointer) self));
+}
+
+/* Must be called with the value mutex held */
+static const gchar *
+g_paste_item_private_get_value (const GPasteItem *self)
+{
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
+
+    if (!priv->value)
+    {
+        priv->value = g_paste_item_inflate (priv->compressed, priv->length);
+        priv->size += priv->length + 1;
+        g_paste_item_private_hold (self);
+    }
+
+    return g_bytes_get_data (priv->value, NULL);
+}
+
 /**
  * g_paste_item_get_value:
  * @self: a #GPasteItem instance
  *
  * Get the value of the given item (text, uris or path to the image)
+ * See g_paste_item_get_real_value for how long it stays valid.
  *
  * Returns: read-only string containing the value
  */
@@ -52,6 +226,9 @@ g_paste_item_get_value (const GPasteItem *self)
  *
  * Get the real value of the given item (text, uris or path to the image)
  * This is different from get_value only for #GPastePasswordItem
+ * The value of an idle compressed item is inflated on demand, and stays
+ * valid until the main loop runs again, even if the item gets removed
+ * meanwhile. It's accounted in the size of the item until then.
  *
  * Returns: read-only string containing the real value
  */
@@ -60,9 +237,61 @@ g_paste_item_get_real_value (const GPasteItem *self)
 {
     g_return_val_if_fail (G_PASTE_IS_ITEM (self), NULL);
 
+    g_mutex_lock (&g_paste_item_value_mutex);
+    const gchar *value = g_paste_item_private_get_value (self);
+    g_mutex_unlock (&g_paste_item_value_mutex);
+
+    return value;
+}
+
+/**
+ * g_paste_item_ref_real_value:
+ * @self: a #GPasteItem instance
+ *
+ * Get the real value of the given item, as g_paste_item_get_real_value,
+ * but which stays valid whatever happens to the item.
+ * This is what should be used outside of the main thread.
+ *
+ * Returns: (transfer full): the real value, with its trailing NUL
+ */
+G_PASTE_VISIBLE GBytes *
+g_paste_item_ref_real_value (const GPasteItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_ITEM (self), NULL);
+
     GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
 
-    return priv->value;
+    g_mutex_lock (&g_paste_item_value_mutex);
+    GBytes *value = (priv->value) ? g_bytes_ref (priv->value) : NULL;
+    g_autoptr (GBytes) compressed = (value) ? NULL : g_bytes_ref (priv->compressed);
+    g_mutex_unlock (&g_paste_item_value_mutex);
+
+    /* Don't cache it, this could evict a value the main thread is using */
+    return (value) ? value : g_paste_item_inflate (compressed, priv->length);
+}
+
+/* Only read the beginning of the value, which may be huge or compressed */
+static gchar *
+g_paste_item_default_build_display_string (const GPasteItem *self,
+                                           guint64           max_length)
+{
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
+
+    g_mutex_lock (&g_paste_item_value_mutex);
+    g_autoptr (GBytes) value = (priv->value) ? g_bytes_ref (priv->value) : NULL;
+    g_autoptr (GBytes) compressed = (value) ? NULL : g_bytes_ref (priv->compressed);
+    g_mutex_unlock (&g_paste_item_value_mutex);
+
+    if (!value && !max_length)
+        value = g_paste_item_inflate (compressed, priv->length);
+
+    if (value)
+        return g_paste_string_truncate (g_bytes_get_data (value, NULL), max_length);
+
+    /* A character is at most 4 bytes long, so that's all we need to inflate */
+    g_autofree gchar *prefix = g_paste_item_inflate_prefix (compressed, MIN (max_length * 4, priv->length));
+
+    return g_paste_string_truncate (prefix, max_length);
 }
 
 /**
@@ -70,6 +299,9 @@ g_paste_item_get_real_value (const GPasteItem *self)
  * @self: a #GPasteItem instance
  *
  * Get the string we should use to display the #GPasteItem
+ * This builds the whole of it, use g_paste_item_dup_display_string
+ * when only its beginning is going to be shown.
+ * It stays valid until the main loop runs again, see g_paste_item_get_real_value
  *
  * Returns: read-only display string
  */
@@ -79,9 +311,51 @@ g_paste_item_get_display_string (const GPasteItem *self)
     g_return_val_if_fail (G_PASTE_IS_ITEM (self), NULL);
 
     GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
-    const gchar *display_string = priv->display_string;
+    GPasteItemClass *klass = G_PASTE_ITEM_GET_CLASS (self);
+
+    if (priv->display_string)
+        return priv->display_string;
+    if (klass->build_display_string == g_paste_item_default_build_display_string)
+        return g_paste_item_get_real_value (self);
+
+    if (!priv->display_string_cache)
+    {
+        gchar *display_string = klass->build_display_string (self, 0);
+
+        g_mutex_lock (&g_paste_item_value_mutex);
+        priv->display_string_cache = display_string;
+        priv->size += strlen (display_string) + 1;
+        g_paste_item_private_hold (self);
+        g_mutex_unlock (&g_paste_item_value_mutex);
+    }
+
+    return priv->display_string_cache;
+}
+
+/**
+ * g_paste_item_dup_display_string:
+ * @self: a #GPasteItem instance
+ * @max_length: how many characters we need at most, 0 for all of them
+ *
+ * Get the beginning of the string we should use to display the #GPasteItem,
+ * without building the rest of it
+ *
+ * Returns: the newly allocated display string
+ */
+G_PASTE_VISIBLE gchar *
+g_paste_item_dup_display_string (const GPasteItem *self,
+                                 guint64           max_length)
+{
+    g_return_val_if_fail (G_PASTE_IS_ITEM (self), NULL);
+
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
+
+    if (priv->display_string)
+        return g_paste_string_truncate (priv->display_string, max_length);
 
-    return (display_string) ? display_string : priv->value;
+    g_autofree gchar *display_string = G_PASTE_ITEM_GET_CLASS (self)->build_display_string (self, max_length);
+
+    return g_paste_string_truncate (display_string, max_length);
 }
 
 /**
@@ -127,6 +401,25 @@ g_paste_item_get_kind (const GPasteItem *self)
     return klass->get_kind (self);
 }
 
+/**
+ * g_paste_item_get_hash:
+ * @self: a #GPasteItem instance
+ *
+ * Get the hash of the real value of the #GPasteItem
+ * Items with the same value have the same hash
+ *
+ * Returns: The hash of its value
+ */
+G_PASTE_VISIBLE guint64
+g_paste_item_get_hash (const GPasteItem *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_ITEM (self), 0);
+
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
+
+    return priv->hash;
+}
+
 /**
  * g_paste_item_get_size:
  * @self: a #GPasteItem instance
@@ -210,7 +503,7 @@ g_paste_item_remove_size (GPasteItem *self,
 /**
  * g_paste_item_set_display_string:
  * @self: a #GPasteItem instance
- * @display_string: the new display string
+ * @display_string: (nullable): the new display string, %NULL to build it on demand
  *
  * Set the string to display
  *
@@ -224,6 +517,14 @@ g_paste_item_set_display_string (GPasteItem  *self,
 
     GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
 
+    g_mutex_lock (&g_paste_item_value_mutex);
+    if (priv->display_string_cache)
+    {
+        priv->size -= strlen (priv->display_string_cache) + 1;
+        g_clear_pointer (&priv->display_string_cache, g_free);
+    }
+    g_mutex_unlock (&g_paste_item_value_mutex);
+
     if (priv->display_string)
     {
         priv->size -= (strlen (priv->display_string) + 1);
@@ -257,13 +558,129 @@ g_paste_item_set_state (GPasteItem     *self,
     G_PASTE_ITEM_GET_CLASS (self)->set_state (self, state);
 }
 
+static void
+g_paste_item_compress_thread (GTask        *task,
+                              gpointer      source_object G_GNUC_UNUSED,
+                              gpointer      task_data,
+                              GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GBytes *value = task_data;
+    guint64 length = g_bytes_get_size (value) - 1;
+    /* Level 1 is the fastest one, and the gain on text is already huge */
+    g_autoptr (GZlibCompressor) compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, 1);
+    GBytes *compressed = g_paste_item_convert (G_CONVERTER (compressor), value, length / 2);
+
+    /* Not worth it, keep the value as is */
+    if (compressed && g_bytes_get_size (compressed) > length - length / 8)
+        g_clear_pointer (&compressed, g_bytes_unref);
+
+    g_task_return_pointer (task, compressed, (GDestroyNotify) g_bytes_unref);
+}
+
+static void
+g_paste_item_compress_done (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data G_GNUC_UNUSED)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GBytes) compressed = g_task_propagate_pointer (G_TASK (result), &error);
+
+    /* The item became active again, it may be compressing another time already */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (G_PASTE_ITEM (source_object));
+
+    g_clear_object (&priv->compressing);
+
+    if (!compressed)
+        return;
+
+    g_mutex_lock (&g_paste_item_value_mutex);
+    priv->compressed = g_bytes_ref (compressed);
+    g_clear_pointer (&priv->value, g_bytes_unref);
+    priv->size -= priv->length + 1;
+    priv->size += g_bytes_get_size (compressed);
+    g_mutex_unlock (&g_paste_item_value_mutex);
+}
+
+/**
+ * g_paste_item_compress:
+ * @self: a #GPasteItem instance
+ *
+ * Keep the value of the item compressed in memory, if it's big enough
+ * for this to be worth it. Its size only accounts the compressed value
+ * once it's done, which happens in a thread.
+ * This is meant for idle items, the value is inflated on demand.
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_item_compress (GPasteItem *self)
+{
+    g_return_if_fail (G_PASTE_IS_ITEM (self));
+
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
+
+    if (priv->compressed || priv->compressing || priv->length < G_PASTE_ITEM_COMPRESSION_THRESHOLD)
+        return;
+
+    priv->compressing = g_cancellable_new ();
+
+    g_autoptr (GTask) task = g_task_new (self, priv->compressing, g_paste_item_compress_done, NULL);
+
+    g_task_set_task_data (task, g_bytes_ref (priv->value), (GDestroyNotify) g_bytes_unref);
+    g_task_run_in_thread (task, g_paste_item_compress_thread);
+}
+
+/**
+ * g_paste_item_uncompress:
+ * @self: a #GPasteItem instance
+ *
+ * Keep the value of the item uncompressed in memory again
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_item_uncompress (GPasteItem *self)
+{
+    g_return_if_fail (G_PASTE_IS_ITEM (self));
+
+    GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
+
+    if (priv->compressing)
+    {
+        g_cancellable_cancel (priv->compressing);
+        g_clear_object (&priv->compressing);
+    }
+
+    if (!priv->compressed)
+        return;
+
+    g_mutex_lock (&g_paste_item_value_mutex);
+    /* If it's already inflated, it's already accounted */
+    if (!priv->value)
+    {
+        priv->value = g_paste_item_inflate (priv->compressed, priv->length);
+        priv->size += priv->length + 1;
+    }
+    priv->size -= g_bytes_get_size (priv->compressed);
+    g_clear_pointer (&priv->compressed, g_bytes_unref);
+    g_mutex_unlock (&g_paste_item_value_mutex);
+}
+
 static void
 g_paste_item_finalize (GObject *object)
 {
     GPasteItemPrivate *priv = g_paste_item_get_instance_private (G_PASTE_ITEM (object));
 
-    g_free (priv->value);
+    /* A running compression holds a reference on us, there's none here */
+    if (priv->compressed)
+        g_bytes_unref (priv->compressed);
+    if (priv->value)
+        g_bytes_unref (priv->value);
     g_free (priv->display_string);
+    g_free (priv->display_string_cache);
 
     G_OBJECT_CLASS (g_paste_item_parent_class)->finalize (object);
 }
@@ -278,7 +695,14 @@ g_paste_item_default_equals (const GPasteItem *self,
     GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
     GPasteItemPrivate *_priv = g_paste_item_get_instance_private (other);
 
-    return !g_strcmp0 (priv->value, _priv->value);
+    if (priv->hash != _priv->hash || priv->length != _priv->length)
+        return FALSE;
+
+    /* Don't keep them inflated, we won't look at them again */
+    g_autoptr (GBytes) value = g_paste_item_ref_real_value (self);
+    g_autoptr (GBytes) other_value = g_paste_item_ref_real_value (other);
+
+    return g_bytes_equal (value, other_value);
 }
 
 static void
@@ -294,6 +718,7 @@ g_paste_item_class_init (GPasteItemClass *klass)
     klass->get_value = g_paste_item_get_real_value;
     klass->get_kind = NULL;
     klass->set_state = g_paste_item_default_set_state;
+    klass->build_display_string = g_paste_item_default_build_display_string;
 
     G_OBJECT_CLASS (klass)->finalize = g_paste_item_finalize;
 }
@@ -323,10 +748,16 @@ g_paste_item_new (GType        type,
     GPasteItem *self = g_object_new (type, NULL);
     GPasteItemPrivate *priv = g_paste_item_get_instance_private (self);
 
-    priv->value = g_strdup (value);
+    priv->length = strlen (value);
+    priv->value = g_bytes_new (value, priv->length + 1);
+    priv->compressed = NULL;
+    priv->compressing = NULL;
     priv->display_string = NULL;
+    priv->display_string_cache = NULL;
 
-    priv->size = strlen (priv->value) + 1;
+    priv->size = priv->length + 1;
+    /* The value never changes, we can compute this once and for all */
+    priv->hash = g_paste_fingerprint_data (value, priv->length, 0);
 
     return self;
 }
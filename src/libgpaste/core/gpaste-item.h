@@ -47,6 +47,8 @@ struct _GPasteItemClass
                                 const GPasteItem *other);
     void          (*set_state) (GPasteItem     *self,
                                 GPasteItemState state);
+    gchar        *(*build_display_string) (const GPasteItem *self,
+                                           guint64           max_length);
 
     /*< pure virtual >*/
     const gchar *(*get_kind) (const GPasteItem *self);
@@ -54,15 +56,22 @@ struct _GPasteItemClass
 
 const gchar *g_paste_item_get_value          (const GPasteItem *self);
 const gchar *g_paste_item_get_real_value     (const GPasteItem *self);
+GBytes      *g_paste_item_ref_real_value     (const GPasteItem *self);
 const gchar *g_paste_item_get_display_string (const GPasteItem *self);
+gchar       *g_paste_item_dup_display_string (const GPasteItem *self,
+                                              guint64           max_length);
 gboolean     g_paste_item_equals             (const GPasteItem *self,
                                               const GPasteItem *other);
 const gchar *g_paste_item_get_kind           (const GPasteItem *self);
 guint64      g_paste_item_get_size           (const GPasteItem *self);
+guint64      g_paste_item_get_hash           (const GPasteItem *self);
 
 void g_paste_item_set_state (GPasteItem     *self,
                              GPasteItemState state);
 
+void g_paste_item_compress   (GPasteItem *self);
+void g_paste_item_uncompress (GPasteItem *self);
+
 void g_paste_item_set_display_string (GPasteItem  *self,
                                       const gchar *display_string);
 
@@ -78,9 +78,18 @@ g_paste_password_item_set_name (GPastePasswordItem *self,
     g_free (priv->name);
     priv->name = g_strdup (name);
 
+    /* Drop the display string built from the previous name */
+    g_paste_item_set_display_string (item, NULL);
+}
+
+static gchar *
+g_paste_password_item_build_display_string (const GPasteItem *self,
+                                            guint64           max_length G_GNUC_UNUSED)
+{
+    GPastePasswordItemPrivate *priv = g_paste_password_item_get_instance_private (G_PASTE_PASSWORD_ITEM (self));
+
     // This is the prefix displayed in history to identify a password
-    g_autofree gchar *full_display_string = g_strdup_printf ("[%s] %s", _("Password"), name);
-    g_paste_item_set_display_string (item, full_display_string);
+    return g_strdup_printf ("[%s] %s", _("Password"), priv->name);
 }
 
 static const gchar *
@@ -106,6 +115,13 @@ g_paste_password_item_equals (const GPasteItem *self,
     return FALSE;
 }
 
+/* Passwords are never compressed, unlike the other texts */
+static void
+g_paste_password_item_set_state (GPasteItem     *self  G_GNUC_UNUSED,
+                                 GPasteItemState state G_GNUC_UNUSED)
+{
+}
+
 static void
 g_paste_password_item_finalize (GObject *object)
 {
@@ -125,6 +141,8 @@ g_paste_password_item_class_init (GPastePasswordItemClass *klass)
     item_class->get_kind = g_paste_password_item_get_kind;
     item_class->get_value = g_paste_password_item_get_value;
     item_class->equals = g_paste_password_item_equals;
+    item_class->build_display_string = g_paste_password_item_build_display_string;
+    item_class->set_state = g_paste_password_item_set_state;
 
     G_OBJECT_CLASS (klass)->finalize = g_paste_password_item_finalize;
 }
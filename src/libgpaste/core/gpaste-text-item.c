@@ -35,6 +35,17 @@ g_paste_text_item_get_kind (const GPasteItem *self G_GNUC_UNUSED)
     return "Text";
 }
 
+/* Idle texts are rarely used again, and pasted logs or documents compress very well */
+static void
+g_paste_text_item_set_state (GPasteItem     *self,
+                             GPasteItemState state)
+{
+    if (state == G_PASTE_ITEM_STATE_ACTIVE)
+        g_paste_item_uncompress (self);
+    else
+        g_paste_item_compress (self);
+}
+
 static void
 g_paste_text_item_class_init (GPasteTextItemClass *klass)
 {
@@ -42,6 +53,7 @@ g_paste_text_item_class_init (GPasteTextItemClass *klass)
 
     item_class->equals = g_paste_text_item_equals;
     item_class->get_kind = g_paste_text_item_get_kind;
+    item_class->set_state = g_paste_text_item_set_state;
 }
 
 static void
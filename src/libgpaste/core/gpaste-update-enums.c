@@ -29,6 +29,7 @@ g_paste_update_action_get_type (void)
         static const GEnumValue values[] = {
             { G_PASTE_UPDATE_ACTION_REPLACE, "G_PASTE_UPDATE_ACTION_REPLACE", "REPLACE" },
             { G_PASTE_UPDATE_ACTION_REMOVE,  "G_PASTE_UPDATE_ACTION_REMOVE",  "REMOVE"  },
+            { G_PASTE_UPDATE_ACTION_ADD,     "G_PASTE_UPDATE_ACTION_ADD",     "ADD"     },
             { G_PASTE_UPDATE_ACTION_INVALID, NULL,                            NULL      }
         };
         etype = g_enum_register_static (g_intern_static_string ("GPasteUpdateAction"), values);
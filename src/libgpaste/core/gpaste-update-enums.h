@@ -31,6 +31,7 @@ G_BEGIN_DECLS
 typedef enum {
     G_PASTE_UPDATE_ACTION_REPLACE = 1,
     G_PASTE_UPDATE_ACTION_REMOVE,
+    G_PASTE_UPDATE_ACTION_ADD,
     G_PASTE_UPDATE_ACTION_INVALID = 0
 } GPasteUpdateAction;
 
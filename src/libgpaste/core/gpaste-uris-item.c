@@ -17,8 +17,9 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-string.h"
+
 #include <gpaste-uris-item.h>
-#include <gpaste-util.h>
 
 struct _GPasteUrisItem
 {
@@ -27,16 +28,56 @@ struct _GPasteUrisItem
 
 typedef struct
 {
-    GStrv uris;
+    /* Only built when the item gets served to the clipboard */
+    GStrv    uris;
+    /* What the uris take once built, accounted while the item is active or they're built */
+    guint64  uris_size;
+    gboolean active;
+    gboolean accounted;
 } GPasteUrisItemPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GPasteUrisItem, g_paste_uris_item, G_PASTE_TYPE_TEXT_ITEM)
 
+static void
+g_paste_uris_item_update_size (GPasteUrisItem *self)
+{
+    GPasteUrisItemPrivate *priv = g_paste_uris_item_get_instance_private (self);
+    gboolean accounted = (priv->active || priv->uris);
+
+    if (accounted == priv->accounted)
+        return;
+
+    if (accounted)
+        g_paste_item_add_size (G_PASTE_ITEM (self), priv->uris_size);
+    else
+        g_paste_item_remove_size (G_PASTE_ITEM (self), priv->uris_size);
+
+    priv->accounted = accounted;
+}
+
+/* The uris of an idle item are only needed by whoever asked for them, until the main loop runs again */
+static gboolean
+g_paste_uris_item_release_uris (gpointer user_data)
+{
+    g_autoptr (GPasteUrisItem) self = user_data;
+    GPasteUrisItemPrivate *priv = g_paste_uris_item_get_instance_private (self);
+
+    if (!priv->active)
+    {
+        g_clear_pointer (&priv->uris, g_strfreev);
+        g_paste_uris_item_update_size (self);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
 /**
  * g_paste_uris_item_get_uris:
  * @self: a #GPasteUrisItem instance
  *
  * Get the list of uris contained in the #GPasteUrisItem
+ * They're built on first use and kept until the item gets idle,
+ * or until the main loop runs again if it's already idle.
  *
  * Returns: (transfer none): read-only array of read-only uris (strings)
  */
@@ -47,6 +88,22 @@ g_paste_uris_item_get_uris (const GPasteUrisItem *self)
 
     GPasteUrisItemPrivate *priv = g_paste_uris_item_get_instance_private (self);
 
+    if (!priv->uris)
+    {
+        g_auto (GStrv) paths = g_strsplit (g_paste_item_get_real_value (G_PASTE_ITEM (self)), "\n", 0);
+        guint64 length = g_strv_length (paths);
+
+        GStrv _uris = priv->uris = g_new (gchar *, length + 1);
+        for (guint64 i = 0; i < length; ++i)
+            _uris[i] = g_strconcat ("file://", paths[i], NULL);
+        _uris[length] = NULL;
+
+        g_paste_uris_item_update_size ((GPasteUrisItem *) self);
+
+        if (!priv->active)
+            g_idle_add (g_paste_uris_item_release_uris, g_object_ref ((gpointer) self));
+    }
+
     return (const gchar * const *) priv->uris;
 }
 
@@ -58,7 +115,36 @@ g_paste_uris_item_equals (const GPasteItem *self,
             G_PASTE_ITEM_CLASS (g_paste_uris_item_parent_class)->equals (self, other));
 }
 
+static gchar *
+g_paste_uris_item_build_display_string (const GPasteItem *self,
+                                        guint64           max_length)
+{
+    const gchar *home = g_get_home_dir ();
+    /* Each "~" stands for the whole home dir, so we may need that many more characters */
+    guint64 value_length = (max_length) ? (max_length + 1) * MAX (g_utf8_strlen (home, -1), 1) : 0;
+    g_autofree gchar *value = g_paste_string_truncate (g_paste_item_get_real_value (self), value_length);
+    g_autofree gchar *display_string_with_newlines = g_paste_string_replace (value, home, "~");
+    g_autofree gchar *display_string = g_paste_string_flatten (display_string_with_newlines);
+
+    // This is the prefix displayed in history to identify selected files
+    return g_strconcat (_("[Files] "), display_string, NULL);
+}
+
+static void
+g_paste_uris_item_set_state (GPasteItem     *self,
+                             GPasteItemState state)
+{
+    GPasteUrisItemPrivate *priv = g_paste_uris_item_get_instance_private (G_PASTE_URIS_ITEM (self));
 
+    G_PASTE_ITEM_CLASS (g_paste_uris_item_parent_class)->set_state (self, state);
+
+    /* Account for the uris as soon as we may be asked for them */
+    priv->active = (state == G_PASTE_ITEM_STATE_ACTIVE);
+    if (!priv->active)
+        g_clear_pointer (&priv->uris, g_strfreev);
+
+    g_paste_uris_item_update_size (G_PASTE_URIS_ITEM (self));
+}
 
 static const gchar *
 g_paste_uris_item_get_kind (const GPasteItem *self G_GNUC_UNUSED)
@@ -82,7 +168,9 @@ g_paste_uris_item_class_init (GPasteUrisItemClass *klass)
     GPasteItemClass *item_class = G_PASTE_ITEM_CLASS (klass);
 
     item_class->equals = g_paste_uris_item_equals;
+    item_class->build_display_string = g_paste_uris_item_build_display_string;
     item_class->get_kind = g_paste_uris_item_get_kind;
+    item_class->set_state = g_paste_uris_item_set_state;
 
     G_OBJECT_CLASS (klass)->finalize = g_paste_uris_item_finalize;
 }
@@ -109,27 +197,16 @@ g_paste_uris_item_new (const gchar *uris)
 
     GPasteItem *self = g_paste_item_new (G_PASTE_TYPE_URIS_ITEM, uris);
     GPasteUrisItemPrivate *priv = g_paste_uris_item_get_instance_private (G_PASTE_URIS_ITEM (self));
+    guint64 length = 1;
 
-    g_autofree gchar *display_string_with_newlines = g_paste_util_replace (uris, g_get_home_dir (), "~");
-    g_autofree gchar *display_string = g_paste_util_replace (display_string_with_newlines, "\n", " ");
-
-    // This is the prefix displayed in history to identify selected files
-    g_autofree gchar *full_display_string = g_strconcat (_("[Files] "), display_string, NULL);
-
-    g_paste_item_set_display_string (self, full_display_string);
-
-    g_auto (GStrv) paths = g_strsplit (uris, "\n", 0);
-    guint64 length = g_strv_length (paths);
-
-    g_paste_item_add_size (self, length + 1);
-
-    GStrv _uris = priv->uris = g_new (gchar *, length + 1);
-    for (guint64 i = 0; i < length; ++i)
+    for (const gchar *c = uris; *c; ++c)
     {
-        _uris[i] = g_strconcat ("file://", paths[i], NULL);
-        g_paste_item_add_size (self, strlen (_uris[i]) + 1);
+        if (*c == '\n')
+            ++length;
     }
-    _uris[length] = NULL;
+
+    /* The array, and each path (the uris minus the newlines) with its "file://" prefix and its NUL */
+    priv->uris_size = (length + 1) * sizeof (gchar *) + (strlen (uris) - (length - 1)) + length * (strlen ("file://") + 1);
 
     return self;
 }
@@ -18,7 +18,10 @@
  */
 
 #include "gpaste-gdbus-macros.h"
+#include "gpaste-memfd.h"
+#include "gpaste-string.h"
 
+#include <gpaste-image-item.h>
 #include <gpaste-keybinder.h>
 #include <gpaste-make-password-keybinding.h>
 #include <gpaste-pop-keybinding.h>
@@ -30,7 +33,11 @@
 #include <gpaste-update-enums.h>
 #include <gpaste-upload-keybinding.h>
 
+#include <gio/gunixfdlist.h>
+#include <gio/gunixinputstream.h>
+
 #include <string.h>
+#include <unistd.h>
 
 #define G_PASTE_SEND_DBUS_SIGNAL_FULL(sig,data,error)               \
     g_dbus_connection_emit_signal (priv->connection,                \
@@ -61,9 +68,12 @@
 
 enum
 {
+    C_DELTA,
     C_UPDATE,
     C_SWITCH,
+    C_SEARCHED,
     C_TRACK,
+    C_ELEMENT_SIZE,
     C_ACTIVE_CHANGED,
 
     C_LAST_SIGNAL
@@ -186,6 +196,115 @@ g_paste_daemon_update (GPasteDaemon      *self,
     G_PASTE_SEND_DBUS_SIGNAL_FULL (UPDATE, g_variant_new_tuple (data, 3), NULL);
 }
 
+/*
+ * What the clients list for an item: its display string, cut to the "element-size"
+ * setting, so that listing huge items doesn't mean sending all of them over D-Bus.
+ * Cut previews end with "…", like the clients would display them anyway.
+ */
+static gchar *
+g_paste_daemon_get_preview (const GPasteSettings *settings,
+                            const GPasteItem     *item)
+{
+    guint64 element_size = g_paste_settings_get_element_size (settings);
+
+    if (!element_size)
+        return g_strdup (g_paste_item_get_display_string (item));
+
+    /* Get one more character to know whether we actually cut something */
+    g_autofree gchar *preview = g_paste_item_dup_display_string (item, element_size + 1);
+
+    if (g_utf8_strlen (preview, -1) <= (glong) element_size)
+        return g_steal_pointer (&preview);
+
+    g_autofree gchar *cut = g_paste_string_truncate (preview, element_size);
+
+    return g_strconcat (cut, "…", NULL);
+}
+
+static void
+g_paste_daemon_add_item (GVariantBuilder      *builder,
+                         const GPasteSettings *settings,
+                         const GPasteItem     *item,
+                         guint64               index)
+{
+    g_autofree gchar *preview = g_paste_daemon_get_preview (settings, item);
+    gint64 timestamp = 0;
+
+    if (G_PASTE_IS_IMAGE_ITEM (item))
+        timestamp = g_date_time_to_unix ((GDateTime *) g_paste_image_item_get_date (G_PASTE_IMAGE_ITEM (item)));
+
+    g_variant_builder_add (builder, "(sstxt)",
+                           preview,
+                           g_paste_item_get_kind (item),
+                           g_paste_item_get_size (item),
+                           timestamp,
+                           index);
+}
+
+static void
+g_paste_daemon_delta (GPasteDaemon      *self,
+                      guint64            version,
+                      GPasteUpdateAction action,
+                      GPasteUpdateTarget target,
+                      guint64            position,
+                      const GPasteItem  *item)
+{
+    GPasteDaemonPrivate *priv = g_paste_daemon_get_instance_private (self);
+    GVariantBuilder items;
+
+    /* An array of zero or one item, as D-Bus has no maybe type */
+    g_variant_builder_init (&items, G_VARIANT_TYPE ("a(sstxt)"));
+    if (item)
+        g_paste_daemon_add_item (&items, priv->settings, item, position);
+
+    GVariant *data[] = {
+        g_variant_new_uint64 (version),
+        g_variant_new_string (g_enum_get_value (g_type_class_peek (G_PASTE_TYPE_UPDATE_ACTION), action)->value_nick),
+        g_variant_new_string (g_enum_get_value (g_type_class_peek (G_PASTE_TYPE_UPDATE_TARGET), target)->value_nick),
+        g_variant_new_uint64 (position),
+        g_variant_builder_end (&items)
+    };
+    G_PASTE_SEND_DBUS_SIGNAL_FULL (DELTA, g_variant_new_tuple (data, 5), NULL);
+}
+
+/**
+ * g_paste_daemon_flush:
+ * @self: (transfer none): the #GPasteDaemon
+ *
+ * Synchronously write the pending history changes to disk
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_daemon_flush (GPasteDaemon *self)
+{
+    g_return_if_fail (G_PASTE_IS_DAEMON (self));
+
+    GPasteDaemonPrivate *priv = g_paste_daemon_get_instance_private (self);
+
+    g_paste_history_flush (priv->history);
+}
+
+/**
+ * g_paste_daemon_hand_off:
+ * @self: (transfer none): the #GPasteDaemon
+ *
+ * Prepare the history to be taken over by the daemon we're about to
+ * reexecute: its fd has to be exported as #G_PASTE_DAEMON_HANDOFF_FD_ENV
+ * The pending history changes are written to disk in any case.
+ *
+ * Returns: the file descriptor, or -1 if the history couldn't be handed off
+ */
+G_PASTE_VISIBLE gint
+g_paste_daemon_hand_off (GPasteDaemon *self)
+{
+    g_return_val_if_fail (G_PASTE_IS_DAEMON (self), -1);
+
+    GPasteDaemonPrivate *priv = g_paste_daemon_get_instance_private (self);
+
+    return g_paste_history_hand_off (priv->history);
+}
+
 /**
  * g_paste_daemon_show_history:
  * @self: (transfer none): the #GPasteDaemon
@@ -260,6 +379,155 @@ g_paste_daemon_private_add (GPasteDaemonPrivate *priv,
     g_paste_daemon_private_do_add (priv, text, length, err);
 }
 
+/* Contents passed as a file descriptor are read as they come, so that a slow writer doesn't block us */
+#define G_PASTE_DAEMON_FD_CHUNK_SIZE (64 * 1024)
+/* Give up on a writer which doesn't send anything for that many seconds */
+#define G_PASTE_DAEMON_FD_TIMEOUT 30
+
+typedef struct
+{
+    GPasteDaemon          *self;
+    GDBusMethodInvocation *invocation;
+    GInputStream          *stream;
+    GCancellable          *cancellable;
+    guint                  timeout_source;
+    GString               *contents;
+    guint64                max_size;
+} GPasteDaemonFdReader;
+
+static void
+g_paste_daemon_fd_reader_free (GPasteDaemonFdReader *reader)
+{
+    if (reader->timeout_source)
+        g_source_remove (reader->timeout_source);
+    g_object_unref (reader->self);
+    g_object_unref (reader->stream);
+    g_object_unref (reader->cancellable);
+    g_string_free (reader->contents, TRUE);
+    g_free (reader);
+}
+
+static void g_paste_daemon_fd_reader_on_read (GObject      *source_object,
+                                              GAsyncResult *res,
+                                              gpointer      user_data);
+
+static gboolean
+g_paste_daemon_fd_reader_timeout (gpointer user_data)
+{
+    GPasteDaemonFdReader *reader = user_data;
+
+    reader->timeout_source = 0;
+    g_cancellable_cancel (reader->cancellable);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+g_paste_daemon_fd_reader_read (GPasteDaemonFdReader *reader)
+{
+    GString *contents = reader->contents;
+    guint64 length = contents->len;
+
+    /* The writer gets the whole timeout for each chunk */
+    if (reader->timeout_source)
+        g_source_remove (reader->timeout_source);
+    reader->timeout_source = g_timeout_add_seconds (G_PASTE_DAEMON_FD_TIMEOUT, g_paste_daemon_fd_reader_timeout, reader);
+
+    g_string_set_size (contents, length + G_PASTE_DAEMON_FD_CHUNK_SIZE);
+    g_input_stream_read_async (reader->stream,
+                               contents->str + length,
+                               G_PASTE_DAEMON_FD_CHUNK_SIZE,
+                               G_PRIORITY_DEFAULT,
+                               reader->cancellable,
+                               g_paste_daemon_fd_reader_on_read,
+                               reader);
+}
+
+static void
+g_paste_daemon_fd_reader_on_read (GObject      *source_object,
+                                  GAsyncResult *res,
+                                  gpointer      user_data)
+{
+    GPasteDaemonFdReader *reader = user_data;
+    GString *contents = reader->contents;
+    GError *error = NULL;
+    gssize length = g_input_stream_read_finish (G_INPUT_STREAM (source_object), res, &error);
+
+    if (length < 0)
+    {
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            g_dbus_method_invocation_return_dbus_error (reader->invocation, G_PASTE_BUS_NAME ".Error", "timed out waiting for the content to add");
+            g_error_free (error);
+        }
+        else
+            g_dbus_method_invocation_take_error (reader->invocation, error);
+        g_paste_daemon_fd_reader_free (reader);
+        return;
+    }
+
+    g_string_truncate (contents, contents->len - G_PASTE_DAEMON_FD_CHUNK_SIZE + length);
+
+    /* Don't keep on buffering something too big to be added anyway */
+    if (length && contents->len <= reader->max_size)
+    {
+        g_paste_daemon_fd_reader_read (reader);
+        return;
+    }
+
+    GPasteDaemonPrivate *priv = g_paste_daemon_get_instance_private (reader->self);
+    g_autofree GPasteDBusError *err = NULL;
+
+    if (!g_utf8_validate (contents->str, contents->len, NULL))
+        err = _err (G_PASTE_BUS_NAME ".Error", "the content to add isn't valid UTF-8");
+    else if (contents->len <= reader->max_size)
+        g_paste_daemon_private_do_add (priv, contents->str, contents->len, &err);
+
+    if (err)
+        g_dbus_method_invocation_return_dbus_error (reader->invocation, err->name, err->msg);
+    else
+        g_dbus_method_invocation_return_value (reader->invocation, NULL);
+
+    g_paste_daemon_fd_reader_free (reader);
+}
+
+/* This one answers asynchronously, once everything has been read */
+static void
+g_paste_daemon_private_add_fd (GPasteDaemon          *self,
+                               GVariant              *parameters,
+                               GDBusMethodInvocation *invocation)
+{
+    GPasteDaemonPrivate *priv = g_paste_daemon_get_instance_private (self);
+    GUnixFDList *fd_list = g_dbus_message_get_unix_fd_list (g_dbus_method_invocation_get_message (invocation));
+    GError *error = NULL;
+    gint32 handle;
+
+    g_variant_get (parameters, "(h)", &handle);
+
+    gint fd = (fd_list) ? g_unix_fd_list_get (fd_list, handle, &error) : -1;
+
+    if (fd < 0)
+    {
+        if (error)
+            g_dbus_method_invocation_take_error (invocation, error);
+        else
+            g_dbus_method_invocation_return_dbus_error (invocation, G_PASTE_BUS_NAME ".Error", "no file descriptor to read from");
+        return;
+    }
+
+    GPasteDaemonFdReader *reader = g_new (GPasteDaemonFdReader, 1);
+
+    reader->self = g_object_ref (self);
+    reader->invocation = invocation;
+    reader->stream = g_unix_input_stream_new (fd, TRUE); /* close fd */
+    reader->cancellable = g_cancellable_new ();
+    reader->timeout_source = 0;
+    reader->contents = g_string_new (NULL);
+    reader->max_size = g_paste_settings_get_max_text_item_size (priv->settings);
+
+    g_paste_daemon_fd_reader_read (reader);
+}
+
 static void
 g_paste_daemon_private_add_file (GPasteDaemonPrivate *priv,
                                  GVariant            *parameters,
@@ -456,9 +724,9 @@ g_paste_daemon_private_get_elements (GPasteDaemonPrivate *priv,
     for (guint64 i = 0; i < len; ++i)
     {
         G_PASTE_DBUS_ASSERT_FULL (indexes[i] < history_length, "invalid index received", NULL);
-        const gchar *value = g_paste_history_get_display_string (history, indexes[i]);
-        G_PASTE_DBUS_ASSERT_FULL (value, "received no value for this index", NULL);
-        ans[i] = g_strdup (value);
+        const GPasteItem *item = g_paste_history_get (history, indexes[i]);
+        G_PASTE_DBUS_ASSERT_FULL (item, "received no value for this index", NULL);
+        ans[i] = g_paste_daemon_get_preview (priv->settings, item);
     }
 
     GVariant *answer = g_variant_new_strv ((const gchar * const *) ans, len);
@@ -469,12 +737,12 @@ g_paste_daemon_private_get_elements (GPasteDaemonPrivate *priv,
 static GVariant *
 g_paste_daemon_private_get_history (GPasteDaemonPrivate *priv)
 {
-    const GList *history = g_paste_history_get_history (priv->history);
-    guint64 length = g_list_length ((GList *) history);
-    g_autofree const gchar **displayed_history = g_new (const gchar *, length + 1);
+    GPasteHistory *history = priv->history;
+    guint64 length = g_paste_history_get_length (history);
+    g_auto (GStrv) displayed_history = g_new (gchar *, length + 1);
 
-    for (guint64 i = 0; i < length; ++i, history = g_list_next (history))
-        displayed_history[i] = g_paste_item_get_display_string (history->data);
+    for (guint64 i = 0; i < length; ++i)
+        displayed_history[i] = g_paste_daemon_get_preview (priv->settings, g_paste_history_get (history, i));
     displayed_history[length] = NULL;
 
     GVariant *variant = g_variant_new_strv ((const gchar * const *) displayed_history, -1);
@@ -494,22 +762,39 @@ g_paste_daemon_private_get_history_size (GPasteDaemonPrivate *priv,
                                          GVariant            *parameters)
 {
     g_autofree gchar *name = g_paste_daemon_get_dbus_string_parameter (parameters, NULL);
-    guint64 size;
+    guint64 size = 0;
 
-    if (!g_strcmp0 (name, g_paste_history_get_current (priv->history)))
-    {
-        size = g_paste_history_get_length (priv->history);
-    }
-    else
-    {
-        g_autoptr (GPasteHistory) history = g_paste_history_new (priv->settings);
+    /* This doesn't need to load the history, unknown ones are empty */
+    g_paste_history_get_info (priv->history, name, &size, NULL, NULL, NULL);
 
-        g_paste_history_load (history, name);
-        size = g_paste_history_get_length (history);
-    }
+    GVariant *variant = g_variant_new_uint64 (size);
+    return g_variant_new_tuple (&variant, 1);
+}
 
+static GVariant *
+g_paste_daemon_private_get_items_page (GPasteDaemonPrivate *priv,
+                                       GVariant            *parameters)
+{
+    GPasteHistory *history = priv->history;
+    GVariantIter parameters_iter;
+
+    g_variant_iter_init (&parameters_iter, parameters);
+
+    g_autoptr (GVariant) variant1 = g_variant_iter_next_value (&parameters_iter);
+    guint64 start = g_variant_get_uint64 (variant1);
+    g_autoptr (GVariant) variant2 = g_variant_iter_next_value (&parameters_iter);
+    guint64 count = g_variant_get_uint64 (variant2);
+    guint64 length = g_paste_history_get_length (history);
+    guint64 end = (start < length) ? start + MIN (count, length - start) : start;
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sstxt)"));
+
+    for (guint64 i = start; i < end; ++i)
+        g_paste_daemon_add_item (&builder, priv->settings, g_paste_history_get (history, i), i);
+
+    GVariant *variant = g_variant_builder_end (&builder);
 
-    GVariant *variant = g_variant_new_uint64 (size);
     return g_variant_new_tuple (&variant, 1);
 }
 
@@ -532,15 +817,46 @@ g_paste_daemon_private_get_raw_element (GPasteDaemonPrivate *priv,
     return g_variant_new_tuple (&variant, 1);
 }
 
+/* The value is sent as a sealed memory file instead of being copied in the message */
+static void
+g_paste_daemon_private_get_raw_element_fd (GPasteDaemonPrivate   *priv,
+                                           GVariant              *parameters,
+                                           GDBusMethodInvocation *invocation)
+{
+    GPasteHistory *history = priv->history;
+    guint64 index = g_paste_daemon_get_dbus_uint64_parameter (parameters);
+    const gchar *value = (index < g_paste_history_get_length (history)) ? g_paste_history_get_value (history, index) : NULL;
+
+    if (!value)
+    {
+        g_dbus_method_invocation_return_dbus_error (invocation, G_PASTE_BUS_NAME ".Error", "invalid index received");
+        return;
+    }
+
+    GError *error = NULL;
+    gint fd = g_paste_memfd_new ("gpaste-element", value, strlen (value), FALSE, &error);
+
+    if (fd < 0)
+    {
+        g_dbus_method_invocation_take_error (invocation, error);
+        return;
+    }
+
+    GUnixFDList *fd_list = g_unix_fd_list_new_from_array (&fd, 1); /* takes fd */
+
+    g_dbus_method_invocation_return_value_with_unix_fd_list (invocation, g_variant_new ("(h)", 0), fd_list);
+    g_object_unref (fd_list);
+}
+
 static GVariant *
 g_paste_daemon_private_get_raw_history (GPasteDaemonPrivate *priv)
 {
-    const GList *history = g_paste_history_get_history (priv->history);
-    guint64 length = g_list_length ((GList *) history);
+    GPasteHistory *history = priv->history;
+    guint64 length = g_paste_history_get_length (history);
     g_autofree const gchar **displayed_history = g_new (const gchar *, length + 1);
 
-    for (guint64 i = 0; i < length; ++i, history = g_list_next (history))
-        displayed_history[i] = g_paste_item_get_value (history->data);
+    for (guint64 i = 0; i < length; ++i)
+        displayed_history[i] = g_paste_history_get_value (history, i);
     displayed_history[length] = NULL;
 
     GVariant *variant = g_variant_new_strv ((const gchar * const *) displayed_history, -1);
@@ -561,6 +877,34 @@ g_paste_daemon_list_histories (GError **error)
     return g_variant_new_tuple (&variant, 1);
 }
 
+static GVariant *
+g_paste_daemon_private_list_histories_info (GPasteDaemonPrivate *priv,
+                                            GError             **error)
+{
+    g_auto (GStrv) history_names = g_paste_history_list (error);
+
+    if (!history_names)
+        return NULL;
+
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sttxs)"));
+
+    for (GStrv h = history_names; *h; ++h)
+    {
+        g_autofree gchar *preview = NULL;
+        guint64 length, size;
+        gint64 modified;
+
+        if (g_paste_history_get_info (priv->history, *h, &length, &size, &modified, &preview))
+            g_variant_builder_add (&builder, "(sttxs)", *h, length, size, modified, (preview) ? preview : "");
+    }
+
+    GVariant *variant = g_variant_builder_end (&builder);
+
+    return g_variant_new_tuple (&variant, 1);
+}
+
 static void
 g_paste_daemon_private_merge (GPasteDaemonPrivate *priv,
                               GVariant            *parameters,
@@ -664,6 +1008,94 @@ g_paste_daemon_private_search (GPasteDaemonPrivate *priv,
     return g_variant_new_tuple (&variant, 1);
 }
 
+static void
+g_paste_daemon_private_on_search_all_ready (GObject      *source_object,
+                                            GAsyncResult *res,
+                                            gpointer      user_data)
+{
+    GDBusMethodInvocation *invocation = user_data;
+    GError *error = NULL;
+    GVariant *results = g_paste_history_search_all_finish (G_PASTE_HISTORY (source_object), res, &error);
+
+    if (!results)
+    {
+        g_dbus_method_invocation_take_error (invocation, error);
+        return;
+    }
+
+    g_dbus_method_invocation_return_value (invocation, g_variant_new_tuple (&results, 1));
+    g_variant_unref (results);
+}
+
+/*
+ * This one answers asynchronously, once all the histories have been searched,
+ * each of them being sent through SearchAllResult as soon as it's done.
+ */
+static void
+g_paste_daemon_private_search_all (GPasteDaemonPrivate   *priv,
+                                   GVariant              *parameters,
+                                   GDBusMethodInvocation *invocation)
+{
+    g_autofree gchar *query = g_paste_daemon_get_dbus_string_parameter (parameters, NULL);
+
+    g_paste_history_search_all (priv->history, query, g_paste_daemon_private_on_search_all_ready, invocation);
+}
+
+/*
+ * The token is the version of the history the results belong to:
+ * they can only be refined while it doesn't change.
+ */
+static GVariant *
+g_paste_daemon_private_search_answer (GPasteDaemonPrivate *priv,
+                                      GArray              *results)
+{
+    GVariant *answer[] = {
+        g_variant_new_uint64 (g_paste_history_get_version (priv->history)),
+        g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                   (results) ? results->data : NULL,
+                                   (results) ? results->len : 0,
+                                   sizeof (guint64))
+    };
+
+    if (results)
+        g_array_unref (results);
+
+    return g_variant_new_tuple (answer, 2);
+}
+
+static GVariant *
+g_paste_daemon_private_start_search (GPasteDaemonPrivate *priv,
+                                     GVariant            *parameters)
+{
+    g_autofree gchar *query = g_paste_daemon_get_dbus_string_parameter (parameters, NULL);
+
+    return g_paste_daemon_private_search_answer (priv, g_paste_history_search (priv->history, query));
+}
+
+static GVariant *
+g_paste_daemon_private_refine_search (GPasteDaemonPrivate *priv,
+                                      GVariant            *parameters)
+{
+    g_autoptr (GVariant) previous_results = NULL;
+    guint64 token;
+    const gchar *previous_query;
+    const gchar *query;
+
+    g_variant_get (parameters, "(t&s@at&s)", &token, &previous_query, &previous_results, &query);
+
+    if (token != g_paste_history_get_version (priv->history))
+        return g_paste_daemon_private_search_answer (priv, g_paste_history_search (priv->history, query));
+
+    guint64 n_previous_results;
+    const guint64 *previous = g_variant_get_fixed_array (previous_results, &n_previous_results, sizeof (guint64));
+
+    return g_paste_daemon_private_search_answer (priv, g_paste_history_refine_search (priv->history,
+                                                                                      previous_query,
+                                                                                      previous,
+                                                                                      n_previous_results,
+                                                                                      query));
+}
+
 static void
 g_paste_daemon_private_select (GPasteDaemonPrivate *priv,
                                GVariant            *parameters)
@@ -838,6 +1270,11 @@ g_paste_daemon_dbus_method_call (GDBusConnection       *connection     G_GNUC_UN
         g_paste_util_activate_ui ("about", NULL);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_ADD))
         g_paste_daemon_private_add (priv, parameters, &err);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_ADD_FD))
+    {
+        g_paste_daemon_private_add_fd (self, parameters, invocation);
+        return;
+    }
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_ADD_FILE))
         g_paste_daemon_private_add_file (priv, parameters, &error, &err);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_ADD_PASSWORD))
@@ -864,30 +1301,48 @@ g_paste_daemon_dbus_method_call (GDBusConnection       *connection     G_GNUC_UN
         answer = g_paste_daemon_private_get_history_name (priv);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_GET_HISTORY_SIZE))
         answer = g_paste_daemon_private_get_history_size (priv, parameters);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_GET_ITEMS_PAGE))
+        answer = g_paste_daemon_private_get_items_page (priv, parameters);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_GET_RAW_ELEMENT))
         answer = g_paste_daemon_private_get_raw_element (priv, parameters, &err);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_GET_RAW_ELEMENT_FD))
+    {
+        g_paste_daemon_private_get_raw_element_fd (priv, parameters, invocation);
+        return;
+    }
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_GET_RAW_HISTORY))
         answer = g_paste_daemon_private_get_raw_history (priv);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_LIST_HISTORIES))
         answer = g_paste_daemon_list_histories (&error);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_LIST_HISTORIES_INFO))
+        answer = g_paste_daemon_private_list_histories_info (priv, &error);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_MERGE))
         g_paste_daemon_private_merge (priv, parameters, &err);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_ON_EXTENSION_STATE_CHANGED))
         g_paste_daemon_on_extension_state_changed (self, parameters);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_REEXECUTE))
         g_paste_daemon_reexecute (self);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_REFINE_SEARCH))
+        answer = g_paste_daemon_private_refine_search (priv, parameters);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_RENAME_PASSWORD))
         g_paste_daemon_private_rename_password (priv, parameters, &err);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_REPLACE))
         g_paste_daemon_private_replace (priv, parameters, &err);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_SEARCH))
         answer = g_paste_daemon_private_search (priv, parameters);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_SEARCH_ALL))
+    {
+        g_paste_daemon_private_search_all (priv, parameters, invocation);
+        return;
+    }
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_SELECT))
         g_paste_daemon_private_select (priv, parameters);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_SET_PASSWORD))
         g_paste_daemon_private_set_password (priv, parameters, &err);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_SHOW_HISTORY))
         g_paste_daemon_show_history (self, &error);
+    else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_START_SEARCH))
+        answer = g_paste_daemon_private_start_search (priv, parameters);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_SWITCH_HISTORY))
         g_paste_daemon_private_switch_history (priv, parameters, &err);
     else if (!g_strcmp0 (method_name, G_PASTE_DAEMON_TRACK))
@@ -930,8 +1385,11 @@ g_paste_daemon_unregister_object (gpointer user_data)
     gulong *c_signals = priv->c_signals;
 
     g_signal_handler_disconnect (priv->settings, c_signals[C_TRACK]);
+    g_signal_handler_disconnect (priv->settings, c_signals[C_ELEMENT_SIZE]);
+    g_signal_handler_disconnect (priv->history,  c_signals[C_DELTA]);
     g_signal_handler_disconnect (priv->history,  c_signals[C_UPDATE]);
     g_signal_handler_disconnect (priv->history,  c_signals[C_SWITCH]);
+    g_signal_handler_disconnect (priv->history,  c_signals[C_SEARCHED]);
 
     if (priv->screensaver)
         g_signal_handler_disconnect (priv->screensaver,  c_signals[C_ACTIVE_CHANGED]);
@@ -949,6 +1407,18 @@ g_paste_daemon_on_history_update (GPasteDaemon      *self,
     g_paste_daemon_update (self, action, target, position);
 }
 
+static void
+g_paste_daemon_on_history_delta (GPasteDaemon      *self,
+                                 guint64            version,
+                                 GPasteUpdateAction action,
+                                 GPasteUpdateTarget target,
+                                 guint64            position,
+                                 GPasteItem        *item,
+                                 gpointer           user_data G_GNUC_UNUSED)
+{
+    g_paste_daemon_delta (self, version, action, target, position, item);
+}
+
 static void
 g_paste_daemon_on_history_switch (GPasteDaemonPrivate *priv,
                                   const gchar         *name,
@@ -957,6 +1427,24 @@ g_paste_daemon_on_history_switch (GPasteDaemonPrivate *priv,
     g_paste_daemon_private_switch_history_signal (priv, name);
 }
 
+static void
+g_paste_daemon_on_history_searched (GPasteDaemonPrivate *priv,
+                                    const gchar         *query,
+                                    GVariant            *result,
+                                    gpointer             user_data G_GNUC_UNUSED)
+{
+    GVariant *data[3] = {
+        g_variant_new_string (query),
+        g_variant_get_child_value (result, 0),
+        g_variant_get_child_value (result, 1)
+    };
+
+    G_PASTE_SEND_DBUS_SIGNAL_FULL (SEARCH_ALL_RESULT, g_variant_new_tuple (data, 3), NULL);
+
+    g_variant_unref (data[1]);
+    g_variant_unref (data[2]);
+}
+
 static void
 g_paste_daemon_on_screensaver_active_changed (GPasteDaemonPrivate *priv,
                                               gboolean             active,
@@ -986,11 +1474,23 @@ _g_paste_daemon_changed (gpointer data)
 {
     GPasteDaemon *self = G_PASTE_DAEMON (data);
 
+    GPasteDaemonPrivate *priv = g_paste_daemon_get_instance_private (self);
+
     g_paste_daemon_update (self, G_PASTE_UPDATE_ACTION_REPLACE, G_PASTE_UPDATE_TARGET_ALL, 0);
+    g_paste_daemon_delta (self, g_paste_history_get_version (priv->history), G_PASTE_UPDATE_ACTION_REPLACE, G_PASTE_UPDATE_TARGET_ALL, 0, NULL);
 
     return G_SOURCE_REMOVE;
 }
 
+static void
+g_paste_daemon_on_element_size_changed (GPasteDaemon *self,
+                                        const gchar  *key      G_GNUC_UNUSED,
+                                        gpointer      settings G_GNUC_UNUSED)
+{
+    /* The previews the clients have were cut to the old size */
+    _g_paste_daemon_changed (self);
+}
+
 static void
 g_paste_daemon_dispose (GObject *object)
 {
@@ -1038,6 +1538,14 @@ g_paste_daemon_register_on_connection (GPasteBusObject *self,
                                                    "track",
                                                    G_CALLBACK (g_paste_daemon_tracking),
                                                    self);
+    c_signals[C_ELEMENT_SIZE] = g_signal_connect_swapped (priv->settings,
+                                                          "changed::" G_PASTE_ELEMENT_SIZE_SETTING,
+                                                          G_CALLBACK (g_paste_daemon_on_element_size_changed),
+                                                          self);
+    c_signals[C_DELTA] = g_signal_connect_swapped (priv->history,
+                                                   "delta",
+                                                   G_CALLBACK (g_paste_daemon_on_history_delta),
+                                                   self);
     c_signals[C_UPDATE] = g_signal_connect_swapped (priv->history,
                                                     "update",
                                                     G_CALLBACK (g_paste_daemon_on_history_update),
@@ -1046,6 +1554,10 @@ g_paste_daemon_register_on_connection (GPasteBusObject *self,
                                                     "switch",
                                                     G_CALLBACK (g_paste_daemon_on_history_switch),
                                                     priv);
+    c_signals[C_SEARCHED] = g_signal_connect_swapped (priv->history,
+                                                      "searched",
+                                                      G_CALLBACK (g_paste_daemon_on_history_searched),
+                                                      priv);
     priv->registered = TRUE;
 
     g_source_set_name_by_id (g_timeout_add_seconds (1, _g_paste_daemon_changed, self), "[GPaste] Startup - changed");
@@ -1109,6 +1621,27 @@ on_shell_client_ready (GObject      *source_object G_GNUC_UNUSED,
     g_paste_daemon_activate_default_keybindings (self);
 }
 
+/* Pick up the history our previous instance handed off when reexecuting, if any */
+static gboolean
+g_paste_daemon_private_take_over (GPasteDaemonPrivate *priv)
+{
+    const gchar *handoff = g_getenv (G_PASTE_DAEMON_HANDOFF_FD_ENV);
+
+    if (!handoff)
+        return FALSE;
+
+    gchar *end = NULL;
+    gint64 fd = g_ascii_strtoll (handoff, &end, 10);
+
+    /* Don't pass it on to what we spawn */
+    g_unsetenv (G_PASTE_DAEMON_HANDOFF_FD_ENV);
+
+    if (*end || fd <= STDERR_FILENO || fd > G_MAXINT)
+        return FALSE;
+
+    return g_paste_history_take_over (priv->history, (gint) fd);
+}
+
 static void
 g_paste_daemon_init (GPasteDaemon *self)
 {
@@ -1134,7 +1667,8 @@ g_paste_daemon_init (GPasteDaemon *self)
     g_paste_clipboards_manager_add_clipboard (clipboards_manager, primary);
     g_paste_clipboards_manager_activate (clipboards_manager);
 
-    g_paste_history_load (history, NULL);
+    if (!g_paste_daemon_private_take_over (priv))
+        g_paste_history_load (history, NULL);
 
     g_paste_gnome_shell_client_new (on_shell_client_ready, self);
 }
@@ -30,8 +30,13 @@ G_BEGIN_DECLS
 
 #define G_PASTE_TYPE_DAEMON (g_paste_daemon_get_type ())
 
+/* Where a reexecuted daemon finds the history handed off by the previous one */
+#define G_PASTE_DAEMON_HANDOFF_FD_ENV "G_PASTE_DAEMON_HANDOFF_FD"
+
 G_PASTE_FINAL_TYPE (Daemon, daemon, DAEMON, GPasteBusObject)
 
+void g_paste_daemon_flush        (GPasteDaemon *self);
+gint g_paste_daemon_hand_off     (GPasteDaemon *self);
 void g_paste_daemon_show_history (GPasteDaemon *self,
                                   GError      **error);
 void g_paste_daemon_upload       (GPasteDaemon *self,
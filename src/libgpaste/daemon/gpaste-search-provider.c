@@ -17,6 +17,8 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-string.h"
+
 #include <gpaste-client.h>
 #include <gpaste-gdbus-defines.h>
 #include <gpaste-search-provider.h>
@@ -37,6 +39,13 @@ typedef struct
 
     GPasteClient        *client;
 
+    /* The last search, which the next one can refine */
+    gchar               *search;
+    guint64              search_token;
+    guint64             *search_results;
+    guint64              search_hits;
+    guint64              search_serial;
+
     GDBusNodeInfo       *g_paste_search_provider_dbus_info;
     GDBusInterfaceVTable g_paste_search_provider_dbus_vtable;
 } GPasteSearchProviderPrivate;
@@ -89,32 +98,58 @@ _g_paste_dbus_get_as_result_as_at (GVariant *parameters,
 /* DBus Mathods */
 /****************/
 
+typedef struct
+{
+    GPasteSearchProviderPrivate *priv;
+    GDBusMethodInvocation       *invocation;
+    gchar                       *search;
+    guint64                      serial;
+    gboolean                     refine;
+} SearchData;
+
 static void
 on_search_ready (GObject      *source_object G_GNUC_UNUSED,
                  GAsyncResult *res,
                  gpointer      user_data)
 {
-    g_autofree gpointer *data = (gpointer *) user_data;
-    GPasteClient *client = data[0];
-    GDBusMethodInvocation *invocation = data[1];
-    guint64 hits;
-    g_autofree guint64 *r = g_paste_client_search_finish (client,
-                                                          res,
-                                                          &hits,
-                                                          NULL); /* Error */
+    g_autofree SearchData *data = user_data;
+    GPasteSearchProviderPrivate *priv = data->priv;
+    guint64 token = 0;
+    guint64 hits = 0;
+    guint64 *r = (data->refine) ?
+        g_paste_client_refine_search_finish (priv->client, res, &token, &hits, NULL /* error */) :
+        g_paste_client_start_search_finish (priv->client, res, &token, &hits, NULL /* error */);
     g_auto (GStrv) results = g_new (char *, hits + 1);
 
     for (guint64 i = 0; i < hits; ++i)
         results[i] = g_strdup_printf ("%" G_GUINT64_FORMAT, r[i]);
     results[hits] = NULL;
 
+    /* Only remember the most recent search, an older one may come back last */
+    if (data->serial == priv->search_serial)
+    {
+        g_free (priv->search);
+        g_free (priv->search_results);
+        priv->search = data->search;
+        priv->search_token = token;
+        priv->search_results = r;
+        priv->search_hits = hits;
+    }
+    else
+    {
+        g_free (data->search);
+        g_free (r);
+    }
+
     GVariant *ans = g_variant_new_strv ((const char * const *) results, hits);
-    g_dbus_method_invocation_return_value (invocation, g_variant_new_tuple (&ans, 1));
+    g_dbus_method_invocation_return_value (data->invocation, g_variant_new_tuple (&ans, 1));
 }
 
 static gboolean
-_do_search (GPasteSearchProviderPrivate *priv G_GNUC_UNUSED,
+_do_search (GPasteSearchProviderPrivate *priv,
             gchar                       *search,
+            const guint64               *previous_results,
+            guint64                      n_previous_results,
             GDBusMethodInvocation       *invocation)
 {
     if (strlen (search) < 3 || !priv->client)
@@ -124,15 +159,37 @@ _do_search (GPasteSearchProviderPrivate *priv G_GNUC_UNUSED,
     }
     else
     {
-        gpointer *data = g_new (gpointer, 2);
-
-        data[0] = priv->client;
-        data[1] = invocation;
-
-        g_paste_client_search (priv->client,
-                               search,
-                               on_search_ready,
-                               data);
+        SearchData *data = g_new (SearchData, 1);
+
+        data->priv = priv;
+        data->invocation = invocation;
+        data->search = g_strdup (search);
+        data->serial = ++priv->search_serial;
+
+        /* Only refine what we know the previous results come from */
+        data->refine = (previous_results &&
+                        priv->search &&
+                        n_previous_results == priv->search_hits &&
+                        !memcmp (previous_results, priv->search_results, n_previous_results * sizeof (guint64)));
+
+        if (data->refine)
+        {
+            g_paste_client_refine_search (priv->client,
+                                          priv->search_token,
+                                          priv->search,
+                                          previous_results,
+                                          n_previous_results,
+                                          search,
+                                          on_search_ready,
+                                          data);
+        }
+        else
+        {
+            g_paste_client_start_search (priv->client,
+                                         search,
+                                         on_search_ready,
+                                         data);
+        }
     }
 
     return TRUE;
@@ -144,7 +201,7 @@ g_paste_search_provider_private_get_initial_result_set (GPasteSearchProviderPriv
                                                         GVariant                    *parameters)
 {
     g_autofree gchar *search = _g_paste_dbus_get_as_result (parameters);
-    return _do_search (priv, search, invocation);
+    return _do_search (priv, search, NULL, 0, invocation);
 }
 
 static gboolean
@@ -152,6 +209,8 @@ g_paste_search_provider_private_get_subsearch_result_set (GPasteSearchProviderPr
                                                           GDBusMethodInvocation       *invocation,
                                                           GVariant                    *parameters)
 {
+    guint64 n_previous_results;
+    g_autofree guint64 *previous_results = _g_paste_dbus_get_as_result_as_at (parameters, &n_previous_results);
     GVariantIter parameters_iter;
 
     g_variant_iter_init (&parameters_iter, parameters);
@@ -160,7 +219,7 @@ g_paste_search_provider_private_get_subsearch_result_set (GPasteSearchProviderPr
     g_autoptr (GVariant) variant = g_variant_iter_next_value (&parameters_iter);
     g_autofree gchar *search = g_paste_dbus_get_as_result (variant);
 
-    return _do_search (priv, search, invocation);
+    return _do_search (priv, search, previous_results, n_previous_results, invocation);
 }
 
 static void
@@ -199,7 +258,7 @@ on_elements_ready (GObject      *source_object G_GNUC_UNUSED,
     {
         g_auto (GVariantBuilder) dict;
         g_autofree gchar *index = g_strdup_printf ("%" G_GUINT64_FORMAT, indexes[i]);
-        g_autofree gchar *result = g_paste_util_replace (results[i], "\n", " ");
+        g_autofree gchar *result = g_paste_string_flatten (results[i]);
 
         g_variant_builder_init (&dict, G_VARIANT_TYPE_VARDICT);
 
@@ -325,6 +384,9 @@ g_paste_search_provider_dispose (GObject *object)
         g_clear_object (&priv->client);
     }
 
+    g_clear_pointer (&priv->search, g_free);
+    g_clear_pointer (&priv->search_results, g_free);
+
     G_OBJECT_CLASS (g_paste_search_provider_parent_class)->dispose (object);
 }
 
@@ -365,6 +427,10 @@ on_client_ready (GObject      *source_object G_GNUC_UNUSED,
 
     priv->client = g_paste_client_new_finish (res,
                                               NULL); /* Error */
+
+    /* The shell asks for the same items over and over while typing */
+    if (priv->client)
+        g_paste_client_set_cache_enabled (priv->client, TRUE);
 }
 
 static void
@@ -35,6 +35,7 @@ G_BEGIN_DECLS
 
 #define G_PASTE_DAEMON_ABOUT                      "About"
 #define G_PASTE_DAEMON_ADD                        "Add"
+#define G_PASTE_DAEMON_ADD_FD                     "AddFd"
 #define G_PASTE_DAEMON_ADD_FILE                   "AddFile"
 #define G_PASTE_DAEMON_ADD_PASSWORD               "AddPassword"
 #define G_PASTE_DAEMON_BACKUP_HISTORY             "BackupHistory"
@@ -48,28 +49,36 @@ G_BEGIN_DECLS
 #define G_PASTE_DAEMON_GET_HISTORY                "GetHistory"
 #define G_PASTE_DAEMON_GET_HISTORY_NAME           "GetHistoryName"
 #define G_PASTE_DAEMON_GET_HISTORY_SIZE           "GetHistorySize"
+#define G_PASTE_DAEMON_GET_ITEMS_PAGE             "GetItemsPage"
 #define G_PASTE_DAEMON_GET_RAW_ELEMENT            "GetRawElement"
+#define G_PASTE_DAEMON_GET_RAW_ELEMENT_FD         "GetRawElementFd"
 #define G_PASTE_DAEMON_GET_RAW_HISTORY            "GetRawHistory"
 #define G_PASTE_DAEMON_LIST_HISTORIES             "ListHistories"
+#define G_PASTE_DAEMON_LIST_HISTORIES_INFO        "ListHistoriesInfo"
 #define G_PASTE_DAEMON_MERGE                      "Merge"
 #define G_PASTE_DAEMON_ON_EXTENSION_STATE_CHANGED "OnExtensionStateChanged"
 #define G_PASTE_DAEMON_REEXECUTE                  "Reexecute"
+#define G_PASTE_DAEMON_REFINE_SEARCH              "RefineSearch"
 #define G_PASTE_DAEMON_RENAME_PASSWORD            "RenamePassword"
 #define G_PASTE_DAEMON_REPLACE                    "Replace"
 #define G_PASTE_DAEMON_SEARCH                     "Search"
+#define G_PASTE_DAEMON_SEARCH_ALL                 "SearchAll"
 #define G_PASTE_DAEMON_SELECT                     "Select"
 #define G_PASTE_DAEMON_SET_PASSWORD               "SetPassword"
 #define G_PASTE_DAEMON_SHOW_HISTORY               "ShowHistory"
+#define G_PASTE_DAEMON_START_SEARCH               "StartSearch"
 #define G_PASTE_DAEMON_SWITCH_HISTORY             "SwitchHistory"
 #define G_PASTE_DAEMON_TRACK                      "Track"
 #define G_PASTE_DAEMON_UPLOAD                     "Upload"
 
-#define G_PASTE_DAEMON_SIG_DELETE_HISTORY "DeleteHistory"
-#define G_PASTE_DAEMON_SIG_EMPTY_HISTORY  "EmptyHistory"
-#define G_PASTE_DAEMON_SIG_SHOW_HISTORY   "ShowHistory"
-#define G_PASTE_DAEMON_SIG_SWITCH_HISTORY "SwitchHistory"
-#define G_PASTE_DAEMON_SIG_TRACKING       "Tracking"
-#define G_PASTE_DAEMON_SIG_UPDATE         "Update"
+#define G_PASTE_DAEMON_SIG_DELETE_HISTORY    "DeleteHistory"
+#define G_PASTE_DAEMON_SIG_DELTA             "Delta"
+#define G_PASTE_DAEMON_SIG_EMPTY_HISTORY     "EmptyHistory"
+#define G_PASTE_DAEMON_SIG_SEARCH_ALL_RESULT "SearchAllResult"
+#define G_PASTE_DAEMON_SIG_SHOW_HISTORY      "ShowHistory"
+#define G_PASTE_DAEMON_SIG_SWITCH_HISTORY    "SwitchHistory"
+#define G_PASTE_DAEMON_SIG_TRACKING          "Tracking"
+#define G_PASTE_DAEMON_SIG_UPDATE            "Update"
 
 #define G_PASTE_DAEMON_PROP_ACTIVE  "Active"
 #define G_PASTE_DAEMON_PROP_VERSION "Version"
@@ -81,6 +90,9 @@ G_BEGIN_DECLS
         "  <method name='" G_PASTE_DAEMON_ADD "'>"                        \
         "   <arg type='s' direction='in' name='text' />"                  \
         "  </method>"                                                     \
+        "  <method name='" G_PASTE_DAEMON_ADD_FD "'>"                     \
+        "   <arg type='h' direction='in' name='fd' />"                    \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_ADD_FILE "'>"                   \
         "   <arg type='s' direction='in' name='file' />"                  \
         "  </method>"                                                     \
@@ -126,16 +138,28 @@ G_BEGIN_DECLS
         "   <arg type='s' direction='in' name='name'  />"                 \
         "   <arg type='t' direction='out' name='size' />"                 \
         "  </method>"                                                     \
+        "  <method name='" G_PASTE_DAEMON_GET_ITEMS_PAGE "'>"             \
+        "   <arg type='t'        direction='in'  name='start' />"         \
+        "   <arg type='t'        direction='in'  name='count' />"         \
+        "   <arg type='a(sstxt)' direction='out' name='items' />"         \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_GET_RAW_ELEMENT "'>"            \
         "   <arg type='t' direction='in'  name='index' />"                \
         "   <arg type='s' direction='out' name='value' />"                \
         "  </method>"                                                     \
+        "  <method name='" G_PASTE_DAEMON_GET_RAW_ELEMENT_FD "'>"         \
+        "   <arg type='t' direction='in'  name='index' />"                \
+        "   <arg type='h' direction='out' name='fd'    />"                \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_GET_RAW_HISTORY "'>"            \
         "   <arg type='as' direction='out' name='history' />"             \
         "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_LIST_HISTORIES "'>"             \
         "   <arg type='as' direction='out' name='histories' />"           \
         "  </method>"                                                     \
+        "  <method name='" G_PASTE_DAEMON_LIST_HISTORIES_INFO "'>"        \
+        "   <arg type='a(sttxs)' direction='out' name='histories' />"     \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_MERGE "'>"                      \
         "   <arg type='s' direction='in'  name='decoration' />"           \
         "   <arg type='s' direction='in'  name='separator'  />"           \
@@ -145,6 +169,14 @@ G_BEGIN_DECLS
         "   <arg type='b' direction='in' name='extension-state' />"       \
         "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_REEXECUTE "' />"                \
+        "  <method name='" G_PASTE_DAEMON_REFINE_SEARCH "'>"              \
+        "   <arg type='t'  direction='in'  name='token'            />"    \
+        "   <arg type='s'  direction='in'  name='previous-query'   />"    \
+        "   <arg type='at' direction='in'  name='previous-results' />"    \
+        "   <arg type='s'  direction='in'  name='query'            />"    \
+        "   <arg type='t'  direction='out' name='new-token'        />"    \
+        "   <arg type='at' direction='out' name='results'          />"    \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_RENAME_PASSWORD "'>"            \
         "   <arg type='s' direction='in' name='old-name' />"              \
         "   <arg type='s' direction='in' name='new-name' />"              \
@@ -157,6 +189,10 @@ G_BEGIN_DECLS
         "   <arg type='s' direction='in'   name='query'   />"             \
         "   <arg type='at' direction='out' name='results' />"             \
         "  </method>"                                                     \
+        "  <method name='" G_PASTE_DAEMON_SEARCH_ALL "'>"                 \
+        "   <arg type='s'         direction='in'  name='query'   />"      \
+        "   <arg type='a(sa(ts))' direction='out' name='results' />"      \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_SELECT "'>"                     \
         "   <arg type='t' direction='in' name='index' />"                 \
         "  </method>"                                                     \
@@ -165,6 +201,11 @@ G_BEGIN_DECLS
         "   <arg type='s' direction='in' name='name'  />"                 \
         "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_SHOW_HISTORY "' />"             \
+        "  <method name='" G_PASTE_DAEMON_START_SEARCH "'>"               \
+        "   <arg type='s'  direction='in'  name='query'   />"             \
+        "   <arg type='t'  direction='out' name='token'   />"             \
+        "   <arg type='at' direction='out' name='results' />"             \
+        "  </method>"                                                     \
         "  <method name='" G_PASTE_DAEMON_SWITCH_HISTORY "'>"             \
         "   <arg type='s' direction='in' name='name' />"                  \
         "  </method>"                                                     \
@@ -177,9 +218,21 @@ G_BEGIN_DECLS
         "  <signal name='" G_PASTE_DAEMON_SIG_DELETE_HISTORY "'>"         \
         "   <arg type='s' direction='out' name='history' />"              \
         "  </signal>"                                                     \
+        "  <signal name='" G_PASTE_DAEMON_SIG_DELTA "'>"                  \
+        "   <arg type='t'        direction='out' name='version' />"       \
+        "   <arg type='s'        direction='out' name='action'  />"       \
+        "   <arg type='s'        direction='out' name='target'  />"       \
+        "   <arg type='t'        direction='out' name='index'   />"       \
+        "   <arg type='a(sstxt)' direction='out' name='item'    />"       \
+        "  </signal>"                                                     \
         "  <signal name='" G_PASTE_DAEMON_SIG_EMPTY_HISTORY "'>"          \
         "   <arg type='s' direction='out' name='history' />"              \
         "  </signal>"                                                     \
+        "  <signal name='" G_PASTE_DAEMON_SIG_SEARCH_ALL_RESULT "'>"      \
+        "   <arg type='s'     direction='out' name='query'   />"          \
+        "   <arg type='s'     direction='out' name='history' />"          \
+        "   <arg type='a(ts)' direction='out' name='results' />"          \
+        "  </signal>"                                                     \
         "  <signal name='" G_PASTE_DAEMON_SIG_SHOW_HISTORY "' />"         \
         "  <signal name='" G_PASTE_DAEMON_SIG_SWITCH_HISTORY "'>"         \
         "   <arg type='s' direction='out' name='history' />"              \
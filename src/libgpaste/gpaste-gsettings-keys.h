@@ -32,8 +32,11 @@ G_BEGIN_DECLS
 #define G_PASTE_SHELL_SETTINGS_NAME "org.gnome.shell"
 
 #define G_PASTE_ELEMENT_SIZE_SETTING               "element-size"
+#define G_PASTE_EVICTION_POLICY_SETTING            "eviction-policy"
 #define G_PASTE_GROWING_LINES_SETTING              "growing-lines"
+#define G_PASTE_HISTORY_FORMAT_SETTING             "history-format"
 #define G_PASTE_HISTORY_NAME_SETTING               "history-name"
+#define G_PASTE_IMAGE_COMPRESSION_SETTING          "image-compression"
 #define G_PASTE_IMAGES_SUPPORT_SETTING             "images-support"
 #define G_PASTE_LAUNCH_UI_SETTING                  "launch-ui"
 #define G_PASTE_MAKE_PASSWORD_SETTING              "make-password"
@@ -45,6 +48,7 @@ G_BEGIN_DECLS
 #define G_PASTE_POP_SETTING                        "pop"
 #define G_PASTE_PRIMARY_TO_HISTORY_SETTING         "primary-to-history"
 #define G_PASTE_SAVE_HISTORY_SETTING               "save-history"
+#define G_PASTE_SAVE_HISTORY_DELAY_SETTING         "save-history-delay"
 #define G_PASTE_SHOW_HISTORY_SETTING               "show-history"
 #define G_PASTE_SYNC_CLIPBOARD_TO_PRIMARY_SETTING  "sync-clipboard-to-primary"
 #define G_PASTE_SYNC_PRIMARY_TO_CLIPBOARD_SETTING  "sync-primary-to-clipboard"
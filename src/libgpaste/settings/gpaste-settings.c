@@ -32,8 +32,11 @@ typedef struct
     GSettings *shell_settings;
 
     guint64    element_size;
+    gchar     *eviction_policy;
     gboolean   growing_lines;
+    gchar     *history_format;
     gchar     *history_name;
+    guint64    image_compression;
     gboolean   images_support;
     gchar     *launch_ui;
     gchar     *make_password;
@@ -45,6 +48,7 @@ typedef struct
     gchar     *pop;
     gboolean   primary_to_history;
     gboolean   save_history;
+    guint64    save_history_delay;
     gchar     *show_history;
     gchar     *sync_clipboard_to_primary;
     gchar     *sync_primary_to_clipboard;
@@ -175,6 +179,33 @@ g_settings_set_gpaste_uint64 (GSettings   *settings,
  */
 UNSIGNED_SETTING (element_size, ELEMENT_SIZE)
 
+/**
+ * g_paste_settings_get_eviction_policy:
+ * @self: a #GPasteSettings instance
+ *
+ * Get the "eviction-policy" setting
+ *
+ * Returns: the value of the "eviction-policy" setting
+ */
+/**
+ * g_paste_settings_reset_eviction_policy:
+ * @self: a #GPasteSettings instance
+ *
+ * Reset the "eviction-policy" setting
+ *
+ * Returns:
+ */
+/**
+ * g_paste_settings_set_eviction_policy:
+ * @self: a #GPasteSettings instance
+ * @value: the new eviction policy
+ *
+ * Change the "eviction-policy" setting
+ *
+ * Returns:
+ */
+STRING_SETTING (eviction_policy, EVICTION_POLICY)
+
 /**
  * g_paste_settings_get_growing_lines:
  * @self: a #GPasteSettings instance
@@ -202,6 +233,33 @@ UNSIGNED_SETTING (element_size, ELEMENT_SIZE)
  */
 BOOLEAN_SETTING (growing_lines, GROWING_LINES)
 
+/**
+ * g_paste_settings_get_history_format:
+ * @self: a #GPasteSettings instance
+ *
+ * Get the "history-format" setting
+ *
+ * Returns: the value of the "history-format" setting
+ */
+/**
+ * g_paste_settings_reset_history_format:
+ * @self: a #GPasteSettings instance
+ *
+ * Reset the "history-format" setting
+ *
+ * Returns:
+ */
+/**
+ * g_paste_settings_set_history_format:
+ * @self: a #GPasteSettings instance
+ * @value: the new history format
+ *
+ * Change the "history-format" setting
+ *
+ * Returns:
+ */
+STRING_SETTING (history_format, HISTORY_FORMAT)
+
 /**
  * g_paste_settings_get_history_name:
  * @self: a #GPasteSettings instance
@@ -229,6 +287,33 @@ BOOLEAN_SETTING (growing_lines, GROWING_LINES)
  */
 STRING_SETTING (history_name, HISTORY_NAME)
 
+/**
+ * g_paste_settings_get_image_compression:
+ * @self: a #GPasteSettings instance
+ *
+ * Get the "image-compression" setting
+ *
+ * Returns: the value of the "image-compression" setting
+ */
+/**
+ * g_paste_settings_reset_image_compression:
+ * @self: a #GPasteSettings instance
+ *
+ * Reset the "image-compression" setting
+ *
+ * Returns:
+ */
+/**
+ * g_paste_settings_set_image_compression:
+ * @self: a #GPasteSettings instance
+ * @value: @value: the new compression level
+ *
+ * Change the "image-compression" setting
+ *
+ * Returns:
+ */
+UNSIGNED_SETTING (image_compression, IMAGE_COMPRESSION)
+
 /**
  * g_paste_settings_get_images_support:
  * @self: a #GPasteSettings instance
@@ -526,6 +611,33 @@ BOOLEAN_SETTING (primary_to_history, PRIMARY_TO_HISTORY)
  */
 BOOLEAN_SETTING (save_history, SAVE_HISTORY)
 
+/**
+ * g_paste_settings_get_save_history_delay:
+ * @self: a #GPasteSettings instance
+ *
+ * Get the "save-history-delay" setting
+ *
+ * Returns: the value of the "save-history-delay" setting
+ */
+/**
+ * g_paste_settings_reset_save_history_delay:
+ * @self: a #GPasteSettings instance
+ *
+ * Reset the "save-history-delay" setting
+ *
+ * Returns:
+ */
+/**
+ * g_paste_settings_set_save_history_delay:
+ * @self: a #GPasteSettings instance
+ * @value: the delay (in milliseconds) before saving the history
+ *
+ * Change the "save-history-delay" setting
+ *
+ * Returns:
+ */
+UNSIGNED_SETTING (save_history_delay, SAVE_HISTORY_DELAY)
+
 /**
  * g_paste_settings_get_show_history:
  * @self: a #GPasteSettings instance
@@ -863,12 +975,18 @@ g_paste_settings_settings_changed (GSettings   *settings G_GNUC_UNUSED,
 
     if (!g_strcmp0 (key, G_PASTE_ELEMENT_SIZE_SETTING))
         g_paste_settings_private_set_element_size_from_dconf (priv);
+    else if (!g_strcmp0 (key, G_PASTE_EVICTION_POLICY_SETTING))
+        g_paste_settings_private_set_eviction_policy_from_dconf (priv);
     else if (!g_strcmp0 (key, G_PASTE_GROWING_LINES_SETTING))
         g_paste_settings_private_set_growing_lines_from_dconf (priv);
+    else if (!g_strcmp0 (key, G_PASTE_HISTORY_FORMAT_SETTING))
+        g_paste_settings_private_set_history_format_from_dconf (priv);
     else if (!g_strcmp0 (key, G_PASTE_HISTORY_NAME_SETTING))
         g_paste_settings_private_set_history_name_from_dconf (priv);
     else if (!g_strcmp0 (key, G_PASTE_IMAGES_SUPPORT_SETTING))
         g_paste_settings_private_set_images_support_from_dconf (priv);
+    else if (!g_strcmp0 (key, G_PASTE_IMAGE_COMPRESSION_SETTING))
+        g_paste_settings_private_set_image_compression_from_dconf (priv);
     else if (!g_strcmp0 (key, G_PASTE_LAUNCH_UI_SETTING))
     {
         g_paste_settings_private_set_launch_ui_from_dconf (priv);
@@ -898,6 +1016,8 @@ g_paste_settings_settings_changed (GSettings   *settings G_GNUC_UNUSED,
         g_paste_settings_private_set_primary_to_history_from_dconf (priv);
     else if (!g_strcmp0 (key, G_PASTE_SAVE_HISTORY_SETTING))
         g_paste_settings_private_set_save_history_from_dconf (priv);
+    else if (!g_strcmp0 (key, G_PASTE_SAVE_HISTORY_DELAY_SETTING))
+        g_paste_settings_private_set_save_history_delay_from_dconf (priv);
     else if (!g_strcmp0 (key, G_PASTE_SHOW_HISTORY_SETTING))
     {
         g_paste_settings_private_set_show_history_from_dconf (priv);
@@ -969,6 +1089,8 @@ g_paste_settings_finalize (GObject *object)
 {
     GPasteSettingsPrivate *priv = g_paste_settings_get_instance_private (G_PASTE_SETTINGS (object));
 
+    g_free (priv->eviction_policy);
+    g_free (priv->history_format);
     g_free (priv->history_name);
     g_free (priv->launch_ui);
     g_free (priv->make_password);
@@ -1036,6 +1158,8 @@ g_paste_settings_init (GPasteSettings *self)
     GPasteSettingsPrivate *priv = g_paste_settings_get_instance_private (self);
     GSettings *settings = priv->settings = g_settings_new (G_PASTE_SETTINGS_NAME);
 
+    priv->eviction_policy = NULL;
+    priv->history_format = NULL;
     priv->history_name = NULL;
     priv->launch_ui = NULL;
     priv->make_password = NULL;
@@ -1051,8 +1175,11 @@ g_paste_settings_init (GPasteSettings *self)
                                              self);
 
     g_paste_settings_private_set_element_size_from_dconf (priv);
+    g_paste_settings_private_set_eviction_policy_from_dconf (priv);
     g_paste_settings_private_set_growing_lines_from_dconf (priv);
+    g_paste_settings_private_set_history_format_from_dconf (priv);
     g_paste_settings_private_set_history_name_from_dconf (priv);
+    g_paste_settings_private_set_image_compression_from_dconf (priv);
     g_paste_settings_private_set_images_support_from_dconf (priv);
     g_paste_settings_private_set_launch_ui_from_dconf (priv);
     g_paste_settings_private_set_make_password_from_dconf (priv);
@@ -1064,6 +1191,7 @@ g_paste_settings_init (GPasteSettings *self)
     g_paste_settings_private_set_pop_from_dconf (priv);
     g_paste_settings_private_set_primary_to_history_from_dconf (priv);
     g_paste_settings_private_set_save_history_from_dconf (priv);
+    g_paste_settings_private_set_save_history_delay_from_dconf (priv);
     g_paste_settings_private_set_show_history_from_dconf (priv);
     g_paste_settings_private_set_sync_clipboard_to_primary_from_dconf (priv);
     g_paste_settings_private_set_sync_primary_to_clipboard_from_dconf (priv);
@@ -33,8 +33,11 @@ G_BEGIN_DECLS
 G_PASTE_FINAL_TYPE (Settings, settings, SETTINGS, GObject)
 
 guint64      g_paste_settings_get_element_size               (const GPasteSettings *self);
+const gchar *g_paste_settings_get_eviction_policy            (const GPasteSettings *self);
 gboolean     g_paste_settings_get_growing_lines              (const GPasteSettings *self);
+const gchar *g_paste_settings_get_history_format             (const GPasteSettings *self);
 const gchar *g_paste_settings_get_history_name               (const GPasteSettings *self);
+guint64      g_paste_settings_get_image_compression          (const GPasteSettings *self);
 gboolean     g_paste_settings_get_images_support             (const GPasteSettings *self);
 const gchar *g_paste_settings_get_launch_ui                  (const GPasteSettings *self);
 const gchar *g_paste_settings_get_make_password              (const GPasteSettings *self);
@@ -46,6 +49,7 @@ guint64      g_paste_settings_get_min_text_item_size         (const GPasteSettin
 const gchar *g_paste_settings_get_pop                        (const GPasteSettings *self);
 gboolean     g_paste_settings_get_primary_to_history         (const GPasteSettings *self);
 gboolean     g_paste_settings_get_save_history               (const GPasteSettings *self);
+guint64      g_paste_settings_get_save_history_delay         (const GPasteSettings *self);
 const gchar *g_paste_settings_get_show_history               (const GPasteSettings *self);
 const gchar *g_paste_settings_get_sync_clipboard_to_primary  (const GPasteSettings *self);
 const gchar *g_paste_settings_get_sync_primary_to_clipboard  (const GPasteSettings *self);
@@ -56,8 +60,11 @@ gboolean     g_paste_settings_get_trim_items                 (const GPasteSettin
 const gchar *g_paste_settings_get_upload                     (const GPasteSettings *self);
 
 void g_paste_settings_reset_element_size               (GPasteSettings *self);
+void g_paste_settings_reset_eviction_policy            (GPasteSettings *self);
 void g_paste_settings_reset_growing_lines              (GPasteSettings *self);
+void g_paste_settings_reset_history_format             (GPasteSettings *self);
 void g_paste_settings_reset_history_name               (GPasteSettings *self);
+void g_paste_settings_reset_image_compression          (GPasteSettings *self);
 void g_paste_settings_reset_images_support             (GPasteSettings *self);
 void g_paste_settings_reset_launch_ui                  (GPasteSettings *self);
 void g_paste_settings_reset_make_password              (GPasteSettings *self);
@@ -69,6 +76,7 @@ void g_paste_settings_reset_min_text_item_size         (GPasteSettings *self);
 void g_paste_settings_reset_pop                        (GPasteSettings *self);
 void g_paste_settings_reset_primary_to_history         (GPasteSettings *self);
 void g_paste_settings_reset_save_history               (GPasteSettings *self);
+void g_paste_settings_reset_save_history_delay         (GPasteSettings *self);
 void g_paste_settings_reset_show_history               (GPasteSettings *self);
 void g_paste_settings_reset_sync_clipboard_to_primary  (GPasteSettings *self);
 void g_paste_settings_reset_sync_primary_to_clipboard  (GPasteSettings *self);
@@ -80,10 +88,16 @@ void g_paste_settings_reset_upload                     (GPasteSettings *self);
 
 void g_paste_settings_set_element_size               (GPasteSettings *self,
                                                       guint64         value);
+void g_paste_settings_set_eviction_policy            (GPasteSettings *self,
+                                                      const gchar    *value);
 void g_paste_settings_set_growing_lines              (GPasteSettings *self,
                                                       gboolean        value);
+void g_paste_settings_set_history_format             (GPasteSettings *self,
+                                                      const gchar    *value);
 void g_paste_settings_set_history_name               (GPasteSettings *self,
                                                       const gchar    *value);
+void g_paste_settings_set_image_compression          (GPasteSettings *self,
+                                                      guint64         value);
 void g_paste_settings_set_images_support             (GPasteSettings *self,
                                                       gboolean        value);
 void g_paste_settings_set_launch_ui                  (GPasteSettings *self,
@@ -106,6 +120,8 @@ void g_paste_settings_set_primary_to_history         (GPasteSettings *self,
                                                       gboolean        value);
 void g_paste_settings_set_save_history               (GPasteSettings *self,
                                                       gboolean        value);
+void g_paste_settings_set_save_history_delay         (GPasteSettings *self,
+                                                      guint64         value);
 void g_paste_settings_set_show_history               (GPasteSettings *self,
                                                       const gchar    *value);
 void g_paste_settings_set_sync_clipboard_to_primary  (GPasteSettings *self,
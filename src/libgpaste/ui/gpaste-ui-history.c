@@ -41,13 +41,23 @@ typedef struct
     guint64         size;
     gint32          item_height;
 
+    /* Mirror of the displayed items, kept up to date with the deltas */
+    GPtrArray      *page;
+    gchar          *name;
+    guint64         length;
+    guint64         version;
+
     gchar          *search;
+    /* The pattern and token of the search the results come from */
+    gchar          *searched;
+    guint64         search_token;
     guint64        *search_results;
     guint64         search_results_size;
+    guint64         search_serial;
 
     gulong          activated_id;
+    gulong          delta_id;
     gulong          size_id;
-    gulong          update_id;
 } GPasteUiHistoryPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GPasteUiHistory, g_paste_ui_history, GTK_TYPE_LIST_BOX)
@@ -98,8 +108,7 @@ g_paste_ui_history_drop_list (GtkContainer *self,
     g_slist_free (list);
 }
 
-static void g_paste_ui_history_refresh (GPasteUiHistory *self,
-                                        guint64          from_index);
+static void g_paste_ui_history_refresh (GPasteUiHistory *self);
 
 static void
 g_paste_ui_history_update_height_request (GPasteSettings *settings,
@@ -114,48 +123,52 @@ g_paste_ui_history_update_height_request (GPasteSettings *settings,
         g_object_set (G_OBJECT (self), "height-request", new_size * priv->item_height, NULL);
 
     if (new_size != priv->size)
-        g_paste_ui_history_refresh (self, 0);
+        g_paste_ui_history_refresh (self);
 }
 
-typedef struct {
-    GPasteUiHistory *self;
-    gchar           *name;
-    guint64          from_index;
-} OnUpdateCallbackData;
-
 static void
-g_paste_ui_history_refresh_history (GObject      *source_object G_GNUC_UNUSED,
-                                    GAsyncResult *res,
-                                    gpointer      user_data)
+g_paste_ui_history_render (GPasteUiHistory *self,
+                           guint64          from_index)
 {
-    g_autofree OnUpdateCallbackData *data = user_data;
-    g_autofree gchar *name = data->name;
-    GPasteUiHistory *self = data->self;
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
 
+    /* Search results are displayed instead */
+    if (priv->search)
+        return;
+
+    GSList *item = g_slist_nth (priv->items, from_index);
+
+    for (guint64 i = from_index; i < priv->page->len && item; ++i, item = g_slist_next (item))
+        g_paste_ui_item_set_item (item->data, i, g_ptr_array_index (priv->page, i));
+}
+
+static void
+g_paste_ui_history_resize (GPasteUiHistory *self,
+                           guint64          length)
+{
+    GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
     guint64 old_size = priv->size;
-    guint64 refreshTextBound = old_size;
-    guint64 new_size = g_paste_client_get_history_size_finish (priv->client, res, NULL);
     guint64 max_size = g_paste_settings_get_max_displayed_history_size (priv->settings);
 
-    priv->size = MIN (new_size, max_size);
+    priv->length = length;
+    priv->size = MIN (length, max_size);
 
     if (priv->size)
         gtk_widget_hide (priv->dummy_item);
     else
         gtk_widget_show (priv->dummy_item);
 
-    g_paste_ui_panel_update_history_length (priv->panel, name, new_size);
+    g_paste_ui_panel_update_history_length (priv->panel, priv->name, length);
 
     if (old_size < priv->size)
     {
         for (guint64 i = old_size; i < priv->size; ++i)
         {
-            GtkWidget *item = g_paste_ui_item_new (priv->client, priv->settings, priv->rootwin, i);
+            /* They get filled from the mirror once it has them */
+            GtkWidget *item = g_paste_ui_item_new (priv->client, priv->settings, priv->rootwin, -1);
             priv->items = g_slist_append (priv->items, item);
         }
         g_paste_ui_history_add_list (GTK_CONTAINER (self), g_slist_nth (priv->items, old_size));
-        refreshTextBound = old_size;
     }
     else if (old_size > priv->size)
     {
@@ -171,15 +184,10 @@ g_paste_ui_history_refresh_history (GObject      *source_object G_GNUC_UNUSED,
             g_paste_ui_history_drop_list (GTK_CONTAINER (self), priv->items);
             priv->items = NULL;
         }
-        refreshTextBound = priv->size;
     }
 
-    GSList *item = priv->items;
-
-    for (guint64 i = 0; i < data->from_index; ++i)
-        item = g_slist_next (item);
-    for (guint64 i = data->from_index; i < refreshTextBound && item; ++i, item = g_slist_next (item))
-        g_paste_ui_item_set_index (item->data, i);
+    if (priv->page->len > priv->size)
+        g_ptr_array_set_size (priv->page, priv->size);
 
     if (!priv->item_height)
     {
@@ -188,59 +196,141 @@ g_paste_ui_history_refresh_history (GObject      *source_object G_GNUC_UNUSED,
     }
 }
 
+typedef struct {
+    GPasteUiHistory *self;
+    guint64          version;
+} OnPageCallbackData;
+
+static void g_paste_ui_history_fill (GPasteUiHistory *self);
+
+static void
+g_paste_ui_history_on_page_ready (GObject      *source_object G_GNUC_UNUSED,
+                                  GAsyncResult *res,
+                                  gpointer      user_data)
+{
+    g_autofree OnPageCallbackData *data = user_data;
+    GPasteUiHistory *self = data->self;
+    GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
+    GList *page = g_paste_client_get_items_page_finish (priv->client, res, NULL /* error */);
+
+    if (data->version != priv->version)
+    {
+        /* The history changed while we were waiting, the indexes may not match anymore */
+        g_paste_ui_history_fill (self);
+    }
+    else
+    {
+        guint64 from_index = priv->page->len;
+
+        /* Another request may already have brought some of them */
+        for (GList *p = page; p && priv->page->len < priv->size; p = g_list_next (p))
+        {
+            if (g_paste_client_item_get_index (p->data) == priv->page->len)
+                g_ptr_array_add (priv->page, g_object_ref (p->data));
+        }
+
+        g_paste_ui_history_render (self, from_index);
+    }
+
+    g_list_free_full (page, g_object_unref);
+}
+
+static void
+g_paste_ui_history_fill (GPasteUiHistory *self)
+{
+    GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
+
+    if (priv->page->len >= priv->size)
+        return;
+
+    OnPageCallbackData *data = g_new (OnPageCallbackData, 1);
+    data->self = self;
+    data->version = priv->version;
+
+    g_paste_client_get_items_page (priv->client,
+                                   priv->page->len,
+                                   priv->size - priv->page->len,
+                                   g_paste_ui_history_on_page_ready,
+                                   data);
+}
+
+static void
+g_paste_ui_history_refresh_history (GObject      *source_object G_GNUC_UNUSED,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
+{
+    GPasteUiHistory *self = user_data;
+    GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
+
+    g_paste_ui_history_resize (self, g_paste_client_get_history_size_finish (priv->client, res, NULL));
+    g_ptr_array_set_size (priv->page, 0);
+    g_paste_ui_history_fill (self);
+}
+
 static void
 on_name_ready (GObject      *source_object G_GNUC_UNUSED,
                GAsyncResult *res,
                gpointer      user_data)
 {
-    OnUpdateCallbackData *data = user_data;
-    GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (data->self);
+    GPasteUiHistory *self = user_data;
+    GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
 
-    data->name = g_paste_client_get_history_name_finish (priv->client, res, NULL);
+    g_free (priv->name);
+    priv->name = g_paste_client_get_history_name_finish (priv->client, res, NULL);
 
-    g_paste_client_get_history_size (priv->client, data->name, g_paste_ui_history_refresh_history, data);
+    g_paste_client_get_history_size (priv->client, priv->name, g_paste_ui_history_refresh_history, self);
 }
 
 static void
-g_paste_ui_history_refresh (GPasteUiHistory *self,
-                            guint64          from_index)
+g_paste_ui_history_refresh (GPasteUiHistory *self)
 {
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
 
     if (priv->search)
-    {
         g_paste_ui_history_search (self, priv->search);
-    }
     else
-    {
-        OnUpdateCallbackData *data = g_new (OnUpdateCallbackData, 1);
-        data->self = self;
-        data->from_index = from_index;
-
-        g_paste_client_get_history_name (priv->client, on_name_ready, data);
-    }
+        g_paste_client_get_history_name (priv->client, on_name_ready, self);
 }
 
+typedef struct {
+    GPasteUiHistory *self;
+    gchar           *search;
+    guint64          serial;
+    gboolean         refine;
+} OnSearchCallbackData;
+
 static void
 on_search_ready (GObject      *source_object G_GNUC_UNUSED,
                  GAsyncResult *res,
                  gpointer      user_data)
 {
-    GPasteUiHistory *self = user_data;
+    g_autofree OnSearchCallbackData *data = user_data;
+    g_autofree gchar *search = data->search;
+    GPasteUiHistory *self = data->self;
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
+    guint64 token = 0;
+    guint64 hits = 0;
+    g_autofree guint64 *results = (data->refine) ?
+        g_paste_client_refine_search_finish (priv->client, res, &token, &hits, NULL /* error */) :
+        g_paste_client_start_search_finish (priv->client, res, &token, &hits, NULL /* error */);
 
-    priv->search_results = g_paste_client_search_finish (priv->client, res, &priv->search_results_size, NULL /* error */);
+    /* Another search was started since then, or the search was reset */
+    if (data->serial != priv->search_serial || !priv->search)
+        return;
 
-    if (!priv->search_results)
-        priv->search_results_size = 0;
-    else if (priv->search_results_size > priv->size)
-        priv->search_results_size = priv->size;
+    g_free (priv->searched);
+    g_free (priv->search_results);
+    priv->searched = g_steal_pointer (&search);
+    priv->search_token = token;
+    priv->search_results = g_steal_pointer (&results);
+    priv->search_results_size = (priv->search_results) ? hits : 0;
 
+    guint64 displayed = MIN (priv->search_results_size, priv->size);
     GSList *item = priv->items;
 
-    for (guint64 i = 0; i < priv->search_results_size; ++i, item = g_slist_next (item))
+    for (guint64 i = 0; i < displayed; ++i, item = g_slist_next (item))
         g_paste_ui_item_set_index (item->data, priv->search_results[i]);
-    for (guint64 i = priv->search_results_size; i < priv->size; ++i, item = g_slist_next (item))
+    for (guint64 i = displayed; i < priv->size; ++i, item = g_slist_next (item))
         g_paste_ui_item_set_index (item->data, -1);
 }
 
@@ -261,56 +351,99 @@ g_paste_ui_history_search (GPasteUiHistory *self,
 
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
 
+    /* Whatever is still running is outdated now */
+    ++priv->search_serial;
+
     if (!g_strcmp0 (search, ""))
     {
         g_clear_pointer (&priv->search, g_free);
+        g_clear_pointer (&priv->searched, g_free);
         g_clear_pointer (&priv->search_results, g_free);
         priv->search_results_size = 0;
-        g_paste_ui_history_refresh (self, 0);
+        g_paste_ui_history_refresh (self);
     }
     else
     {
+        OnSearchCallbackData *data = g_new (OnSearchCallbackData, 1);
+
+        /* @search may be priv->search itself */
+        data->self = self;
+        data->search = g_strdup (search);
         g_free (priv->search);
-        priv->search = g_strdup (search);
-        g_paste_client_search (priv->client, search, on_search_ready, self);
+        priv->search = g_strdup (data->search);
+        data->serial = priv->search_serial;
+        data->refine = !!priv->searched;
+
+        /* The daemon only narrows the previous results down if that's possible */
+        if (data->refine)
+        {
+            g_paste_client_refine_search (priv->client,
+                                          priv->search_token,
+                                          priv->searched,
+                                          priv->search_results,
+                                          priv->search_results_size,
+                                          data->search,
+                                          on_search_ready,
+                                          data);
+        }
+        else
+        {
+            g_paste_client_start_search (priv->client, data->search, on_search_ready, data);
+        }
     }
 }
 
 static void
-g_paste_ui_history_on_update (GPasteClient      *client G_GNUC_UNUSED,
-                              GPasteUpdateAction action,
-                              GPasteUpdateTarget target,
-                              guint64            position,
-                              gpointer           user_data)
+g_paste_ui_history_on_delta (GPasteClient      *client G_GNUC_UNUSED,
+                             guint64            version,
+                             GPasteUpdateAction action,
+                             GPasteUpdateTarget target,
+                             guint64            position,
+                             GPasteClientItem  *item,
+                             gpointer           user_data)
 {
     GPasteUiHistory *self = user_data;
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
-    gboolean refresh = FALSE;
+    gboolean missed = (version != priv->version + 1);
 
-    switch (target)
+    priv->version = version;
+
+    /* The results of a search can't be updated locally, and the mirror is fetched again after it */
+    if (missed || priv->search || target != G_PASTE_UPDATE_TARGET_POSITION)
     {
-    case G_PASTE_UPDATE_TARGET_ALL:
-        refresh = TRUE;
+        g_paste_ui_history_refresh (self);
+        return;
+    }
+
+    switch (action)
+    {
+    case G_PASTE_UPDATE_ACTION_ADD:
+        g_return_if_fail (item);
+        g_ptr_array_insert (priv->page, 0, g_object_ref (item));
+        g_paste_ui_history_resize (self, priv->length + 1);
+        g_paste_ui_history_render (self, 0);
+        break;
+    case G_PASTE_UPDATE_ACTION_REMOVE:
+        if (position < priv->page->len)
+            g_ptr_array_remove_index (priv->page, position);
+        g_paste_ui_history_resize (self, (priv->length) ? priv->length - 1 : 0);
+        g_paste_ui_history_render (self, position);
+        /* Something may have to replace it at the bottom */
+        g_paste_ui_history_fill (self);
         break;
-    case G_PASTE_UPDATE_TARGET_POSITION:
-        switch (action)
+    case G_PASTE_UPDATE_ACTION_REPLACE:
+        g_return_if_fail (item);
+        if (position < priv->page->len)
         {
-        case G_PASTE_UPDATE_ACTION_REPLACE:
-            g_paste_ui_item_refresh (g_slist_nth_data (priv->items, position));
-            break;
-        case G_PASTE_UPDATE_ACTION_REMOVE:
-            refresh = TRUE;
-            break;
-        default:
-            g_assert_not_reached ();
+            g_object_unref (g_ptr_array_index (priv->page, position));
+            g_ptr_array_index (priv->page, position) = g_object_ref (item);
+            g_paste_ui_history_render (self, position);
         }
         break;
     default:
-        g_assert_not_reached ();
+        g_paste_ui_history_refresh (self);
+        break;
     }
-
-    if (refresh)
-        g_paste_ui_history_refresh (self, position);
 }
 
 static void
@@ -332,7 +465,7 @@ g_paste_ui_history_dispose (GObject *object)
 
     if (priv->client)
     {
-        g_signal_handler_disconnect (priv->client, priv->update_id);
+        g_signal_handler_disconnect (priv->client, priv->delta_id);
         g_clear_object (&priv->client);
     }
 
@@ -344,7 +477,10 @@ g_paste_ui_history_finalize (GObject *object)
 {
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (G_PASTE_UI_HISTORY (object));
 
+    g_ptr_array_unref (priv->page);
+    g_free (priv->name);
     g_free (priv->search);
+    g_free (priv->searched);
     g_free (priv->search_results);
 
     G_OBJECT_CLASS (g_paste_ui_history_parent_class)->finalize (object);
@@ -364,6 +500,8 @@ g_paste_ui_history_init (GPasteUiHistory *self)
 {
     GPasteUiHistoryPrivate *priv = g_paste_ui_history_get_instance_private (self);
 
+    priv->page = g_ptr_array_new_with_free_func (g_object_unref);
+
     priv->activated_id = g_signal_connect (G_OBJECT (self),
                                            "row-activated",
                                            G_CALLBACK (on_row_activated),
@@ -408,12 +546,12 @@ g_paste_ui_history_new (GPasteClient   *client,
                                       "changed::" G_PASTE_MAX_DISPLAYED_HISTORY_SIZE_SETTING,
                                       G_CALLBACK (g_paste_ui_history_update_height_request),
                                       self);
-    priv->update_id = g_signal_connect (client,
-                                        "update",
-                                        G_CALLBACK (g_paste_ui_history_on_update),
-                                        self);
+    priv->delta_id = g_signal_connect (client,
+                                       "delta",
+                                       G_CALLBACK (g_paste_ui_history_on_delta),
+                                       self);
 
-    g_paste_ui_history_on_update (client, G_PASTE_UPDATE_ACTION_REPLACE, G_PASTE_UPDATE_TARGET_ALL, 0, self);
+    g_paste_ui_history_refresh (G_PASTE_UI_HISTORY (self));
 
     return self;
 }
@@ -17,8 +17,9 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-string.h"
+
 #include <gpaste-ui-item.h>
-#include <gpaste-util.h>
 
 struct _GPasteUiItem
 {
@@ -30,7 +31,6 @@ typedef struct
     GPasteClient   *client;
 
     GtkLabel       *index_label;
-    GtkLabel       *label;
     guint64         index;
     gboolean        bold;
 
@@ -76,48 +76,46 @@ g_paste_ui_item_refresh (GPasteUiItem *self)
 }
 
 static void
-g_paste_ui_item_on_text_ready (GObject      *source_object G_GNUC_UNUSED,
-                               GAsyncResult *res,
-                               gpointer      user_data)
+g_paste_ui_item_fill (GPasteUiItem           *self,
+                      const GPasteClientItem *item)
 {
-    GPasteUiItem *self = user_data;
     GPasteUiItemPrivate *priv = g_paste_ui_item_get_instance_private (self);
-    g_autoptr (GError) error = NULL;
-    g_autofree gchar *txt = g_paste_client_get_element_finish (priv->client, res, &error);
-
-    if (!txt || error)
-        return;
-
-    g_autofree gchar *oneline = g_paste_util_replace (txt, "\n", " ");
+    GPasteUiItemSkeleton *sk = G_PASTE_UI_ITEM_SKELETON (self);
+    GPasteItemKind kind = g_paste_client_item_get_kind (item);
+    g_autofree gchar *oneline = g_paste_string_flatten (g_paste_client_item_get_display_string (item));
 
     if (priv->bold)
     {
         g_autofree gchar *markup = g_markup_printf_escaped ("<b>%s</b>", oneline);
-        g_paste_ui_item_skeleton_set_markup (G_PASTE_UI_ITEM_SKELETON (self), markup);
+        g_paste_ui_item_skeleton_set_markup (sk, markup);
     }
     else
     {
-        g_paste_ui_item_skeleton_set_text (G_PASTE_UI_ITEM_SKELETON (self), oneline);
+        g_paste_ui_item_skeleton_set_text (sk, oneline);
     }
+
+    g_paste_ui_item_skeleton_set_editable (sk, kind == G_PASTE_ITEM_KIND_TEXT);
+    g_paste_ui_item_skeleton_set_uploadable (sk, kind == G_PASTE_ITEM_KIND_TEXT);
 }
 
 static void
-g_paste_ui_item_on_kind_ready (GObject      *source_object G_GNUC_UNUSED,
+g_paste_ui_item_on_item_ready (GObject      *source_object G_GNUC_UNUSED,
                                GAsyncResult *res,
                                gpointer      user_data)
 {
     GPasteUiItem *self = user_data;
     GPasteUiItemPrivate *priv = g_paste_ui_item_get_instance_private (self);
     g_autoptr (GError) error = NULL;
-    GPasteItemKind kind = g_paste_client_get_element_kind_finish (priv->client, res, &error);
+    GList *items = g_paste_client_get_items_page_finish (priv->client, res, &error);
 
-    if (!kind || error)
+    if (!items || error)
         return;
 
-    GPasteUiItemSkeleton *sk = G_PASTE_UI_ITEM_SKELETON (self);
+    /* We may have been given another index in the meantime */
+    if (g_paste_client_item_get_index (items->data) == priv->index)
+        g_paste_ui_item_fill (self, items->data);
 
-    g_paste_ui_item_skeleton_set_editable (sk, kind == G_PASTE_ITEM_KIND_TEXT);
-    g_paste_ui_item_skeleton_set_uploadable (sk, kind == G_PASTE_ITEM_KIND_TEXT);
+    g_list_free_full (items, g_object_unref);
 }
 
 static void
@@ -127,8 +125,35 @@ g_paste_ui_item_reset_text (GPasteUiItem *self)
 
     GPasteUiItemPrivate *priv = g_paste_ui_item_get_instance_private (self);
 
-    g_paste_client_get_element (priv->client, priv->index, g_paste_ui_item_on_text_ready, self);
-    g_paste_client_get_element_kind (priv->client, priv->index, g_paste_ui_item_on_kind_ready, self);
+    g_paste_client_get_items_page (priv->client, priv->index, 1, g_paste_ui_item_on_item_ready, self);
+}
+
+static gboolean
+g_paste_ui_item_track_index (GPasteUiItem *self,
+                             guint64       index)
+{
+    GPasteUiItemPrivate *priv = g_paste_ui_item_get_instance_private (self);
+
+    g_paste_ui_item_skeleton_set_index (G_PASTE_UI_ITEM_SKELETON (self), index);
+
+    guint64 old_index = priv->index;
+    priv->index = index;
+
+    if (!index)
+        priv->bold = TRUE;
+    else if (!old_index)
+        priv->bold = FALSE;
+
+    if (index == (guint64)-1)
+    {
+        g_paste_ui_item_skeleton_set_text (G_PASTE_UI_ITEM_SKELETON (self), "");
+        gtk_widget_hide (GTK_WIDGET (self));
+        return FALSE;
+    }
+
+    gtk_widget_show (GTK_WIDGET (self));
+
+    return TRUE;
 }
 
 /**
@@ -145,28 +170,32 @@ g_paste_ui_item_set_index (GPasteUiItem *self,
                            guint64       index)
 {
     g_return_if_fail (G_PASTE_IS_UI_ITEM (self));
-    GPasteUiItemPrivate *priv = g_paste_ui_item_get_instance_private (self);
 
-    g_paste_ui_item_skeleton_set_index (G_PASTE_UI_ITEM_SKELETON (self), index);
-
-    guint64 old_index = priv->index;
-    priv->index = index;
+    if (g_paste_ui_item_track_index (self, index))
+        g_paste_ui_item_reset_text (self);
+}
 
-    if (!index)
-        priv->bold = TRUE;
-    else if (!old_index)
-        priv->bold = FALSE;
+/**
+ * g_paste_ui_item_set_item:
+ * @self: a #GPasteUiItem instance
+ * @index: the index of the corresponding item
+ * @item: the #GPasteClientItem to display
+ *
+ * Track @index and display @item without asking the daemon for it
+ * (the index stored in @item may be outdated if it comes from a mirror)
+ *
+ * Returns:
+ */
+G_PASTE_VISIBLE void
+g_paste_ui_item_set_item (GPasteUiItem           *self,
+                          guint64                 index,
+                          const GPasteClientItem *item)
+{
+    g_return_if_fail (G_PASTE_IS_UI_ITEM (self));
+    g_return_if_fail (G_PASTE_IS_CLIENT_ITEM ((gpointer) item));
 
-    if (index != (guint64)-1)
-    {
-        g_paste_ui_item_reset_text (self);
-        gtk_widget_show (GTK_WIDGET (self));
-    }
-    else
-    {
-        gtk_label_set_text (priv->label, "");
-        gtk_widget_hide (GTK_WIDGET (self));
-    }
+    if (g_paste_ui_item_track_index (self, index))
+        g_paste_ui_item_fill (self, item);
 }
 
 static void
@@ -32,10 +32,13 @@ G_BEGIN_DECLS
 
 G_PASTE_FINAL_TYPE (UiItem, ui_item, UI_ITEM, GPasteUiItemSkeleton)
 
-void g_paste_ui_item_activate  (GPasteUiItem *self);
-void g_paste_ui_item_refresh   (GPasteUiItem *self);
-void g_paste_ui_item_set_index (GPasteUiItem *self,
-                                guint64       index);
+void g_paste_ui_item_activate  (GPasteUiItem           *self);
+void g_paste_ui_item_refresh   (GPasteUiItem           *self);
+void g_paste_ui_item_set_index (GPasteUiItem           *self,
+                                guint64                 index);
+void g_paste_ui_item_set_item  (GPasteUiItem           *self,
+                                guint64                 index,
+                                const GPasteClientItem *item);
 
 GtkWidget *g_paste_ui_item_new (GPasteClient   *client,
                                 GPasteSettings *settings,
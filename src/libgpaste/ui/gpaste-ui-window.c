@@ -212,6 +212,9 @@ on_client_ready (GObject      *source_object G_GNUC_UNUSED,
         gtk_window_close (win); /* will exit the application */
     }
 
+    /* Each row asks for its item, most of them can be answered locally */
+    g_paste_client_set_cache_enabled (client, TRUE);
+
     g_autoptr (GPasteSettings) settings = g_paste_settings_new ();
     GtkWidget *header = g_paste_ui_header_new (win, client);
     GtkWidget *panel = g_paste_ui_panel_new (client, settings, win, priv->search_entry);
@@ -0,0 +1,195 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-fingerprint.h"
+
+#include <string.h>
+
+/*
+ * XXH64: processes the input 32 bytes at a time in four independent lanes
+ * which compilers happily keep in registers and vectorize.
+ */
+
+#define G_PASTE_FINGERPRINT_PRIME_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define G_PASTE_FINGERPRINT_PRIME_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define G_PASTE_FINGERPRINT_PRIME_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define G_PASTE_FINGERPRINT_PRIME_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define G_PASTE_FINGERPRINT_PRIME_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+#define G_PASTE_FINGERPRINT_IMAGE_KEY "gpaste-fingerprint"
+
+static inline guint64
+g_paste_fingerprint_rotl (guint64 value,
+                          guint   bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline guint64
+g_paste_fingerprint_read64 (const guchar *data)
+{
+    guint64 value;
+
+    memcpy (&value, data, sizeof (value));
+
+    return GUINT64_FROM_LE (value);
+}
+
+static inline guint32
+g_paste_fingerprint_read32 (const guchar *data)
+{
+    guint32 value;
+
+    memcpy (&value, data, sizeof (value));
+
+    return GUINT32_FROM_LE (value);
+}
+
+static inline guint64
+g_paste_fingerprint_round (guint64 acc,
+                           guint64 input)
+{
+    acc += input * G_PASTE_FINGERPRINT_PRIME_2;
+    acc = g_paste_fingerprint_rotl (acc, 31);
+
+    return acc * G_PASTE_FINGERPRINT_PRIME_1;
+}
+
+static inline guint64
+g_paste_fingerprint_merge (guint64 acc,
+                           guint64 lane)
+{
+    acc ^= g_paste_fingerprint_round (0, lane);
+
+    return acc * G_PASTE_FINGERPRINT_PRIME_1 + G_PASTE_FINGERPRINT_PRIME_4;
+}
+
+/**
+ * g_paste_fingerprint_data:
+ * @data: the data to fingerprint
+ * @length: the length of @data
+ * @seed: the seed of the hash, can be used to chain several calls
+ *
+ * Compute a fast 64 bits fingerprint of some data
+ *
+ * Returns: the fingerprint
+ */
+guint64
+g_paste_fingerprint_data (gconstpointer data,
+                          gsize         length,
+                          guint64       seed)
+{
+    const guchar *p = data;
+    const guchar *end = p + length;
+    guint64 hash;
+
+    if (length >= 32)
+    {
+        const guchar *limit = end - 32;
+        guint64 v1 = seed + G_PASTE_FINGERPRINT_PRIME_1 + G_PASTE_FINGERPRINT_PRIME_2;
+        guint64 v2 = seed + G_PASTE_FINGERPRINT_PRIME_2;
+        guint64 v3 = seed;
+        guint64 v4 = seed - G_PASTE_FINGERPRINT_PRIME_1;
+
+        do
+        {
+            v1 = g_paste_fingerprint_round (v1, g_paste_fingerprint_read64 (p));
+            v2 = g_paste_fingerprint_round (v2, g_paste_fingerprint_read64 (p + 8));
+            v3 = g_paste_fingerprint_round (v3, g_paste_fingerprint_read64 (p + 16));
+            v4 = g_paste_fingerprint_round (v4, g_paste_fingerprint_read64 (p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = g_paste_fingerprint_rotl (v1, 1) + g_paste_fingerprint_rotl (v2, 7) +
+               g_paste_fingerprint_rotl (v3, 12) + g_paste_fingerprint_rotl (v4, 18);
+        hash = g_paste_fingerprint_merge (hash, v1);
+        hash = g_paste_fingerprint_merge (hash, v2);
+        hash = g_paste_fingerprint_merge (hash, v3);
+        hash = g_paste_fingerprint_merge (hash, v4);
+    }
+    else
+        hash = seed + G_PASTE_FINGERPRINT_PRIME_5;
+
+    hash += length;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        hash ^= g_paste_fingerprint_round (0, g_paste_fingerprint_read64 (p));
+        hash = g_paste_fingerprint_rotl (hash, 27) * G_PASTE_FINGERPRINT_PRIME_1 + G_PASTE_FINGERPRINT_PRIME_4;
+    }
+
+    if (p + 4 <= end)
+    {
+        hash ^= (guint64) g_paste_fingerprint_read32 (p) * G_PASTE_FINGERPRINT_PRIME_1;
+        hash = g_paste_fingerprint_rotl (hash, 23) * G_PASTE_FINGERPRINT_PRIME_2 + G_PASTE_FINGERPRINT_PRIME_3;
+        p += 4;
+    }
+
+    for (; p < end; ++p)
+    {
+        hash ^= (guint64) *p * G_PASTE_FINGERPRINT_PRIME_5;
+        hash = g_paste_fingerprint_rotl (hash, 11) * G_PASTE_FINGERPRINT_PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= G_PASTE_FINGERPRINT_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= G_PASTE_FINGERPRINT_PRIME_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+/**
+ * g_paste_fingerprint_image:
+ * @image: (nullable): the #GdkPixbuf to fingerprint
+ *
+ * Compute the fingerprint of the pixels of an image.
+ * It is cached on the image, which thus only ever gets hashed once.
+ *
+ * Returns: (transfer none): the fingerprint, owned by @image
+ */
+const gchar *
+g_paste_fingerprint_image (GdkPixbuf *image)
+{
+    if (!image)
+        return NULL;
+
+    const gchar *cached = g_object_get_data (G_OBJECT (image), G_PASTE_FINGERPRINT_IMAGE_KEY);
+
+    if (cached)
+        return cached;
+
+    gint width = gdk_pixbuf_get_width (image);
+    gint height = gdk_pixbuf_get_height (image);
+    gint rowstride = gdk_pixbuf_get_rowstride (image);
+    gsize row_length = ((gsize) width * gdk_pixbuf_get_n_channels (image) * gdk_pixbuf_get_bits_per_sample (image) + 7) / 8;
+    const guchar *pixels = gdk_pixbuf_get_pixels (image);
+    guint64 hash = ((guint64) width << 32) | (guint32) height;
+
+    /* Don't hash the padding at the end of the rows, its contents are undefined */
+    for (gint y = 0; y < height; ++y)
+        hash = g_paste_fingerprint_data (pixels + (gsize) y * rowstride, row_length, hash);
+
+    gchar *fingerprint = g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
+
+    g_object_set_data_full (G_OBJECT (image), G_PASTE_FINGERPRINT_IMAGE_KEY, fingerprint, g_free);
+
+    return fingerprint;
+}
@@ -0,0 +1,45 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_FINGERPRINT_H__
+#define __G_PASTE_FINGERPRINT_H__
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Fingerprints are fast non-cryptographic hashes used to tell whether two
+ * contents are the same (clipboard change detection, duplicates lookup).
+ * They must never be used where the name of something on disk depends on it,
+ * g_paste_util_compute_checksum is there for this.
+ */
+
+guint64      g_paste_fingerprint_data  (gconstpointer data,
+                                        gsize         length,
+                                        guint64       seed);
+const gchar *g_paste_fingerprint_image (GdkPixbuf    *image);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_FINGERPRINT_H__*/
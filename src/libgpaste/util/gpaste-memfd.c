@@ -0,0 +1,107 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-memfd.h"
+
+#include <gio/gio.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined (HAVE_MEMFD_CREATE) && defined (F_ADD_SEALS)
+static gboolean
+g_paste_memfd_fill (gint         fd,
+                    const gchar *data,
+                    gsize        length)
+{
+    while (length)
+    {
+        gssize written = write (fd, data, length);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+
+        data += written;
+        length -= written;
+    }
+
+    /* The receiver doesn't have to trust us not to change it once it's mapped */
+    if (fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+        return FALSE;
+
+    /* The offset is shared with the receiver, which may read it rather than mapping it */
+    return (lseek (fd, 0, SEEK_SET) == 0);
+}
+#endif
+
+/**
+ * g_paste_memfd_new:
+ * @name: the name of the file, for debugging purposes
+ * @data: the contents of the file
+ * @length: the length of @data
+ * @inheritable: whether the file descriptor must survive exec
+ * @error: a #GError
+ *
+ * Create a sealed memory file holding @data
+ *
+ * Returns: the file descriptor, or -1 on error
+ */
+gint
+g_paste_memfd_new (const gchar *name,
+                   const gchar *data,
+                   gsize        length,
+                   gboolean     inheritable,
+                   GError     **error)
+{
+    g_return_val_if_fail (name, -1);
+    g_return_val_if_fail (data || !length, -1);
+    g_return_val_if_fail (!error || !(*error), -1);
+
+#if defined (HAVE_MEMFD_CREATE) && defined (F_ADD_SEALS)
+    gint fd = memfd_create (name, (inheritable) ? MFD_ALLOW_SEALING : MFD_ALLOW_SEALING | MFD_CLOEXEC);
+
+    if (fd >= 0 && !g_paste_memfd_fill (fd, data, length))
+    {
+        gint saved_errno = errno;
+
+        close (fd);
+        errno = saved_errno;
+        fd = -1;
+    }
+
+    if (fd < 0)
+    {
+        gint saved_errno = errno;
+
+        g_set_error_literal (error, G_IO_ERROR, g_io_error_from_errno (saved_errno), g_strerror (saved_errno));
+    }
+
+    return fd;
+#else
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Sealed memory files are not supported");
+
+    return -1;
+#endif
+}
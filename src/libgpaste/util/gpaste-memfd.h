@@ -0,0 +1,45 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_MEMFD_H__
+#define __G_PASTE_MEMFD_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A sealed memory file lets us hand big contents to another process (over
+ * D-Bus, or across exec) without copying them through a message, and the
+ * receiver can map it knowing that it won't change under its feet.
+ */
+
+gint g_paste_memfd_new (const gchar *name,
+                        const gchar *data,
+                        gsize        length,
+                        gboolean     inheritable,
+                        GError     **error);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_MEMFD_H__*/
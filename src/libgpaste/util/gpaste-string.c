@@ -0,0 +1,198 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-string.h"
+
+#include <string.h>
+
+/**
+ * g_paste_string_replace:
+ * @text: the initial text
+ * @pattern: the literal pattern to replace
+ * @substitution: the replacement text
+ *
+ * Replace all the occurences of @pattern in @text by @substitution
+ *
+ * Returns: the newly allocated string
+ */
+gchar *
+g_paste_string_replace (const gchar *text,
+                        const gchar *pattern,
+                        const gchar *substitution)
+{
+    g_return_val_if_fail (text, NULL);
+    g_return_val_if_fail (pattern, NULL);
+    g_return_val_if_fail (substitution, NULL);
+
+    gsize pattern_length = strlen (pattern);
+    const gchar *match;
+
+    if (!pattern_length || !(match = strstr (text, pattern)))
+        return g_strdup (text);
+
+    gsize substitution_length = strlen (substitution);
+    GString *result = g_string_sized_new (strlen (text));
+
+    do
+    {
+        g_string_append_len (result, text, match - text);
+        g_string_append_len (result, substitution, substitution_length);
+        text = match + pattern_length;
+    } while ((match = strstr (text, pattern)));
+
+    g_string_append (result, text);
+
+    return g_string_free (result, FALSE);
+}
+
+/**
+ * g_paste_string_xml_encode:
+ * @text: the text to encode
+ *
+ * Escape the characters which can't appear as is in the history XML CDATA
+ *
+ * Returns: the newly allocated string
+ */
+gchar *
+g_paste_string_xml_encode (const gchar *text)
+{
+    g_return_val_if_fail (text, NULL);
+
+    gsize length = strlen (text);
+    gsize span = strcspn (text, "&>");
+
+    if (span == length)
+        return g_strndup (text, length);
+
+    GString *result = g_string_sized_new (length + length / 8);
+
+    for (;;)
+    {
+        g_string_append_len (result, text, span);
+        text += span;
+
+        if (!*text)
+            break;
+
+        g_string_append (result, (*text == '&') ? "&amp;" : "&gt;");
+        span = strcspn (++text, "&>");
+    }
+
+    return g_string_free (result, FALSE);
+}
+
+/**
+ * g_paste_string_xml_decode:
+ * @text: the text to decode
+ *
+ * Unescape what g_paste_string_xml_encode escaped
+ *
+ * Returns: the newly allocated string
+ */
+gchar *
+g_paste_string_xml_decode (const gchar *text)
+{
+    g_return_val_if_fail (text, NULL);
+
+    const gchar *amp = strchr (text, '&');
+
+    if (!amp)
+        return g_strdup (text);
+
+    gsize length = strlen (text);
+    gchar *result = g_malloc (length + 1);
+    gchar *out = result;
+
+    /* Decoding never makes the text grow */
+    do
+    {
+        memcpy (out, text, amp - text);
+        out += amp - text;
+
+        if (!strncmp (amp, "&amp;", 5))
+        {
+            *out++ = '&';
+            text = amp + 5;
+        }
+        else if (!strncmp (amp, "&gt;", 4))
+        {
+            *out++ = '>';
+            text = amp + 4;
+        }
+        else
+        {
+            *out++ = '&';
+            text = amp + 1;
+        }
+    } while ((amp = strchr (text, '&')));
+
+    strcpy (out, text);
+
+    return result;
+}
+
+/**
+ * g_paste_string_flatten:
+ * @text: the text to flatten
+ *
+ * Turn a multiline text into a single line one, replacing newlines by spaces
+ *
+ * Returns: the newly allocated string
+ */
+gchar *
+g_paste_string_flatten (const gchar *text)
+{
+    g_return_val_if_fail (text, NULL);
+
+    gsize length = strlen (text);
+    gchar *result = g_strndup (text, length);
+    gchar *end = result + length;
+
+    for (gchar *nl = memchr (result, '\n', length); nl; nl = memchr (nl, '\n', end - nl))
+        *nl++ = ' ';
+
+    return result;
+}
+
+/**
+ * g_paste_string_truncate:
+ * @text: the text to truncate
+ * @max_length: how many characters to keep at most, 0 to keep them all
+ *
+ * Keep the beginning of a text without splitting any character,
+ * only reading the part of it we keep
+ *
+ * Returns: the newly allocated string
+ */
+gchar *
+g_paste_string_truncate (const gchar *text,
+                         guint64      max_length)
+{
+    g_return_val_if_fail (text, NULL);
+
+    if (!max_length)
+        return g_strdup (text);
+
+    const gchar *end = text;
+
+    for (guint64 i = 0; *end && i < max_length; ++i)
+        end = g_utf8_next_char (end);
+
+    return g_strndup (text, end - text);
+}
@@ -0,0 +1,47 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__G_PASTE_H_INSIDE__) && !defined (G_PASTE_COMPILATION)
+#error "Only <gpaste.h> can be included directly."
+#endif
+
+#ifndef __G_PASTE_STRING_H__
+#define __G_PASTE_STRING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Single pass string transforms for the hot paths. They rely on the libc
+ * search primitives (strstr, strcspn, memchr...), which are vectorized.
+ */
+
+gchar *g_paste_string_replace    (const gchar *text,
+                                  const gchar *pattern,
+                                  const gchar *substitution);
+gchar *g_paste_string_xml_encode (const gchar *text);
+gchar *g_paste_string_xml_decode (const gchar *text);
+gchar *g_paste_string_flatten    (const gchar *text);
+gchar *g_paste_string_truncate   (const gchar *text,
+                                  guint64      max_length);
+
+G_END_DECLS
+
+#endif /*__G_PASTE_STRING_H__*/
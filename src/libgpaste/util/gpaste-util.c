@@ -17,6 +17,8 @@
  *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "gpaste-string.h"
+
 #include <gpaste-gsettings-keys.h>
 #include <gpaste-macros.h>
 #include <gpaste-util.h>
@@ -307,25 +309,16 @@ g_paste_util_replace (const gchar *text,
     g_return_val_if_fail (g_utf8_validate (pattern, -1, NULL), NULL);
     g_return_val_if_fail (g_utf8_validate (substitution, -1, NULL), NULL);
 
-    g_autofree gchar *regex_string = g_regex_escape_string (pattern, -1);
-    g_autoptr (GRegex) regex = g_regex_new (regex_string,
-                                            0, /* Compile options */
-                                            0, /* Match options */
-                                            NULL); /* Error */
-    return g_regex_replace_literal (regex,
-                                    text,
-                                    (gssize) -1,
-                                    0, /* Start position */
-                                    substitution,
-                                    0, /* Match options */
-                                    NULL); /* Error */
+    return g_paste_string_replace (text, pattern, substitution);
 }
 
 /**
  * g_paste_util_compute_checksum:
  * @image: the #GdkPixbuf to checksum
  *
- * Compute the checksum of an image
+ * Compute the SHA256 checksum of an image.
+ * This is slow, only use it when a cryptographic hash is needed.
+ * It is cached on the image, which thus only ever gets hashed once.
  *
  * Returns: the newly allocated checksum
  */
@@ -335,10 +328,18 @@ g_paste_util_compute_checksum (GdkPixbuf *image)
     if (!image)
         return NULL;
 
+    const gchar *cached = g_object_get_data (G_OBJECT (image), "gpaste-checksum");
+
+    if (cached)
+        return g_strdup (cached);
+
     guint32 length;
     const guchar *data = gdk_pixbuf_get_pixels_with_length (image, &length);
+    gchar *checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, data, length);
+
+    g_object_set_data_full (G_OBJECT (image), "gpaste-checksum", g_strdup (checksum), g_free);
 
-    return g_compute_checksum_for_data (G_CHECKSUM_SHA256, data, length);
+    return checksum;
 }
 
 /**
@@ -0,0 +1,168 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gpaste-history-binary.h"
+
+#include <gpaste-image-item.h>
+#include <gpaste-password-item.h>
+#include <gpaste-text-item.h>
+#include <gpaste-uris-item.h>
+
+#include <glib/gstdio.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Writes a binary snapshot of each kind of item, loads it back and checks
+ * that the entries give back the same items, then that writing the entries
+ * again without creating their items gives the same snapshot.
+ */
+
+#define SERIAL 42
+
+static gboolean
+check_slot (gconstpointer     slot,
+            const GPasteItem *expected)
+{
+    const gchar *kind = g_paste_item_get_kind (expected);
+    g_autoptr (GBytes) value = g_paste_history_binary_slot_ref_value (slot);
+    g_autoptr (GBytes) expected_value = g_paste_item_ref_real_value (expected);
+
+    if (!G_PASTE_HISTORY_BINARY_IS_ENTRY (slot))
+    {
+        g_printerr ("%s: loading created the item\n", kind);
+        return FALSE;
+    }
+
+    if (g_strcmp0 (g_paste_history_binary_slot_get_kind (slot), kind) ||
+        g_paste_history_binary_slot_get_hash (slot) != g_paste_item_get_hash (expected) ||
+        g_paste_history_binary_slot_get_size (slot) != g_bytes_get_size (expected_value) ||
+        !value || !g_bytes_equal (value, expected_value))
+    {
+        g_printerr ("%s: the entry doesn't match the item\n", kind);
+        return FALSE;
+    }
+
+    g_autoptr (GPasteItem) item = g_paste_history_binary_slot_dup_item (slot);
+
+    if (!g_paste_item_equals (item, expected) || g_strcmp0 (g_paste_item_get_kind (item), kind))
+    {
+        g_printerr ("%s: the item doesn't match the original one\n", kind);
+        return FALSE;
+    }
+
+    if (G_PASTE_IS_IMAGE_ITEM (item))
+    {
+        GPasteImageItem *image = G_PASTE_IMAGE_ITEM (item);
+        GPasteImageItem *expected_image = G_PASTE_IMAGE_ITEM (expected);
+
+        if (g_paste_image_item_get_width (image) != g_paste_image_item_get_width (expected_image) ||
+            g_paste_image_item_get_height (image) != g_paste_image_item_get_height (expected_image) ||
+            g_strcmp0 (g_paste_image_item_get_checksum (image), g_paste_image_item_get_checksum (expected_image)))
+        {
+            g_printerr ("%s: the metadata doesn't match\n", kind);
+            return FALSE;
+        }
+    }
+    else if (G_PASTE_IS_PASSWORD_ITEM (item) &&
+             g_strcmp0 (g_paste_password_item_get_name (G_PASTE_PASSWORD_ITEM (item)),
+                        g_paste_password_item_get_name (G_PASTE_PASSWORD_ITEM (expected))))
+    {
+        g_printerr ("%s: the name doesn't match\n", kind);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+write_snapshot (const gchar   *path,
+                const GString *contents)
+{
+    g_autoptr (GError) error = NULL;
+
+    if (!g_file_set_contents (path, contents->str, contents->len, &error))
+    {
+        g_printerr ("Failed to write the snapshot: %s\n", error->message);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+gint
+main (gint argc    G_GNUC_UNUSED,
+      gchar *argv[] G_GNUC_UNUSED)
+{
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *dir = g_dir_make_tmp ("gpaste-test-binary-XXXXXX", &error);
+
+    if (!dir)
+    {
+        g_printerr ("Failed to create a temporary directory: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_autofree gchar *path = g_build_filename (dir, "history.bin", NULL);
+    g_autoptr (GDateTime) date = g_date_time_new_from_unix_local (1234567890);
+    g_autoptr (GPtrArray) items = g_ptr_array_new_with_free_func (g_object_unref);
+
+    g_ptr_array_add (items, g_paste_text_item_new ("some text\nover two lines"));
+    g_ptr_array_add (items, g_paste_uris_item_new ("/tmp/gpaste-first\n/tmp/gpaste-second"));
+    g_ptr_array_add (items, g_paste_image_item_new_from_file_full ("/tmp/gpaste-image.png", date, 16, 9, "0123456789abcdef"));
+    g_ptr_array_add (items, g_paste_password_item_new ("name", "secret"));
+    g_ptr_array_add (items, g_paste_text_item_new (""));
+
+    g_autoptr (GString) contents = g_paste_history_binary_serialize (items, SERIAL, NULL);
+    g_autoptr (GPtrArray) history = g_ptr_array_new_with_free_func (g_paste_history_binary_slot_unref);
+    guint64 serial = 0;
+    guint64 size = 0;
+    gboolean ok = write_snapshot (path, contents);
+
+    if (ok && !g_paste_history_binary_load (path, &serial, history, &size))
+    {
+        g_printerr ("Failed to load the snapshot\n");
+        ok = FALSE;
+    }
+
+    if (ok && (serial != SERIAL || size != contents->len || history->len != items->len))
+    {
+        g_printerr ("Expected %u items with serial %d, got %u with serial %" G_GUINT64_FORMAT "\n", items->len, SERIAL, history->len, serial);
+        ok = FALSE;
+    }
+
+    for (guint64 i = 0; ok && i < items->len; ++i)
+        ok &= check_slot (g_ptr_array_index (history, i), g_ptr_array_index (items, i));
+
+    if (ok)
+    {
+        g_autoptr (GString) again = g_paste_history_binary_serialize (history, SERIAL, NULL);
+
+        if (!g_string_equal (again, contents))
+        {
+            g_printerr ("Writing the entries back changed the snapshot\n");
+            ok = FALSE;
+        }
+    }
+
+    g_unlink (path);
+    g_rmdir (dir);
+
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
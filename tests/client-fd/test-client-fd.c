@@ -0,0 +1,126 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <gpaste-client.h>
+
+#include <glib/gstdio.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EXIT_TEST_SKIP 77
+
+/*
+ * Adds a text bigger than a chunk through AddFd and reads it back through
+ * GetRawElementFd. This needs a running daemon, and adds to its history.
+ */
+
+static gboolean
+read_all (gint     fd,
+          GString *contents)
+{
+    gchar buffer[4096];
+
+    for (;;)
+    {
+        gssize length = read (fd, buffer, sizeof (buffer));
+
+        if (!length)
+            return TRUE;
+        if (length < 0)
+            return FALSE;
+
+        g_string_append_len (contents, buffer, length);
+    }
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+    if (argc != 2 || g_strcmp0 (argv[1], "--dont-skip"))
+        return EXIT_TEST_SKIP;
+
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GPasteClient) client = g_paste_client_new_sync (&error);
+
+    if (!client)
+    {
+        g_printerr ("Couldn't connect to the daemon: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr (GString) text = g_string_new (NULL);
+
+    /* Make it unique so that it doesn't get merged with what's already in the history */
+    g_string_printf (text, "GPaste AddFd test %" G_GINT64_FORMAT "\n", g_get_real_time ());
+    while (text->len < 200 * 1024)
+        g_string_append (text, "Lorem ipsum dolor sit amet, consectetur adipiscing elit.\n");
+
+    g_autofree gchar *path = NULL;
+    gint fd = g_file_open_tmp ("gpaste-test-client-fd-XXXXXX", &path, &error);
+
+    if (fd < 0)
+    {
+        g_printerr ("Couldn't create a temporary file: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    gboolean written = (write (fd, text->str, text->len) == (gssize) text->len && lseek (fd, 0, SEEK_SET) == 0);
+
+    g_unlink (path);
+
+    if (!written)
+    {
+        g_printerr ("Couldn't write the temporary file\n");
+        close (fd);
+        return EXIT_FAILURE;
+    }
+
+    g_paste_client_add_fd_sync (client, fd, &error);
+    close (fd);
+
+    if (error)
+    {
+        g_printerr ("AddFd failed: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    fd = g_paste_client_get_raw_element_fd_sync (client, 0, &error);
+
+    if (fd < 0)
+    {
+        g_printerr ("GetRawElementFd failed: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr (GString) contents = g_string_new (NULL);
+    gboolean ok = read_all (fd, contents);
+
+    close (fd);
+
+    if (!ok || !g_string_equal (contents, text))
+    {
+        g_printerr ("Read back %" G_GSIZE_FORMAT " bytes instead of the %" G_GSIZE_FORMAT " we added\n", contents->len, text->len);
+        return EXIT_FAILURE;
+    }
+
+    g_paste_client_delete_sync (client, 0, NULL);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gpaste-history-eviction.h"
+
+#include <stdlib.h>
+
+/*
+ * Checks which items each eviction policy picks, and that the plans
+ * never include the first item and list the indexes highest first.
+ */
+
+static const guint64 sizes[] = { 100, 10, 50, 30, 20, 30 };
+
+static gboolean
+check_plan (const gchar                *name,
+            GPasteHistoryEvictionPolicy policy,
+            guint64                     n_items,
+            guint64                     excess,
+            const guint64               expected[],
+            guint64                     n_expected)
+{
+    g_autoptr (GArray) history = g_array_new (FALSE, /* zero-terminated */
+                                              FALSE, /* clear */
+                                              sizeof (guint64));
+
+    g_array_append_vals (history, sizes, n_items);
+
+    g_autoptr (GArray) victims = g_paste_history_eviction_plan (history, policy, excess);
+
+    for (guint64 i = 0; i < victims->len; ++i)
+    {
+        guint64 index = g_array_index (victims, guint64, i);
+
+        if (!index || (i && index >= g_array_index (victims, guint64, i - 1)))
+        {
+            g_printerr ("%s: the first item got evicted, or the indexes aren't strictly decreasing\n", name);
+            return FALSE;
+        }
+    }
+
+    if (victims->len != n_expected)
+    {
+        g_printerr ("%s: expected %" G_GUINT64_FORMAT " victims, got %u\n", name, n_expected, victims->len);
+        return FALSE;
+    }
+
+    for (guint64 i = 0; i < n_expected; ++i)
+    {
+        if (g_array_index (victims, guint64, i) != expected[i])
+        {
+            g_printerr ("%s: expected %" G_GUINT64_FORMAT " at %" G_GUINT64_FORMAT ", got %" G_GUINT64_FORMAT "\n",
+                        name, expected[i], i, g_array_index (victims, guint64, i));
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+gint
+main (gint argc    G_GNUC_UNUSED,
+      gchar *argv[] G_GNUC_UNUSED)
+{
+    gboolean ok = TRUE;
+
+    /* 50 then 30, the oldest one going first on equal sizes */
+    const guint64 largest[] = { 5, 2 };
+    /* 30 + 20 from the tail */
+    const guint64 lru[] = { 5, 4 };
+    /* size × position: 10, 100, 90, 80, 150 */
+    const guint64 weighted[] = { 5 };
+    const guint64 everything[] = { 5, 4, 3, 2, 1 };
+
+    ok &= check_plan ("largest", G_PASTE_HISTORY_EVICTION_LARGEST, G_N_ELEMENTS (sizes), 60, largest, G_N_ELEMENTS (largest));
+    ok &= check_plan ("lru", G_PASTE_HISTORY_EVICTION_LRU, G_N_ELEMENTS (sizes), 40, lru, G_N_ELEMENTS (lru));
+    ok &= check_plan ("weighted", G_PASTE_HISTORY_EVICTION_WEIGHTED, G_N_ELEMENTS (sizes), 1, weighted, G_N_ELEMENTS (weighted));
+    ok &= check_plan ("not enough", G_PASTE_HISTORY_EVICTION_LARGEST, G_N_ELEMENTS (sizes), 1000, everything, G_N_ELEMENTS (everything));
+    ok &= check_plan ("no excess", G_PASTE_HISTORY_EVICTION_LARGEST, G_N_ELEMENTS (sizes), 0, NULL, 0);
+    ok &= check_plan ("only the first", G_PASTE_HISTORY_EVICTION_LRU, 1, 1000, NULL, 0);
+
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
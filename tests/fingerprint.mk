@@ -0,0 +1,35 @@
+## This file is part of GPaste.
+##
+## Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+##
+## GPaste is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## GPaste is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+
+TESTS+=                      \
+	bin/test-fingerprint \
+	$(NULL)
+
+bin_test_fingerprint_SOURCES =                  \
+	%D%/fingerprint/test-fingerprint.c      \
+	src/libgpaste/util/gpaste-fingerprint.c \
+	$(NULL)
+
+bin_test_fingerprint_CFLAGS = \
+	$(AM_CFLAGS)          \
+	$(GDK_PIXBUF_CFLAGS)  \
+	$(NULL)
+
+bin_test_fingerprint_LDADD = \
+	$(AM_LIBS)           \
+	$(GDK_PIXBUF_LIBS)   \
+	$(NULL)
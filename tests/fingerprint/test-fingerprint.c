@@ -0,0 +1,67 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gpaste-fingerprint.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Checks the fingerprints against known XXH64 values, with inputs
+ * going through each of the stripe, 8, 4 and 1 byte steps.
+ */
+
+typedef struct
+{
+    const gchar *data;
+    guint64      seed;
+    guint64      expected;
+} Vector;
+
+static const Vector vectors[] = {
+    { "",                                            0,  G_GUINT64_CONSTANT (0xEF46DB3751D8E999) },
+    { "",                                            1,  G_GUINT64_CONSTANT (0xD5AFBA1336A3BE4B) },
+    { "a",                                           0,  G_GUINT64_CONSTANT (0xD24EC4F1A98C6E5B) },
+    { "abc",                                         0,  G_GUINT64_CONSTANT (0x44BC2CF5AD770999) },
+    { "abcdefghijkl",                                0,  G_GUINT64_CONSTANT (0x4B09B7D3A233D4B3) },
+    { "Nobody inspects the spammish repetition",     0,  G_GUINT64_CONSTANT (0xFBCEA83C8A378BF1) },
+    { "The quick brown fox jumps over the lazy dog", 0,  G_GUINT64_CONSTANT (0x0B242D361FDA71BC) },
+    { "The quick brown fox jumps over the lazy dog", 42, G_GUINT64_CONSTANT (0xAA9F288A8BAA3D3F) },
+};
+
+gint
+main (gint argc    G_GNUC_UNUSED,
+      gchar *argv[] G_GNUC_UNUSED)
+{
+    gboolean ok = TRUE;
+
+    for (guint64 i = 0; i < G_N_ELEMENTS (vectors); ++i)
+    {
+        const Vector *vector = &vectors[i];
+        guint64 fingerprint = g_paste_fingerprint_data (vector->data, strlen (vector->data), vector->seed);
+
+        if (fingerprint != vector->expected)
+        {
+            g_printerr ("\"%s\" with seed %" G_GUINT64_FORMAT ": expected %016" G_GINT64_MODIFIER "x, got %016" G_GINT64_MODIFIER "x\n",
+                        vector->data, vector->seed, vector->expected, fingerprint);
+            ok = FALSE;
+        }
+    }
+
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,174 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gpaste-history-index.h"
+
+#include <stdlib.h>
+
+/*
+ * Checks that the items the index selects for a search include all the
+ * ones the regex matches, so that running the regex only on them finds
+ * the same results as running it on every item.
+ */
+
+static const gchar *values[] = {
+    "Hello world",
+    "HELLO WORLD, in capitals",
+    "hello\nworld, over two lines",
+    "Straße",
+    "STRASSE",
+    "Ünïcödé ÉTÉ",
+    "été ünïcödé",
+    "ab",
+    "",
+    "the quick brown fox jumps over the lazy dog"
+};
+
+static const gchar *patterns[] = {
+    "hello",
+    "world",
+    "LO WO",
+    "straße",
+    "strasse",
+    "été",
+    "ünïcödé",
+    "quick brown",
+    "nothing like that",
+    "abc",
+    "hel+o",
+    "wor.d",
+    "qu[a-z]ck brown",
+    "capitals?$",
+    "lazy\\s+dog",
+    "(over )?two",
+    "^été",
+    "hello|fox"
+};
+
+#define KEY(i) GUINT_TO_POINTER ((i) + 1)
+
+static GRegex *
+compile (const gchar *pattern)
+{
+    /* Just like the history does */
+    return g_regex_new (pattern,
+                        G_REGEX_CASELESS|G_REGEX_MULTILINE|G_REGEX_DOTALL|G_REGEX_OPTIMIZE,
+                        G_REGEX_MATCH_NOTEMPTY|G_REGEX_MATCH_NEWLINE_ANY,
+                        NULL);
+}
+
+static gboolean
+check_pattern (const GPasteHistoryIndex *index,
+               const gchar              *pattern,
+               gboolean                  removed[])
+{
+    g_autoptr (GRegex) regex = compile (pattern);
+    g_autoptr (GArray) query = g_paste_history_index_prepare_query (pattern);
+
+    /* Only some regexes have no part the index can use */
+    if (!query)
+    {
+        if (g_paste_history_index_is_literal (pattern))
+        {
+            g_printerr ("%s: the index can't help\n", pattern);
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    g_autoptr (GHashTable) may_match = g_paste_history_index_lookup (index, query);
+
+    for (guint64 i = 0; i < G_N_ELEMENTS (values); ++i)
+    {
+        if (removed[i])
+        {
+            if (g_hash_table_contains (may_match, KEY (i)))
+            {
+                g_printerr ("%s: \"%s\" was removed but can still match\n", pattern, values[i]);
+                return FALSE;
+            }
+        }
+        else if (g_regex_match (regex, values[i], G_REGEX_MATCH_NOTEMPTY|G_REGEX_MATCH_NEWLINE_ANY, NULL) &&
+                 !g_hash_table_contains (may_match, KEY (i)))
+        {
+            g_printerr ("%s: \"%s\" matches but the index left it out\n", pattern, values[i]);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+check_patterns (const GPasteHistoryIndex *index,
+                gboolean                  removed[])
+{
+    gboolean ok = TRUE;
+
+    for (guint64 i = 0; ok && i < G_N_ELEMENTS (patterns); ++i)
+        ok = check_pattern (index, patterns[i], removed);
+
+    return ok;
+}
+
+gint
+main (gint argc    G_GNUC_UNUSED,
+      gchar *argv[] G_GNUC_UNUSED)
+{
+    GPasteHistoryIndex *index = g_paste_history_index_new ();
+    gboolean removed[G_N_ELEMENTS (values)] = { FALSE };
+    gboolean ok = TRUE;
+
+    for (guint64 i = 0; i < G_N_ELEMENTS (values); ++i)
+        g_paste_history_index_add_pending (index, KEY (i));
+
+    /* Pending items may match anything */
+    ok = check_patterns (index, removed);
+
+    for (guint64 i = 0; i < G_N_ELEMENTS (values); ++i)
+    {
+        g_autoptr (GArray) trigrams = g_paste_history_index_get_trigrams (values[i]);
+
+        g_paste_history_index_add_trigrams (index, KEY (i), trigrams);
+    }
+
+    ok = ok && check_patterns (index, removed);
+
+    /* Forgetting some items doesn't make the others go missing */
+    for (guint64 i = 0; i < G_N_ELEMENTS (values); i += 2)
+    {
+        g_paste_history_index_remove (index, KEY (i));
+        removed[i] = TRUE;
+    }
+
+    ok = ok && check_patterns (index, removed);
+
+    for (guint64 i = 1; i < G_N_ELEMENTS (values); i += 2)
+        g_paste_history_index_remove (index, KEY (i));
+
+    if (ok && g_paste_history_index_get_size (index))
+    {
+        g_printerr ("The index still takes %" G_GUINT64_FORMAT " bytes once empty\n", g_paste_history_index_get_size (index));
+        ok = FALSE;
+    }
+
+    g_paste_history_index_free (index);
+
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,178 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-history-journal.h"
+
+#include <gpaste-text-item.h>
+#include <gpaste-uris-item.h>
+
+#include <glib/gstdio.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Writes a journal, replays it on top of a history and checks the result,
+ * then checks that a truncated journal still replays up to its last complete record.
+ */
+
+#define SERIAL 42
+
+static gboolean
+check_history (const gchar *name,
+               GPtrArray   *history,
+               const gchar *expected[],
+               guint64      n_expected)
+{
+    if (history->len != n_expected)
+    {
+        g_printerr ("%s: expected %" G_GUINT64_FORMAT " items, got %u\n", name, n_expected, history->len);
+        return FALSE;
+    }
+
+    for (guint64 i = 0; i < n_expected; ++i)
+    {
+        const gchar *value = g_paste_item_get_value (g_ptr_array_index (history, i));
+
+        if (g_strcmp0 (value, expected[i]))
+        {
+            g_printerr ("%s: expected \"%s\" at %" G_GUINT64_FORMAT ", got \"%s\"\n", name, expected[i], i, value);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+write_journal (const gchar   *path,
+               const GString *records)
+{
+    g_autoptr (GError) error = NULL;
+    guint64 size;
+
+    if (!g_paste_history_journal_reset (path, SERIAL, &size, &error) ||
+        !g_paste_history_journal_append (path, records, &size, &error))
+    {
+        g_printerr ("Failed to write the journal: %s\n", error->message);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static GPtrArray *
+new_history (void)
+{
+    GPtrArray *history = g_ptr_array_new_with_free_func (g_object_unref);
+
+    g_ptr_array_add (history, g_paste_text_item_new ("snapshot"));
+
+    return history;
+}
+
+static void
+log_text (GString     *records,
+          const gchar *text)
+{
+    g_autoptr (GPasteItem) item = g_paste_text_item_new (text);
+
+    g_paste_history_journal_log_add (records, item);
+}
+
+static gboolean
+check_replay (const gchar   *name,
+              const gchar   *path,
+              const GString *records,
+              guint64        serial,
+              gboolean       expected_complete,
+              const gchar   *expected[],
+              guint64        n_expected)
+{
+    g_autoptr (GPtrArray) history = new_history ();
+    guint64 size;
+
+    if (!write_journal (path, records))
+        return FALSE;
+
+    if (g_paste_history_journal_replay (path, serial, history, &size) != expected_complete)
+    {
+        g_printerr ("%s: the replay was expected to be %s\n", name, (expected_complete) ? "complete" : "incomplete");
+        return FALSE;
+    }
+
+    return check_history (name, history, expected, n_expected);
+}
+
+gint
+main (gint argc    G_GNUC_UNUSED,
+      gchar *argv[] G_GNUC_UNUSED)
+{
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *dir = g_dir_make_tmp ("gpaste-test-journal-XXXXXX", &error);
+
+    if (!dir)
+    {
+        g_printerr ("Failed to create a temporary directory: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_autofree gchar *history_path = g_build_filename (dir, "history.bin", NULL);
+    g_autofree gchar *path = g_paste_history_journal_get_path (history_path);
+    g_autoptr (GString) records = g_string_new (NULL);
+    g_autoptr (GPasteItem) replacement = g_paste_text_item_new ("uno");
+    gboolean ok = TRUE;
+
+    log_text (records, "one");
+    log_text (records, "two\nlines");
+    g_paste_history_journal_log_replace (records, 1, replacement);
+    g_paste_history_journal_log_remove (records, 2);
+
+    guint64 complete_length = records->len;
+
+    log_text (records, "last");
+
+    const gchar *full[] = { "last", "two\nlines", "uno" };
+    const gchar *partial[] = { "two\nlines", "uno" };
+    const gchar *untouched[] = { "snapshot" };
+
+    ok &= check_replay ("replay", path, records, SERIAL, TRUE, full, G_N_ELEMENTS (full));
+    ok &= check_replay ("other serial", path, records, SERIAL + 1, FALSE, untouched, G_N_ELEMENTS (untouched));
+
+    /* Cut the last record in the middle of its value, as a crash while appending would */
+    g_string_truncate (records, records->len - 3);
+    ok &= check_replay ("truncated value", path, records, SERIAL, FALSE, partial, G_N_ELEMENTS (partial));
+
+    /* Cut it in the middle of its header line */
+    g_string_truncate (records, complete_length + 3);
+    ok &= check_replay ("truncated header", path, records, SERIAL, FALSE, partial, G_N_ELEMENTS (partial));
+
+    g_string_truncate (records, complete_length);
+    g_paste_history_journal_log_empty (records);
+    log_text (records, "after");
+
+    const gchar *emptied[] = { "after" };
+
+    ok &= check_replay ("empty", path, records, SERIAL, TRUE, emptied, G_N_ELEMENTS (emptied));
+
+    g_paste_history_journal_delete (path);
+    g_rmdir (dir);
+
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,157 @@
+/*
+ *      This file is part of GPaste.
+ *
+ *      Copyright 2015 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GPaste is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GPaste is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GPaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpaste-string.h"
+
+#include <stdlib.h>
+
+/*
+ * Checks the string transforms against the GRegex based implementation
+ * they replace, and compares their speed on a multi-megabyte text.
+ */
+
+static gchar *
+regex_replace (const gchar *text,
+               const gchar *pattern,
+               const gchar *substitution)
+{
+    g_autofree gchar *regex_string = g_regex_escape_string (pattern, -1);
+    g_autoptr (GRegex) regex = g_regex_new (regex_string,
+                                            0, /* Compile options */
+                                            0, /* Match options */
+                                            NULL); /* Error */
+    return g_regex_replace_literal (regex,
+                                    text,
+                                    (gssize) -1,
+                                    0, /* Start position */
+                                    substitution,
+                                    0, /* Match options */
+                                    NULL); /* Error */
+}
+
+static gchar *
+regex_xml_encode (const gchar *text)
+{
+    g_autofree gchar *_encoded_text = regex_replace (text, "&", "&amp;");
+    return regex_replace (_encoded_text, ">", "&gt;");
+}
+
+static gchar *
+regex_xml_decode (const gchar *text)
+{
+    g_autofree gchar *_decoded_text = regex_replace (text, "&gt;", ">");
+    return regex_replace (_decoded_text, "&amp;", "&");
+}
+
+static gchar *
+regex_flatten (const gchar *text)
+{
+    return regex_replace (text, "\n", " ");
+}
+
+static gchar *
+string_truncate (const gchar *text)
+{
+    return g_paste_string_truncate (text, 4096);
+}
+
+static gchar *
+utf8_truncate (const gchar *text)
+{
+    return g_utf8_substring (text, 0, MIN (g_utf8_strlen (text, -1), 4096));
+}
+
+static gchar *
+string_replace_home (const gchar *text)
+{
+    return g_paste_string_replace (text, "/home/user", "~");
+}
+
+static gchar *
+regex_replace_home (const gchar *text)
+{
+    return regex_replace (text, "/home/user", "~");
+}
+
+typedef gchar *(*Transform) (const gchar *text);
+
+static gboolean
+check (const gchar *name,
+       Transform    transform,
+       Transform    reference,
+       const gchar *text)
+{
+    gint64 start = g_get_monotonic_time ();
+    g_autofree gchar *result = transform (text);
+    gint64 middle = g_get_monotonic_time ();
+    g_autofree gchar *expected = reference (text);
+    gint64 end = g_get_monotonic_time ();
+
+    if (g_strcmp0 (result, expected))
+    {
+        g_printerr ("%s: unexpected result\n", name);
+        return FALSE;
+    }
+
+    g_print ("%-10s %8" G_GINT64_FORMAT "us (GRegex: %8" G_GINT64_FORMAT "us)\n", name, middle - start, end - middle);
+
+    return TRUE;
+}
+
+static gchar *
+make_text (gsize length)
+{
+    const gchar *chunks[] = { "some text ", "a > b && c\n", "/home/user/file\n", "&amp; &gt;", "\n\n", "caf\xc3\xa9 \xe2\x80\xa6 " };
+    GString *text = g_string_sized_new (length);
+
+    for (guint64 i = 0; text->len < length; ++i)
+        g_string_append (text, chunks[(i * 7) % G_N_ELEMENTS (chunks)]);
+
+    return g_string_free (text, FALSE);
+}
+
+gint
+main (gint argc    G_GNUC_UNUSED,
+      gchar *argv[] G_GNUC_UNUSED)
+{
+    const gchar *samples[] = { "", "&", ">", "&gt;", "&amp;gt;", "a\nb\n", "/home/user", "nothing to see here" };
+    g_autofree gchar *big = make_text (8 * 1024 * 1024);
+    g_autofree gchar *encoded = g_paste_string_xml_encode (big);
+    gboolean ok = TRUE;
+
+    for (guint64 i = 0; i < G_N_ELEMENTS (samples); ++i)
+    {
+        g_autofree gchar *encoded_sample = g_paste_string_xml_encode (samples[i]);
+        g_autofree gchar *decoded_sample = g_paste_string_xml_decode (encoded_sample);
+
+        if (g_strcmp0 (decoded_sample, samples[i]))
+        {
+            g_printerr ("xml round trip failed for \"%s\"\n", samples[i]);
+            ok = FALSE;
+        }
+    }
+
+    ok &= check ("encode", g_paste_string_xml_encode, regex_xml_encode, big);
+    ok &= check ("decode", g_paste_string_xml_decode, regex_xml_decode, encoded);
+    ok &= check ("flatten", g_paste_string_flatten, regex_flatten, big);
+    ok &= check ("replace", string_replace_home, regex_replace_home, big);
+    ok &= check ("truncate", string_truncate, utf8_truncate, big);
+
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}